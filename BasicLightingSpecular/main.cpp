@@ -4,6 +4,12 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "benchmark.h"
+#include "camera_block.h"
+#include "mesh_optimizer.h"
+#include "normal_matrix.h"
+#include "program_cache.h"
+#include "vertex_quantization.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
@@ -18,27 +24,28 @@ void processInput(GLFWwindow* window)
 
 const char* vertexShaderSource = //same for light
 "#version 330 core\n"
+CAMERA_BLOCK_GLSL
+VERTEX_DECODE_GLSL
 "layout(location = 0) in vec3 aPos;\n"
-"layout(location = 1) in vec3 aNormal;\n"
+"layout(location = 1) in vec4 aNormal;\n"
 "out vec3 FragPos;\n"
 "out vec3 Normal;\n"
 "uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
+"uniform mat3 normalMatrix;\n"
 "void main()\n"
 "{\n"
-"	FragPos = vec3(model * vec4(aPos, 1.0));\n"
-"	Normal = mat3(transpose(inverse(model))) * aNormal;\n"
-"	gl_Position = projection * view * vec4(FragPos, 1.0);\n"
+"	FragPos = vec3(model * vec4(decodePosition(aPos), 1.0));\n"
+"	Normal = normalMatrix * decodeNormal(aNormal);\n"
+"	gl_Position = viewProj * vec4(FragPos, 1.0);\n"
 "}\n";
 
 const char* fragmentShaderSource =
 "#version 330 core\n"
+CAMERA_BLOCK_GLSL
 "out vec4 FragColor;\n"
 "in vec3 Normal;\n"
 "in vec3 FragPos;\n"
 "uniform vec3 lightPos;\n"
-"uniform vec3 viewPos;\n"
 "uniform vec3 lightColor;\n"
 "uniform vec3 objectColor;\n"
 "void main()\n"
@@ -60,13 +67,13 @@ const char* fragmentShaderSource =
 
 const char* vertexShaderLightSource =
 "#version 330 core\n"
+CAMERA_BLOCK_GLSL
+VERTEX_DECODE_GLSL
 "layout(location = 0) in vec3 aPos;\n"
 "uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
 "void main()\n"
 "{\n"
-"	gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
+"	gl_Position = viewProj * model * vec4(decodePosition(aPos), 1.0);\n"
 "}\n";
 
 const char* fragmentShaderLightSource =
@@ -200,6 +207,11 @@ int mainDiffuse()
 	glDeleteShader(vertexShaderLight);
 	glDeleteShader(fragmentShaderLight);
 
+	// view and projection live in one buffer shared by both programs
+	unsigned int cameraBuffer = createCameraBuffer();
+	bindCameraBlock(shaderProgram);
+	bindCameraBlock(shaderProgramLight);
+
 	glUseProgram(shaderProgram); //Not sure what to do with this
 
 	//Buffer section
@@ -300,9 +312,8 @@ int mainDiffuse()
 		glUniform3fv(lightPosLocation, 1, glm::value_ptr(lightPos));
 
 		// camera/view transformation
-		GLuint viewMatrixLocation = glGetUniformLocation(shaderProgram, "view");
-		GLuint projectionMatrixLocation = glGetUniformLocation(shaderProgram, "projection");
 		GLuint modelMatrixLocation = glGetUniformLocation(shaderProgram, "model");
+		GLuint normalMatrixLocation = glGetUniformLocation(shaderProgram, "normalMatrix");
 
 
 		glm::mat4 view = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
@@ -312,14 +323,14 @@ int mainDiffuse()
 		view = glm::lookAt(glm::vec3(camX, 0.0f, camZ), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
 		glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+		updateCameraBuffer(cameraBuffer, view, projection, glm::vec3(camX, 0.0f, camZ), glfwGetTime());
 
 		glm::mat4 model = glm::mat4(1.0f);
 		float angle = 0.0f;
 		model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
 
-		glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
-		glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
 		glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(model));
+		glUniformMatrix3fv(normalMatrixLocation, 1, GL_FALSE, glm::value_ptr(normalMatrixOf(model))); // once per object, not per vertex
 
 		// render the cube
 		glBindVertexArray(VAO);
@@ -327,15 +338,11 @@ int mainDiffuse()
 
 		// also draw the lamp object
 		glUseProgram(shaderProgramLight);
-		projectionMatrixLocation = glGetUniformLocation(shaderProgramLight, "projection");
-		viewMatrixLocation = glGetUniformLocation(shaderProgramLight,"view");
 		modelMatrixLocation = glGetUniformLocation(shaderProgramLight, "model");
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, lightPos);
 		model = glm::scale(model, glm::vec3(0.2f)); // a smaller cube
 		
-		glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
-		glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
 		glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(model));
 
 		glBindVertexArray(lightVAO);
@@ -347,6 +354,7 @@ int mainDiffuse()
 
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &cameraBuffer);
 
 	glfwTerminate();
 	return 0;
@@ -376,53 +384,21 @@ int main()
 		return -1;
 	}
 
+	initBenchmark("BasicLightingSpecular");
+
 	glViewport(0, 0, 800, 600);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
 	//Shader section
-	unsigned int vertexShader = 0, vertexShaderLight = 0;
-	checkShaderError(
-		createAndCompileShader(vertexShaderSource, vertexShader, GL_VERTEX_SHADER),
-		vertexShader,
-		vertexShaderError
-	);
-
-	checkShaderError(
-		createAndCompileShader(vertexShaderLightSource, vertexShaderLight, GL_VERTEX_SHADER),
-		vertexShaderLight,
-		vertexShaderError
-	);
-
-	unsigned int fragmentShader = 0, fragmentShaderLight = 0;
-	checkShaderError(
-		createAndCompileShader(fragmentShaderSource, fragmentShader, GL_FRAGMENT_SHADER),
-		fragmentShader,
-		fragmentShaderError
-	);
-
-	checkShaderError(
-		createAndCompileShader(fragmentShaderLightSource, fragmentShaderLight, GL_FRAGMENT_SHADER),
-		fragmentShaderLight,
-		fragmentShaderError
-	);
-
 	unsigned int shaderProgram = 0, shaderProgramLight = 0;
-	checkShaderError(
-		createAndLinkShaderProgram(vertexShader, fragmentShader, shaderProgram),
-		shaderProgram,
-		shaderProgramError
-	);
-
-	checkShaderError(
-		createAndLinkShaderProgram(vertexShaderLight, fragmentShaderLight, shaderProgramLight),
-		shaderProgramLight,
-		shaderProgramError
-	);
+	createCachedShaderProgram(vertexShaderSource, fragmentShaderSource, shaderProgram);
+	createCachedShaderProgram(vertexShaderLightSource, fragmentShaderLightSource, shaderProgramLight);
+	printProgramCacheStats();
 
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
-	glDeleteShader(vertexShaderLight);
-	glDeleteShader(fragmentShaderLight);
+	// view and projection live in one buffer shared by both programs
+	unsigned int cameraBuffer = createCameraBuffer();
+	bindCameraBlock(shaderProgram);
+	bindCameraBlock(shaderProgramLight);
 
 	glUseProgram(shaderProgram); //Not sure what to do with this
 
@@ -471,21 +447,34 @@ int main()
 		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
 	};
 
-	unsigned int VBO, VAO;
+	// the 36 corners weld to 24 vertices, drawn with an index buffer in vertex cache order
+	IndexedMesh cube;
+	buildIndexedMesh(vertices, sizeof(vertices) / (6 * sizeof(float)), 6, cube);
+	printIndexedMeshStats("cube", cube);
+	GLenum cubeIndexType = cube.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	// and packed into the smallest formats that keep it exact enough, decoded by both programs
+	FloatVertexLayout cubeLayout = { 6, 0, 3, -1 };
+	QuantizedVertices cubeVertices;
+	quantizeVertices(cube.vertices.data(), cube.vertices.size() / 6, cubeLayout, defaultVertexTolerance, cubeVertices);
+	printQuantizedVertexStats("cube", cubeVertices, cubeLayout);
+	glUseProgram(shaderProgramLight);
+	setVertexDecodeUniforms(shaderProgramLight, cubeVertices);
+	glUseProgram(shaderProgram);
+	setVertexDecodeUniforms(shaderProgram, cubeVertices);
+
+	unsigned int VBO, VAO, EBO;
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
 
 	glBindVertexArray(VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, cubeVertices.data.size(), cubeVertices.data.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, cube.indices.size(), cube.indices.data(), GL_STATIC_DRAW);
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-		(void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-		(void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	setQuantizedAttributes(cubeVertices, 0, 1, -1);
 
 	unsigned int lightVAO;
 	glGenVertexArrays(1, &lightVAO);
@@ -493,8 +482,9 @@ int main()
 
 	// we only need to bind to the VBO (to link it with glVertexAttribPointer), no need to fill it; the VBO's data already contains all we need (it's already bound, but we do it again for educational purposes)
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
+	// the element buffer binding is part of the VAO, the lamp needs it as well
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	setQuantizedAttributes(cubeVertices, 0, -1, -1);
 
 	// lighting position
 	glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
@@ -502,9 +492,10 @@ int main()
 
 	while (!glfwWindowShouldClose(window))
 	{
+		beginBenchmarkFrame();
 		processInput(window);
 
-		float currentFrame = glfwGetTime();
+		float currentFrame = benchmarkTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
@@ -525,54 +516,53 @@ int main()
 		glUniform3fv(lightPosLocation, 1, glm::value_ptr(lightPos));
 
 		// camera/view transformation
-		GLuint viewMatrixLocation = glGetUniformLocation(shaderProgram, "view");
-		GLuint projectionMatrixLocation = glGetUniformLocation(shaderProgram, "projection");
 		GLuint modelMatrixLocation = glGetUniformLocation(shaderProgram, "model");
+		GLuint normalMatrixLocation = glGetUniformLocation(shaderProgram, "normalMatrix");
 
 
 		glm::mat4 view = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
 		float radius = 10.0f;
-		float camX = sin(glfwGetTime()) * radius;
-		float camZ = cos(glfwGetTime()) * radius;
+		float camX = sin(benchmarkTime()) * radius;
+		float camZ = cos(benchmarkTime()) * radius;
 		view = glm::lookAt(glm::vec3(camX, 0.0f, camZ), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
 		glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+		updateCameraBuffer(cameraBuffer, view, projection, glm::vec3(camX, 0.0f, camZ), benchmarkTime());
 
 		glm::mat4 model = glm::mat4(1.0f);
 		float angle = 0.0f;
 		model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
 
-		glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
-		glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
 		glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(model));
+		glUniformMatrix3fv(normalMatrixLocation, 1, GL_FALSE, glm::value_ptr(normalMatrixOf(model))); // once per object, not per vertex
 
 		// render the cube
 		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
+		glDrawElements(GL_TRIANGLES, (GLsizei)cube.indexCount, cubeIndexType, 0);
 
 		// also draw the lamp object
 		glUseProgram(shaderProgramLight);
-		projectionMatrixLocation = glGetUniformLocation(shaderProgramLight, "projection");
-		viewMatrixLocation = glGetUniformLocation(shaderProgramLight, "view");
 		modelMatrixLocation = glGetUniformLocation(shaderProgramLight, "model");
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, lightPos);
 		model = glm::scale(model, glm::vec3(0.2f)); // a smaller cube
 
-		glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
-		glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
 		glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(model));
 
 		glBindVertexArray(lightVAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
+		glDrawElements(GL_TRIANGLES, (GLsizei)cube.indexCount, cubeIndexType, 0);
 
 		glfwSwapBuffers(window);
+		endBenchmarkFrame(window);
 		glfwPollEvents();
 	}
 
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	glDeleteBuffers(1, &cameraBuffer);
 
+	finishBenchmark();
 	glfwTerminate();
 	return 0;
 
@@ -1,37 +1,80 @@
 #include<glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <cstdlib>
 #include <iostream>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include "benchmark.h"
+#include "camera_block.h"
+#include "cpu_profiler.h"
+#include "frustum_culling.h"
+#include "gl_state.h"
+#include "gpu_timer.h"
+#include "texture_cache.h"
+#include "texture_loader.h"
+#include "uniform_table.h"
+#include "vertex_layout.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	stateViewport(0, 0, width, height);
 }
 
 void processInput(GLFWwindow* window)
 {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
+	dumpCpuTraceOnKey(window, GLFW_KEY_F12);
 }
 
+struct CubeVertex
+{
+	glm::vec3 position;
+	glm::vec2 texCoord;
+};
+
+constexpr auto cubeVertexLayout = makeVertexLayout<CubeVertex>(
+	VERTEX_ATTRIBUTE(CubeVertex, position, 0),
+	VERTEX_ATTRIBUTE(CubeVertex, texCoord, 1));
+
+//A mat4 attribute takes four consecutive vec4 locations, advanced once per instance.
+struct CubeInstance
+{
+	glm::mat4 model;
+};
+
+constexpr auto cubeInstanceLayout = makeVertexLayout<CubeInstance>(
+	INSTANCE_ATTRIBUTE(CubeInstance, model, 2));
+
 const char* vertexShaderSource =
 "#version 330 core\n"
+CAMERA_BLOCK_GLSL
 "layout(location = 0) in vec3 aPos;\n"
 "layout(location = 1) in vec2 aTexCoord;\n"
 "out vec2 TexCoord;\n"
 "uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
 "void main()\n"
 "{\n"
-"	gl_Position = projection * view * model * vec4(aPos, 1.0f);\n"
+"	gl_Position = viewProj * model * vec4(aPos, 1.0f);\n"
 "	TexCoord = vec2(aTexCoord.x, aTexCoord.y);\n"
 "};\n";
 
+//Instanced variant: the model matrix comes from a per-instance attribute (locations 2-5)
+const char* instancedVertexShaderSource =
+"#version 330 core\n"
+CAMERA_BLOCK_GLSL
+"layout(location = 0) in vec3 aPos;\n"
+"layout(location = 1) in vec2 aTexCoord;\n"
+"layout(location = 2) in mat4 aModel;\n"
+"out vec2 TexCoord;\n"
+"void main()\n"
+"{\n"
+"	gl_Position = viewProj * aModel * vec4(aPos, 1.0f);\n"
+"	TexCoord = vec2(aTexCoord.x, aTexCoord.y);\n"
+"}\n";
+
 const char* fragmentShaderSource =
 "#version 330 core\n"
 "out vec4 FragColor;\n"
@@ -42,9 +85,58 @@ const char* fragmentShaderSource =
 "	FragColor = texture(inputTexture, TexCoord);\n"
 "}\n";
 
+// cube field settings, CUBE_COUNT, CUBE_INSTANCED, CUBE_CULLING and CUBE_ORBIT override them
+unsigned int cubeCount = 10;
+bool cubeInstanced = false;
+bool cubeCulling = true;
+float cubeOrbit = 0.0f;  // camera distance from the centre, 0 keeps the whole field in view
+const float cubeSpacing = 2.0f;
+
+void readCubeSettings()
+{
+	const char* count = getenv("CUBE_COUNT");
+	if (count && atoi(count) > 0)
+		cubeCount = (unsigned int)atoi(count);
+	const char* instanced = getenv("CUBE_INSTANCED");
+	if (instanced)
+		cubeInstanced = atoi(instanced) != 0;
+	const char* culling = getenv("CUBE_CULLING");
+	if (culling)
+		cubeCulling = atoi(culling) != 0;
+	const char* orbit = getenv("CUBE_ORBIT");
+	if (orbit && atof(orbit) > 0.0)
+		cubeOrbit = (float)atof(orbit);
+}
+
+//Cubes sit on a grid of side ceil(cbrt(count)) centred on the origin, each one rotated a bit more
+//than the previous. Used by both the per-cube loop and the instance buffer; the side is worked out
+//once per field, not per cube.
+unsigned int cubeFieldSide(unsigned int count)
+{
+	unsigned int side = 1;
+	while (side * side * side < count)
+		side++;
+	return side;
+}
+
+glm::mat4 cubeModelMatrix(unsigned int i, unsigned int side)
+{
+	float offset = (side - 1) * cubeSpacing * 0.5f;
+	glm::vec3 position(
+		(i % side) * cubeSpacing - offset,
+		((i / side) % side) * cubeSpacing - offset,
+		(i / (side * side)) * cubeSpacing - offset);
+
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+	float angle = 20.0f * i;
+	return glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+}
+
 int main()
 {
+	readCubeSettings();
 
+	initCpuProfiler();
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -65,44 +157,22 @@ int main()
 		return -1;
 	}
 
+	initBenchmark("Camera");
+	initTextureLoader();
+	initGpuTimer();
+
 	glViewport(0, 0, 800, 600);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-	//Begin texture
-	unsigned int texture;
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	// set the texture wrapping/filtering options (on currently bound texture)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load and generate the texture
-	int width, height, nrChannels;
-	unsigned char* data = stbi_load("./container.jpg", &width, &height,
-		&nrChannels, 0);
-
-	std::cout << "Width, height " << width << ", " << height << std::endl;
-
-	if (data)
-	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-			GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
-	{
-		std::cout << "Failed to load texture" << std::endl;
-	}
-
-	stbi_image_free(data);
-	//end texture
+	// shared with anything else using the same image, decoded on a worker thread
+	unsigned int texture = acquireTexture("./container.jpg");
 
 	//Shader section
 	unsigned int vertexShader;
 	vertexShader = glCreateShader(GL_VERTEX_SHADER);
 
-	glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+	const char* cubeVertexShaderSource = cubeInstanced ? instancedVertexShaderSource : vertexShaderSource;
+	glShaderSource(vertexShader, 1, &cubeVertexShaderSource, NULL);
 	glCompileShader(vertexShader);
 
 	int success;
@@ -139,98 +209,221 @@ int main()
 
 	//check error for linking and compilation
 
+	// view and projection come from the shared camera buffer
+	unsigned int cameraBuffer = createCameraBuffer();
+	bindCameraBlock(shaderProgram);
+
 	glUseProgram(shaderProgram); //Not sure what to do with this
 
 	//Buffer section
 	float vertices[] = {
-		// positions // colors // texture coords
-		0.5f, 0.5f, 0.0f, 1.0f, 1.0f, // top right
-		0.5f, -0.5f, 0.0f, 1.0f, 0.0f, // bottom right
-		-0.5f, -0.5f, 0.0f, 0.0f, 0.0f, // bottom left
-		-0.5f, 0.5f, 0.0f,  0.0f, 1.0f // top left
+		// positions // texture coords
+		-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+		 0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+		-0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+
+		-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		-0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+
+		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		-0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
+		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f
 	};
 
+	// bounding spheres of the cubes, tested against the view frustum every frame; only the visible ones are drawn
+	unsigned int fieldSide = cubeFieldSide(cubeCount);
+	CullSpheres cubeSpheres;
+	std::vector<unsigned int> visibleCubes(cubeCount);
+	for (unsigned int i = 0; i < cubeCount; i++)
+		addCullBox(cubeSpheres, cubeModelMatrix(i, fieldSide), glm::vec3(-0.5f), glm::vec3(0.5f));
+	CullPool* cullPool = createCullPool(readCullThreads());
 
-	unsigned int indices[] = {
-		0, 1, 3, // first triangle
-		1, 2, 3  // second triangle
-	};
-
-	unsigned int VBO, VAO, EBO;
+	unsigned int VBO, VAO, instanceVBO = 0;
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
 
 	glBindVertexArray(VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	uploadVertices(cubeVertexLayout, vertices, sizeof(vertices), readVertexStreams(), GL_STATIC_DRAW);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
-		(void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
-		(void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	// the cubes don't move; without culling the model matrices are uploaded once, with it the visible ones every frame
+	std::vector<glm::mat4> models, visibleModels;
+	if (cubeInstanced)
+	{
+		models.resize(cubeCount);
+		for (unsigned int i = 0; i < cubeCount; i++)
+			models[i] = cubeModelMatrix(i, fieldSide);
+		visibleModels.resize(cubeCulling ? cubeCount : 0);
+
+		glGenBuffers(1, &instanceVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		uploadVertices(cubeInstanceLayout, models.data(), models.size() * sizeof(glm::mat4), VERTEX_INTERLEAVED,
+			cubeCulling ? GL_STREAM_DRAW : GL_STATIC_DRAW);
+	}
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 
+	glEnable(GL_DEPTH_TEST);
+
+	// keep the whole field in view
+	float fieldExtent = fieldSide * cubeSpacing;
+	float radius = cubeOrbit > 0.0f ? cubeOrbit : glm::max(10.0f, fieldExtent * 1.5f);
+	float farPlane = glm::max(100.0f, radius + fieldExtent * 2.0f);
+
+	// uniform handles, resolved once so the loop doesn't look names up every frame
+	UniformTable uniforms;
+	reflectUniforms(shaderProgram, uniforms);
+	Uniform<glm::mat4> modelUniform = findUniform<glm::mat4>(uniforms, "model");
+
+	double startTime = glfwGetTime();
+	unsigned int frames = 0;
+	unsigned long long drawnTotal = 0;
+
+	// setup above talked to GL directly, start the state cache from scratch
+	resetStateCache();
+
+	unsigned int cubesScope = gpuScopeId("cubes");
+
 	while (!glfwWindowShouldClose(window))
 	{
+		beginBenchmarkFrame();
+		beginCpuZone("frame");
+		beginGpuFrame();
+		beginCpuZone("texture uploads");
+		pumpTextureUploads();
+		endCpuZone();
+		beginCpuZone("processInput");
 		processInput(window);
+		endCpuZone();
 
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// bind Texture
-		glBindTexture(GL_TEXTURE_2D, texture);
+		beginCpuZone("uniforms");
+		stateActiveTexture(GL_TEXTURE0);
+		stateBindTexture(GL_TEXTURE_2D, texture);
 
-		glUseProgram(shaderProgram);
+		stateUseProgram(shaderProgram);
 
 		// camera/view transformation
 		glm::mat4 view = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-		float radius = 10.0f;
-		float camX = sin(glfwGetTime()) * radius;
-		float camZ = cos(glfwGetTime()) * radius;
+		float camX = sin(benchmarkTime()) * radius;
+		float camZ = cos(benchmarkTime()) * radius;
 		view = glm::lookAt(glm::vec3(camX, 0.0f, camZ), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
-		glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 100.0f);
-		GLuint projectionMatrixLocation = glGetUniformLocation(shaderProgram, "projection");
-		glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
+		int width, height;
+		glfwGetFramebufferSize(window, &width, &height);
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, farPlane);
+		updateCameraBuffer(cameraBuffer, view, projection, glm::vec3(camX, 0.0f, camZ), benchmarkTime());
+		endCpuZone();
 
-		GLuint viewMatrixLocation = glGetUniformLocation(shaderProgram, "view");
-		glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
+		unsigned int drawnCubes = cubeCount;
+		if (cubeCulling)
+		{
+			CpuZone zone("culling");
+			drawnCubes = (unsigned int)cullSpheres(cullPool, frustumOf(projection * view), cubeSpheres, visibleCubes.data());
+			if (cubeInstanced)
+			{
+				// only the visible instances go to the GPU, into fresh storage so the last frame's draw isn't waited on
+				for (unsigned int i = 0; i < drawnCubes; i++)
+					visibleModels[i] = models[visibleCubes[i]];
+				stateBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+				glBufferData(GL_ARRAY_BUFFER, models.size() * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+				glBufferSubData(GL_ARRAY_BUFFER, 0, drawnCubes * sizeof(glm::mat4), visibleModels.data());
+			}
+		}
 
 		// render boxes
-		glBindVertexArray(VAO);
-		for (unsigned int i = 0; i < 10; i++)
+		beginCpuZone("draw");
+		beginGpuScope(cubesScope);
+		stateBindVertexArray(VAO);
+		if (cubeInstanced)
 		{
-			// calculate the model matrix for each object and pass it to shader before drawing
-			glm::mat4 model = glm::mat4(1.0f);
-			float angle = 20.0f * i;
-			model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-			
-			GLuint modelMatrixLocation = glGetUniformLocation(shaderProgram, "model");
-			glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(model));
-
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+			glDrawArraysInstanced(GL_TRIANGLES, 0, 36, drawnCubes);
 		}
+		else
+		{
+			for (unsigned int i = 0; i < drawnCubes; i++)
+			{
+				// calculate the model matrix for each object and pass it to shader before drawing
+				setUniform(modelUniform, cubeModelMatrix(cubeCulling ? visibleCubes[i] : i, fieldSide));
 
-		glBindVertexArray(VAO); //This isn't necessary
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+				glDrawArrays(GL_TRIANGLES, 0, 36);
+			}
+		}
+		endGpuScope(cubesScope);
+		endCpuZone();
 
+		endGpuFrame();
+		endStateFrame();
+		beginCpuZone("glfwSwapBuffers");
 		glfwSwapBuffers(window);
+		endCpuZone();
+		endBenchmarkFrame(window);
+		beginCpuZone("glfwPollEvents");
 		glfwPollEvents();
+		endCpuZone();
+		endCpuZone();
+		frames++;
+		drawnTotal += drawnCubes;
 	}
 
+	double elapsed = glfwGetTime() - startTime;
+	std::cout << cubeCount << (cubeInstanced ? " instanced" : " individually drawn") << " cubes, "
+		<< frames / elapsed << " fps, " << drawnTotal / elapsed << " cubes/s drawn";
+	if (cubeCulling)
+		std::cout << " of " << frames * (double)cubeCount / elapsed << " cubes/s tested";
+	std::cout << std::endl;
+
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
-
+	glDeleteBuffers(1, &instanceVBO);
+	glDeleteBuffers(1, &cameraBuffer);
+
+	if (cubeCulling)
+		printCullStats("cubes", cullPool);
+	destroyCullPool(cullPool);
+	printStateStats();
+	releaseTexture(texture);
+	finishTextureCache();
+	finishTextureLoader();
+	finishGpuTimer();
+	finishCpuProfiler();
+	finishBenchmark();
 	glfwTerminate();
 	return 0;
 
@@ -0,0 +1,199 @@
+#include "benchmark.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const int queryCount = 4;
+
+	struct Benchmark
+	{
+		bool enabled;
+		std::string name;
+		std::string output;
+		long long frames;      // measured frames requested
+		long long warmup;
+		double timestep;
+		long long frame;       // frames begun so far
+		bool inFrame;
+		std::chrono::steady_clock::time_point lastBegin;
+		std::vector<double> cpuMilliseconds;
+		std::vector<double> gpuMilliseconds;
+		unsigned int queries[queryCount];
+		long long queryFrame[queryCount];  // frame a query measures, -1 when free
+	};
+
+	Benchmark benchmark = {};
+
+	long long readInteger(const char* name, long long fallback)
+	{
+		const char* value = getenv(name);
+		return value ? atoll(value) : fallback;
+	}
+
+	bool measured(long long frame)
+	{
+		return frame >= benchmark.warmup && frame < benchmark.warmup + benchmark.frames;
+	}
+
+	void collectQuery(int slot)
+	{
+		if (benchmark.queryFrame[slot] < 0)
+			return;
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(benchmark.queries[slot], GL_QUERY_RESULT, &nanoseconds);
+		if (measured(benchmark.queryFrame[slot]))
+			benchmark.gpuMilliseconds.push_back(nanoseconds * 1e-6);
+		benchmark.queryFrame[slot] = -1;
+	}
+
+	double percentile(const std::vector<double>& sorted, double p)
+	{
+		if (sorted.empty())
+			return 0.0;
+		// nearest rank
+		size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.5);
+		rank = std::min(std::max(rank, (size_t)1), sorted.size());
+		return sorted[rank - 1];
+	}
+
+	void writeStatistics(FILE* file, const char* key, std::vector<double> values, bool last)
+	{
+		std::sort(values.begin(), values.end());
+		double sum = 0.0;
+		for (size_t i = 0; i < values.size(); i++)
+			sum += values[i];
+		fprintf(file, "  \"%s\": {\"samples\": %zu, \"mean\": %.6f, \"min\": %.6f, \"p50\": %.6f, \"p95\": %.6f, \"p99\": %.6f, \"max\": %.6f}%s\n",
+			key, values.size(), values.empty() ? 0.0 : sum / values.size(),
+			values.empty() ? 0.0 : values.front(), percentile(values, 50.0), percentile(values, 95.0),
+			percentile(values, 99.0), values.empty() ? 0.0 : values.back(), last ? "" : ",");
+	}
+
+	std::string escape(const char* text)
+	{
+		std::string result;
+		for (; text && *text; ++text)
+		{
+			if (*text == '"' || *text == '\\')
+				result += '\\';
+			result += *text;
+		}
+		return result;
+	}
+}
+
+void initBenchmark(const char* sampleName)
+{
+	benchmark.frames = readInteger("BENCHMARK_FRAMES", 0);
+	benchmark.enabled = benchmark.frames > 0;
+	if (!benchmark.enabled)
+		return;
+
+	benchmark.name = sampleName;
+	const char* output = getenv("BENCHMARK_OUTPUT");
+	benchmark.output = output ? output : "benchmark_" + benchmark.name + ".json";
+	benchmark.warmup = std::max(readInteger("BENCHMARK_WARMUP", 10), 0LL);
+	const char* timestep = getenv("BENCHMARK_TIMESTEP");
+	benchmark.timestep = timestep ? atof(timestep) : 1.0 / 60.0;
+	benchmark.cpuMilliseconds.reserve(benchmark.frames);
+	benchmark.gpuMilliseconds.reserve(benchmark.frames);
+
+	glGenQueries(queryCount, benchmark.queries);
+	for (int i = 0; i < queryCount; i++)
+		benchmark.queryFrame[i] = -1;
+}
+
+bool benchmarkEnabled()
+{
+	return benchmark.enabled;
+}
+
+double benchmarkTime()
+{
+	if (!benchmark.enabled)
+		return glfwGetTime();
+	// frame n shows the scene at n * timestep
+	return (benchmark.frame > 0 ? benchmark.frame - 1 : 0) * benchmark.timestep;
+}
+
+void beginBenchmarkFrame()
+{
+	if (!benchmark.enabled)
+		return;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (benchmark.frame > 0 && measured(benchmark.frame - 1))
+		benchmark.cpuMilliseconds.push_back(std::chrono::duration<double, std::milli>(now - benchmark.lastBegin).count());
+	benchmark.lastBegin = now;
+
+	// reuse the oldest query, its result is a few frames old and normally ready
+	int slot = (int)(benchmark.frame % queryCount);
+	collectQuery(slot);
+	glBeginQuery(GL_TIME_ELAPSED, benchmark.queries[slot]);
+	benchmark.queryFrame[slot] = benchmark.frame;
+	benchmark.inFrame = true;
+	benchmark.frame++;
+}
+
+void endBenchmarkFrame(GLFWwindow* window)
+{
+	if (!benchmark.enabled || !benchmark.inFrame)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	benchmark.inFrame = false;
+	// one extra frame so the last measured one gets its begin-to-begin CPU time
+	if (benchmark.frame > benchmark.warmup + benchmark.frames)
+		glfwSetWindowShouldClose(window, true);
+}
+
+void finishBenchmark()
+{
+	if (!benchmark.enabled)
+		return;
+
+	if (benchmark.inFrame)
+		glEndQuery(GL_TIME_ELAPSED);
+	for (int i = 0; i < queryCount; i++)
+		collectQuery((int)((benchmark.frame + i) % queryCount));
+	glDeleteQueries(queryCount, benchmark.queries);
+
+	FILE* file = fopen(benchmark.output.c_str(), "w");
+	if (!file)
+	{
+		std::cout << "Failed to write " << benchmark.output << std::endl;
+		return;
+	}
+	fprintf(file, "{\n");
+	fprintf(file, "  \"sample\": \"%s\",\n", escape(benchmark.name.c_str()).c_str());
+	fprintf(file, "  \"renderer\": \"%s\",\n", escape((const char*)glGetString(GL_RENDERER)).c_str());
+	fprintf(file, "  \"version\": \"%s\",\n", escape((const char*)glGetString(GL_VERSION)).c_str());
+	fprintf(file, "  \"frames\": %lld,\n", (long long)benchmark.cpuMilliseconds.size());
+	fprintf(file, "  \"warmup\": %lld,\n", benchmark.warmup);
+	fprintf(file, "  \"timestep\": %.9f,\n", benchmark.timestep);
+	writeStatistics(file, "cpu_ms", benchmark.cpuMilliseconds, false);
+	writeStatistics(file, "gpu_ms", benchmark.gpuMilliseconds, true);
+	fprintf(file, "}\n");
+	fclose(file);
+
+	std::cout << "Benchmark written to " << benchmark.output << std::endl;
+	benchmark.enabled = false;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+unsigned int readCount(const char* name, unsigned int fallback)
+{
+	const char* value = getenv(name);
+	return value && atoi(value) > 0 ? (unsigned int)atoi(value) : fallback;
+}
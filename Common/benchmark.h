@@ -0,0 +1,30 @@
+#pragma once
+#include <chrono>
+
+struct GLFWwindow;
+
+//Deterministic benchmark mode for the render loops, enabled by BENCHMARK_FRAMES=<n>.
+//The animation clock advances by a fixed BENCHMARK_TIMESTEP (default 1/60 s) per frame instead of
+//following the wall clock, the first BENCHMARK_WARMUP frames (default 10) are not measured, and after
+//n measured frames the window is closed. CPU frame time (begin to begin) and GPU time
+//(GL_TIME_ELAPSED, read back a few frames late) are written as JSON with p50/p95/p99 to
+//BENCHMARK_OUTPUT, default benchmark_<sample>.json.
+//
+//Without BENCHMARK_FRAMES everything is a pass-through and benchmarkTime() is glfwGetTime().
+
+//Call once the GL context is current.
+void initBenchmark(const char* sampleName);
+bool benchmarkEnabled();
+//Seconds since start; drives every animation so runs are reproducible.
+double benchmarkTime();
+//First thing in the render loop.
+void beginBenchmarkFrame();
+//Right after glfwSwapBuffers.
+void endBenchmarkFrame(GLFWwindow* window);
+//Before glfwTerminate, writes the report.
+void finishBenchmark();
+
+//Wall clock milliseconds since start, for the timings the benchmarks and loaders take themselves.
+double millisecondsSince(std::chrono::steady_clock::time_point start);
+//A positive count from the environment variable name, fallback when it is unset or not positive.
+unsigned int readCount(const char* name, unsigned int fallback);
@@ -0,0 +1,402 @@
+#include "block_compression.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace
+{
+	//Direction of largest variance of the points, by power iteration on their covariance.
+	template<typename Vec>
+	Vec principalAxis(const Vec* points, int count, const Vec& mean)
+	{
+		const int n = Vec::length();
+		float covariance[4][4] = {};
+		for (int i = 0; i < count; i++)
+		{
+			Vec d = points[i] - mean;
+			for (int r = 0; r < n; r++)
+				for (int c = 0; c < n; c++)
+					covariance[r][c] += d[r] * d[c];
+		}
+
+		Vec axis(1.0f);
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			Vec next(0.0f);
+			for (int r = 0; r < n; r++)
+				for (int c = 0; c < n; c++)
+					next[r] += covariance[r][c] * axis[c];
+			float length = glm::length(next);
+			if (length < 1e-6f)
+				break;
+			axis = next / length;
+		}
+		return axis;
+	}
+
+	//Endpoints at the extremes of the points along their principal axis.
+	template<typename Vec>
+	void axisEndpoints(const Vec* points, int count, Vec& first, Vec& second)
+	{
+		Vec mean(0.0f);
+		for (int i = 0; i < count; i++)
+			mean += points[i];
+		mean /= (float)count;
+		Vec axis = principalAxis(points, count, mean);
+
+		float low = 0.0f, high = 0.0f;
+		for (int i = 0; i < count; i++)
+		{
+			float t = glm::dot(points[i] - mean, axis);
+			low = std::min(low, t);
+			high = std::max(high, t);
+		}
+		first = glm::clamp(mean + axis * high, 0.0f, 255.0f);
+		second = glm::clamp(mean + axis * low, 0.0f, 255.0f);
+	}
+
+	//Least squares endpoints for fixed indices, weights[i] is how much of the first endpoint texel i takes.
+	template<typename Vec>
+	bool refineEndpoints(const Vec* points, const float* weights, int count, Vec& first, Vec& second)
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		Vec ax(0.0f), bx(0.0f);
+		for (int i = 0; i < count; i++)
+		{
+			float a = weights[i], b = 1.0f - weights[i];
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			ax += points[i] * a;
+			bx += points[i] * b;
+		}
+		float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f)
+			return false;
+		first = glm::clamp((ax * bb - bx * ab) / determinant, 0.0f, 255.0f);
+		second = glm::clamp((bx * aa - ax * ab) / determinant, 0.0f, 255.0f);
+		return true;
+	}
+
+	template<typename Vec>
+	float distance2(const Vec& a, const Vec& b)
+	{
+		Vec d = a - b;
+		return glm::dot(d, d);
+	}
+
+	//128 bit little endian bit stream
+	struct BitWriter
+	{
+		unsigned char* bytes;
+		int position;
+
+		void put(unsigned int value, int count)
+		{
+			for (int i = 0; i < count; i++, position++)
+				if (value & (1u << i))
+					bytes[position >> 3] |= (unsigned char)(1u << (position & 7));
+		}
+	};
+
+	// BC1 -------------------------------------------------------------------------------------------
+
+	unsigned short packRgb565(const glm::vec3& color)
+	{
+		int r = (int)(color.r * 31.0f / 255.0f + 0.5f);
+		int g = (int)(color.g * 63.0f / 255.0f + 0.5f);
+		int b = (int)(color.b * 31.0f / 255.0f + 0.5f);
+		return (unsigned short)(r << 11 | g << 5 | b);
+	}
+
+	glm::vec3 unpackRgb565(unsigned short packed)
+	{
+		int r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+		return glm::vec3((float)(r << 3 | r >> 2), (float)(g << 2 | g >> 4), (float)(b << 3 | b >> 2));
+	}
+
+	struct ColorBlock
+	{
+		unsigned short color0;
+		unsigned short color1;
+		unsigned char indices[16];
+		float error;
+	};
+
+	//Quantizes the endpoints and picks the nearest of the four palette colors for every texel.
+	ColorBlock fitColors(const glm::vec3* colors, const glm::vec3& first, const glm::vec3& second)
+	{
+		ColorBlock block;
+		block.color0 = packRgb565(first);
+		block.color1 = packRgb565(second);
+		// 4-color mode needs color0 > color1
+		if (block.color0 < block.color1)
+			std::swap(block.color0, block.color1);
+
+		glm::vec3 palette[4];
+		palette[0] = unpackRgb565(block.color0);
+		palette[1] = unpackRgb565(block.color1);
+		palette[2] = (palette[0] * 2.0f + palette[1]) / 3.0f;
+		palette[3] = (palette[0] + palette[1] * 2.0f) / 3.0f;
+
+		block.error = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			float bestError = distance2(colors[i], palette[0]);
+			for (int p = 1; p < 4 && block.color0 != block.color1; p++)
+			{
+				float error = distance2(colors[i], palette[p]);
+				if (error < bestError)
+				{
+					best = p;
+					bestError = error;
+				}
+			}
+			block.indices[i] = (unsigned char)best;
+			block.error += bestError;
+		}
+		return block;
+	}
+
+	void encodeColorBlock(const unsigned char* texels, unsigned char* output)
+	{
+		glm::vec3 colors[16];
+		for (int i = 0; i < 16; i++)
+			colors[i] = glm::vec3(texels[i * 4], texels[i * 4 + 1], texels[i * 4 + 2]);
+
+		glm::vec3 first, second;
+		axisEndpoints(colors, 16, first, second);
+		ColorBlock best = fitColors(colors, first, second);
+
+		// one least squares pass on the chosen indices, kept only if it helps
+		const float paletteWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float weights[16];
+		for (int i = 0; i < 16; i++)
+			weights[i] = paletteWeights[best.indices[i]];
+		if (refineEndpoints(colors, weights, 16, first, second))
+		{
+			ColorBlock refined = fitColors(colors, first, second);
+			if (refined.error < best.error)
+				best = refined;
+		}
+
+		unsigned int indexBits = 0;
+		for (int i = 0; i < 16; i++)
+			indexBits |= (unsigned int)best.indices[i] << (i * 2);
+		output[0] = (unsigned char)(best.color0 & 0xff);
+		output[1] = (unsigned char)(best.color0 >> 8);
+		output[2] = (unsigned char)(best.color1 & 0xff);
+		output[3] = (unsigned char)(best.color1 >> 8);
+		for (int i = 0; i < 4; i++)
+			output[4 + i] = (unsigned char)(indexBits >> (i * 8));
+	}
+
+	// BC3 alpha -------------------------------------------------------------------------------------
+
+	void encodeAlphaBlock(const unsigned char* texels, unsigned char* output)
+	{
+		int alpha0 = 0, alpha1 = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			alpha0 = std::max(alpha0, (int)texels[i * 4 + 3]);
+			alpha1 = std::min(alpha1, (int)texels[i * 4 + 3]);
+		}
+
+		// alpha0 > alpha1 selects the 8 value palette
+		float palette[8] = { (float)alpha0, (float)alpha1 };
+		for (int i = 2; i < 8; i++)
+			palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7.0f;
+
+		unsigned long long indexBits = 0;
+		for (int i = 0; i < 16 && alpha0 != alpha1; i++)
+		{
+			int best = 0;
+			for (int p = 1; p < 8; p++)
+				if (std::abs(texels[i * 4 + 3] - palette[p]) < std::abs(texels[i * 4 + 3] - palette[best]))
+					best = p;
+			indexBits |= (unsigned long long)best << (i * 3);
+		}
+		output[0] = (unsigned char)alpha0;
+		output[1] = (unsigned char)alpha1;
+		for (int i = 0; i < 6; i++)
+			output[2 + i] = (unsigned char)(indexBits >> (i * 8));
+	}
+
+	// BC7 mode 6 ------------------------------------------------------------------------------------
+
+	const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	//7 bit channels plus a p-bit shared by the endpoint, whichever p-bit reconstructs it better.
+	void quantizeBc7Endpoint(const glm::vec4& endpoint, int quantized[4], int& pBit)
+	{
+		float bestError = 1e30f;
+		for (int p = 0; p < 2; p++)
+		{
+			int candidate[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; c++)
+			{
+				candidate[c] = std::min(127, std::max(0, (int)((endpoint[c] - p) / 2.0f + 0.5f)));
+				float reconstructed = (float)(candidate[c] << 1 | p);
+				error += (reconstructed - endpoint[c]) * (reconstructed - endpoint[c]);
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				memcpy(quantized, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	struct Bc7Block
+	{
+		int endpoints[2][4];
+		int pBits[2];
+		unsigned char indices[16];
+		float error;
+	};
+
+	Bc7Block fitBc7(const glm::vec4* colors, const glm::vec4& first, const glm::vec4& second)
+	{
+		Bc7Block block;
+		quantizeBc7Endpoint(first, block.endpoints[0], block.pBits[0]);
+		quantizeBc7Endpoint(second, block.endpoints[1], block.pBits[1]);
+
+		glm::vec4 palette[16];
+		for (int p = 0; p < 16; p++)
+			for (int c = 0; c < 4; c++)
+			{
+				int e0 = block.endpoints[0][c] << 1 | block.pBits[0];
+				int e1 = block.endpoints[1][c] << 1 | block.pBits[1];
+				palette[p][c] = (float)(((64 - bc7Weights[p]) * e0 + bc7Weights[p] * e1 + 32) >> 6);
+			}
+
+		block.error = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			float bestError = distance2(colors[i], palette[0]);
+			for (int p = 1; p < 16; p++)
+			{
+				float error = distance2(colors[i], palette[p]);
+				if (error < bestError)
+				{
+					best = p;
+					bestError = error;
+				}
+			}
+			block.indices[i] = (unsigned char)best;
+			block.error += bestError;
+		}
+		return block;
+	}
+
+	void encodeBc7Block(const unsigned char* texels, unsigned char* output)
+	{
+		glm::vec4 colors[16];
+		for (int i = 0; i < 16; i++)
+			colors[i] = glm::vec4(texels[i * 4], texels[i * 4 + 1], texels[i * 4 + 2], texels[i * 4 + 3]);
+
+		glm::vec4 first, second;
+		axisEndpoints(colors, 16, first, second);
+		Bc7Block best = fitBc7(colors, first, second);
+
+		float weights[16];
+		for (int i = 0; i < 16; i++)
+			weights[i] = 1.0f - bc7Weights[best.indices[i]] / 64.0f;
+		if (refineEndpoints(colors, weights, 16, first, second))
+		{
+			Bc7Block refined = fitBc7(colors, first, second);
+			if (refined.error < best.error)
+				best = refined;
+		}
+
+		// the first texel's index has an implied 0 top bit, flip the block if it would need it
+		if (best.indices[0] & 8)
+		{
+			for (int c = 0; c < 4; c++)
+				std::swap(best.endpoints[0][c], best.endpoints[1][c]);
+			std::swap(best.pBits[0], best.pBits[1]);
+			for (int i = 0; i < 16; i++)
+				best.indices[i] = (unsigned char)(15 - best.indices[i]);
+		}
+
+		memset(output, 0, 16);
+		BitWriter writer = { output, 0 };
+		writer.put(1 << 6, 7);  // mode 6
+		for (int c = 0; c < 4; c++)
+		{
+			writer.put(best.endpoints[0][c], 7);
+			writer.put(best.endpoints[1][c], 7);
+		}
+		writer.put(best.pBits[0], 1);
+		writer.put(best.pBits[1], 1);
+		writer.put(best.indices[0], 3);
+		for (int i = 1; i < 16; i++)
+			writer.put(best.indices[i], 4);
+	}
+
+	void compressRows(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* output,
+		std::atomic<int>* nextRow)
+	{
+		int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		size_t bytes = blockBytes(format);
+		unsigned char texels[64];
+		for (int row = (*nextRow)++; row < blocksY; row = (*nextRow)++)
+			for (int column = 0; column < blocksX; column++)
+			{
+				for (int y = 0; y < 4; y++)
+					for (int x = 0; x < 4; x++)
+					{
+						int sourceX = std::min(column * 4 + x, width - 1);
+						int sourceY = std::min(row * 4 + y, height - 1);
+						memcpy(&texels[(y * 4 + x) * 4], &rgba[((size_t)sourceY * width + sourceX) * 4], 4);
+					}
+				compressBlock(format, texels, output + ((size_t)row * blocksX + column) * bytes);
+			}
+	}
+}
+
+size_t blockBytes(BlockFormat format)
+{
+	return format == BLOCK_BC1 ? 8 : 16;
+}
+
+size_t compressedLevelBytes(BlockFormat format, int width, int height)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+void compressBlock(BlockFormat format, const unsigned char* texels, unsigned char* block)
+{
+	switch (format)
+	{
+	case BLOCK_BC1:
+		encodeColorBlock(texels, block);
+		break;
+	case BLOCK_BC3:
+		encodeAlphaBlock(texels, block);
+		encodeColorBlock(texels, block + 8);
+		break;
+	case BLOCK_BC7:
+		encodeBc7Block(texels, block);
+		break;
+	}
+}
+
+void compressImage(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* output,
+	unsigned int threads)
+{
+	std::atomic<int> nextRow(0);
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threads; i++)
+		workers.push_back(std::thread(compressRows, format, rgba, width, height, output, &nextRow));
+	compressRows(format, rgba, width, height, output, &nextRow);
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+
+//CPU encoders for the BCn block formats, 4x4 RGBA8 texels in, one block out.
+//	BC1  RGB, 8 bytes per block: principal axis endpoints refined by least squares, 4-color mode
+//	BC3  RGBA, 16 bytes per block: BC1 color plus an 8-value interpolated alpha block
+//	BC7  RGBA, 16 bytes per block: mode 6 only (one subset, 7.7.7.7 endpoints with p-bits, 4-bit indices),
+//	     which is fast to encode and already well above BC1/BC3 quality, the partitioned modes aren't tried
+
+enum BlockFormat
+{
+	BLOCK_BC1,
+	BLOCK_BC3,
+	BLOCK_BC7
+};
+
+size_t blockBytes(BlockFormat format);
+//Bytes of a width x height level, partial blocks at the edges are padded by repeating the last texel.
+size_t compressedLevelBytes(BlockFormat format, int width, int height);
+
+//texels is a 4x4 block of RGBA8, row by row.
+void compressBlock(BlockFormat format, const unsigned char* texels, unsigned char* block);
+//rgba holds width x height RGBA8 texels; the rows of blocks are spread over threads.
+void compressImage(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* output,
+	unsigned int threads);
@@ -0,0 +1,36 @@
+#include "camera_block.h"
+#include <glad/glad.h>
+
+static_assert(sizeof(CameraBlock) == 3 * 64 + 16, "CameraBlock must match the std140 layout");
+
+unsigned int createCameraBuffer()
+{
+	unsigned int cameraBuffer;
+	glGenBuffers(1, &cameraBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, cameraBlockBinding, cameraBuffer);
+	return cameraBuffer;
+}
+
+void updateCameraBuffer(unsigned int cameraBuffer, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos, float time)
+{
+	CameraBlock block;
+	block.view = view;
+	block.projection = projection;
+	block.viewProj = projection * view;
+	block.viewPos = viewPos;
+	block.time = time;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void bindCameraBlock(unsigned int shaderProgram)
+{
+	unsigned int blockIndex = glGetUniformBlockIndex(shaderProgram, "Camera");
+	if (blockIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(shaderProgram, blockIndex, cameraBlockBinding);
+}
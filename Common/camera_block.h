@@ -0,0 +1,33 @@
+#pragma once
+#include <glm/glm.hpp>
+
+//Per-frame camera data shared by every program through one std140 uniform buffer.
+//Shaders paste CAMERA_BLOCK_GLSL after their #version line, the application updates the
+//buffer once per frame and calls bindCameraBlock once per program after linking.
+#define CAMERA_BLOCK_GLSL \
+"layout(std140) uniform Camera\n" \
+"{\n" \
+"	mat4 view;\n" \
+"	mat4 projection;\n" \
+"	mat4 viewProj;\n" \
+"	vec3 viewPos;\n" \
+"	float time;\n" \
+"};\n"
+
+const unsigned int cameraBlockBinding = 0;
+
+//Mirrors the std140 layout above: viewPos is padded to 16 bytes and time takes the last slot.
+struct CameraBlock
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProj;
+	glm::vec3 viewPos;
+	float time;
+};
+
+//Creates the buffer and binds it to cameraBlockBinding.
+unsigned int createCameraBuffer();
+void updateCameraBuffer(unsigned int cameraBuffer, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos, float time);
+//Points the program's Camera block at cameraBlockBinding, does nothing if the block isn't used.
+void bindCameraBlock(unsigned int shaderProgram);
@@ -0,0 +1,266 @@
+#include "cpu_profiler.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const unsigned int maxZoneDepth = 32;
+
+	struct ZoneEvent
+	{
+		const char* name;
+		long long begin;  // ns since initCpuProfiler
+		long long end;
+	};
+
+	//A ring entry; the owner stores and a dumping thread loads, so every field is atomic, relaxed, with
+	//the buffer's counters ordering them.
+	struct ZoneSlot
+	{
+		std::atomic<const char*> name;
+		std::atomic<long long> begin;
+		std::atomic<long long> end;
+	};
+
+	struct OpenZone
+	{
+		const char* name;
+		long long begin;
+	};
+
+	struct ThreadBuffer
+	{
+		unsigned int threadId;
+		std::unique_ptr<ZoneSlot[]> events;           // ring, size is a power of two
+		std::atomic<unsigned long long> written;       // zones ever recorded, only the owner stores
+		std::atomic<unsigned long long> claimed;       // written + 1 while a zone is being stored
+		OpenZone open[maxZoneDepth];
+		unsigned int depth;                            // may exceed maxZoneDepth, deeper zones aren't recorded
+	};
+
+	bool enabled = false;
+	const char* outputPath = NULL;
+	size_t ringSize = 65536;
+	std::chrono::steady_clock::time_point startTime;
+	std::mutex registryMutex;  // only taken the first time a thread records and when dumping
+	std::vector<ThreadBuffer*> buffers;
+	unsigned int generation = 0;  // bumped by finishCpuProfiler, which frees the buffers
+	thread_local ThreadBuffer* localBuffer = NULL;
+	thread_local unsigned int localGeneration = 0;
+	bool keyWasDown = false;
+
+	long long now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+	ThreadBuffer* threadBuffer()
+	{
+		if (localBuffer && localGeneration == generation)
+			return localBuffer;
+		// kept after the thread exits so its zones still end up in the trace
+		ThreadBuffer* buffer = new ThreadBuffer();
+		buffer->events.reset(new ZoneSlot[ringSize]);
+		buffer->written = 0;
+		buffer->claimed = 0;
+		buffer->depth = 0;
+		std::lock_guard<std::mutex> lock(registryMutex);
+		buffer->threadId = (unsigned int)buffers.size() + 1;
+		buffers.push_back(buffer);
+		localBuffer = buffer;
+		localGeneration = generation;
+		return buffer;
+	}
+
+	//Zones still in the ring of buffer, oldest first. A thread may keep recording while another one
+	//dumps; whatever it overwrote during the copy is discarded afterwards.
+	void snapshot(ThreadBuffer* buffer, std::vector<ZoneEvent>& events)
+	{
+		unsigned long long written = buffer->written.load(std::memory_order_acquire);
+		unsigned long long first = written > ringSize ? written - ringSize : 0;
+		events.clear();
+		for (unsigned long long i = first; i < written; i++)
+		{
+			const ZoneSlot& slot = buffer->events[i & (ringSize - 1)];
+			ZoneEvent event = { slot.name.load(std::memory_order_relaxed), slot.begin.load(std::memory_order_relaxed),
+				slot.end.load(std::memory_order_relaxed) };
+			events.push_back(event);
+		}
+
+		// a slot store seen above was claimed before it was made, so the claim shows up here
+		std::atomic_thread_fence(std::memory_order_acquire);
+		unsigned long long after = buffer->claimed.load(std::memory_order_relaxed);
+		if (after > ringSize && after - ringSize > first)
+			events.erase(events.begin(), events.begin() + (size_t)std::min<unsigned long long>(after - ringSize - first, events.size()));
+	}
+
+	void writeString(FILE* file, const char* text)
+	{
+		fputc('"', file);
+		for (const char* c = text; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				fputc('\\', file);
+			fputc(*c, file);
+		}
+		fputc('"', file);
+	}
+}
+
+void initCpuProfiler()
+{
+	outputPath = getenv("CPU_TRACE_OUTPUT");
+	if (!outputPath)
+		return;
+	const char* events = getenv("CPU_TRACE_EVENTS");
+	if (events && atoll(events) > 0)
+	{
+		ringSize = 1;
+		while (ringSize < (size_t)atoll(events))
+			ringSize <<= 1;
+	}
+	startTime = std::chrono::steady_clock::now();
+	enabled = true;
+}
+
+bool cpuProfilerEnabled()
+{
+	return enabled;
+}
+
+void beginCpuZone(const char* name)
+{
+	if (!enabled)
+		return;
+	ThreadBuffer* buffer = threadBuffer();
+	if (buffer->depth < maxZoneDepth)
+	{
+		buffer->open[buffer->depth].name = name;
+		buffer->open[buffer->depth].begin = now();
+	}
+	buffer->depth++;
+}
+
+void endCpuZone()
+{
+	if (!enabled)
+		return;
+	ThreadBuffer* buffer = threadBuffer();
+	if (buffer->depth == 0)
+	{
+		std::cout << "ERROR::CPU_PROFILER::UNBALANCED_ZONE" << std::endl;
+		return;
+	}
+	buffer->depth--;
+	if (buffer->depth >= maxZoneDepth)
+		return;
+
+	const OpenZone& zone = buffer->open[buffer->depth];
+	unsigned long long index = buffer->written.load(std::memory_order_relaxed);
+	buffer->claimed.store(index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	ZoneSlot& slot = buffer->events[index & (ringSize - 1)];
+	slot.name.store(zone.name, std::memory_order_relaxed);
+	slot.begin.store(zone.begin, std::memory_order_relaxed);
+	slot.end.store(now(), std::memory_order_relaxed);
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+bool dumpCpuTrace()
+{
+	if (!enabled)
+		return false;
+	FILE* file = fopen(outputPath, "w");
+	if (!file)
+	{
+		std::cout << "Failed to write " << outputPath << std::endl;
+		return false;
+	}
+
+	std::vector<ThreadBuffer*> threads;
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		threads = buffers;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	bool first = true;
+	std::vector<ZoneEvent> events;
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"thread %u\"}}",
+			first ? "" : ",\n", threads[t]->threadId, threads[t]->threadId);
+		first = false;
+
+		snapshot(threads[t], events);
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			fprintf(file, ",\n{\"name\": ");
+			writeString(file, events[i].name);
+			// complete events, timestamps in microseconds
+			fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+				threads[t]->threadId, events[i].begin * 1e-3, (events[i].end - events[i].begin) * 1e-3);
+		}
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
+
+void dumpCpuTraceOnKey(GLFWwindow* window, int key)
+{
+	if (!enabled)
+		return;
+	bool down = glfwGetKey(window, key) == GLFW_PRESS;
+	if (down && !keyWasDown && dumpCpuTrace())
+		std::cout << "CPU trace written to " << outputPath << std::endl;
+	keyWasDown = down;
+}
+
+void finishCpuProfiler()
+{
+	if (!enabled)
+		return;
+	dumpCpuTrace();
+
+	// per zone over every thread, in the order zones first appear
+	std::vector<std::string> names;
+	std::map<std::string, long long> calls;
+	std::map<std::string, double> totals;
+	std::vector<ZoneEvent> events;
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (size_t t = 0; t < buffers.size(); t++)
+	{
+		snapshot(buffers[t], events);
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			std::string name = events[i].name;
+			if (!calls.count(name))
+				names.push_back(name);
+			calls[name]++;
+			totals[name] += (events[i].end - events[i].begin) * 1e-6;
+		}
+	}
+
+	std::cout << "CPU zones (" << outputPath << "):" << std::endl;
+	for (size_t i = 0; i < names.size(); i++)
+		std::cout << "  " << names[i] << " " << calls[names[i]] << " calls, "
+			<< totals[names[i]] / calls[names[i]] << " ms" << std::endl;
+
+	for (size_t t = 0; t < buffers.size(); t++)
+		delete buffers[t];
+	buffers.clear();
+	// threads still holding a freed buffer find it stale and take a new one if profiling starts again
+	generation++;
+	enabled = false;
+}
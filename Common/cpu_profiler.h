@@ -0,0 +1,37 @@
+#pragma once
+
+struct GLFWwindow;
+
+//CPU timing zones for the hot paths of the render loop.
+//Every thread records into its own ring of CPU_TRACE_EVENTS (default 65536) completed zones; only the
+//owning thread writes to it, so recording takes no lock and costs two clock reads. Once a ring is full the
+//oldest zones are overwritten. Zones nest per thread. Entries are stored through relaxed atomics, so dumping
+//from one thread while others record is safe; zones overwritten during the copy are left out.
+//
+//Enabled by CPU_TRACE_OUTPUT=<path>: the zones are written there in Chrome trace_event format
+//(chrome://tracing, ui.perfetto.dev) on finish and whenever dumpCpuTrace() is called. Without it all
+//calls are no-ops.
+
+//Call once at startup, before any zone.
+void initCpuProfiler();
+bool cpuProfilerEnabled();
+//Names are kept by pointer, pass string literals.
+void beginCpuZone(const char* name);
+void endCpuZone();
+//Writes everything recorded so far, false if profiling is off or the file couldn't be written.
+bool dumpCpuTrace();
+//Dumps on the press (not while held) of key, e.g. GLFW_KEY_F12 from processInput.
+void dumpCpuTraceOnKey(GLFWwindow* window, int key);
+//Before exiting, writes the trace and prints calls and mean time per zone, then frees every thread's ring.
+//Threads other than the caller must be done recording: join worker pools (finishTextureLoader(),
+//destroyRasterPool(), destroyCullPool()) first.
+void finishCpuProfiler();
+
+//Zone for the rest of the enclosing block.
+struct CpuZone
+{
+	explicit CpuZone(const char* name) { beginCpuZone(name); }
+	~CpuZone() { endCpuZone(); }
+	CpuZone(const CpuZone&) = delete;
+	CpuZone& operator=(const CpuZone&) = delete;
+};
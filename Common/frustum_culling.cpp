@@ -0,0 +1,342 @@
+#include "frustum_culling.h"
+#include "benchmark.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLING_SSE 1
+#include <xmmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	enum CullPass
+	{
+		PASS_TEST,    // chunks into their own ranges of scratch
+		PASS_GATHER   // ranges moved together into visible
+	};
+}
+
+struct CullPool
+{
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	unsigned long long generation;
+	unsigned int busy;
+	bool quit;
+	std::atomic<size_t> nextChunk;
+
+	CullPass pass;
+	size_t chunks;
+	const Frustum* frustum;
+	const CullSpheres* spheres;
+	unsigned int* visible;
+	std::vector<unsigned int> scratch;
+	std::vector<size_t> chunkVisible;
+	std::vector<size_t> chunkOffsets;
+
+	unsigned long long frames;
+	size_t tested;
+	size_t lastVisible;
+	double lastMicroseconds;
+	double totalVisible;
+	double totalMicroseconds;
+	double maxMicroseconds;
+};
+
+namespace
+{
+	//Spheres [begin, end) into output, a batch at a time and the rest one by one; returns how many were written.
+	size_t testSpheres(const Frustum& frustum, const CullSpheres& spheres, size_t begin, size_t end, unsigned int* output)
+	{
+		size_t written = 0;
+		size_t batches = begin + (end - begin) / cullBatchSize * cullBatchSize;
+#if defined(__AVX__)
+		__m256 planes[6][4];
+		for (int p = 0; p < 6; p++)
+			for (int c = 0; c < 4; c++)
+				planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+		const __m256 zero = _mm256_setzero_ps();
+		for (size_t i = begin; i < batches; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(&spheres.x[i]), y = _mm256_loadu_ps(&spheres.y[i]);
+			__m256 z = _mm256_loadu_ps(&spheres.z[i]), radius = _mm256_loadu_ps(&spheres.radius[i]);
+			__m256 outside = zero;
+			for (int p = 0; p < 6; p++)
+			{
+				// distance + radius < 0: the whole sphere is behind the plane
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], x), _mm256_mul_ps(planes[p][1], y)),
+					_mm256_add_ps(_mm256_mul_ps(planes[p][2], z), _mm256_add_ps(planes[p][3], radius)));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero, _CMP_LT_OQ));
+			}
+			unsigned int inside = ~(unsigned int)_mm256_movemask_ps(outside);
+			// every lane is stored, only the inside ones advance; never writes past lane i of this chunk
+			for (unsigned int lane = 0; lane < 8; lane++)
+			{
+				output[written] = (unsigned int)(i + lane);
+				written += inside >> lane & 1;
+			}
+		}
+#elif defined(FRUSTUM_CULLING_SSE)
+		__m128 planes[6][4];
+		for (int p = 0; p < 6; p++)
+			for (int c = 0; c < 4; c++)
+				planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+		const __m128 zero = _mm_setzero_ps();
+		for (size_t i = begin; i < batches; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(&spheres.x[i]), y = _mm_loadu_ps(&spheres.y[i]);
+			__m128 z = _mm_loadu_ps(&spheres.z[i]), radius = _mm_loadu_ps(&spheres.radius[i]);
+			__m128 outside = zero;
+			for (int p = 0; p < 6; p++)
+			{
+				// distance + radius < 0: the whole sphere is behind the plane
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+					_mm_add_ps(_mm_mul_ps(planes[p][2], z), _mm_add_ps(planes[p][3], radius)));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+			}
+			unsigned int inside = ~(unsigned int)_mm_movemask_ps(outside);
+			// every lane is stored, only the inside ones advance; never writes past lane i of this chunk
+			output[written] = (unsigned int)i;
+			written += inside & 1;
+			output[written] = (unsigned int)(i + 1);
+			written += inside >> 1 & 1;
+			output[written] = (unsigned int)(i + 2);
+			written += inside >> 2 & 1;
+			output[written] = (unsigned int)(i + 3);
+			written += inside >> 3 & 1;
+		}
+#else
+		batches = begin;
+#endif
+		for (size_t i = batches; i < end; i++)
+		{
+			output[written] = (unsigned int)i;
+			written += sphereInFrustum(frustum, glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]);
+		}
+		return written;
+	}
+
+	void runChunks(CullPool* pool)
+	{
+		size_t count = pool->spheres->x.size();
+		for (size_t chunk = pool->nextChunk++; chunk < pool->chunks; chunk = pool->nextChunk++)
+		{
+			size_t begin = chunk * cullChunkSize;
+			if (pool->pass == PASS_TEST)
+				pool->chunkVisible[chunk] = testSpheres(*pool->frustum, *pool->spheres, begin,
+					std::min(begin + cullChunkSize, count), &pool->scratch[begin]);
+			else if (pool->chunkVisible[chunk])
+				memcpy(pool->visible + pool->chunkOffsets[chunk], &pool->scratch[begin],
+					pool->chunkVisible[chunk] * sizeof(unsigned int));
+		}
+	}
+
+	void workerLoop(CullPool* pool)
+	{
+		unsigned long long seen = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(pool->mutex);
+				pool->wake.wait(lock, [&] { return pool->quit || pool->generation != seen; });
+				if (pool->quit)
+					return;
+				seen = pool->generation;
+			}
+			runChunks(pool);
+			{
+				std::lock_guard<std::mutex> lock(pool->mutex);
+				if (--pool->busy == 0)
+					pool->done.notify_one();
+			}
+		}
+	}
+
+	//One pass over every chunk on all threads, returns once they are all done.
+	void runPass(CullPool* pool, CullPass pass)
+	{
+		pool->pass = pass;
+		pool->nextChunk = 0;
+		{
+			std::lock_guard<std::mutex> lock(pool->mutex);
+			pool->busy = (unsigned int)pool->workers.size();
+			pool->generation++;
+		}
+		pool->wake.notify_all();
+		runChunks(pool);
+		std::unique_lock<std::mutex> lock(pool->mutex);
+		pool->done.wait(lock, [&] { return pool->busy == 0; });
+	}
+}
+
+Frustum frustumOf(const glm::mat4& viewProjection)
+{
+	// glm is column major, row r is (m[0][r], m[1][r], m[2][r], m[3][r]); clip space is -w..w on every axis
+	glm::vec4 rows[4];
+	for (int r = 0; r < 4; r++)
+		rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0];
+	frustum.planes[1] = rows[3] - rows[0];
+	frustum.planes[2] = rows[3] + rows[1];
+	frustum.planes[3] = rows[3] - rows[1];
+	frustum.planes[4] = rows[3] + rows[2];
+	frustum.planes[5] = rows[3] - rows[2];
+	for (int p = 0; p < 6; p++)
+		frustum.planes[p] /= glm::length(glm::vec3(frustum.planes[p]));
+	return frustum;
+}
+
+bool sphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius)
+{
+	// summed in the order of the batched tests, so both agree on spheres touching a plane
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4& plane = frustum.planes[p];
+		if ((plane.x * center.x + plane.y * center.y) + (plane.z * center.z + (plane.w + radius)) < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+void clearCullSpheres(CullSpheres& spheres)
+{
+	spheres.x.clear();
+	spheres.y.clear();
+	spheres.z.clear();
+	spheres.radius.clear();
+}
+
+void addCullSphere(CullSpheres& spheres, const glm::vec3& center, float radius)
+{
+	spheres.x.push_back(center.x);
+	spheres.y.push_back(center.y);
+	spheres.z.push_back(center.z);
+	spheres.radius.push_back(radius);
+}
+
+void addCullBox(CullSpheres& spheres, const glm::mat4& transform, const glm::vec3& minimum, const glm::vec3& maximum)
+{
+	// the longest axis bounds how far any rotation and scale can stretch the half diagonal
+	float scale = std::max(std::max(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1]))),
+		glm::length(glm::vec3(transform[2])));
+	glm::vec3 center = glm::vec3(transform * glm::vec4(0.5f * (minimum + maximum), 1.0f));
+	addCullSphere(spheres, center, 0.5f * glm::length(maximum - minimum) * scale);
+}
+
+unsigned int readCullThreads()
+{
+	return readCount("CULL_THREADS", std::max(1u, std::thread::hardware_concurrency()));
+}
+
+CullPool* createCullPool(unsigned int threads)
+{
+	CullPool* pool = new CullPool();
+	pool->generation = 0;
+	pool->busy = 0;
+	pool->quit = false;
+	pool->nextChunk = 0;
+	pool->pass = PASS_TEST;
+	pool->chunks = 0;
+	pool->frustum = NULL;
+	pool->spheres = NULL;
+	pool->visible = NULL;
+	pool->frames = 0;
+	pool->tested = 0;
+	pool->lastVisible = 0;
+	pool->lastMicroseconds = 0.0;
+	pool->totalVisible = 0.0;
+	pool->totalMicroseconds = 0.0;
+	pool->maxMicroseconds = 0.0;
+	for (unsigned int i = 1; i < threads; i++)
+		pool->workers.push_back(std::thread(workerLoop, pool));
+	return pool;
+}
+
+void destroyCullPool(CullPool* pool)
+{
+	{
+		std::lock_guard<std::mutex> lock(pool->mutex);
+		pool->quit = true;
+	}
+	pool->wake.notify_all();
+	for (size_t i = 0; i < pool->workers.size(); i++)
+		pool->workers[i].join();
+	delete pool;
+}
+
+size_t cullSpheres(CullPool* pool, const Frustum& frustum, const CullSpheres& spheres, unsigned int* visible)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t objects = spheres.x.size();
+	size_t chunks = (objects + cullChunkSize - 1) / cullChunkSize;
+	size_t count = 0;
+	if (chunks <= 1 || pool->workers.empty())
+	{
+		// straight into visible, nothing to move together
+		count = testSpheres(frustum, spheres, 0, objects, visible);
+	}
+	else
+	{
+		pool->chunks = chunks;
+		pool->frustum = &frustum;
+		pool->spheres = &spheres;
+		pool->visible = visible;
+		if (pool->scratch.size() < objects)
+			pool->scratch.resize(objects);
+		pool->chunkVisible.resize(chunks);
+		pool->chunkOffsets.resize(chunks);
+		runPass(pool, PASS_TEST);
+		for (size_t chunk = 0; chunk < chunks; chunk++)
+		{
+			pool->chunkOffsets[chunk] = count;
+			count += pool->chunkVisible[chunk];
+		}
+		runPass(pool, PASS_GATHER);
+	}
+
+	double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	pool->frames++;
+	pool->tested = objects;
+	pool->lastVisible = count;
+	pool->lastMicroseconds = microseconds;
+	pool->totalVisible += (double)count;
+	pool->totalMicroseconds += microseconds;
+	pool->maxMicroseconds = std::max(pool->maxMicroseconds, microseconds);
+	return count;
+}
+
+CullStats getCullStats(const CullPool* pool)
+{
+	CullStats stats;
+	stats.frames = pool->frames;
+	stats.tested = pool->tested;
+	stats.visible = pool->lastVisible;
+	stats.microseconds = pool->lastMicroseconds;
+	stats.meanVisible = pool->frames ? pool->totalVisible / pool->frames : 0.0;
+	stats.meanMicroseconds = pool->frames ? pool->totalMicroseconds / pool->frames : 0.0;
+	stats.maxMicroseconds = pool->maxMicroseconds;
+	stats.threads = (unsigned int)pool->workers.size() + 1;
+	return stats;
+}
+
+void printCullStats(const char* name, const CullPool* pool)
+{
+	CullStats stats = getCullStats(pool);
+	std::cout << "Frustum culling " << name << ": " << stats.tested << " objects, " << stats.meanVisible << " visible and "
+		<< stats.tested - stats.meanVisible << " culled per frame on " << stats.threads << (stats.threads == 1 ? " thread" : " threads")
+		<< " (" << cullBatchSize << " wide), " << stats.meanMicroseconds << " us per frame mean, " << stats.maxMicroseconds
+		<< " us max" << std::endl;
+}
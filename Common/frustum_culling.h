@@ -0,0 +1,71 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+//CPU frustum culling of bounding spheres, so only what can be seen is submitted.
+//frustumOf() extracts the six planes from projection * view (Gribb and Hartmann), normalized so a plane's
+//distance is in world units. The spheres are kept as structure of arrays and tested a batch at a time
+//against all six planes: eight at once with AVX, four with SSE, one at a time without either. The indices
+//of the spheres that are at least partly inside are written out compacted, in ascending order, without a
+//branch per sphere.
+//
+//cullSpheres() splits the spheres into cullChunkSize chunks that the pool's threads take in turn, each
+//compacting into its own range; a second pass moves the ranges together, also on the pool. Scenes that fit
+//one chunk are culled on the calling thread alone.
+
+#if defined(__AVX__)
+const size_t cullBatchSize = 8;
+#else
+const size_t cullBatchSize = 4;
+#endif
+const size_t cullChunkSize = 16384;
+
+//Inside where dot(plane.xyz, point) + plane.w >= 0; left, right, bottom, top, near, far.
+struct Frustum
+{
+	glm::vec4 planes[6];
+};
+
+struct CullSpheres
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> radius;
+};
+
+struct CullStats
+{
+	unsigned long long frames;
+	size_t tested;                // last frame
+	size_t visible;
+	double microseconds;
+	double meanVisible;           // over all frames
+	double meanMicroseconds;
+	double maxMicroseconds;
+	unsigned int threads;
+};
+
+struct CullPool;
+
+Frustum frustumOf(const glm::mat4& viewProjection);
+//The scalar test, one sphere; also takes the spheres after the last whole batch.
+bool sphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius);
+
+void clearCullSpheres(CullSpheres& spheres);
+void addCullSphere(CullSpheres& spheres, const glm::vec3& center, float radius);
+//The sphere around a box in model space once transform is applied, scale included.
+void addCullBox(CullSpheres& spheres, const glm::mat4& transform, const glm::vec3& minimum, const glm::vec3& maximum);
+
+//CULL_THREADS, default the core count.
+unsigned int readCullThreads();
+//threads includes the calling thread, which culls chunks as well.
+CullPool* createCullPool(unsigned int threads);
+void destroyCullPool(CullPool* pool);
+//Writes the indices of the visible spheres to visible, which needs room for all of them, and returns how
+//many there are.
+size_t cullSpheres(CullPool* pool, const Frustum& frustum, const CullSpheres& spheres, unsigned int* visible);
+CullStats getCullStats(const CullPool* pool);
+//Objects, visible and culled per frame, microseconds per frame.
+void printCullStats(const char* name, const CullPool* pool);
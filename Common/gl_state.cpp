@@ -0,0 +1,234 @@
+#include "gl_state.h"
+#include <iostream>
+
+namespace
+{
+	const unsigned int unknown = 0xFFFFFFFFu;
+
+	struct StateCache
+	{
+		unsigned int program;
+		unsigned int vertexArray;
+		unsigned int arrayBuffer;
+		unsigned int elementBuffer;   // part of the VAO, forgotten when the VAO changes
+		unsigned int uniformBuffer;
+		unsigned int pixelUnpackBuffer;
+		unsigned int drawIndirectBuffer;
+		unsigned int activeTexture;
+		unsigned int textures[maxCachedTextureUnits];
+		unsigned int depthTest;
+		unsigned int blend;
+		unsigned int cullFace;
+		unsigned int depthFunc;
+		unsigned int blendSource;
+		unsigned int blendDestination;
+		int viewport[4];
+		bool viewportKnown;
+	};
+
+	StateCache cache;
+	GLStateStats frame = {};
+	GLStateStats totals = {};
+	unsigned int frames = 0;
+	bool initialized = false;
+
+	StateCache& state()
+	{
+		if (!initialized)
+			resetStateCache();
+		return cache;
+	}
+
+	// true when the call has to go to GL
+	bool update(unsigned int& shadow, unsigned int value)
+	{
+		if (shadow == value)
+		{
+			frame.elided++;
+			return false;
+		}
+		shadow = value;
+		frame.issued++;
+		return true;
+	}
+
+	unsigned int* capabilitySlot(GLenum capability)
+	{
+		switch (capability)
+		{
+		case GL_DEPTH_TEST: return &state().depthTest;
+		case GL_BLEND: return &state().blend;
+		case GL_CULL_FACE: return &state().cullFace;
+		default: return NULL;
+		}
+	}
+
+	unsigned int* bufferSlot(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_ARRAY_BUFFER: return &state().arrayBuffer;
+		case GL_ELEMENT_ARRAY_BUFFER: return &state().elementBuffer;
+		case GL_UNIFORM_BUFFER: return &state().uniformBuffer;
+		case GL_PIXEL_UNPACK_BUFFER: return &state().pixelUnpackBuffer;
+		case GL_DRAW_INDIRECT_BUFFER: return &state().drawIndirectBuffer;
+		default: return NULL;
+		}
+	}
+}
+
+void stateUseProgram(unsigned int program)
+{
+	if (update(state().program, program))
+		glUseProgram(program);
+}
+
+void stateBindVertexArray(unsigned int vertexArray)
+{
+	if (update(state().vertexArray, vertexArray))
+	{
+		glBindVertexArray(vertexArray);
+		cache.elementBuffer = unknown;
+	}
+}
+
+void stateBindBuffer(GLenum target, unsigned int buffer)
+{
+	unsigned int* slot = bufferSlot(target);
+	if (!slot)
+	{
+		frame.issued++;
+		glBindBuffer(target, buffer);
+	}
+	else if (update(*slot, buffer))
+		glBindBuffer(target, buffer);
+}
+
+void stateActiveTexture(GLenum unit)
+{
+	if (update(state().activeTexture, unit))
+		glActiveTexture(unit);
+}
+
+void stateBindTexture(GLenum target, unsigned int texture)
+{
+	// after resetStateCache the unit is selected once, else no binding would ever be cached
+	if (state().activeTexture == unknown)
+		stateActiveTexture(GL_TEXTURE0);
+	unsigned int unit = cache.activeTexture - GL_TEXTURE0;
+	if (target != GL_TEXTURE_2D || unit >= maxCachedTextureUnits)
+	{
+		frame.issued++;
+		glBindTexture(target, texture);
+	}
+	else if (update(cache.textures[unit], texture))
+		glBindTexture(target, texture);
+}
+
+void stateEnable(GLenum capability)
+{
+	unsigned int* slot = capabilitySlot(capability);
+	if (!slot)
+	{
+		frame.issued++;
+		glEnable(capability);
+	}
+	else if (update(*slot, GL_TRUE))
+		glEnable(capability);
+}
+
+void stateDisable(GLenum capability)
+{
+	unsigned int* slot = capabilitySlot(capability);
+	if (!slot)
+	{
+		frame.issued++;
+		glDisable(capability);
+	}
+	else if (update(*slot, GL_FALSE))
+		glDisable(capability);
+}
+
+void stateDepthFunc(GLenum func)
+{
+	if (update(state().depthFunc, func))
+		glDepthFunc(func);
+}
+
+void stateBlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+	StateCache& current = state();
+	if (current.blendSource == sourceFactor && current.blendDestination == destinationFactor)
+	{
+		frame.elided++;
+		return;
+	}
+	current.blendSource = sourceFactor;
+	current.blendDestination = destinationFactor;
+	frame.issued++;
+	glBlendFunc(sourceFactor, destinationFactor);
+}
+
+void stateViewport(int x, int y, int width, int height)
+{
+	StateCache& current = state();
+	if (current.viewportKnown && current.viewport[0] == x && current.viewport[1] == y &&
+		current.viewport[2] == width && current.viewport[3] == height)
+	{
+		frame.elided++;
+		return;
+	}
+	current.viewport[0] = x;
+	current.viewport[1] = y;
+	current.viewport[2] = width;
+	current.viewport[3] = height;
+	current.viewportKnown = true;
+	frame.issued++;
+	glViewport(x, y, width, height);
+}
+
+void resetStateCache()
+{
+	initialized = true;
+	cache.program = unknown;
+	cache.vertexArray = unknown;
+	cache.arrayBuffer = unknown;
+	cache.elementBuffer = unknown;
+	cache.uniformBuffer = unknown;
+	cache.pixelUnpackBuffer = unknown;
+	cache.drawIndirectBuffer = unknown;
+	cache.activeTexture = unknown;
+	for (unsigned int i = 0; i < maxCachedTextureUnits; ++i)
+		cache.textures[i] = unknown;
+	cache.depthTest = unknown;
+	cache.blend = unknown;
+	cache.cullFace = unknown;
+	cache.depthFunc = unknown;
+	cache.blendSource = unknown;
+	cache.blendDestination = unknown;
+	cache.viewportKnown = false;
+}
+
+GLStateStats endStateFrame()
+{
+	GLStateStats ended = frame;
+	totals.issued += frame.issued;
+	totals.elided += frame.elided;
+	frames++;
+	frame.issued = 0;
+	frame.elided = 0;
+	return ended;
+}
+
+GLStateStats getStateTotals(unsigned int& frameCount)
+{
+	frameCount = frames;
+	return totals;
+}
+
+void printStateStats()
+{
+	double perFrame = frames ? 1.0 / frames : 0.0;
+	std::cout << "GL state cache: " << totals.issued * perFrame << " calls issued, "
+		<< totals.elided * perFrame << " elided per frame over " << frames << " frames" << std::endl;
+}
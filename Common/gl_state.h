@@ -0,0 +1,36 @@
+#pragma once
+#include <glad/glad.h>
+
+//Shadow copy of the GL bindings the samples touch every frame. Each state* call compares
+//against the shadow and only reaches the driver when the value actually changes.
+//Anything changed behind its back (direct gl* calls) has to be followed by resetStateCache.
+
+struct GLStateStats
+{
+	unsigned int issued;   // calls forwarded to GL
+	unsigned int elided;   // calls skipped because nothing would change
+};
+
+const unsigned int maxCachedTextureUnits = 16;
+
+void stateUseProgram(unsigned int program);
+void stateBindVertexArray(unsigned int vertexArray);
+//GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_UNPACK_BUFFER and
+//GL_DRAW_INDIRECT_BUFFER are tracked, anything else is always forwarded
+void stateBindBuffer(GLenum target, unsigned int buffer);
+void stateActiveTexture(GLenum unit);
+//GL_TEXTURE_2D on the active unit; when that isn't known since resetStateCache, GL_TEXTURE0 is made active
+void stateBindTexture(GLenum target, unsigned int texture);
+void stateEnable(GLenum capability);
+void stateDisable(GLenum capability);
+void stateDepthFunc(GLenum func);
+void stateBlendFunc(GLenum sourceFactor, GLenum destinationFactor);
+void stateViewport(int x, int y, int width, int height);
+
+//Forget every shadowed value, the next call of each kind goes to GL.
+void resetStateCache();
+//Returns the counters of the frame that just ended and starts a new one.
+GLStateStats endStateFrame();
+//Totals since start, plus the number of frames ended.
+GLStateStats getStateTotals(unsigned int& frames);
+void printStateStats();
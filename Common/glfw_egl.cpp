@@ -0,0 +1,273 @@
+//Headless backend: implements the part of the GLFW API the samples use on top of an
+//EGL pbuffer, so every *_bin runs unchanged on machines without a display or a GPU
+//(Mesa llvmpipe through the surfaceless platform).
+//
+//Environment:
+//	HEADLESS_FRAMES   number of frames before glfwWindowShouldClose returns true (default 600)
+//	HEADLESS_DUMP     if set, the last frame is written there as a binary PPM on exit
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+struct GLFWwindow
+{
+	EGLSurface surface;
+	EGLContext context;
+	int width;
+	int height;
+	int shouldClose;
+	long long frame;
+	GLFWframebuffersizefun framebufferSizeCallback;
+	GLFWkeyfun keyCallback;
+};
+
+namespace
+{
+	EGLDisplay display = EGL_NO_DISPLAY;
+	GLFWwindow* current = NULL;
+	std::chrono::steady_clock::time_point startTime;
+	long long frameLimit = 600;
+	int contextMajor = 3;
+	int contextMinor = 3;
+	int contextProfile = GLFW_OPENGL_CORE_PROFILE;
+
+	EGLDisplay openDisplay()
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+		EGLDisplay result = EGL_NO_DISPLAY;
+		// surfaceless first: it never needs an X or Wayland server
+		if (getPlatformDisplay && clientExtensions && strstr(clientExtensions, "EGL_MESA_platform_surfaceless"))
+			result = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (result == EGL_NO_DISPLAY)
+			result = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		return result;
+	}
+
+	void writeFrame(GLFWwindow* window, const char* path)
+	{
+		typedef void (*ReadPixelsProc)(int, int, int, int, unsigned int, unsigned int, void*);
+		ReadPixelsProc readPixels = (ReadPixelsProc)eglGetProcAddress("glReadPixels");
+		if (!readPixels)
+			return;
+
+		std::vector<unsigned char> pixels(window->width * window->height * 3);
+		readPixels(0, 0, window->width, window->height, 0x1907 /*GL_RGB*/, 0x1401 /*GL_UNSIGNED_BYTE*/, pixels.data());
+
+		FILE* file = fopen(path, "wb");
+		if (!file)
+		{
+			std::cout << "Failed to write " << path << std::endl;
+			return;
+		}
+		fprintf(file, "P6\n%d %d\n255\n", window->width, window->height);
+		// GL rows are bottom-up
+		for (int y = window->height - 1; y >= 0; --y)
+			fwrite(&pixels[y * window->width * 3], 1, window->width * 3, file);
+		fclose(file);
+	}
+}
+
+int glfwInit(void)
+{
+	if (display != EGL_NO_DISPLAY)
+		return GLFW_TRUE;
+
+	display = openDisplay();
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		std::cout << "Failed to initialize EGL" << std::endl;
+		display = EGL_NO_DISPLAY;
+		return GLFW_FALSE;
+	}
+
+	const char* frames = getenv("HEADLESS_FRAMES");
+	if (frames)
+		frameLimit = atoll(frames);
+	startTime = std::chrono::steady_clock::now();
+	return GLFW_TRUE;
+}
+
+void glfwTerminate(void)
+{
+	if (display == EGL_NO_DISPLAY)
+		return;
+	if (current)
+		glfwDestroyWindow(current);
+	eglTerminate(display);
+	display = EGL_NO_DISPLAY;
+}
+
+void glfwWindowHint(int hint, int value)
+{
+	switch (hint)
+	{
+	case GLFW_CONTEXT_VERSION_MAJOR: contextMajor = value; break;
+	case GLFW_CONTEXT_VERSION_MINOR: contextMinor = value; break;
+	case GLFW_OPENGL_PROFILE: contextProfile = value; break;
+	default: break;
+	}
+}
+
+GLFWwindow* glfwCreateWindow(int width, int height, const char*, GLFWmonitor*, GLFWwindow* share)
+{
+	if (display == EGL_NO_DISPLAY)
+		return NULL;
+
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0)
+	{
+		std::cout << "Failed to find an EGL pbuffer config" << std::endl;
+		return NULL;
+	}
+
+	const EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+	EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+	if (surface == EGL_NO_SURFACE)
+	{
+		std::cout << "Failed to create EGL pbuffer" << std::endl;
+		return NULL;
+	}
+
+	eglBindAPI(EGL_OPENGL_API);
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, contextMajor,
+		EGL_CONTEXT_MINOR_VERSION, contextMinor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, contextProfile == GLFW_OPENGL_COMPAT_PROFILE ?
+			EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT : EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, config,
+		share ? share->context : EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT)
+	{
+		std::cout << "Failed to create EGL context" << std::endl;
+		eglDestroySurface(display, surface);
+		return NULL;
+	}
+
+	GLFWwindow* window = new GLFWwindow();
+	window->surface = surface;
+	window->context = context;
+	window->width = width;
+	window->height = height;
+	return window;
+}
+
+void glfwDestroyWindow(GLFWwindow* window)
+{
+	if (!window)
+		return;
+
+	const char* dumpPath = getenv("HEADLESS_DUMP");
+	if (dumpPath && window == current)
+		writeFrame(window, dumpPath);
+
+	if (window == current)
+	{
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		current = NULL;
+	}
+	eglDestroyContext(display, window->context);
+	eglDestroySurface(display, window->surface);
+	delete window;
+}
+
+void glfwMakeContextCurrent(GLFWwindow* window)
+{
+	if (window)
+		eglMakeCurrent(display, window->surface, window->surface, window->context);
+	else
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	current = window;
+}
+
+GLFWwindow* glfwGetCurrentContext(void)
+{
+	return current;
+}
+
+GLFWglproc glfwGetProcAddress(const char* procname)
+{
+	return (GLFWglproc)eglGetProcAddress(procname);
+}
+
+int glfwWindowShouldClose(GLFWwindow* window)
+{
+	return window->shouldClose || (frameLimit > 0 && window->frame >= frameLimit);
+}
+
+void glfwSetWindowShouldClose(GLFWwindow* window, int value)
+{
+	window->shouldClose = value;
+}
+
+void glfwGetFramebufferSize(GLFWwindow* window, int* width, int* height)
+{
+	if (width)
+		*width = window->width;
+	if (height)
+		*height = window->height;
+}
+
+GLFWframebuffersizefun glfwSetFramebufferSizeCallback(GLFWwindow* window, GLFWframebuffersizefun callback)
+{
+	GLFWframebuffersizefun previous = window->framebufferSizeCallback;
+	window->framebufferSizeCallback = callback;
+	return previous;
+}
+
+GLFWkeyfun glfwSetKeyCallback(GLFWwindow* window, GLFWkeyfun callback)
+{
+	GLFWkeyfun previous = window->keyCallback;
+	window->keyCallback = callback;
+	return previous;
+}
+
+int glfwGetKey(GLFWwindow*, int)
+{
+	// no keyboard offscreen
+	return GLFW_RELEASE;
+}
+
+void glfwPollEvents(void)
+{
+}
+
+void glfwSwapBuffers(GLFWwindow* window)
+{
+	// swapping a pbuffer is a no-op, flush like a real swap would so frames don't pile up
+	typedef void (*FlushProc)(void);
+	static FlushProc flush = (FlushProc)eglGetProcAddress("glFlush");
+	if (flush)
+		flush();
+	eglSwapBuffers(display, window->surface);
+	++window->frame;
+}
+
+void glfwSwapInterval(int interval)
+{
+	eglSwapInterval(display, interval);
+}
+
+double glfwGetTime(void)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
@@ -0,0 +1,743 @@
+#include "gltf_loader.h"
+#include "gl_state.h"
+#include "json.h"
+#include "texture_loader.h"
+#include "vertex_layout.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const unsigned int glbMagic = 0x46546C67;      // "glTF"
+	const unsigned int glbJsonChunk = 0x4E4F534A;  // "JSON"
+	const unsigned int glbBinaryChunk = 0x004E4942; // "BIN\0"
+
+	struct Buffer
+	{
+		const unsigned char* data;
+		size_t size;
+		size_t uploadBegin;   // range the accessors use, uploaded
+		size_t uploadEnd;
+		unsigned int buffer;
+	};
+
+	struct View
+	{
+		size_t buffer;
+		size_t offset;
+		size_t length;
+		size_t stride;        // 0 for tightly packed
+	};
+
+	struct Accessor
+	{
+		size_t buffer;
+		size_t offset;        // bytes into the buffer
+		size_t stride;        // bytes between elements, never 0
+		GLenum type;
+		int components;
+		bool normalized;
+		size_t count;
+	};
+
+	//A primitive between reading the accessors and uploading the buffers they point into.
+	struct PendingPrimitive
+	{
+		Accessor attributes[3];   // POSITION, NORMAL, TEXCOORD_0
+		bool hasAttribute[3];
+		Accessor indices;
+		bool indexed;
+	};
+
+	const char* attributeNames[3] = { "POSITION", "NORMAL", "TEXCOORD_0" };
+
+	unsigned int readUint(const unsigned char* bytes)
+	{
+		return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (unsigned int)bytes[3] << 24;
+	}
+
+	size_t componentSize(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE: return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT: return 2;
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT: return 4;
+		default: return 0;
+		}
+	}
+
+	int componentCount(const char* type)
+	{
+		if (strcmp(type, "SCALAR") == 0)
+			return 1;
+		if (strcmp(type, "VEC2") == 0)
+			return 2;
+		if (strcmp(type, "VEC3") == 0)
+			return 3;
+		if (strcmp(type, "VEC4") == 0)
+			return 4;
+		return 0; // matrices aren't vertex attributes here
+	}
+
+	//One component as the vertex shader sees it.
+	float readComponent(const unsigned char* bytes, GLenum type, bool normalized)
+	{
+		switch (type)
+		{
+		case GL_BYTE: { int8_t v; memcpy(&v, bytes, 1); return normalized ? std::max(v / 127.0f, -1.0f) : v; }
+		case GL_UNSIGNED_BYTE: return normalized ? bytes[0] / 255.0f : bytes[0];
+		case GL_SHORT: { int16_t v; memcpy(&v, bytes, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : v; }
+		case GL_UNSIGNED_SHORT: { uint16_t v; memcpy(&v, bytes, 2); return normalized ? v / 65535.0f : v; }
+		case GL_UNSIGNED_INT: { uint32_t v; memcpy(&v, bytes, 4); return (float)v; }
+		default: { float v; memcpy(&v, bytes, 4); return v; }
+		}
+	}
+
+	//accessor.min and max are stored like the data, so normalized integers need the same conversion.
+	float boundComponent(double value, GLenum type, bool normalized)
+	{
+		if (!normalized)
+			return (float)value;
+		switch (type)
+		{
+		case GL_BYTE: return std::max((float)value / 127.0f, -1.0f);
+		case GL_UNSIGNED_BYTE: return (float)value / 255.0f;
+		case GL_SHORT: return std::max((float)value / 32767.0f, -1.0f);
+		case GL_UNSIGNED_SHORT: return (float)value / 65535.0f;
+		default: return (float)value;
+		}
+	}
+
+	std::string directoryOf(const char* path)
+	{
+		std::string directory = path;
+		size_t slash = directory.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : directory.substr(0, slash + 1);
+	}
+
+	int hexDigit(char c)
+	{
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	//URIs are percent-encoded, "my%20model.bin" is a file name with a space.
+	std::string decodeUri(const char* uri)
+	{
+		std::string decoded;
+		for (const char* c = uri; *c; c++)
+		{
+			int high, low;
+			if (*c == '%' && (high = hexDigit(c[1])) >= 0 && (low = hexDigit(c[2])) >= 0)
+			{
+				decoded += (char)(high << 4 | low);
+				c += 2;
+			}
+			else
+				decoded += *c;
+		}
+		return decoded;
+	}
+
+	int base64Digit(char c)
+	{
+		if (c >= 'A' && c <= 'Z')
+			return c - 'A';
+		if (c >= 'a' && c <= 'z')
+			return c - 'a' + 26;
+		if (c >= '0' && c <= '9')
+			return c - '0' + 52;
+		if (c == '+' || c == '-')
+			return 62;
+		if (c == '/' || c == '_')
+			return 63;
+		return -1;
+	}
+
+	//"data:<mime>;base64,<data>"; false for other URIs and broken data.
+	bool decodeDataUri(const char* uri, std::vector<unsigned char>& bytes)
+	{
+		if (strncmp(uri, "data:", 5) != 0)
+			return false;
+		const char* data = strstr(uri, ";base64,");
+		if (!data)
+			return false;
+		data += 8;
+		bytes.clear();
+		bytes.reserve(strlen(data) / 4 * 3);
+		unsigned int bits = 0;
+		int count = 0;
+		for (const char* c = data; *c && *c != '='; c++)
+		{
+			int digit = base64Digit(*c);
+			if (digit < 0)
+				return false;
+			bits = bits << 6 | digit;
+			count += 6;
+			if (count >= 8)
+			{
+				count -= 8;
+				bytes.push_back((unsigned char)(bits >> count));
+			}
+		}
+		return true;
+	}
+
+	bool readAccessor(const JsonValue* accessors, int index, const std::vector<View>& views, const std::vector<Buffer>& buffers,
+		const char* path, Accessor& accessor)
+	{
+		const JsonValue* description = jsonItem(accessors, index < 0 ? jsonSize(accessors) : (size_t)index);
+		int view = jsonInt(jsonMember(description, "bufferView"), -1);
+		if (!description || jsonMember(description, "sparse") || view < 0 || (size_t)view >= views.size())
+		{
+			// accessors without a view are all zeros, not worth a buffer of their own
+			std::cout << "ERROR::GLTF::UNSUPPORTED_ACCESSOR " << index << " " << path << std::endl;
+			return false;
+		}
+		accessor.type = (GLenum)jsonInt(jsonMember(description, "componentType"), 0);
+		accessor.components = componentCount(jsonString(jsonMember(description, "type"), ""));
+		accessor.normalized = jsonBool(jsonMember(description, "normalized"), false);
+		size_t offset;
+		bool numbers = jsonUnsigned(jsonMember(description, "count"), 0, accessor.count) &&
+			jsonUnsigned(jsonMember(description, "byteOffset"), 0, offset);
+		size_t elementSize = componentSize(accessor.type) * accessor.components;
+
+		const View& source = views[view];
+		accessor.buffer = source.buffer;
+		accessor.stride = source.stride ? source.stride : elementSize;
+		// bounded before multiplying, so a huge count can't wrap around
+		bool inView = numbers && elementSize && accessor.stride >= elementSize && accessor.count &&
+			accessor.count <= source.length && offset <= source.length &&
+			offset + accessor.stride * (accessor.count - 1) + elementSize <= source.length;
+		if (!inView || source.offset > buffers[source.buffer].size || source.length > buffers[source.buffer].size - source.offset)
+		{
+			std::cout << "ERROR::GLTF::BAD_ACCESSOR " << index << " " << path << std::endl;
+			return false;
+		}
+		accessor.offset = source.offset + offset;
+		return true;
+	}
+
+	void useRange(Buffer& buffer, const Accessor& accessor)
+	{
+		size_t end = accessor.offset + accessor.stride * (accessor.count - 1) + componentSize(accessor.type) * accessor.components;
+		buffer.uploadBegin = std::min(buffer.uploadBegin, accessor.offset);
+		buffer.uploadEnd = std::max(buffer.uploadEnd, end);
+	}
+
+	//POSITION bounds from accessor.min and max, which glTF requires; files that leave them out are scanned.
+	void positionBounds(const JsonValue* accessors, int index, const Accessor& accessor, const Buffer& buffer,
+		glm::vec3& minimum, glm::vec3& maximum)
+	{
+		const JsonValue* description = jsonItem(accessors, (size_t)index);
+		const JsonValue* low = jsonMember(description, "min");
+		const JsonValue* high = jsonMember(description, "max");
+		if (jsonSize(low) >= 3 && jsonSize(high) >= 3)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				minimum[i] = boundComponent(jsonNumber(jsonItem(low, i), 0.0), accessor.type, accessor.normalized);
+				maximum[i] = boundComponent(jsonNumber(jsonItem(high, i), 0.0), accessor.type, accessor.normalized);
+			}
+			return;
+		}
+		size_t size = componentSize(accessor.type);
+		minimum = glm::vec3(std::numeric_limits<float>::max());
+		maximum = glm::vec3(-std::numeric_limits<float>::max());
+		for (size_t i = 0; i < accessor.count; i++)
+			for (int c = 0; c < 3; c++)
+			{
+				float value = readComponent(buffer.data + accessor.offset + i * accessor.stride + c * size, accessor.type,
+					accessor.normalized);
+				minimum[c] = std::min(minimum[c], value);
+				maximum[c] = std::max(maximum[c], value);
+			}
+	}
+
+	glm::mat4 nodeTransform(const JsonValue* node)
+	{
+		const JsonValue* matrix = jsonMember(node, "matrix");
+		if (jsonSize(matrix) == 16)
+		{
+			// column major, as glm stores it
+			float values[16];
+			for (size_t i = 0; i < 16; i++)
+				values[i] = (float)jsonNumber(jsonItem(matrix, i), 0.0);
+			return glm::make_mat4(values);
+		}
+		const JsonValue* translation = jsonMember(node, "translation");
+		const JsonValue* rotation = jsonMember(node, "rotation");
+		const JsonValue* scale = jsonMember(node, "scale");
+		glm::vec3 t(0.0f), s(1.0f);
+		for (size_t i = 0; i < 3; i++)
+		{
+			t[i] = (float)jsonNumber(jsonItem(translation, i), 0.0);
+			s[i] = (float)jsonNumber(jsonItem(scale, i), 1.0);
+		}
+		// stored x, y, z, w
+		glm::quat r((float)jsonNumber(jsonItem(rotation, 3), 1.0), (float)jsonNumber(jsonItem(rotation, 0), 0.0),
+			(float)jsonNumber(jsonItem(rotation, 1), 0.0), (float)jsonNumber(jsonItem(rotation, 2), 0.0));
+		return glm::translate(glm::mat4(1.0f), t) * glm::mat4_cast(r) * glm::scale(glm::mat4(1.0f), s);
+	}
+
+	//Appends a draw for every primitive of node and its children; meshPrimitives holds each mesh's first primitive
+	//and the end of its range, -1 for meshes that had none left.
+	void addNode(const JsonValue* nodes, size_t index, const glm::mat4& parent,
+		const std::vector<std::pair<size_t, size_t> >& meshPrimitives, size_t depth, GltfModel& model)
+	{
+		const JsonValue* node = jsonItem(nodes, index);
+		// nodes form trees, a cycle would recurse forever
+		if (!node || depth > jsonSize(nodes))
+			return;
+		glm::mat4 transform = parent * nodeTransform(node);
+		int mesh = jsonInt(jsonMember(node, "mesh"), -1);
+		if (mesh >= 0 && (size_t)mesh < meshPrimitives.size())
+			for (size_t i = meshPrimitives[mesh].first; i < meshPrimitives[mesh].second; i++)
+			{
+				GltfDraw draw = { i, transform };
+				model.draws.push_back(draw);
+			}
+		const JsonValue* children = jsonMember(node, "children");
+		for (size_t i = 0; i < jsonSize(children); i++)
+			addNode(nodes, (size_t)jsonInt(jsonItem(children, i), -1), transform, meshPrimitives, depth + 1, model);
+	}
+
+	//Requests the image once, however many materials use it.
+	unsigned int imageTexture(const JsonValue* root, int textureIndex, const std::vector<Buffer>& buffers,
+		const std::vector<View>& views, const std::string& directory, const char* path, std::vector<unsigned int>& imageTextures,
+		GltfModel& model)
+	{
+		const JsonValue* texture = jsonItem(jsonMember(root, "textures"), textureIndex < 0 ? (size_t)-1 : (size_t)textureIndex);
+		int image = jsonInt(jsonMember(texture, "source"), -1);
+		const JsonValue* description = jsonItem(jsonMember(root, "images"), image < 0 ? (size_t)-1 : (size_t)image);
+		if (!description)
+			return 0;
+		if (imageTextures[image])
+			return imageTextures[image];
+
+		std::string name = std::string(path) + " image " + std::to_string(image);
+		const char* uri = jsonString(jsonMember(description, "uri"), NULL);
+		int view = jsonInt(jsonMember(description, "bufferView"), -1);
+		unsigned int result = 0;
+		if (uri && strncmp(uri, "data:", 5) == 0)
+		{
+			model.decoded.push_back(std::vector<unsigned char>());
+			if (decodeDataUri(uri, model.decoded.back()))
+				result = requestTextureFromMemory(model.decoded.back().data(), model.decoded.back().size(), name.c_str());
+		}
+		else if (uri)
+			result = requestTexture((directory + decodeUri(uri)).c_str());
+		else if (view >= 0 && (size_t)view < views.size() && views[view].offset + views[view].length <= buffers[views[view].buffer].size)
+			result = requestTextureFromMemory(buffers[views[view].buffer].data + views[view].offset, views[view].length, name.c_str());
+		if (!result)
+			std::cout << "ERROR::GLTF::BAD_IMAGE " << name << std::endl;
+		else
+			model.textures.push_back(result);
+		imageTextures[image] = result;
+		return result;
+	}
+
+	//Phong terms for a metallic-roughness material: dielectrics reflect 4% white, metals their base color and
+	//have no diffuse. Shininess 2 / roughness^4 - 2 gives the highlight the width of the GGX lobe.
+	GltfMaterial phongMaterial(const glm::vec3& baseColor, float metallic, float roughness, unsigned int diffuseMap)
+	{
+		GltfMaterial material;
+		metallic = glm::clamp(metallic, 0.0f, 1.0f);
+		roughness = glm::clamp(roughness, 0.0f, 1.0f);
+		float alpha = roughness * roughness;
+		material.ambient = baseColor;
+		material.diffuse = baseColor * (1.0f - metallic);
+		material.specular = glm::mix(glm::vec3(0.04f), baseColor, metallic);
+		material.shininess = alpha > 0.0f ? glm::clamp(2.0f / (alpha * alpha) - 2.0f, 1.0f, 256.0f) : 256.0f;
+		material.diffuseMap = diffuseMap;
+		return material;
+	}
+
+	//The JSON and, for .glb, the binary chunk.
+	bool splitFile(const MappedFile& file, const char* path, const char*& json, size_t& jsonSize,
+		const unsigned char*& binary, size_t& binarySize)
+	{
+		binary = NULL;
+		binarySize = 0;
+		if (file.size < 4 || readUint(file.data) != glbMagic)
+		{
+			json = (const char*)file.data;
+			jsonSize = file.size;
+			return true;
+		}
+		if (file.size < 20 || readUint(file.data + 4) != 2 || readUint(file.data + 8) > file.size)
+		{
+			std::cout << "ERROR::GLTF::NOT_GLB " << path << std::endl;
+			return false;
+		}
+		size_t length = readUint(file.data + 8), at = 12;
+		json = NULL;
+		while (at + 8 <= length)
+		{
+			size_t chunkSize = readUint(file.data + at), chunkType = readUint(file.data + at + 4);
+			if (chunkSize > length - at - 8)
+				break;
+			if (chunkType == glbJsonChunk && !json)
+			{
+				json = (const char*)file.data + at + 8;
+				jsonSize = chunkSize;
+			}
+			else if (chunkType == glbBinaryChunk && !binary)
+			{
+				binary = file.data + at + 8;
+				binarySize = chunkSize;
+			}
+			// chunks are 4 byte aligned
+			at += 8 + ((chunkSize + 3) & ~(size_t)3);
+		}
+		if (!json)
+		{
+			std::cout << "ERROR::GLTF::NOT_GLB " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+}
+
+bool loadGltfModel(const char* path, GltfModel& model)
+{
+	Clock::time_point start = Clock::now();
+	model = GltfModel();
+	model.files.push_back(MappedFile());
+	if (!mapFile(path, model.files.back()))
+	{
+		std::cout << "ERROR::GLTF::READ_FAILED " << path << std::endl;
+		model.files.clear();
+		return false;
+	}
+
+	const char* text;
+	size_t textSize;
+	const unsigned char* binary;
+	size_t binarySize;
+	JsonValue document;
+	if (!splitFile(model.files.back(), path, text, textSize, binary, binarySize) || !parseJson(text, textSize, path, document))
+	{
+		destroyGltfModel(model);
+		return false;
+	}
+	const JsonValue* root = &document;
+	const char* version = jsonString(jsonMember(jsonMember(root, "asset"), "version"), "");
+	if (version[0] != '2')
+	{
+		std::cout << "ERROR::GLTF::UNSUPPORTED_VERSION " << version << " " << path << std::endl;
+		destroyGltfModel(model);
+		return false;
+	}
+	// quantized attributes need nothing but the formats GL reads anyway, everything else changes the meaning
+	const JsonValue* required = jsonMember(root, "extensionsRequired");
+	for (size_t i = 0; i < jsonSize(required); i++)
+	{
+		const char* extension = jsonString(jsonItem(required, i), "");
+		if (strcmp(extension, "KHR_mesh_quantization") != 0)
+		{
+			std::cout << "ERROR::GLTF::UNSUPPORTED_EXTENSION " << extension << " " << path << std::endl;
+			destroyGltfModel(model);
+			return false;
+		}
+	}
+
+	// buffers: the GLB chunk, data: URIs or files next to the model, mapped
+	std::string directory = directoryOf(path);
+	const JsonValue* bufferList = jsonMember(root, "buffers");
+	std::vector<Buffer> buffers(jsonSize(bufferList));
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		const JsonValue* description = jsonItem(bufferList, i);
+		const char* uri = jsonString(jsonMember(description, "uri"), NULL);
+		Buffer& buffer = buffers[i];
+		buffer.data = NULL;
+		buffer.size = 0;
+		buffer.uploadBegin = std::numeric_limits<size_t>::max();
+		buffer.uploadEnd = 0;
+		buffer.buffer = 0;
+		bool ok;
+		if (!uri)
+		{
+			ok = i == 0 && binary;
+			buffer.data = binary;
+			buffer.size = binarySize;
+		}
+		else if (strncmp(uri, "data:", 5) == 0)
+		{
+			model.decoded.push_back(std::vector<unsigned char>());
+			ok = decodeDataUri(uri, model.decoded.back());
+			buffer.data = model.decoded.back().data();
+			buffer.size = model.decoded.back().size();
+		}
+		else
+		{
+			model.files.push_back(MappedFile());
+			ok = mapFile((directory + decodeUri(uri)).c_str(), model.files.back());
+			buffer.data = model.files.back().data;
+			buffer.size = model.files.back().size;
+		}
+		size_t length;
+		if (!ok || !jsonUnsigned(jsonMember(description, "byteLength"), 0, length) || buffer.size < length)
+		{
+			std::cout << "ERROR::GLTF::BAD_BUFFER " << i << " " << path << std::endl;
+			destroyGltfModel(model);
+			return false;
+		}
+	}
+
+	const JsonValue* viewList = jsonMember(root, "bufferViews");
+	std::vector<View> views(jsonSize(viewList));
+	for (size_t i = 0; i < views.size(); i++)
+	{
+		const JsonValue* description = jsonItem(viewList, i);
+		int buffer = jsonInt(jsonMember(description, "buffer"), -1);
+		bool numbers = jsonUnsigned(jsonMember(description, "byteOffset"), 0, views[i].offset) &&
+			jsonUnsigned(jsonMember(description, "byteLength"), 0, views[i].length) &&
+			jsonUnsigned(jsonMember(description, "byteStride"), 0, views[i].stride);
+		// glTF allows strides of 4 to 252 bytes, 0 stands for tightly packed
+		if (buffer < 0 || (size_t)buffer >= buffers.size() || !numbers || views[i].stride > 252 ||
+			(views[i].stride && views[i].stride < 4))
+		{
+			std::cout << "ERROR::GLTF::BAD_BUFFER_VIEW " << i << " " << path << std::endl;
+			destroyGltfModel(model);
+			return false;
+		}
+		views[i].buffer = (size_t)buffer;
+	}
+
+	// accessors first, the buffers are uploaded once it is known which of their bytes are used
+	const JsonValue* materialList = jsonMember(root, "materials");
+	const JsonValue* accessors = jsonMember(root, "accessors");
+	const JsonValue* meshList = jsonMember(root, "meshes");
+	std::vector<std::pair<size_t, size_t> > meshPrimitives(jsonSize(meshList));
+	std::vector<PendingPrimitive> pending;
+	size_t skipped = 0;
+	for (size_t mesh = 0; mesh < meshPrimitives.size(); mesh++)
+	{
+		meshPrimitives[mesh].first = model.primitives.size();
+		const JsonValue* primitiveList = jsonMember(jsonItem(meshList, mesh), "primitives");
+		for (size_t i = 0; i < jsonSize(primitiveList); i++)
+		{
+			const JsonValue* description = jsonItem(primitiveList, i);
+			const JsonValue* attributes = jsonMember(description, "attributes");
+			PendingPrimitive primitive;
+			for (int a = 0; a < 3; a++)
+			{
+				int index = jsonInt(jsonMember(attributes, attributeNames[a]), -1);
+				primitive.hasAttribute[a] = index >= 0;
+				if (index >= 0 && !readAccessor(accessors, index, views, buffers, path, primitive.attributes[a]))
+				{
+					destroyGltfModel(model);
+					return false;
+				}
+			}
+			int indices = jsonInt(jsonMember(description, "indices"), -1);
+			primitive.indexed = indices >= 0;
+			if (primitive.indexed && (!readAccessor(accessors, indices, views, buffers, path, primitive.indices) ||
+				primitive.indices.components != 1 || primitive.indices.type == GL_BYTE || primitive.indices.type == GL_SHORT ||
+				primitive.indices.type == GL_FLOAT))
+			{
+				std::cout << "ERROR::GLTF::BAD_INDICES " << mesh << " " << path << std::endl;
+				destroyGltfModel(model);
+				return false;
+			}
+			if (!primitive.hasAttribute[0] || !primitive.hasAttribute[1] || primitive.attributes[0].components != 3 ||
+				jsonMember(description, "targets"))
+			{
+				skipped++;
+				continue;
+			}
+
+			GltfPrimitive drawn;
+			drawn.vertexArray = 0;
+			drawn.mode = (GLenum)jsonInt(jsonMember(description, "mode"), GL_TRIANGLES);
+			drawn.count = (GLsizei)(primitive.indexed ? primitive.indices.count : primitive.attributes[0].count);
+			drawn.indexType = primitive.indexed ? primitive.indices.type : 0;
+			drawn.indexOffset = 0;
+			int material = jsonInt(jsonMember(description, "material"), -1);
+			drawn.material = material >= 0 && (size_t)material < jsonSize(materialList) ? (size_t)material : (size_t)-1;
+			positionBounds(accessors, jsonInt(jsonMember(attributes, "POSITION"), -1), primitive.attributes[0],
+				buffers[primitive.attributes[0].buffer], drawn.minimum, drawn.maximum);
+			for (int a = 0; a < 3; a++)
+				if (primitive.hasAttribute[a])
+				{
+					useRange(buffers[primitive.attributes[a].buffer], primitive.attributes[a]);
+					if (primitive.attributes[a].type == GL_FLOAT)
+						model.floatAttributes++;
+					else
+						model.integerAttributes++;
+				}
+			if (primitive.indexed)
+				useRange(buffers[primitive.indices.buffer], primitive.indices);
+			model.vertices += primitive.attributes[0].count;
+			model.primitives.push_back(drawn);
+			pending.push_back(primitive);
+		}
+		meshPrimitives[mesh].second = model.primitives.size();
+	}
+	if (skipped)
+		std::cout << "glTF " << path << ": skipped " << skipped << " primitives without POSITION and NORMAL or with morph targets"
+			<< std::endl;
+
+	// requested only once nothing can fail anymore, a worker may already be reading an embedded image
+	std::vector<unsigned int> imageTextures(jsonSize(jsonMember(root, "images")), 0);
+	for (size_t i = 0; i < jsonSize(materialList); i++)
+	{
+		const JsonValue* pbr = jsonMember(jsonItem(materialList, i), "pbrMetallicRoughness");
+		const JsonValue* factor = jsonMember(pbr, "baseColorFactor");
+		glm::vec3 baseColor((float)jsonNumber(jsonItem(factor, 0), 1.0), (float)jsonNumber(jsonItem(factor, 1), 1.0),
+			(float)jsonNumber(jsonItem(factor, 2), 1.0));
+		int texture = jsonInt(jsonMember(jsonMember(pbr, "baseColorTexture"), "index"), -1);
+		unsigned int diffuseMap = texture >= 0 ? imageTexture(root, texture, buffers, views, directory, path, imageTextures, model) : 0;
+		model.materials.push_back(phongMaterial(baseColor, (float)jsonNumber(jsonMember(pbr, "metallicFactor"), 1.0),
+			(float)jsonNumber(jsonMember(pbr, "roughnessFactor"), 1.0), diffuseMap));
+	}
+
+	// the glTF default material, for primitives that name none
+	for (size_t i = 0; i < model.primitives.size(); i++)
+		if (model.primitives[i].material == (size_t)-1)
+		{
+			if (model.materials.size() == jsonSize(materialList))
+				model.materials.push_back(phongMaterial(glm::vec3(1.0f), 1.0f, 1.0f, 0));
+			model.primitives[i].material = model.materials.size() - 1;
+		}
+
+	// the used range of every buffer straight from the mapping, 16 byte aligned so every accessor keeps its alignment
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		Buffer& buffer = buffers[i];
+		if (buffer.uploadEnd == 0)
+			continue;
+		buffer.uploadBegin &= ~(size_t)15;
+		glGenBuffers(1, &buffer.buffer);
+		stateBindBuffer(GL_ARRAY_BUFFER, buffer.buffer);
+		glBufferData(GL_ARRAY_BUFFER, buffer.uploadEnd - buffer.uploadBegin, buffer.data + buffer.uploadBegin, GL_STATIC_DRAW);
+		model.buffers.push_back(buffer.buffer);
+		model.uploadedBytes += buffer.uploadEnd - buffer.uploadBegin;
+	}
+
+	// each attribute in its own format, from whichever buffer it is in
+	for (size_t i = 0; i < model.primitives.size(); i++)
+	{
+		GltfPrimitive& drawn = model.primitives[i];
+		const PendingPrimitive& primitive = pending[i];
+		glGenVertexArrays(1, &drawn.vertexArray);
+		stateBindVertexArray(drawn.vertexArray);
+		for (int a = 0; a < 3; a++)
+		{
+			if (!primitive.hasAttribute[a])
+				continue;
+			const Accessor& accessor = primitive.attributes[a];
+			const Buffer& buffer = buffers[accessor.buffer];
+			VertexAttribute attribute = { a, accessor.components, accessor.type, accessor.normalized, false, 1, 0,
+				componentSize(accessor.type) * accessor.components, 0 };
+			stateBindBuffer(GL_ARRAY_BUFFER, buffer.buffer);
+			setVertexAttributes(&attribute, 1, accessor.stride, accessor.offset - buffer.uploadBegin, 0);
+		}
+		if (primitive.indexed)
+		{
+			const Buffer& buffer = buffers[primitive.indices.buffer];
+			stateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.buffer);
+			drawn.indexOffset = primitive.indices.offset - buffer.uploadBegin;
+		}
+	}
+
+	const JsonValue* nodes = jsonMember(root, "nodes");
+	const JsonValue* scenes = jsonMember(root, "scenes");
+	const JsonValue* scene = jsonItem(scenes, (size_t)std::max(jsonInt(jsonMember(root, "scene"), 0), 0));
+	if (scene)
+	{
+		const JsonValue* roots = jsonMember(scene, "nodes");
+		for (size_t i = 0; i < jsonSize(roots); i++)
+			addNode(nodes, (size_t)jsonInt(jsonItem(roots, i), -1), glm::mat4(1.0f), meshPrimitives, 0, model);
+	}
+	else
+	{
+		// no scene, every node that isn't a child is a root
+		std::vector<bool> child(jsonSize(nodes), false);
+		for (size_t i = 0; i < child.size(); i++)
+		{
+			const JsonValue* children = jsonMember(jsonItem(nodes, i), "children");
+			for (size_t c = 0; c < jsonSize(children); c++)
+			{
+				int index = jsonInt(jsonItem(children, c), -1);
+				if (index >= 0 && (size_t)index < child.size())
+					child[index] = true;
+			}
+		}
+		for (size_t i = 0; i < child.size(); i++)
+			if (!child[i])
+				addNode(nodes, i, glm::mat4(1.0f), meshPrimitives, 0, model);
+	}
+
+	model.minimum = glm::vec3(std::numeric_limits<float>::max());
+	model.maximum = glm::vec3(-std::numeric_limits<float>::max());
+	for (size_t i = 0; i < model.draws.size(); i++)
+	{
+		const GltfPrimitive& primitive = model.primitives[model.draws[i].primitive];
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 local(corner & 1 ? primitive.maximum.x : primitive.minimum.x, corner & 2 ? primitive.maximum.y : primitive.minimum.y,
+				corner & 4 ? primitive.maximum.z : primitive.minimum.z);
+			glm::vec3 world = glm::vec3(model.draws[i].transform * glm::vec4(local, 1.0f));
+			model.minimum = glm::min(model.minimum, world);
+			model.maximum = glm::max(model.maximum, world);
+		}
+	}
+	if (model.draws.empty())
+		model.minimum = model.maximum = glm::vec3(0.0f);
+	model.loadMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	return true;
+}
+
+void drawGltfPrimitive(const GltfModel& model, size_t primitive)
+{
+	const GltfPrimitive& drawn = model.primitives[primitive];
+	stateBindVertexArray(drawn.vertexArray);
+	if (drawn.indexType)
+		glDrawElements(drawn.mode, drawn.count, drawn.indexType, (void*)drawn.indexOffset);
+	else
+		glDrawArrays(drawn.mode, 0, drawn.count);
+}
+
+void destroyGltfModel(GltfModel& model)
+{
+	for (size_t i = 0; i < model.textures.size(); i++)
+		deleteRequestedTexture(model.textures[i]);
+	for (size_t i = 0; i < model.primitives.size(); i++)
+		glDeleteVertexArrays(1, &model.primitives[i].vertexArray);
+	if (!model.buffers.empty())
+		glDeleteBuffers((GLsizei)model.buffers.size(), model.buffers.data());
+	for (size_t i = 0; i < model.files.size(); i++)
+		unmapFile(model.files[i]);
+	// deleted vertex arrays and buffers may still be in the state cache
+	resetStateCache();
+	model = GltfModel();
+}
+
+void printGltfModelStats(const char* name, const GltfModel& model)
+{
+	std::cout << "glTF " << name << ": " << model.primitives.size() << " primitives in " << model.draws.size() << " draws, "
+		<< model.vertices << " vertices, " << model.materials.size() << " materials, " << model.textures.size()
+		<< " textures; attributes " << model.integerAttributes << " integer, " << model.floatAttributes << " float; uploaded "
+		<< model.uploadedBytes / 1024 << " KiB from the mapping in " << model.loadMs << " ms" << std::endl;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+
+//glTF 2.0 models, .gltf with its buffers in .bin files (or data: URIs) next to it, and binary .glb. The buffers
+//are memory mapped and the byte range the primitives' accessors cover is handed to glBufferData straight from the
+//mapping, one GL buffer per glTF buffer that serves as vertex and index buffer at once. Every accessor becomes a
+//glVertexAttribPointer on that buffer in its own format: floats, normalized and plain integers as written by
+//KHR_mesh_quantization (whose dequantization lives in the node transforms) are all read by GL as they are, nothing
+//is unpacked to float on the CPU. Locations follow the samples' shaders: 0 POSITION, 1 NORMAL, 2 TEXCOORD_0.
+//
+//Metallic-roughness materials are mapped onto the samples' Phong Material (ambient, diffuse, specular, shininess):
+//the base color is the ambient color, diffuse for dielectrics and specular for metals, and roughness goes to a
+//shininess with the same highlight width. Base color textures are requested from texture_loader.h, images
+//embedded in the buffers or in data: URIs included, and decode on its workers while the model is drawn.
+//
+//Sparse accessors, morph targets and skins are not supported; primitives without POSITION or NORMAL are skipped.
+
+struct GltfMaterial
+{
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	float shininess;
+	unsigned int diffuseMap;   // base color texture from requestTexture(), 0 without
+};
+
+struct GltfPrimitive
+{
+	unsigned int vertexArray;
+	GLenum mode;               // GL_TRIANGLES etc., glTF uses the GL values
+	GLsizei count;             // indices, or vertices without an index accessor
+	GLenum indexType;          // 0 for glDrawArrays
+	size_t indexOffset;        // bytes into the buffer bound to the vertex array
+	size_t material;           // into GltfModel::materials, the glTF default material is added when needed
+	glm::vec3 minimum;         // POSITION bounds, in the mesh's space
+	glm::vec3 maximum;
+};
+
+//A primitive placed by a node of the scene.
+struct GltfDraw
+{
+	size_t primitive;
+	glm::mat4 transform;
+};
+
+struct GltfModel
+{
+	std::vector<MappedFile> files;                      // the .glb or .bin buffers, mapped while images load
+	std::vector<std::vector<unsigned char> > decoded;   // data: URIs
+	std::vector<unsigned int> buffers;
+	std::vector<unsigned int> textures;
+	std::vector<GltfMaterial> materials;
+	std::vector<GltfPrimitive> primitives;
+	std::vector<GltfDraw> draws;
+	glm::vec3 minimum;                                  // of the whole scene, transforms applied
+	glm::vec3 maximum;
+	size_t vertices;
+	size_t uploadedBytes;
+	size_t integerAttributes;                           // read from normalized or plain integers
+	size_t floatAttributes;
+	double loadMs;
+};
+
+//Loads the default scene (or the first) and uploads it; binds through gl_state. Fails with a message for files
+//that aren't glTF 2.0, missing buffers, accessors outside their buffer views and required extensions other than
+//KHR_mesh_quantization. Textures come from requestTexture(), initTextureLoader() has to run first.
+bool loadGltfModel(const char* path, GltfModel& model);
+//Binds the primitive's vertex array and draws it; material and transform are up to the caller.
+void drawGltfPrimitive(const GltfModel& model, size_t primitive);
+//Also while textures are still loading: deleteRequestedTexture() waits for workers reading embedded images
+//out of the mapped files before they are unmapped.
+void destroyGltfModel(GltfModel& model);
+void printGltfModelStats(const char* name, const GltfModel& model);
@@ -0,0 +1,237 @@
+#include "gpu_timer.h"
+#include <glad/glad.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+	struct ScopeSample
+	{
+		unsigned int scopeId;
+		unsigned int beginQuery;
+		unsigned int endQuery;
+	};
+
+	struct FrameSlot
+	{
+		long long frame;                    // -1 when nothing is pending
+		std::vector<unsigned int> queries;  // pool, grows to the busiest frame
+		unsigned int used;
+		std::vector<ScopeSample> samples;
+		std::vector<unsigned int> open;     // indices into samples still waiting for endGpuScope
+	};
+
+	bool enabled = false;
+	FILE* output = NULL;
+	long long frameIndex = 0;
+	long long droppedFrames = 0;
+	FrameSlot slots[gpuTimerLatency];
+	std::vector<std::string> scopeNames;
+	std::vector<double> scopeTotals;
+	std::vector<long long> scopeFrames;
+	long long latestFrame = -1;
+	std::vector<GpuScopeTime> latestScopes;
+
+	FrameSlot& currentSlot()
+	{
+		return slots[frameIndex % gpuTimerLatency];
+	}
+
+	unsigned int timestamp(FrameSlot& slot)
+	{
+		if (slot.used == slot.queries.size())
+		{
+			unsigned int query;
+			glGenQueries(1, &query);
+			slot.queries.push_back(query);
+		}
+		unsigned int query = slot.queries[slot.used++];
+		glQueryCounter(query, GL_TIMESTAMP);
+		return query;
+	}
+
+	//Scope names are the caller's, quote them so the line stays valid JSON.
+	void writeString(FILE* file, const char* text)
+	{
+		fputc('"', file);
+		for (const char* c = text; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				fputc('\\', file);
+			fputc(*c, file);
+		}
+		fputc('"', file);
+	}
+
+	bool available(const FrameSlot& slot)
+	{
+		if (slot.used == 0)
+			return true;
+		// queries complete in order, the last one is enough
+		GLint ready = 0;
+		glGetQueryObjectiv(slot.queries[slot.used - 1], GL_QUERY_RESULT_AVAILABLE, &ready);
+		return ready != 0;
+	}
+
+	void collect(FrameSlot& slot, bool wait)
+	{
+		if (slot.frame < 0)
+			return;
+		if (!wait && !available(slot))
+		{
+			droppedFrames++;
+			slot.frame = -1;
+			return;
+		}
+
+		std::vector<double> frameTimes(scopeNames.size(), 0.0);
+		std::vector<bool> seen(scopeNames.size(), false);
+		for (size_t i = 0; i < slot.samples.size(); i++)
+		{
+			const ScopeSample& sample = slot.samples[i];
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(sample.beginQuery, GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(sample.endQuery, GL_QUERY_RESULT, &end);
+			frameTimes[sample.scopeId] += (end - begin) * 1e-6;
+			seen[sample.scopeId] = true;
+		}
+
+		latestFrame = slot.frame;
+		latestScopes.clear();
+		for (size_t id = 0; id < scopeNames.size(); id++)
+		{
+			if (!seen[id])
+				continue;
+			GpuScopeTime time = { scopeNames[id], frameTimes[id] };
+			latestScopes.push_back(time);
+			scopeTotals[id] += frameTimes[id];
+			scopeFrames[id]++;
+		}
+
+		if (output)
+		{
+			fprintf(output, "{\"frame\": %lld, \"scopes\": {", slot.frame);
+			for (size_t i = 0; i < latestScopes.size(); i++)
+			{
+				fprintf(output, "%s", i ? ", " : "");
+				writeString(output, latestScopes[i].name.c_str());
+				fprintf(output, ": %.6f", latestScopes[i].milliseconds);
+			}
+			fprintf(output, "}}\n");
+		}
+		slot.frame = -1;
+	}
+}
+
+void initGpuTimer()
+{
+	const char* path = getenv("GPU_TIMING_OUTPUT");
+	if (!path)
+		return;
+	output = fopen(path, "w");
+	if (!output)
+	{
+		std::cout << "Failed to write " << path << std::endl;
+		return;
+	}
+	enabled = true;
+	for (unsigned int i = 0; i < gpuTimerLatency; i++)
+		slots[i].frame = -1;
+}
+
+bool gpuTimerEnabled()
+{
+	return enabled;
+}
+
+unsigned int gpuScopeId(const char* name)
+{
+	for (unsigned int i = 0; i < scopeNames.size(); i++)
+		if (scopeNames[i] == name)
+			return i;
+	scopeNames.push_back(name);
+	scopeTotals.push_back(0.0);
+	scopeFrames.push_back(0);
+	return (unsigned int)scopeNames.size() - 1;
+}
+
+void beginGpuFrame()
+{
+	if (!enabled)
+		return;
+	// the slot was last used gpuTimerLatency frames ago
+	FrameSlot& slot = currentSlot();
+	collect(slot, false);
+	slot.frame = frameIndex;
+	slot.used = 0;
+	slot.samples.clear();
+	slot.open.clear();
+}
+
+void beginGpuScope(unsigned int scopeId)
+{
+	if (!enabled)
+		return;
+	FrameSlot& slot = currentSlot();
+	ScopeSample sample = { scopeId, timestamp(slot), 0 };
+	slot.open.push_back((unsigned int)slot.samples.size());
+	slot.samples.push_back(sample);
+}
+
+void endGpuScope(unsigned int scopeId)
+{
+	if (!enabled)
+		return;
+	FrameSlot& slot = currentSlot();
+	if (slot.open.empty() || slot.samples[slot.open.back()].scopeId != scopeId)
+	{
+		std::cout << "ERROR::GPU_TIMER::UNBALANCED_SCOPE " << scopeNames[scopeId] << std::endl;
+		return;
+	}
+	slot.samples[slot.open.back()].endQuery = timestamp(slot);
+	slot.open.pop_back();
+}
+
+void endGpuFrame()
+{
+	if (!enabled)
+		return;
+	FrameSlot& slot = currentSlot();
+	// drop scopes left open, they have no end timestamp
+	while (!slot.open.empty())
+	{
+		slot.samples.erase(slot.samples.begin() + slot.open.back());
+		slot.open.pop_back();
+	}
+	frameIndex++;
+}
+
+bool latestGpuFrame(long long& frame, std::vector<GpuScopeTime>& scopes)
+{
+	if (latestFrame < 0)
+		return false;
+	frame = latestFrame;
+	scopes = latestScopes;
+	return true;
+}
+
+void finishGpuTimer()
+{
+	if (!enabled)
+		return;
+	for (unsigned int i = 0; i < gpuTimerLatency; i++)
+		collect(slots[(frameIndex + i) % gpuTimerLatency], true);
+	for (unsigned int i = 0; i < gpuTimerLatency; i++)
+		if (!slots[i].queries.empty())
+			glDeleteQueries((GLsizei)slots[i].queries.size(), slots[i].queries.data());
+
+	std::cout << "GPU timing (" << droppedFrames << " frames dropped):" << std::endl;
+	for (size_t id = 0; id < scopeNames.size(); id++)
+		if (scopeFrames[id])
+			std::cout << "  " << scopeNames[id] << " " << scopeTotals[id] / scopeFrames[id] << " ms" << std::endl;
+
+	fclose(output);
+	output = NULL;
+	enabled = false;
+}
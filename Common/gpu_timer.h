@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <vector>
+
+//Named GPU timing scopes backed by GL_TIMESTAMP queries.
+//Queries of a frame are read back gpuTimerLatency frames later, and only once the driver reports
+//them available, so reading never stalls the pipeline; frames whose results aren't ready by the time
+//their slot comes around again are dropped and counted. Scopes may nest.
+//
+//Enabled by GPU_TIMING_OUTPUT=<path>: every completed frame is appended to that file as one JSON
+//line, {"frame": n, "scopes": {"name": ms, ...}}. Without it all calls are no-ops.
+
+const unsigned int gpuTimerLatency = 4;
+
+struct GpuScopeTime
+{
+	std::string name;
+	double milliseconds;
+};
+
+//Call once the GL context is current.
+void initGpuTimer();
+bool gpuTimerEnabled();
+//Names are registered once, the returned id is what the render loop passes around.
+unsigned int gpuScopeId(const char* name);
+void beginGpuFrame();
+void beginGpuScope(unsigned int scopeId);
+void endGpuScope(unsigned int scopeId);
+void endGpuFrame();
+//Most recent frame whose results came back, false if none has yet.
+bool latestGpuFrame(long long& frame, std::vector<GpuScopeTime>& scopes);
+//Writes the remaining frames and prints the average time per scope.
+void finishGpuTimer();
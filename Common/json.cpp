@@ -0,0 +1,340 @@
+#include "json.h"
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+	// deeper nesting than any real file needs, keeps hostile input from running the stack out
+	const int maxDepth = 256;
+
+	struct Parser
+	{
+		const char* text;
+		const char* end;
+		const char* at;
+		const char* error;
+	};
+
+	bool fail(Parser& parser, const char* error)
+	{
+		if (!parser.error)
+			parser.error = error;
+		return false;
+	}
+
+	void skipSpace(Parser& parser)
+	{
+		while (parser.at < parser.end && (*parser.at == ' ' || *parser.at == '\t' || *parser.at == '\n' || *parser.at == '\r'))
+			parser.at++;
+	}
+
+	bool literal(Parser& parser, const char* word)
+	{
+		size_t length = strlen(word);
+		if ((size_t)(parser.end - parser.at) < length || memcmp(parser.at, word, length) != 0)
+			return fail(parser, "unknown literal");
+		parser.at += length;
+		return true;
+	}
+
+	int hexDigit(char c)
+	{
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	bool readHex4(Parser& parser, unsigned int& code)
+	{
+		if (parser.end - parser.at < 4)
+			return fail(parser, "cut short \\u escape");
+		code = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			int digit = hexDigit(*parser.at++);
+			if (digit < 0)
+				return fail(parser, "bad \\u escape");
+			code = code << 4 | digit;
+		}
+		return true;
+	}
+
+	void appendUtf8(std::string& string, unsigned int code)
+	{
+		if (code < 0x80)
+			string += (char)code;
+		else if (code < 0x800)
+		{
+			string += (char)(0xC0 | code >> 6);
+			string += (char)(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000)
+		{
+			string += (char)(0xE0 | code >> 12);
+			string += (char)(0x80 | (code >> 6 & 0x3F));
+			string += (char)(0x80 | (code & 0x3F));
+		}
+		else
+		{
+			string += (char)(0xF0 | code >> 18);
+			string += (char)(0x80 | (code >> 12 & 0x3F));
+			string += (char)(0x80 | (code >> 6 & 0x3F));
+			string += (char)(0x80 | (code & 0x3F));
+		}
+	}
+
+	bool parseString(Parser& parser, std::string& string)
+	{
+		parser.at++; // opening quote
+		for (;;)
+		{
+			// copy runs without escapes at once
+			const char* run = parser.at;
+			while (parser.at < parser.end && *parser.at != '"' && *parser.at != '\\' && (unsigned char)*parser.at >= 0x20)
+				parser.at++;
+			string.append(run, parser.at);
+			if (parser.at == parser.end)
+				return fail(parser, "unterminated string");
+			char c = *parser.at++;
+			if (c == '"')
+				return true;
+			if (c != '\\')
+				return fail(parser, "control character in string");
+			if (parser.at == parser.end)
+				return fail(parser, "unterminated string");
+			c = *parser.at++;
+			switch (c)
+			{
+			case '"': string += '"'; break;
+			case '\\': string += '\\'; break;
+			case '/': string += '/'; break;
+			case 'b': string += '\b'; break;
+			case 'f': string += '\f'; break;
+			case 'n': string += '\n'; break;
+			case 'r': string += '\r'; break;
+			case 't': string += '\t'; break;
+			case 'u':
+			{
+				unsigned int code;
+				if (!readHex4(parser, code))
+					return false;
+				// a surrogate pair is one code point
+				if (code >= 0xD800 && code < 0xDC00 && parser.end - parser.at >= 6 && parser.at[0] == '\\' && parser.at[1] == 'u')
+				{
+					parser.at += 2;
+					unsigned int low;
+					if (!readHex4(parser, low))
+						return false;
+					if (low < 0xDC00 || low >= 0xE000)
+						return fail(parser, "bad surrogate pair");
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+				appendUtf8(string, code);
+				break;
+			}
+			default:
+				return fail(parser, "unknown escape");
+			}
+		}
+	}
+
+	bool parseNumber(Parser& parser, double& number)
+	{
+		// strtod alone would also take hex, inf and nan, check the JSON grammar first
+		const char* c = parser.at;
+		if (c < parser.end && *c == '-')
+			c++;
+		if (c == parser.end || *c < '0' || *c > '9')
+			return fail(parser, "bad number");
+		const char* start = parser.at;
+		while (c < parser.end && ((*c >= '0' && *c <= '9') || *c == '.' || *c == 'e' || *c == 'E' || *c == '+' || *c == '-'))
+			c++;
+		// the text need not be terminated, copy the few characters of the number
+		char digits[64];
+		size_t length = c - start;
+		if (length >= sizeof(digits))
+			return fail(parser, "number too long");
+		memcpy(digits, start, length);
+		digits[length] = 0;
+		char* parsed;
+		number = strtod(digits, &parsed);
+		if (parsed != digits + length)
+			return fail(parser, "bad number");
+		parser.at = c;
+		return true;
+	}
+
+	bool parseValue(Parser& parser, JsonValue& value, int depth)
+	{
+		value.type = JSON_NULL;
+		value.boolean = false;
+		value.number = 0.0;
+		if (depth > maxDepth)
+			return fail(parser, "nested too deep");
+		skipSpace(parser);
+		if (parser.at == parser.end)
+			return fail(parser, "value expected");
+		switch (*parser.at)
+		{
+		case 'n':
+			return literal(parser, "null");
+		case 't':
+			value.type = JSON_BOOL;
+			value.boolean = true;
+			return literal(parser, "true");
+		case 'f':
+			value.type = JSON_BOOL;
+			return literal(parser, "false");
+		case '"':
+			value.type = JSON_STRING;
+			return parseString(parser, value.string);
+		case '[':
+			value.type = JSON_ARRAY;
+			parser.at++;
+			skipSpace(parser);
+			if (parser.at < parser.end && *parser.at == ']')
+			{
+				parser.at++;
+				return true;
+			}
+			for (;;)
+			{
+				value.items.push_back(std::unique_ptr<JsonValue>(new JsonValue()));
+				if (!parseValue(parser, *value.items.back(), depth + 1))
+					return false;
+				skipSpace(parser);
+				if (parser.at == parser.end)
+					return fail(parser, "unterminated array");
+				char c = *parser.at++;
+				if (c == ']')
+					return true;
+				if (c != ',')
+					return fail(parser, "',' or ']' expected");
+			}
+		case '{':
+			value.type = JSON_OBJECT;
+			parser.at++;
+			skipSpace(parser);
+			if (parser.at < parser.end && *parser.at == '}')
+			{
+				parser.at++;
+				return true;
+			}
+			for (;;)
+			{
+				skipSpace(parser);
+				if (parser.at == parser.end || *parser.at != '"')
+					return fail(parser, "member name expected");
+				value.members.push_back(std::make_pair(std::string(), std::unique_ptr<JsonValue>(new JsonValue())));
+				std::pair<std::string, std::unique_ptr<JsonValue> >& member = value.members.back();
+				if (!parseString(parser, member.first))
+					return false;
+				skipSpace(parser);
+				if (parser.at == parser.end || *parser.at != ':')
+					return fail(parser, "':' expected");
+				parser.at++;
+				if (!parseValue(parser, *member.second, depth + 1))
+					return false;
+				skipSpace(parser);
+				if (parser.at == parser.end)
+					return fail(parser, "unterminated object");
+				char c = *parser.at++;
+				if (c == '}')
+					return true;
+				if (c != ',')
+					return fail(parser, "',' or '}' expected");
+			}
+		default:
+			value.type = JSON_NUMBER;
+			return parseNumber(parser, value.number);
+		}
+	}
+}
+
+bool parseJson(const char* text, size_t size, const char* name, JsonValue& value)
+{
+	Parser parser = { text, text + size, text, NULL };
+	// a UTF-8 byte order mark is allowed in front
+	if (size >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0)
+		parser.at += 3;
+	value = JsonValue();
+	if (parseValue(parser, value, 0))
+	{
+		skipSpace(parser);
+		if (parser.at != parser.end)
+			fail(parser, "text after the value");
+	}
+	if (!parser.error)
+		return true;
+	size_t line = 1;
+	for (const char* c = text; c < parser.at && c < parser.end; c++)
+		line += *c == '\n';
+	std::cout << "ERROR::JSON::PARSE_FAILED " << name << " line " << line << ": " << parser.error << std::endl;
+	return false;
+}
+
+const JsonValue* jsonMember(const JsonValue* object, const char* name)
+{
+	if (!object || object->type != JSON_OBJECT)
+		return NULL;
+	for (size_t i = 0; i < object->members.size(); i++)
+		if (object->members[i].first == name)
+			return object->members[i].second.get();
+	return NULL;
+}
+
+const JsonValue* jsonItem(const JsonValue* array, size_t index)
+{
+	if (!array || array->type != JSON_ARRAY || index >= array->items.size())
+		return NULL;
+	return array->items[index].get();
+}
+
+size_t jsonSize(const JsonValue* array)
+{
+	return array && array->type == JSON_ARRAY ? array->items.size() : 0;
+}
+
+double jsonNumber(const JsonValue* value, double fallback)
+{
+	return value && value->type == JSON_NUMBER ? value->number : fallback;
+}
+
+int jsonInt(const JsonValue* value, int fallback)
+{
+	if (!value || value->type != JSON_NUMBER || value->number != std::floor(value->number) ||
+		value->number < INT_MIN || value->number > INT_MAX)
+		return fallback;
+	return (int)value->number;
+}
+
+bool jsonUnsigned(const JsonValue* value, size_t fallback, size_t& result)
+{
+	result = fallback;
+	if (!value)
+		return true;
+	// doubles stop being exact at 2^53; the size_t bound only matters on 32 bit
+	if (value->type != JSON_NUMBER || value->number != std::floor(value->number) || value->number < 0.0 ||
+		value->number >= 9007199254740992.0 || value->number >= (double)std::numeric_limits<size_t>::max())
+		return false;
+	result = (size_t)value->number;
+	return true;
+}
+
+bool jsonBool(const JsonValue* value, bool fallback)
+{
+	return value && value->type == JSON_BOOL ? value->boolean : fallback;
+}
+
+const char* jsonString(const JsonValue* value, const char* fallback)
+{
+	return value && value->type == JSON_STRING ? value->string.c_str() : fallback;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Small JSON reader for file formats that wrap their binary data in a JSON description (glTF). Parses the whole
+//text into a tree; numbers are doubles, \u escapes are decoded to UTF-8. The lookups below return NULL or the
+//fallback for missing members and members of the wrong type, so readers don't check every step.
+
+enum JsonType
+{
+	JSON_NULL,
+	JSON_BOOL,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT
+};
+
+struct JsonValue
+{
+	JsonType type;
+	bool boolean;
+	double number;
+	std::string string;
+	// children by pointer: a std::vector of the still incomplete JsonValue is undefined before C++17
+	std::vector<std::unique_ptr<JsonValue> > items;                              // JSON_ARRAY
+	std::vector<std::pair<std::string, std::unique_ptr<JsonValue> > > members;    // JSON_OBJECT, in file order
+};
+
+//Fails with a message naming the line for text that isn't a single JSON value.
+bool parseJson(const char* text, size_t size, const char* name, JsonValue& value);
+
+const JsonValue* jsonMember(const JsonValue* object, const char* name);
+//Element index of an array, NULL past the end.
+const JsonValue* jsonItem(const JsonValue* array, size_t index);
+size_t jsonSize(const JsonValue* array);
+double jsonNumber(const JsonValue* value, double fallback);
+//Whole numbers only; fractions and values beyond int give the fallback.
+int jsonInt(const JsonValue* value, int fallback);
+//Sizes and offsets: a missing value gives the fallback, anything but a whole number in [0, 2^53) fails.
+bool jsonUnsigned(const JsonValue* value, size_t fallback, size_t& result);
+bool jsonBool(const JsonValue* value, bool fallback);
+const char* jsonString(const JsonValue* value, const char* fallback);
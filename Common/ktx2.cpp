@@ -0,0 +1,264 @@
+#include "ktx2.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	const unsigned char identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	// identifier, header, index; the level index follows
+	const size_t headerBytes = 12 + 9 * 4 + 4 * 4 + 2 * 8;
+	const size_t levelIndexBytes = 3 * 8;
+
+	// VkFormat
+	const unsigned int VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+	const unsigned int VK_FORMAT_BC3_UNORM_BLOCK = 137;
+	const unsigned int VK_FORMAT_BC7_UNORM_BLOCK = 145;
+
+	// Khronos data format descriptor
+	const unsigned char KHR_DF_MODEL_BC1A = 128;
+	const unsigned char KHR_DF_MODEL_BC3 = 130;
+	const unsigned char KHR_DF_MODEL_BC7 = 134;
+	const unsigned char KHR_DF_PRIMARIES_BT709 = 1;
+	const unsigned char KHR_DF_TRANSFER_LINEAR = 1;
+	const unsigned char KHR_DF_CHANNEL_COLOR = 0;
+	const unsigned char KHR_DF_CHANNEL_ALPHA = 15;
+
+	unsigned int vkFormatOf(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BLOCK_BC1: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		case BLOCK_BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
+		default: return VK_FORMAT_BC7_UNORM_BLOCK;
+		}
+	}
+
+	unsigned char colorModelOf(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BLOCK_BC1: return KHR_DF_MODEL_BC1A;
+		case BLOCK_BC3: return KHR_DF_MODEL_BC3;
+		default: return KHR_DF_MODEL_BC7;
+		}
+	}
+
+	void put32(std::vector<unsigned char>& bytes, size_t offset, unsigned int value)
+	{
+		for (int i = 0; i < 4; i++)
+			bytes[offset + i] = (unsigned char)(value >> (i * 8));
+	}
+
+	void put64(std::vector<unsigned char>& bytes, size_t offset, unsigned long long value)
+	{
+		for (int i = 0; i < 8; i++)
+			bytes[offset + i] = (unsigned char)(value >> (i * 8));
+	}
+
+	unsigned int get32(const unsigned char* bytes)
+	{
+		return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (unsigned int)bytes[3] << 24;
+	}
+
+	unsigned long long get64(const unsigned char* bytes)
+	{
+		return get32(bytes) | (unsigned long long)get32(bytes + 4) << 32;
+	}
+
+	//Total size prefix, then one basic descriptor block with a sample per BCn sub-block.
+	std::vector<unsigned char> dataFormatDescriptor(BlockFormat format)
+	{
+		struct Sample
+		{
+			unsigned short bitOffset;
+			unsigned char bitLength;
+			unsigned char channel;
+		};
+		Sample samples[2];
+		int sampleCount = 1;
+		switch (format)
+		{
+		case BLOCK_BC1:
+			samples[0] = { 0, 64, KHR_DF_CHANNEL_COLOR };
+			break;
+		case BLOCK_BC3:
+			samples[0] = { 0, 64, KHR_DF_CHANNEL_ALPHA };
+			samples[1] = { 64, 64, KHR_DF_CHANNEL_COLOR };
+			sampleCount = 2;
+			break;
+		default:
+			samples[0] = { 0, 128, KHR_DF_CHANNEL_COLOR };
+			break;
+		}
+
+		size_t blockSize = 24 + 16 * sampleCount;
+		std::vector<unsigned char> bytes(4 + blockSize, 0);
+		put32(bytes, 0, (unsigned int)bytes.size());
+		// vendor and descriptor type 0 (Khronos basic), version 2
+		bytes[8] = 2;
+		bytes[10] = (unsigned char)blockSize;
+		bytes[12] = colorModelOf(format);
+		bytes[13] = KHR_DF_PRIMARIES_BT709;
+		bytes[14] = KHR_DF_TRANSFER_LINEAR;
+		bytes[16] = 3;  // 4x4 texel blocks, dimensions minus one
+		bytes[17] = 3;
+		bytes[20] = (unsigned char)blockBytes(format);
+		for (int i = 0; i < sampleCount; i++)
+		{
+			size_t sample = 28 + 16 * i;
+			bytes[sample] = (unsigned char)samples[i].bitOffset;
+			bytes[sample + 1] = (unsigned char)(samples[i].bitOffset >> 8);
+			bytes[sample + 2] = samples[i].bitLength - 1;
+			bytes[sample + 3] = samples[i].channel;
+			put32(bytes, sample + 12, 0xffffffffu);  // sampleUpper
+		}
+		return bytes;
+	}
+
+	//The descriptor has to describe the vkFormat: a Khronos basic block with the format's colour model, 4x4
+	//texel blocks and its block size.
+	bool descriptorMatches(const unsigned char* bytes, size_t size, BlockFormat format)
+	{
+		unsigned long long offset = get32(&bytes[48]), length = get32(&bytes[52]);
+		if (length < 4 + 24 || offset + length > size || get32(&bytes[offset]) != length)
+			return false;
+		const unsigned char* block = &bytes[offset + 4];
+		unsigned int blockSize = block[6] | block[7] << 8;
+		return get32(block) == 0 && blockSize >= 24 && 4 + blockSize <= length && block[8] == colorModelOf(format) &&
+			block[12] == 3 && block[13] == 3 && block[16] == blockBytes(format);
+	}
+
+	size_t align(size_t offset, size_t alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+}
+
+size_t compressedLevelSize(const CompressedTexture& texture, size_t level)
+{
+	return compressedLevelBytes(texture.format, std::max(texture.width >> level, 1), std::max(texture.height >> level, 1));
+}
+
+bool writeKtx2(const char* path, const CompressedTexture& texture)
+{
+	size_t levels = texture.levelOffsets.size();
+	std::vector<unsigned char> descriptor = dataFormatDescriptor(texture.format);
+	size_t descriptorOffset = headerBytes + levels * levelIndexBytes;
+	size_t dataOffset = descriptorOffset + descriptor.size();
+
+	// mip levels are aligned to the block size; 8 and 16 are multiples of 4, so that is the lcm(block size, 4)
+	// KTX2 asks for
+	std::vector<size_t> levelFileOffsets(levels);
+	size_t fileSize = dataOffset;
+	for (size_t level = levels; level-- > 0;)
+	{
+		fileSize = align(fileSize, blockBytes(texture.format));
+		levelFileOffsets[level] = fileSize;
+		fileSize += compressedLevelSize(texture, level);
+	}
+
+	std::vector<unsigned char> bytes(fileSize, 0);
+	memcpy(&bytes[0], identifier, sizeof(identifier));
+	put32(bytes, 12, vkFormatOf(texture.format));
+	put32(bytes, 16, 1);  // typeSize
+	put32(bytes, 20, texture.width);
+	put32(bytes, 24, texture.height);
+	// depth and layer count 0, one face
+	put32(bytes, 36, 1);
+	put32(bytes, 40, (unsigned int)levels);
+	// no supercompression, no key/value data, no supercompression global data
+	put32(bytes, 48, (unsigned int)descriptorOffset);
+	put32(bytes, 52, (unsigned int)descriptor.size());
+	for (size_t level = 0; level < levels; level++)
+	{
+		size_t entry = headerBytes + level * levelIndexBytes;
+		size_t size = compressedLevelSize(texture, level);
+		put64(bytes, entry, levelFileOffsets[level]);
+		put64(bytes, entry + 8, size);
+		put64(bytes, entry + 16, size);
+		memcpy(&bytes[levelFileOffsets[level]], &texture.data[texture.levelOffsets[level]], size);
+	}
+	memcpy(&bytes[descriptorOffset], &descriptor[0], descriptor.size());
+
+	FILE* file = fopen(path, "wb");
+	if (!file || fwrite(&bytes[0], 1, bytes.size(), file) != bytes.size())
+	{
+		std::cout << "ERROR::KTX2::WRITE_FAILED " << path << std::endl;
+		if (file)
+			fclose(file);
+		return false;
+	}
+	fclose(file);
+	return true;
+}
+
+bool readKtx2(const char* path, CompressedTexture& texture)
+{
+	MappedFile file;
+	if (!mapFile(path, file))
+		return false;
+	bool parsed = parseKtx2(file.data, file.size, path, texture);
+	if (parsed)
+		for (size_t level = 0; level < texture.levelOffsets.size(); level++)
+		{
+			size_t offset = texture.levelOffsets[level];
+			texture.levelOffsets[level] = texture.data.size();
+			texture.data.insert(texture.data.end(), file.data + offset, file.data + offset + compressedLevelSize(texture, level));
+		}
+	unmapFile(file);
+	return parsed;
+}
+
+bool parseKtx2(const unsigned char* bytes, size_t size, const char* path, CompressedTexture& texture)
+{
+	if (size < headerBytes || memcmp(bytes, identifier, sizeof(identifier)) != 0)
+	{
+		std::cout << "ERROR::KTX2::NOT_KTX2 " << path << std::endl;
+		return false;
+	}
+	unsigned int vkFormat = get32(&bytes[12]);
+	if (vkFormat == VK_FORMAT_BC1_RGB_UNORM_BLOCK)
+		texture.format = BLOCK_BC1;
+	else if (vkFormat == VK_FORMAT_BC3_UNORM_BLOCK)
+		texture.format = BLOCK_BC3;
+	else if (vkFormat == VK_FORMAT_BC7_UNORM_BLOCK)
+		texture.format = BLOCK_BC7;
+	else
+	{
+		std::cout << "ERROR::KTX2::UNSUPPORTED_FORMAT " << vkFormat << " " << path << std::endl;
+		return false;
+	}
+	texture.width = (int)get32(&bytes[20]);
+	texture.height = (int)get32(&bytes[24]);
+	unsigned int levels = std::max(get32(&bytes[40]), 1u);
+	if (get32(&bytes[28]) > 1 || get32(&bytes[32]) > 1 || get32(&bytes[36]) != 1 || get32(&bytes[44]) != 0 ||
+		size < headerBytes + levels * levelIndexBytes)
+	{
+		std::cout << "ERROR::KTX2::UNSUPPORTED_LAYOUT " << path << std::endl;
+		return false;
+	}
+	if (!descriptorMatches(bytes, size, texture.format))
+	{
+		std::cout << "ERROR::KTX2::FORMAT_MISMATCH " << vkFormat << " " << path << std::endl;
+		return false;
+	}
+
+	texture.levelOffsets.clear();
+	texture.data.clear();
+	for (unsigned int level = 0; level < levels; level++)
+	{
+		const unsigned char* entry = &bytes[headerBytes + level * levelIndexBytes];
+		unsigned long long offset = get64(entry), length = get64(entry + 8);
+		if (offset + length > size || length != compressedLevelSize(texture, level))
+		{
+			std::cout << "ERROR::KTX2::BAD_LEVEL " << level << " " << path << std::endl;
+			return false;
+		}
+		texture.levelOffsets.push_back((size_t)offset);
+	}
+	return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "block_compression.h"
+
+//KTX2 files holding one 2D BCn texture with its mip chain, no supercompression and no key/value data.
+//Level data is stored smallest mip first, as the KTX2 spec asks, and read back largest first.
+
+struct CompressedTexture
+{
+	BlockFormat format;
+	int width;
+	int height;
+	std::vector<size_t> levelOffsets;  // into data, level 0 (full size) first
+	std::vector<unsigned char> data;
+};
+
+//Follows from the format and size, data doesn't need to be there.
+size_t compressedLevelSize(const CompressedTexture& texture, size_t level);
+
+bool writeKtx2(const char* path, const CompressedTexture& texture);
+//Fails with a message for files that aren't a BC1/BC3/BC7 2D texture this writer could have produced.
+bool readKtx2(const char* path, CompressedTexture& texture);
+//The same on a file already in memory (see mapped_file.h), without copying: data stays empty and
+//levelOffsets are into bytes.
+bool parseKtx2(const unsigned char* bytes, size_t size, const char* path, CompressedTexture& texture);
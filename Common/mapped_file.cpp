@@ -0,0 +1,67 @@
+#include "mapped_file.h"
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool mapFile(const char* path, MappedFile& file)
+{
+	memset(&file, 0, sizeof(file));
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	HANDLE mapping = NULL;
+	if (GetFileSizeEx(handle, &size) && size.QuadPart > 0)
+		mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	// the mapping keeps the file open
+	CloseHandle(handle);
+	if (!mapping)
+		return false;
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+	file.data = (const unsigned char*)data;
+	file.size = (size_t)size.QuadPart;
+	file.mapping = mapping;
+#else
+	int descriptor = open(path, O_RDONLY);
+	if (descriptor < 0)
+		return false;
+	struct stat status;
+	void* data = MAP_FAILED;
+	if (fstat(descriptor, &status) == 0 && status.st_size > 0)
+		data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	// the mapping keeps the file open
+	close(descriptor);
+	if (data == MAP_FAILED)
+		return false;
+	// decoders read front to back
+	madvise(data, (size_t)status.st_size, MADV_SEQUENTIAL);
+	file.data = (const unsigned char*)data;
+	file.size = (size_t)status.st_size;
+#endif
+	return true;
+}
+
+void unmapFile(MappedFile& file)
+{
+	if (!file.data)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(file.data);
+	CloseHandle(file.mapping);
+#else
+	munmap((void*)file.data, file.size);
+#endif
+	memset(&file, 0, sizeof(file));
+}
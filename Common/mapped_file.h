@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+
+//Read-only memory mapping of a whole file, so decoders read the page cache directly instead of copying
+//through stdio buffers.
+
+struct MappedFile
+{
+	const unsigned char* data;
+	size_t size;
+#ifdef _WIN32
+	void* mapping;
+#endif
+};
+
+//False for missing, unreadable and empty files; the file is left zeroed then.
+bool mapFile(const char* path, MappedFile& file);
+void unmapFile(MappedFile& file);
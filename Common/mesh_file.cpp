@@ -0,0 +1,499 @@
+#include "mesh_file.h"
+#include "gl_state.h"
+#include "mesh_optimizer.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+//glBufferStorage is core in 4.4, the bundled glad only goes up to 4.0
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace
+{
+	typedef void (APIENTRYP BufferStorageProc)(GLenum, GLsizeiptr, const void*, GLbitfield);
+
+	BufferStorageProc bufferStorage = NULL;
+	bool bufferStorageChecked = false;
+	const unsigned char magic[8] = { 'L', 'G', 'L', 'M', 'E', 'S', 'H', 0 };
+	const size_t headerBytes = 8 + 6 * 4 + 4 * 8 + 6 * 4;
+	const size_t attributeBytes = 5 * 4;
+	const size_t submeshBytes = 4 * 4 + 6 * 4;
+	const size_t blobAlignment = 16;
+
+	bool hasExtension(const char* name)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+			if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+				return true;
+		return false;
+	}
+
+	//A driver may export the entry point without supporting it, only trust it on 4.4 or ARB_buffer_storage.
+	void loadBufferStorage()
+	{
+		bufferStorageChecked = true;
+		GLint major = 0, minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		if (major * 10 + minor >= 44 || hasExtension("GL_ARB_buffer_storage"))
+			bufferStorage = (BufferStorageProc)glfwGetProcAddress("glBufferStorage");
+	}
+
+	size_t alignBlob(size_t offset)
+	{
+		return (offset + blobAlignment - 1) / blobAlignment * blobAlignment;
+	}
+
+	void put32(std::vector<unsigned char>& bytes, size_t offset, unsigned int value)
+	{
+		for (int i = 0; i < 4; i++)
+			bytes[offset + i] = (unsigned char)(value >> (i * 8));
+	}
+
+	void put64(std::vector<unsigned char>& bytes, size_t offset, unsigned long long value)
+	{
+		for (int i = 0; i < 8; i++)
+			bytes[offset + i] = (unsigned char)(value >> (i * 8));
+	}
+
+	void putVec3(std::vector<unsigned char>& bytes, size_t offset, const glm::vec3& value)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			unsigned int bits;
+			memcpy(&bits, &value[i], 4);
+			put32(bytes, offset + i * 4, bits);
+		}
+	}
+
+	unsigned int get32(const unsigned char* bytes)
+	{
+		return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (unsigned int)bytes[3] << 24;
+	}
+
+	unsigned long long get64(const unsigned char* bytes)
+	{
+		return get32(bytes) | (unsigned long long)get32(bytes + 4) << 32;
+	}
+
+	glm::vec3 getVec3(const unsigned char* bytes)
+	{
+		glm::vec3 value;
+		for (int i = 0; i < 3; i++)
+		{
+			unsigned int bits = get32(bytes + i * 4);
+			memcpy(&value[i], &bits, 4);
+		}
+		return value;
+	}
+
+	//Bytes of one attribute, the GL type times the components; packed types are 4 bytes whole.
+	size_t attributeSize(GLenum type, int components)
+	{
+		switch (type)
+		{
+		case GL_BYTE: case GL_UNSIGNED_BYTE: return components;
+		case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: return components * 2;
+		case GL_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_2_10_10_10_REV: return 4;
+		case GL_INT: case GL_UNSIGNED_INT: case GL_FLOAT: return components * 4;
+		default: return 0;
+		}
+	}
+
+	void optimizeSubmeshes(std::vector<FloatSubmesh>* submeshes, std::atomic<size_t>* next)
+	{
+		for (size_t i = (*next)++; i < submeshes->size(); i = (*next)++)
+		{
+			FloatSubmesh& submesh = (*submeshes)[i];
+			if (submesh.indices.empty())
+				continue;
+			optimizeVertexCache(&submesh.indices[0], submesh.indices.size(), submesh.vertices.size() / 8);
+			optimizeOverdraw(&submesh.indices[0], submesh.indices.size(), &submesh.vertices[0], submesh.vertices.size() / 8,
+				8, 1.05f);
+			optimizeVertexFetch(submesh.vertices, 8, &submesh.indices[0], submesh.indices.size());
+		}
+	}
+
+	bool readWholeFile(const char* path, std::vector<unsigned char>& bytes)
+	{
+		FILE* file = fopen(path, "rb");
+		if (!file)
+			return false;
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		bytes.resize(size > 0 ? (size_t)size : 0);
+		bool read = size > 0 && fread(&bytes[0], 1, bytes.size(), file) == bytes.size();
+		fclose(file);
+		return read;
+	}
+}
+
+void buildMeshFile(std::vector<FloatSubmesh>& submeshes, const VertexTolerance& tolerance, unsigned int threads,
+	MeshFile& mesh)
+{
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threads; i++)
+		workers.push_back(std::thread(optimizeSubmeshes, &submeshes, &next));
+	optimizeSubmeshes(&submeshes, &next);
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	std::vector<float> vertices;
+	mesh.submeshes.clear();
+	mesh.indexSize = 2;
+	mesh.indexCount = 0;
+	for (size_t i = 0; i < submeshes.size(); i++)
+	{
+		const FloatSubmesh& source = submeshes[i];
+		Submesh submesh;
+		submesh.firstIndex = (unsigned int)mesh.indexCount;
+		submesh.indexCount = (unsigned int)source.indices.size();
+		submesh.baseVertex = (unsigned int)(vertices.size() / 8);
+		submesh.vertexCount = (unsigned int)(source.vertices.size() / 8);
+		submesh.minimum = submesh.maximum = glm::vec3(0.0f);
+		for (size_t v = 0; v < submesh.vertexCount; v++)
+		{
+			glm::vec3 position(source.vertices[v * 8], source.vertices[v * 8 + 1], source.vertices[v * 8 + 2]);
+			submesh.minimum = v ? glm::min(submesh.minimum, position) : position;
+			submesh.maximum = v ? glm::max(submesh.maximum, position) : position;
+		}
+		mesh.submeshes.push_back(submesh);
+		mesh.indexCount += source.indices.size();
+		mesh.indexSize = std::max(mesh.indexSize, (unsigned int)indexSizeFor(submesh.vertexCount));
+		vertices.insert(vertices.end(), source.vertices.begin(), source.vertices.end());
+	}
+
+	FloatVertexLayout layout = { 8, 0, 3, 6 };
+	QuantizedVertices quantized;
+	quantizeVertices(vertices.empty() ? NULL : &vertices[0], vertices.size() / 8, layout, tolerance, quantized);
+	VertexAttribute attributes[3];
+	size_t attributeCount = quantizedAttributes(quantized, 0, 1, 2, attributes);
+	mesh.attributes.assign(attributes, attributes + attributeCount);
+	mesh.flags = quantized.normalFormat == NORMAL_OCT16 ? MESH_OCTAHEDRAL_NORMALS : 0;
+	mesh.vertexSize = (unsigned int)quantized.stride;
+	mesh.positionOffset = quantized.decodeOffset;
+	mesh.positionScale = quantized.decodeScale;
+	mesh.vertexCount = quantized.vertexCount;
+	mesh.vertices.swap(quantized.data);
+
+	mesh.indices.clear();
+	std::vector<unsigned char> packed;
+	for (size_t i = 0; i < submeshes.size(); i++)
+	{
+		if (submeshes[i].indices.empty())
+			continue;
+		packIndices(&submeshes[i].indices[0], submeshes[i].indices.size(), mesh.indexSize, packed);
+		mesh.indices.insert(mesh.indices.end(), packed.begin(), packed.end());
+	}
+}
+
+bool writeMeshFile(const char* path, const MeshFile& mesh)
+{
+	size_t attributesOffset = headerBytes;
+	size_t submeshesOffset = attributesOffset + mesh.attributes.size() * attributeBytes;
+	size_t verticesOffset = alignBlob(submeshesOffset + mesh.submeshes.size() * submeshBytes);
+	size_t indicesOffset = alignBlob(verticesOffset + mesh.vertices.size());
+	std::vector<unsigned char> bytes(indicesOffset + mesh.indices.size(), 0);
+
+	memcpy(&bytes[0], magic, sizeof(magic));
+	put32(bytes, 8, meshFileVersion);
+	put32(bytes, 12, mesh.flags);
+	put32(bytes, 16, mesh.vertexSize);
+	put32(bytes, 20, mesh.indexSize);
+	put32(bytes, 24, (unsigned int)mesh.attributes.size());
+	put32(bytes, 28, (unsigned int)mesh.submeshes.size());
+	put64(bytes, 32, mesh.vertexCount);
+	put64(bytes, 40, mesh.indexCount);
+	put64(bytes, 48, verticesOffset);
+	put64(bytes, 56, indicesOffset);
+	putVec3(bytes, 64, mesh.positionOffset);
+	putVec3(bytes, 76, mesh.positionScale);
+	for (size_t i = 0; i < mesh.attributes.size(); i++)
+	{
+		const VertexAttribute& attribute = mesh.attributes[i];
+		size_t entry = attributesOffset + i * attributeBytes;
+		put32(bytes, entry, (unsigned int)attribute.location);
+		put32(bytes, entry + 4, (unsigned int)attribute.components);
+		put32(bytes, entry + 8, attribute.type);
+		put32(bytes, entry + 12, attribute.normalized ? 1 : 0);
+		put32(bytes, entry + 16, (unsigned int)attribute.offset);
+	}
+	for (size_t i = 0; i < mesh.submeshes.size(); i++)
+	{
+		const Submesh& submesh = mesh.submeshes[i];
+		size_t entry = submeshesOffset + i * submeshBytes;
+		put32(bytes, entry, submesh.firstIndex);
+		put32(bytes, entry + 4, submesh.indexCount);
+		put32(bytes, entry + 8, submesh.baseVertex);
+		put32(bytes, entry + 12, submesh.vertexCount);
+		putVec3(bytes, entry + 16, submesh.minimum);
+		putVec3(bytes, entry + 28, submesh.maximum);
+	}
+	if (!mesh.vertices.empty())
+		memcpy(&bytes[verticesOffset], &mesh.vertices[0], mesh.vertices.size());
+	if (!mesh.indices.empty())
+		memcpy(&bytes[indicesOffset], &mesh.indices[0], mesh.indices.size());
+
+	FILE* file = fopen(path, "wb");
+	if (!file || fwrite(&bytes[0], 1, bytes.size(), file) != bytes.size())
+	{
+		std::cout << "ERROR::MESH_FILE::WRITE_FAILED " << path << std::endl;
+		if (file)
+			fclose(file);
+		return false;
+	}
+	fclose(file);
+	return true;
+}
+
+bool parseMeshFile(const unsigned char* bytes, size_t size, const char* name, MeshFileView& view)
+{
+	if (size < headerBytes || memcmp(bytes, magic, sizeof(magic)) != 0)
+	{
+		std::cout << "ERROR::MESH_FILE::NOT_MESH_FILE " << name << std::endl;
+		return false;
+	}
+	unsigned int version = get32(bytes + 8);
+	if (version != meshFileVersion)
+	{
+		std::cout << "ERROR::MESH_FILE::UNSUPPORTED_VERSION " << version << " " << name << std::endl;
+		return false;
+	}
+
+	view.flags = get32(bytes + 12);
+	view.vertexSize = get32(bytes + 16);
+	view.indexSize = get32(bytes + 20);
+	size_t attributeCount = get32(bytes + 24), submeshCount = get32(bytes + 28);
+	unsigned long long vertexCount = get64(bytes + 32), indexCount = get64(bytes + 40);
+	unsigned long long verticesOffset = get64(bytes + 48), indicesOffset = get64(bytes + 56);
+	view.positionOffset = getVec3(bytes + 64);
+	view.positionScale = getVec3(bytes + 76);
+	// every field is bounded by the file size before it is multiplied or added, so nothing wraps
+	bool layout = (view.indexSize == 2 || view.indexSize == 4) && view.vertexSize != 0 &&
+		verticesOffset >= headerBytes && verticesOffset <= size && indicesOffset <= size &&
+		vertexCount <= (size - verticesOffset) / view.vertexSize && indexCount <= (size - indicesOffset) / view.indexSize &&
+		attributeCount <= (verticesOffset - headerBytes) / attributeBytes;
+	layout = layout && submeshCount <= (verticesOffset - headerBytes - attributeCount * attributeBytes) / submeshBytes &&
+		verticesOffset + vertexCount * view.vertexSize <= indicesOffset;
+	if (!layout)
+	{
+		std::cout << "ERROR::MESH_FILE::BAD_LAYOUT " << name << std::endl;
+		return false;
+	}
+	view.vertexCount = (size_t)vertexCount;
+	view.indexCount = (size_t)indexCount;
+
+	view.attributes.resize(attributeCount);
+	for (size_t i = 0; i < attributeCount; i++)
+	{
+		const unsigned char* entry = bytes + headerBytes + i * attributeBytes;
+		VertexAttribute& attribute = view.attributes[i];
+		attribute.location = (int)get32(entry);
+		attribute.components = (int)get32(entry + 4);
+		attribute.type = get32(entry + 8);
+		attribute.normalized = get32(entry + 12) != 0;
+		attribute.integer = false;
+		attribute.columns = 1;
+		attribute.offset = get32(entry + 16);
+		attribute.size = attributeSize(attribute.type, attribute.components);
+		attribute.divisor = 0;
+		if (!attribute.size || attribute.offset + attribute.size > view.vertexSize)
+		{
+			std::cout << "ERROR::MESH_FILE::BAD_ATTRIBUTE " << i << " " << name << std::endl;
+			return false;
+		}
+	}
+	view.submeshes.resize(submeshCount);
+	for (size_t i = 0; i < submeshCount; i++)
+	{
+		const unsigned char* entry = bytes + headerBytes + attributeCount * attributeBytes + i * submeshBytes;
+		Submesh& submesh = view.submeshes[i];
+		submesh.firstIndex = get32(entry);
+		submesh.indexCount = get32(entry + 4);
+		submesh.baseVertex = get32(entry + 8);
+		submesh.vertexCount = get32(entry + 12);
+		submesh.minimum = getVec3(entry + 16);
+		submesh.maximum = getVec3(entry + 28);
+		if ((size_t)submesh.firstIndex + submesh.indexCount > view.indexCount ||
+			(size_t)submesh.baseVertex + submesh.vertexCount > view.vertexCount)
+		{
+			std::cout << "ERROR::MESH_FILE::BAD_SUBMESH " << i << " " << name << std::endl;
+			return false;
+		}
+	}
+	view.vertices = bytes + (size_t)verticesOffset;
+	view.indices = bytes + (size_t)indicesOffset;
+	return true;
+}
+
+bool mapMeshFile(const char* path, MappedFile& file, MeshFileView& view)
+{
+	if (!mapFile(path, file))
+	{
+		std::cout << "ERROR::MESH_FILE::READ_FAILED " << path << std::endl;
+		return false;
+	}
+	if (parseMeshFile(file.data, file.size, path, view))
+		return true;
+	unmapFile(file);
+	return false;
+}
+
+bool readMeshFile(const char* path, MeshFile& mesh)
+{
+	std::vector<unsigned char> bytes;
+	MeshFileView view;
+	if (!readWholeFile(path, bytes))
+	{
+		std::cout << "ERROR::MESH_FILE::READ_FAILED " << path << std::endl;
+		return false;
+	}
+	if (!parseMeshFile(&bytes[0], bytes.size(), path, view))
+		return false;
+	mesh.flags = view.flags;
+	mesh.vertexSize = view.vertexSize;
+	mesh.indexSize = view.indexSize;
+	mesh.attributes.swap(view.attributes);
+	mesh.submeshes.swap(view.submeshes);
+	mesh.positionOffset = view.positionOffset;
+	mesh.positionScale = view.positionScale;
+	mesh.vertexCount = view.vertexCount;
+	mesh.indexCount = view.indexCount;
+	mesh.vertices.assign(view.vertices, view.vertices + mesh.vertexCount * mesh.vertexSize);
+	mesh.indices.assign(view.indices, view.indices + mesh.indexCount * mesh.indexSize);
+	return true;
+}
+
+MeshFileView viewMeshFile(const MeshFile& mesh)
+{
+	MeshFileView view;
+	view.flags = mesh.flags;
+	view.vertexSize = mesh.vertexSize;
+	view.indexSize = mesh.indexSize;
+	view.attributes = mesh.attributes;
+	view.submeshes = mesh.submeshes;
+	view.positionOffset = mesh.positionOffset;
+	view.positionScale = mesh.positionScale;
+	view.vertexCount = mesh.vertexCount;
+	view.indexCount = mesh.indexCount;
+	view.vertices = mesh.vertices.empty() ? NULL : &mesh.vertices[0];
+	view.indices = mesh.indices.empty() ? NULL : &mesh.indices[0];
+	return view;
+}
+
+MeshUploadMode readMeshUploadMode()
+{
+	const char* value = getenv("MESH_UPLOAD");
+	if (value && strcmp(value, "subdata") == 0)
+		return MESH_UPLOAD_SUB_DATA;
+	if (value && strcmp(value, "persistent") == 0)
+		return MESH_UPLOAD_PERSISTENT;
+	return MESH_UPLOAD_DATA;
+}
+
+bool uploadMeshFile(const MeshFileView& view, MeshUploadMode mode, MeshBuffers& buffers)
+{
+	size_t vertexBytes = view.vertexCount * view.vertexSize, indexBytes = view.indexCount * view.indexSize;
+	if (mode == MESH_UPLOAD_PERSISTENT && !bufferStorageChecked)
+		loadBufferStorage();
+	if (mode == MESH_UPLOAD_PERSISTENT && !bufferStorage)
+	{
+		std::cout << "ERROR::MESH_FILE::NO_BUFFER_STORAGE falling back to glBufferData" << std::endl;
+		mode = MESH_UPLOAD_DATA;
+	}
+
+	buffers.indexType = view.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	buffers.vertexMapping = buffers.indexMapping = NULL;
+	glGenVertexArrays(1, &buffers.vertexArray);
+	glGenBuffers(1, &buffers.vertexBuffer);
+	glGenBuffers(1, &buffers.indexBuffer);
+	stateBindVertexArray(buffers.vertexArray);
+	stateBindBuffer(GL_ARRAY_BUFFER, buffers.vertexBuffer);
+	stateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.indexBuffer);
+	if (mode == MESH_UPLOAD_DATA)
+	{
+		glBufferData(GL_ARRAY_BUFFER, vertexBytes, view.vertices, GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, view.indices, GL_STATIC_DRAW);
+	}
+	else if (mode == MESH_UPLOAD_SUB_DATA)
+	{
+		// a submesh at a time, the way meshes stream into a MeshHeap
+		glBufferData(GL_ARRAY_BUFFER, vertexBytes, NULL, GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, NULL, GL_STATIC_DRAW);
+		for (size_t i = 0; i < view.submeshes.size(); i++)
+		{
+			const Submesh& submesh = view.submeshes[i];
+			glBufferSubData(GL_ARRAY_BUFFER, (size_t)submesh.baseVertex * view.vertexSize,
+				(size_t)submesh.vertexCount * view.vertexSize, view.vertices + (size_t)submesh.baseVertex * view.vertexSize);
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (size_t)submesh.firstIndex * view.indexSize,
+				(size_t)submesh.indexCount * view.indexSize, view.indices + (size_t)submesh.firstIndex * view.indexSize);
+		}
+	}
+	else
+	{
+		// immutable storage mapped for good: the file's bytes are copied straight into what the GPU reads
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		bufferStorage(GL_ARRAY_BUFFER, std::max(vertexBytes, (size_t)1), NULL, flags);
+		bufferStorage(GL_ELEMENT_ARRAY_BUFFER, std::max(indexBytes, (size_t)1), NULL, flags);
+		buffers.vertexMapping = glMapBufferRange(GL_ARRAY_BUFFER, 0, std::max(vertexBytes, (size_t)1), flags);
+		buffers.indexMapping = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, std::max(indexBytes, (size_t)1), flags);
+		if (!buffers.vertexMapping || !buffers.indexMapping)
+		{
+			std::cout << "ERROR::MESH_FILE::MAP_FAILED" << std::endl;
+			destroyMeshBuffers(buffers);
+			return false;
+		}
+		if (vertexBytes)
+			memcpy(buffers.vertexMapping, view.vertices, vertexBytes);
+		if (indexBytes)
+			memcpy(buffers.indexMapping, view.indices, indexBytes);
+	}
+	setVertexAttributes(view.attributes.data(), view.attributes.size(), view.vertexSize, 0, 0);
+	return true;
+}
+
+void destroyMeshBuffers(MeshBuffers& buffers)
+{
+	// unbind first, so the state cache doesn't hold on to names GL may hand out again
+	stateBindVertexArray(0);
+	stateBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDeleteVertexArrays(1, &buffers.vertexArray);
+	glDeleteBuffers(1, &buffers.vertexBuffer);
+	glDeleteBuffers(1, &buffers.indexBuffer);
+	buffers.vertexArray = buffers.vertexBuffer = buffers.indexBuffer = 0;
+	buffers.vertexMapping = buffers.indexMapping = NULL;
+}
+
+void drawMeshSubmesh(const MeshFileView& view, const MeshBuffers& buffers, size_t submesh)
+{
+	const Submesh& range = view.submeshes[submesh];
+	stateBindVertexArray(buffers.vertexArray);
+	glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)range.indexCount, buffers.indexType,
+		(void*)((size_t)range.firstIndex * view.indexSize), (GLint)range.baseVertex);
+}
+
+void printMeshFileStats(const char* name, const MeshFile& mesh)
+{
+	glm::vec3 minimum(0.0f), maximum(0.0f);
+	for (size_t i = 0; i < mesh.submeshes.size(); i++)
+	{
+		minimum = i ? glm::min(minimum, mesh.submeshes[i].minimum) : mesh.submeshes[i].minimum;
+		maximum = i ? glm::max(maximum, mesh.submeshes[i].maximum) : mesh.submeshes[i].maximum;
+	}
+	std::cout << "Mesh " << name << ": " << mesh.submeshes.size() << " submeshes, " << mesh.vertexCount << " vertices x "
+		<< mesh.vertexSize << " bytes, " << mesh.indexCount / 3 << " triangles with " << mesh.indexSize * 8
+		<< " bit indices, bounds (" << minimum.x << ", " << minimum.y << ", " << minimum.z << ") - (" << maximum.x
+		<< ", " << maximum.y << ", " << maximum.z << ")" << std::endl;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+#include "mapped_file.h"
+#include "vertex_layout.h"
+#include "vertex_quantization.h"
+
+//Runtime mesh files (.mesh) as written by ModelImporter: ready to upload, no importer library needed to
+//load them. Little endian:
+//	header      "LGLMESH\0", version, flags, vertex and index size, attribute and submesh counts, vertex and
+//	            index counts and file offsets, the position decode offset and scale (VERTEX_DECODE_GLSL)
+//	attributes  location, components, GL type, normalized, offset into the vertex
+//	submeshes   first index, index count, base vertex, vertex count, bounding box
+//	vertices    all submeshes back to back, 16 byte aligned
+//	indices     relative to their submesh's base vertex, 16 or 32 bit, 16 byte aligned
+//Locations follow the samples' shaders: 0 position, 1 normal, 2 texture coordinate.
+//
+//The blobs are stored exactly as GL takes them, so loading is mapping the file, decoding the header and the
+//two small tables, and handing pointers into the mapping to glBufferData: no work per vertex or index.
+
+const unsigned int meshFileVersion = 1;
+
+enum MeshFileFlags
+{
+	MESH_OCTAHEDRAL_NORMALS = 1
+};
+
+struct Submesh
+{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	unsigned int baseVertex;
+	unsigned int vertexCount;
+	glm::vec3 minimum;        // bounding box, decoded positions
+	glm::vec3 maximum;
+};
+
+struct MeshFile
+{
+	unsigned int flags;
+	unsigned int vertexSize;          // bytes
+	unsigned int indexSize;           // 2 or 4
+	std::vector<VertexAttribute> attributes;
+	std::vector<Submesh> submeshes;
+	glm::vec3 positionOffset;         // position = positionOffset + positionScale * stored
+	glm::vec3 positionScale;
+	size_t vertexCount;
+	size_t indexCount;
+	std::vector<unsigned char> vertices;
+	std::vector<unsigned char> indices;
+};
+
+//A mesh file in place: the same fields, but vertices and indices point into the bytes it was parsed from,
+//usually a MappedFile, and are only valid while those are.
+struct MeshFileView
+{
+	unsigned int flags;
+	unsigned int vertexSize;
+	unsigned int indexSize;
+	std::vector<VertexAttribute> attributes;
+	std::vector<Submesh> submeshes;
+	glm::vec3 positionOffset;
+	glm::vec3 positionScale;
+	size_t vertexCount;
+	size_t indexCount;
+	const unsigned char* vertices;
+	const unsigned char* indices;
+};
+
+//How uploadMeshFile gets the blobs into GL buffers (MESH_UPLOAD=data, subdata or persistent):
+//	MESH_UPLOAD_DATA        glBufferData from the pointers, one call per buffer
+//	MESH_UPLOAD_SUB_DATA    allocated empty, then a glBufferSubData per submesh
+//	MESH_UPLOAD_PERSISTENT  glBufferStorage (4.4), mapped persistent and coherent, memcpy into the mapping;
+//	                        falls back to MESH_UPLOAD_DATA where glBufferStorage is missing
+enum MeshUploadMode
+{
+	MESH_UPLOAD_DATA,
+	MESH_UPLOAD_SUB_DATA,
+	MESH_UPLOAD_PERSISTENT
+};
+
+struct MeshBuffers
+{
+	unsigned int vertexArray;
+	unsigned int vertexBuffer;
+	unsigned int indexBuffer;
+	GLenum indexType;
+	void* vertexMapping;      // stay mapped with MESH_UPLOAD_PERSISTENT, NULL otherwise
+	void* indexMapping;
+};
+
+//One submesh as an importer hands it over: 8 floats per vertex (position, normal, texture coordinate) and
+//triangles indexing them.
+struct FloatSubmesh
+{
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+};
+
+//Reorders every submesh's triangles for the vertex cache and then for overdraw, and its vertices for fetch
+//locality, spread over threads, then quantizes all vertices together within tolerance (vertex_quantization.h)
+//and packs the indices into 16 bits when every submesh allows it. The submeshes are left reordered.
+void buildMeshFile(std::vector<FloatSubmesh>& submeshes, const VertexTolerance& tolerance, unsigned int threads,
+	MeshFile& mesh);
+bool writeMeshFile(const char* path, const MeshFile& mesh);
+//Checks the header and tables against size and decodes them; fails with a message for bytes that aren't a
+//mesh file of this version or are cut short.
+bool parseMeshFile(const unsigned char* bytes, size_t size, const char* name, MeshFileView& view);
+//Maps the file and parses it in place; the view is valid until unmapFile(file).
+bool mapMeshFile(const char* path, MappedFile& file, MeshFileView& view);
+//Reads the file into memory and copies the blobs out.
+bool readMeshFile(const char* path, MeshFile& mesh);
+MeshFileView viewMeshFile(const MeshFile& mesh);
+
+MeshUploadMode readMeshUploadMode();
+//Creates a VAO over one vertex and one index buffer filled from the view with the file's attributes; binds
+//through gl_state and leaves the VAO bound. Shaders decode positions with setVertexDecodeUniforms(program,
+//positionOffset, positionScale, flags & MESH_OCTAHEDRAL_NORMALS).
+bool uploadMeshFile(const MeshFileView& view, MeshUploadMode mode, MeshBuffers& buffers);
+void destroyMeshBuffers(MeshBuffers& buffers);
+void drawMeshSubmesh(const MeshFileView& view, const MeshBuffers& buffers, size_t submesh);
+//Submeshes, vertices and indices, and the whole scene's bounding box.
+void printMeshFileStats(const char* name, const MeshFile& mesh);
@@ -0,0 +1,210 @@
+#include "mesh_heap.h"
+#include "gl_state.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	unsigned int createBuffer(size_t size)
+	{
+		unsigned int buffer;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+		return buffer;
+	}
+
+	//New buffer of size bytes holding the moved ranges (in elements of elementSize bytes) of buffer, which is
+	//deleted. Neighbouring ranges are copied in one go.
+	unsigned int copyBuffer(unsigned int buffer, size_t size, const std::vector<RangeMove>& moves, size_t elementSize)
+	{
+		unsigned int copy = createBuffer(size);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		for (size_t i = 0; i < moves.size();)
+		{
+			RangeMove run = moves[i];
+			for (i++; i < moves.size() && moves[i].from == run.from + run.size && moves[i].to == run.to + run.size; i++)
+				run.size += moves[i].size;
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, run.from * elementSize, run.to * elementSize,
+				run.size * elementSize);
+		}
+		glDeleteBuffers(1, &buffer);
+		return copy;
+	}
+
+	//Points the VAO at the current buffers after one was replaced.
+	void attachBuffers(MeshHeap& heap)
+	{
+		stateBindVertexArray(heap.vertexArray);
+		stateBindBuffer(GL_ARRAY_BUFFER, heap.vertexBuffer);
+		setVertexAttributes(heap.attributes.data(), heap.attributes.size(), heap.vertexSize, 0, 0);
+		stateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, heap.indexBuffer);
+	}
+
+	void growBuffer(unsigned int& buffer, OffsetAllocator& allocator, unsigned int capacity, size_t elementSize)
+	{
+		std::vector<RangeMove> moves(1);
+		moves[0].from = 0;
+		moves[0].to = 0;
+		moves[0].size = allocator.capacity;
+		buffer = copyBuffer(buffer, (size_t)capacity * elementSize, moves, elementSize);
+		growOffsetAllocator(allocator, capacity);
+	}
+
+	//Allocates size elements, defragmenting or growing the buffer when needed.
+	unsigned int allocateIn(MeshHeap& heap, unsigned int& buffer, OffsetAllocator& allocator, unsigned int size,
+		size_t elementSize)
+	{
+		unsigned int allocation = allocateRange(allocator, size);
+		if (allocation != invalidAllocation)
+			return allocation;
+
+		if (allocator.capacity - allocator.used >= size)
+		{
+			std::vector<RangeMove> moves;
+			defragmentOffsetAllocator(allocator, moves);
+			buffer = copyBuffer(buffer, (size_t)allocator.capacity * elementSize, moves, elementSize);
+			heap.defragmentations++;
+		}
+		else
+		{
+			unsigned int capacity = std::max(allocator.capacity, 1u);
+			while (capacity - allocator.used < size && capacity < 0x40000000u)
+				capacity *= 2;
+			growBuffer(buffer, allocator, capacity, elementSize);
+			heap.grows++;
+		}
+		attachBuffers(heap);
+		return allocateRange(allocator, size);
+	}
+}
+
+void createMeshHeap(MeshHeap& heap, const VertexAttribute* attributes, size_t attributeCount, size_t vertexSize,
+	GLenum indexType, unsigned int vertexCapacity, unsigned int indexCapacity)
+{
+	heap.attributes.assign(attributes, attributes + attributeCount);
+	heap.vertexSize = vertexSize;
+	heap.indexType = indexType;
+	heap.indexSize = indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+	heap.grows = 0;
+	heap.defragmentations = 0;
+	initOffsetAllocator(heap.vertices, vertexCapacity);
+	initOffsetAllocator(heap.indices, indexCapacity);
+	heap.vertexBuffer = createBuffer((size_t)vertexCapacity * vertexSize);
+	heap.indexBuffer = createBuffer((size_t)indexCapacity * heap.indexSize);
+	glGenVertexArrays(1, &heap.vertexArray);
+	attachBuffers(heap);
+}
+
+void destroyMeshHeap(MeshHeap& heap)
+{
+	// unbind first, so the state cache doesn't hold on to names GL may hand out again
+	stateBindVertexArray(0);
+	stateBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDeleteVertexArrays(1, &heap.vertexArray);
+	glDeleteBuffers(1, &heap.vertexBuffer);
+	glDeleteBuffers(1, &heap.indexBuffer);
+	heap.vertexArray = heap.vertexBuffer = heap.indexBuffer = 0;
+	initOffsetAllocator(heap.vertices, 0);
+	initOffsetAllocator(heap.indices, 0);
+}
+
+bool addHeapMesh(MeshHeap& heap, const void* vertices, unsigned int vertexCount, const void* indices,
+	unsigned int indexCount, HeapMesh& mesh)
+{
+	mesh.vertexAllocation = mesh.indexAllocation = invalidAllocation;
+	mesh.indexCount = 0;
+	if (heap.indexType == GL_UNSIGNED_SHORT && vertexCount > 65536)
+		return false;
+	mesh.vertexAllocation = allocateIn(heap, heap.vertexBuffer, heap.vertices, vertexCount, heap.vertexSize);
+	mesh.indexAllocation = allocateIn(heap, heap.indexBuffer, heap.indices, indexCount, heap.indexSize);
+	if (mesh.vertexAllocation == invalidAllocation || mesh.indexAllocation == invalidAllocation)
+	{
+		removeHeapMesh(heap, mesh);
+		return false;
+	}
+	mesh.indexCount = indexCount;
+
+	// through the copy target, so neither the bound VAO nor the tracked bindings change
+	glBindBuffer(GL_COPY_WRITE_BUFFER, heap.vertexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (size_t)rangeOffset(heap.vertices, mesh.vertexAllocation) * heap.vertexSize,
+		(size_t)vertexCount * heap.vertexSize, vertices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, heap.indexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (size_t)rangeOffset(heap.indices, mesh.indexAllocation) * heap.indexSize,
+		(size_t)indexCount * heap.indexSize, indices);
+	return true;
+}
+
+void removeHeapMesh(MeshHeap& heap, HeapMesh& mesh)
+{
+	if (mesh.vertexAllocation != invalidAllocation)
+		freeRange(heap.vertices, mesh.vertexAllocation);
+	if (mesh.indexAllocation != invalidAllocation)
+		freeRange(heap.indices, mesh.indexAllocation);
+	mesh.vertexAllocation = mesh.indexAllocation = invalidAllocation;
+	mesh.indexCount = 0;
+}
+
+void defragmentMeshHeap(MeshHeap& heap)
+{
+	std::vector<RangeMove> moves;
+	defragmentOffsetAllocator(heap.vertices, moves);
+	heap.vertexBuffer = copyBuffer(heap.vertexBuffer, (size_t)heap.vertices.capacity * heap.vertexSize, moves, heap.vertexSize);
+	defragmentOffsetAllocator(heap.indices, moves);
+	heap.indexBuffer = copyBuffer(heap.indexBuffer, (size_t)heap.indices.capacity * heap.indexSize, moves, heap.indexSize);
+	heap.defragmentations++;
+	attachBuffers(heap);
+}
+
+int heapBaseVertex(const MeshHeap& heap, const HeapMesh& mesh)
+{
+	return (int)rangeOffset(heap.vertices, mesh.vertexAllocation);
+}
+
+unsigned int heapFirstIndex(const MeshHeap& heap, const HeapMesh& mesh)
+{
+	return rangeOffset(heap.indices, mesh.indexAllocation);
+}
+
+void bindMeshHeap(const MeshHeap& heap)
+{
+	stateBindVertexArray(heap.vertexArray);
+}
+
+void drawHeapMesh(const MeshHeap& heap, const HeapMesh& mesh)
+{
+	glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)mesh.indexCount, heap.indexType,
+		(void*)((size_t)heapFirstIndex(heap, mesh) * heap.indexSize), heapBaseVertex(heap, mesh));
+}
+
+void drawHeapMeshes(MeshHeap& heap, const HeapMesh* meshes, size_t count)
+{
+	heap.drawCounts.resize(count);
+	heap.drawOffsets.resize(count);
+	heap.drawBaseVertices.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		heap.drawCounts[i] = (GLsizei)meshes[i].indexCount;
+		heap.drawOffsets[i] = (const void*)((size_t)heapFirstIndex(heap, meshes[i]) * heap.indexSize);
+		heap.drawBaseVertices[i] = heapBaseVertex(heap, meshes[i]);
+	}
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, heap.drawCounts.data(), heap.indexType,
+		(const void* const*)heap.drawOffsets.data(), (GLsizei)count, heap.drawBaseVertices.data());
+}
+
+MeshHeapStats getMeshHeapStats(const MeshHeap& heap)
+{
+	MeshHeapStats stats = { getOffsetAllocatorStats(heap.vertices), getOffsetAllocatorStats(heap.indices), heap.grows,
+		heap.defragmentations };
+	return stats;
+}
+
+void printMeshHeapStats(const char* name, const MeshHeap& heap)
+{
+	MeshHeapStats stats = getMeshHeapStats(heap);
+	std::cout << "Mesh heap " << name << ": " << stats.vertices.allocations << " meshes, vertices " << stats.vertices.used
+		<< "/" << stats.vertices.capacity << " in " << stats.vertices.freeRanges << " free ranges (fragmentation "
+		<< stats.vertices.fragmentation << "), indices " << stats.indices.used << "/" << stats.indices.capacity << " in "
+		<< stats.indices.freeRanges << " free ranges (fragmentation " << stats.indices.fragmentation << "), "
+		<< stats.grows << " grows, " << stats.defragmentations << " defragmentations" << std::endl;
+}
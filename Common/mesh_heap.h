@@ -0,0 +1,77 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+#include "offset_allocator.h"
+#include "vertex_layout.h"
+
+//Many meshes of one vertex layout in one vertex buffer and one index buffer, bound once through one VAO.
+//Both buffers are handed out by an OffsetAllocator (TLSF), in vertices and in indices, so a mesh is just
+//(baseVertex, firstIndex, indexCount) and is drawn with glDrawElementsBaseVertex, or together with others in
+//one glMultiDrawElementsBaseVertex. Indices stay relative to the mesh, so 16 bit indices work for meshes below
+//65536 vertices however big the heap gets.
+//
+//When a mesh doesn't fit, the heap defragments if the free space would hold it and grows to twice the size
+//otherwise; both copy into a new buffer with glCopyBufferSubData, so briefly take twice the memory. HeapMesh
+//handles stay valid through both. Buffer bindings go through gl_state.
+struct MeshHeap
+{
+	std::vector<VertexAttribute> attributes;
+	size_t vertexSize;            // bytes
+	GLenum indexType;             // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	size_t indexSize;
+	unsigned int vertexArray;
+	unsigned int vertexBuffer;
+	unsigned int indexBuffer;
+	OffsetAllocator vertices;     // in vertices
+	OffsetAllocator indices;      // in indices
+	unsigned int grows;
+	unsigned int defragmentations;
+	std::vector<GLsizei> drawCounts;        // scratch for drawHeapMeshes
+	std::vector<const void*> drawOffsets;
+	std::vector<GLint> drawBaseVertices;
+};
+
+struct HeapMesh
+{
+	unsigned int vertexAllocation;
+	unsigned int indexAllocation;
+	unsigned int indexCount;
+};
+
+struct MeshHeapStats
+{
+	OffsetAllocatorStats vertices;
+	OffsetAllocatorStats indices;
+	unsigned int grows;
+	unsigned int defragmentations;
+};
+
+void createMeshHeap(MeshHeap& heap, const VertexAttribute* attributes, size_t attributeCount, size_t vertexSize,
+	GLenum indexType, unsigned int vertexCapacity, unsigned int indexCapacity);
+template <typename Vertex, size_t Count>
+void createMeshHeap(MeshHeap& heap, const VertexLayout<Vertex, Count>& layout, GLenum indexType, unsigned int vertexCapacity,
+	unsigned int indexCapacity)
+{
+	createMeshHeap(heap, layout.attributes, Count, sizeof(Vertex), indexType, vertexCapacity, indexCapacity);
+}
+void destroyMeshHeap(MeshHeap& heap);
+
+//Copies the mesh in with glBufferSubData. Fails only for 16 bit heaps and meshes of more than 65536 vertices.
+bool addHeapMesh(MeshHeap& heap, const void* vertices, unsigned int vertexCount, const void* indices,
+	unsigned int indexCount, HeapMesh& mesh);
+void removeHeapMesh(MeshHeap& heap, HeapMesh& mesh);
+//Packs both buffers so all free space is one range at the end.
+void defragmentMeshHeap(MeshHeap& heap);
+
+int heapBaseVertex(const MeshHeap& heap, const HeapMesh& mesh);
+unsigned int heapFirstIndex(const MeshHeap& heap, const HeapMesh& mesh);
+
+//Binds the heap's VAO; the draws below expect it bound.
+void bindMeshHeap(const MeshHeap& heap);
+void drawHeapMesh(const MeshHeap& heap, const HeapMesh& mesh);
+//All of them in one glMultiDrawElementsBaseVertex.
+void drawHeapMeshes(MeshHeap& heap, const HeapMesh* meshes, size_t count);
+
+MeshHeapStats getMeshHeapStats(const MeshHeap& heap);
+//Used and free vertices and indices, fragmentation, grows and defragmentations.
+void printMeshHeapStats(const char* name, const MeshHeap& heap);
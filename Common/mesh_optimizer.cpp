@@ -0,0 +1,406 @@
+#include "mesh_optimizer.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	const unsigned int sortCacheSize = 32;  // LRU entries Forsyth's scoring simulates
+	const unsigned int maxValence = 32;     // live triangle counts above this score the same
+	const unsigned int none = ~0u;          // no triangle, no vertex
+
+	unsigned int floatBits(float value)
+	{
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+		// -0 and 0 are the same vertex
+		return bits == 0x80000000u ? 0 : bits;
+	}
+
+	//MurmurHash3's mixing over the float bits.
+	unsigned int hashVertex(const float* vertex, size_t vertexSize)
+	{
+		unsigned int hash = 0x9747b28cu;
+		for (size_t i = 0; i < vertexSize; i++)
+		{
+			unsigned int word = floatBits(vertex[i]) * 0xcc9e2d51u;
+			word = ((word << 15) | (word >> 17)) * 0x1b873593u;
+			hash ^= word;
+			hash = ((hash << 13) | (hash >> 19)) * 5 + 0xe6546b64u;
+		}
+		hash ^= hash >> 16;
+		hash *= 0x85ebca6bu;
+		hash ^= hash >> 13;
+		hash *= 0xc2b2ae35u;
+		return hash ^ (hash >> 16);
+	}
+
+	bool sameVertex(const float* a, const float* b, size_t vertexSize)
+	{
+		for (size_t i = 0; i < vertexSize; i++)
+			if (floatBits(a[i]) != floatBits(b[i]))
+				return false;
+		return true;
+	}
+
+	//Shader runs of every triangle against a FIFO cache: a vertex stays until cacheSize misses after its own.
+	void simulateFifo(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize,
+		std::vector<unsigned char>& triangleMisses)
+	{
+		std::vector<size_t> loadedAt(vertexCount, 0);  // miss count right after loading it, 0 never loaded
+		size_t misses = 0;
+		triangleMisses.assign(indexCount / 3, 0);
+		for (size_t i = 0; i < triangleMisses.size() * 3; i++)
+		{
+			unsigned int vertex = indices[i];
+			if (loadedAt[vertex] == 0 || misses - loadedAt[vertex] >= cacheSize)
+			{
+				loadedAt[vertex] = ++misses;
+				triangleMisses[i / 3]++;
+			}
+		}
+	}
+
+	glm::vec3 positionOf(const float* vertices, size_t vertexSize, unsigned int vertex)
+	{
+		const float* position = vertices + vertex * vertexSize;
+		return glm::vec3(position[0], position[1], position[2]);
+	}
+
+	struct Cluster
+	{
+		size_t first;  // triangle
+		size_t count;
+		float sortKey;
+	};
+
+	bool drawnEarlier(const Cluster& a, const Cluster& b)
+	{
+		return a.sortKey > b.sortKey;
+	}
+}
+
+VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+	unsigned int cacheSize)
+{
+	std::vector<unsigned char> triangleMisses;
+	simulateFifo(indices, indexCount, vertexCount, cacheSize, triangleMisses);
+	size_t misses = 0;
+	for (size_t i = 0; i < triangleMisses.size(); i++)
+		misses += triangleMisses[i];
+	std::vector<bool> used(vertexCount, false);
+	size_t usedCount = 0;
+	for (size_t i = 0; i < triangleMisses.size() * 3; i++)
+		if (!used[indices[i]])
+		{
+			used[indices[i]] = true;
+			usedCount++;
+		}
+
+	VertexCacheStats stats;
+	stats.acmr = triangleMisses.empty() ? 0.0f : (float)misses / triangleMisses.size();
+	stats.atvr = usedCount ? (float)misses / usedCount : 0.0f;
+	return stats;
+}
+
+size_t weldVertices(const float* vertices, size_t vertexCount, size_t vertexSize, std::vector<float>& unique,
+	std::vector<unsigned int>& indices)
+{
+	// open addressing, at most half full
+	size_t buckets = 1;
+	while (buckets < vertexCount * 2)
+		buckets *= 2;
+	std::vector<unsigned int> table(buckets, none);
+	unique.clear();
+	indices.resize(vertexCount);
+	unsigned int uniqueCount = 0;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float* vertex = vertices + i * vertexSize;
+		size_t bucket = hashVertex(vertex, vertexSize) & (buckets - 1);
+		while (table[bucket] != none && !sameVertex(&unique[table[bucket] * vertexSize], vertex, vertexSize))
+			bucket = (bucket + 1) & (buckets - 1);
+		if (table[bucket] == none)
+		{
+			table[bucket] = uniqueCount++;
+			unique.insert(unique.end(), vertex, vertex + vertexSize);
+		}
+		indices[i] = table[bucket];
+	}
+	return uniqueCount;
+}
+
+void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (!triangleCount)
+		return;
+
+	// Forsyth's scores: the last triangle's vertices a flat 0.75 (so strips aren't favoured over fans), older
+	// cache entries less the further back they are, plus a bonus for vertices with few triangles left so no
+	// lone triangles get stranded
+	float cacheScores[sortCacheSize];
+	for (unsigned int position = 0; position < sortCacheSize; position++)
+		cacheScores[position] = position < 3 ? 0.75f :
+			powf(1.0f - (float)(position - 3) / (sortCacheSize - 3), 1.5f);
+	float valenceScores[maxValence + 1];
+	valenceScores[0] = 0.0f;
+	for (unsigned int valence = 1; valence <= maxValence; valence++)
+		valenceScores[valence] = 2.0f / sqrtf((float)valence);
+
+	// triangles of every vertex; the ones not emitted yet are kept at the front of each list
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		liveTriangles[indices[i]]++;
+	std::vector<size_t> firstTriangle(vertexCount + 1, 0);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		firstTriangle[vertex + 1] = firstTriangle[vertex] + liveTriangles[vertex];
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<size_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		vertexScore[vertex] = valenceScores[std::min(liveTriangles[vertex], maxValence)];
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> ordered(triangleCount * 3);
+	unsigned int cache[sortCacheSize + 3];
+	unsigned int nextCache[sortCacheSize + 3];
+	size_t cacheCount = 0;
+	size_t nextInput = 0;  // where to continue when the cache runs dry
+
+	// nothing is cached yet, the start is the triangle with the loneliest vertices
+	unsigned int best = 0;
+	float bestScore = -1.0f;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const unsigned int* corners = indices + triangle * 3;
+		float score = vertexScore[corners[0]] + vertexScore[corners[1]] + vertexScore[corners[2]];
+		if (score > bestScore)
+		{
+			best = (unsigned int)triangle;
+			bestScore = score;
+		}
+	}
+
+	for (size_t output = 0; output < triangleCount; output++)
+	{
+		if (best == none)
+		{
+			// dead end, none of the cached vertices has triangles left
+			while (emitted[nextInput])
+				nextInput++;
+			best = (unsigned int)nextInput;
+		}
+		const unsigned int* corners = indices + best * 3;
+		memcpy(&ordered[output * 3], corners, 3 * sizeof(unsigned int));
+		emitted[best] = true;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			unsigned int vertex = corners[corner];
+			unsigned int* live = &adjacency[firstTriangle[vertex]];
+			unsigned int* found = std::find(live, live + liveTriangles[vertex], best);
+			std::swap(*found, live[--liveTriangles[vertex]]);
+		}
+
+		// the triangle's vertices move to the front, everything else keeps its order and the tail is evicted
+		size_t nextCount = 0;
+		for (int corner = 0; corner < 3; corner++)
+			if (std::find(nextCache, nextCache + nextCount, corners[corner]) == nextCache + nextCount)
+				nextCache[nextCount++] = corners[corner];
+		for (size_t i = 0; i < cacheCount; i++)
+			if (cache[i] != corners[0] && cache[i] != corners[1] && cache[i] != corners[2])
+				nextCache[nextCount++] = cache[i];
+		for (size_t i = 0; i < nextCount; i++)
+		{
+			unsigned int vertex = nextCache[i];
+			vertexScore[vertex] = liveTriangles[vertex] == 0 ? -1.0f :
+				(i < sortCacheSize ? cacheScores[i] : 0.0f) + valenceScores[std::min(liveTriangles[vertex], maxValence)];
+		}
+		cacheCount = std::min(nextCount, (size_t)sortCacheSize);
+		memcpy(cache, nextCache, cacheCount * sizeof(unsigned int));
+
+		// only triangles touching the cache changed score, the next one is among them
+		best = none;
+		bestScore = -1.0f;
+		for (size_t i = 0; i < cacheCount; i++)
+		{
+			unsigned int vertex = cache[i];
+			const unsigned int* live = &adjacency[firstTriangle[vertex]];
+			for (unsigned int j = 0; j < liveTriangles[vertex]; j++)
+			{
+				const unsigned int* triangle = indices + live[j] * 3;
+				float score = vertexScore[triangle[0]] + vertexScore[triangle[1]] + vertexScore[triangle[2]];
+				if (score > bestScore)
+				{
+					best = live[j];
+					bestScore = score;
+				}
+			}
+		}
+	}
+	memcpy(indices, &ordered[0], ordered.size() * sizeof(unsigned int));
+}
+
+void optimizeOverdraw(unsigned int* indices, size_t indexCount, const float* vertices, size_t vertexCount,
+	size_t vertexSize, float threshold)
+{
+	size_t triangleCount = indexCount / 3;
+	if (!triangleCount)
+		return;
+
+	// hard boundaries where the cache starts over anyway (three misses), soft ones inside those as soon as the
+	// cluster so far, drawn from an empty cache, is within threshold of the whole run's ACMR: wherever the
+	// sort puts it then, it costs at most that much
+	std::vector<unsigned char> triangleMisses;
+	simulateFifo(indices, indexCount, vertexCount, MESH_CACHE_SIZE, triangleMisses);
+	std::vector<size_t> loadedAt(vertexCount, 0);  // like simulateFifo, entries up to emptiedAt don't count
+	size_t misses = 0;
+	std::vector<Cluster> clusters;
+	size_t hardStart = 0;
+	while (hardStart < triangleCount)
+	{
+		size_t hardEnd = hardStart + 1;
+		size_t hardMisses = triangleMisses[hardStart];
+		while (hardEnd < triangleCount && triangleMisses[hardEnd] < 3)
+			hardMisses += triangleMisses[hardEnd++];
+		float target = threshold * hardMisses / (hardEnd - hardStart);
+
+		size_t start = hardStart;
+		size_t emptiedAt = misses;
+		for (size_t triangle = hardStart; triangle < hardEnd; triangle++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int vertex = indices[triangle * 3 + corner];
+				if (loadedAt[vertex] <= emptiedAt || misses - loadedAt[vertex] >= MESH_CACHE_SIZE)
+					loadedAt[vertex] = ++misses;
+			}
+			size_t count = triangle + 1 - start;
+			if (triangle + 1 == hardEnd || misses - emptiedAt <= target * count)
+			{
+				Cluster cluster = { start, count, 0.0f };
+				clusters.push_back(cluster);
+				start = triangle + 1;
+				emptiedAt = misses;
+			}
+		}
+		hardStart = hardEnd;
+	}
+
+	// clusters facing away from the middle of the mesh are on the outside and occlude the rest, they go first
+	glm::vec3 meshCenter(0.0f);
+	float meshArea = 0.0f;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const unsigned int* corners = indices + triangle * 3;
+		glm::vec3 a = positionOf(vertices, vertexSize, corners[0]);
+		glm::vec3 b = positionOf(vertices, vertexSize, corners[1]);
+		glm::vec3 c = positionOf(vertices, vertexSize, corners[2]);
+		float area = glm::length(glm::cross(b - a, c - a));
+		meshCenter += (a + b + c) * (area / 3.0f);
+		meshArea += area;
+	}
+	if (meshArea > 0.0f)
+		meshCenter /= meshArea;
+	for (size_t i = 0; i < clusters.size(); i++)
+	{
+		glm::vec3 center(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t triangle = clusters[i].first; triangle < clusters[i].first + clusters[i].count; triangle++)
+		{
+			const unsigned int* corners = indices + triangle * 3;
+			glm::vec3 a = positionOf(vertices, vertexSize, corners[0]);
+			glm::vec3 b = positionOf(vertices, vertexSize, corners[1]);
+			glm::vec3 c = positionOf(vertices, vertexSize, corners[2]);
+			glm::vec3 cross = glm::cross(b - a, c - a);  // area weighted normal
+			float triangleArea = glm::length(cross);
+			center += (a + b + c) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+		float normalLength = glm::length(normal);
+		if (area > 0.0f && normalLength > 0.0f)
+			clusters[i].sortKey = glm::dot(center / area - meshCenter, normal / normalLength);
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), drawnEarlier);
+
+	std::vector<unsigned int> ordered;
+	ordered.reserve(triangleCount * 3);
+	for (size_t i = 0; i < clusters.size(); i++)
+		ordered.insert(ordered.end(), indices + clusters[i].first * 3, indices + (clusters[i].first + clusters[i].count) * 3);
+	memcpy(indices, &ordered[0], ordered.size() * sizeof(unsigned int));
+}
+
+size_t optimizeVertexFetch(std::vector<float>& vertices, size_t vertexSize, unsigned int* indices, size_t indexCount)
+{
+	std::vector<unsigned int> remap(vertices.size() / vertexSize, none);
+	std::vector<float> ordered;
+	ordered.reserve(vertices.size());
+	unsigned int vertexCount = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int vertex = indices[i];
+		if (remap[vertex] == none)
+		{
+			remap[vertex] = vertexCount++;
+			ordered.insert(ordered.end(), vertices.begin() + vertex * vertexSize, vertices.begin() + (vertex + 1) * vertexSize);
+		}
+		indices[i] = remap[vertex];
+	}
+	vertices.swap(ordered);
+	return vertexCount;
+}
+
+size_t indexSizeFor(size_t vertexCount)
+{
+	return vertexCount <= 65536 ? 2 : 4;
+}
+
+void packIndices(const unsigned int* indices, size_t indexCount, size_t indexSize, std::vector<unsigned char>& packed)
+{
+	packed.resize(indexCount * indexSize);
+	if (indexSize == 4)
+	{
+		if (indexCount)
+			memcpy(&packed[0], indices, indexCount * 4);
+		return;
+	}
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned short index = (unsigned short)indices[i];
+		memcpy(&packed[i * 2], &index, 2);
+	}
+}
+
+void buildIndexedMesh(const float* vertices, size_t vertexCount, size_t vertexSize, IndexedMesh& mesh)
+{
+	std::vector<unsigned int> indices;
+	mesh.vertexSize = vertexSize;
+	mesh.sourceVertexCount = vertexCount;
+	size_t uniqueCount = weldVertices(vertices, vertexCount - vertexCount % 3, vertexSize, mesh.vertices, indices);
+	mesh.welded = analyzeVertexCache(indices.data(), indices.size(), uniqueCount, MESH_CACHE_SIZE);
+
+	optimizeVertexCache(indices.data(), indices.size(), uniqueCount);
+	optimizeOverdraw(indices.data(), indices.size(), mesh.vertices.data(), uniqueCount, vertexSize, 1.05f);
+	uniqueCount = optimizeVertexFetch(mesh.vertices, vertexSize, indices.data(), indices.size());
+	mesh.optimized = analyzeVertexCache(indices.data(), indices.size(), uniqueCount, MESH_CACHE_SIZE);
+
+	mesh.indexSize = indexSizeFor(uniqueCount);
+	mesh.indexCount = indices.size();
+	packIndices(indices.data(), indices.size(), mesh.indexSize, mesh.indices);
+}
+
+void printIndexedMeshStats(const char* name, const IndexedMesh& mesh)
+{
+	size_t vertexCount = mesh.vertexSize ? mesh.vertices.size() / mesh.vertexSize : 0;
+	std::cout << "Mesh " << name << ": " << mesh.sourceVertexCount << " vertices welded to " << vertexCount << ", "
+		<< mesh.indexCount / 3 << " triangles, " << mesh.indexSize * 8 << " bit indices; ACMR 3 -> "
+		<< mesh.welded.acmr << " -> " << mesh.optimized.acmr << ", ATVR "
+		<< (vertexCount ? (float)mesh.sourceVertexCount / vertexCount : 0.0f) << " -> " << mesh.welded.atvr << " -> "
+		<< mesh.optimized.atvr << " (triangle list, welded, optimized; FIFO " << MESH_CACHE_SIZE << ")" << std::endl;
+}
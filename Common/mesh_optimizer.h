@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+//Turns non-indexed triangle lists into indexed meshes that are cheap for the vertex stage.
+//	weldVertices         merges vertices whose floats are identical (position, normal, uv, whatever the layout
+//	                     holds; -0 and 0 count as equal) through a hash table, and builds the index buffer
+//	optimizeVertexCache  reorders triangles for the post-transform cache with Forsyth's greedy scoring
+//	                     ("Linear-Speed Vertex Cache Optimisation"), LRU of 32 entries
+//	optimizeOverdraw     splits that order into clusters that hardly cost cache hits and sorts them outside
+//	                     in, so the depth test rejects more of what is drawn later (Sander, Nehab, Barczak 2007)
+//	optimizeVertexFetch  renumbers vertices in the order the indices first use them
+//Vertices are arrays of vertexSize floats with the position in the first three.
+//
+//ACMR is vertex shader runs per triangle: 3 when nothing is reused, 0.5 at best on large regular meshes.
+//ATVR is vertex shader runs per unique vertex, 1 at best. Both are measured against a FIFO cache of
+//MESH_CACHE_SIZE entries, the kind most GPUs have.
+
+const unsigned int MESH_CACHE_SIZE = 16;
+
+struct VertexCacheStats
+{
+	float acmr;
+	float atvr;
+};
+
+VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+	unsigned int cacheSize);
+
+//Returns the number of unique vertices, which unique holds afterwards; indices gets one per input vertex.
+size_t weldVertices(const float* vertices, size_t vertexCount, size_t vertexSize, std::vector<float>& unique,
+	std::vector<unsigned int>& indices);
+void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+//threshold is how much worse than the cache order a cluster's ACMR may get, 1.05 allows 5%.
+void optimizeOverdraw(unsigned int* indices, size_t indexCount, const float* vertices, size_t vertexCount,
+	size_t vertexSize, float threshold);
+//Unreferenced vertices are dropped; returns the vertex count left.
+size_t optimizeVertexFetch(std::vector<float>& vertices, size_t vertexSize, unsigned int* indices, size_t indexCount);
+
+//2 (GL_UNSIGNED_SHORT) when every index fits in 16 bits, else 4 (GL_UNSIGNED_INT).
+size_t indexSizeFor(size_t vertexCount);
+void packIndices(const unsigned int* indices, size_t indexCount, size_t indexSize, std::vector<unsigned char>& packed);
+
+struct IndexedMesh
+{
+	size_t vertexSize;                   // floats per vertex
+	std::vector<float> vertices;
+	size_t indexSize;                    // bytes per index, see indexSizeFor
+	std::vector<unsigned char> indices;
+	size_t indexCount;
+	size_t sourceVertexCount;            // of the triangle list it was built from
+	VertexCacheStats welded;             // indexed, triangles still in the source order
+	VertexCacheStats optimized;
+};
+
+//All of the above on a GL_TRIANGLES vertex array, ready for glBufferData and glDrawElements.
+void buildIndexedMesh(const float* vertices, size_t vertexCount, size_t vertexSize, IndexedMesh& mesh);
+//One line with the vertex counts and ACMR/ATVR drawn as a triangle list, welded and optimized.
+void printIndexedMeshStats(const char* name, const IndexedMesh& mesh);
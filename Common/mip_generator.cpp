@@ -0,0 +1,325 @@
+#include "mip_generator.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATOR_SSE 1
+#include <emmintrin.h>
+#endif
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const float pi = 3.14159265f;
+	const float windowRadius = 3.0f;  // of the Kaiser and Lanczos kernels, in destination texels
+	const int linearSteps = 1 << 14;  // fine enough that the darkest sRGB codes still round correctly
+
+	struct ColorTables
+	{
+		float srgbToLinear[256];
+		unsigned char linearToSrgb[linearSteps + 1];
+
+		ColorTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float value = i / 255.0f;
+				srgbToLinear[i] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i <= linearSteps; i++)
+			{
+				float value = (float)i / linearSteps;
+				float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+				linearToSrgb[i] = (unsigned char)(encoded * 255.0f + 0.5f);
+			}
+		}
+	};
+
+	const ColorTables& colorTables()
+	{
+		static const ColorTables tables;
+		return tables;
+	}
+
+	float sinc(float x)
+	{
+		if (std::abs(x) < 1e-5f)
+			return 1.0f;
+		x *= pi;
+		return sinf(x) / x;
+	}
+
+	float besselI0(float x)
+	{
+		float sum = 1.0f, term = 1.0f;
+		for (int k = 1; k < 20; k++)
+		{
+			term *= (x * 0.5f / k) * (x * 0.5f / k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	//Windowed sinc, distance in destination texels.
+	float kernelWeight(MipFilter filter, float distance)
+	{
+		if (std::abs(distance) >= windowRadius)
+			return 0.0f;
+		if (filter == MIP_FILTER_LANCZOS)
+			return sinc(distance) * sinc(distance / windowRadius);
+		const float beta = 4.0f;
+		float t = distance / windowRadius;
+		return sinc(distance) * besselI0(beta * sqrtf(1.0f - t * t)) / besselI0(beta);
+	}
+
+	//Source texels and normalized weights for every destination texel along one axis, edges clamped.
+	struct AxisTaps
+	{
+		int count;
+		std::vector<int> indices;
+		std::vector<float> weights;
+	};
+
+	AxisTaps axisTaps(MipFilter filter, int source, int destination)
+	{
+		float scale = (float)source / destination;
+		float support = filter == MIP_FILTER_BOX ? scale * 0.5f : windowRadius * scale;
+		AxisTaps taps;
+		taps.count = (int)ceilf(support * 2.0f) + 1;
+		for (int o = 0; o < destination; o++)
+		{
+			float center = (o + 0.5f) * scale;
+			int first = (int)floorf(center - support);
+			float sum = 0.0f;
+			size_t start = taps.weights.size();
+			for (int k = 0; k < taps.count; k++)
+			{
+				int i = first + k;
+				float weight = filter == MIP_FILTER_BOX ?
+					std::max(0.0f, std::min(i + 1.0f, center + support) - std::max((float)i, center - support)) :
+					kernelWeight(filter, (i + 0.5f - center) / scale);
+				taps.indices.push_back(std::min(std::max(i, 0), source - 1));
+				taps.weights.push_back(weight);
+				sum += weight;
+			}
+			for (size_t k = start; k < taps.weights.size(); k++)
+				taps.weights[k] /= sum;
+		}
+
+		// the count is for the worst alignment, drop tap columns that are zero for every texel
+		int leading = taps.count, trailing = taps.count;
+		for (int o = 0; o < destination; o++)
+		{
+			const float* weights = &taps.weights[(size_t)o * taps.count];
+			int first = 0, last = taps.count - 1;
+			while (first < last && weights[first] == 0.0f)
+				first++;
+			while (last > first && weights[last] == 0.0f)
+				last--;
+			leading = std::min(leading, first);
+			trailing = std::min(trailing, taps.count - 1 - last);
+		}
+		int count = taps.count - leading - trailing;
+		for (int o = 0; o < destination; o++)
+			for (int k = 0; k < count; k++)
+			{
+				taps.indices[(size_t)o * count + k] = taps.indices[(size_t)o * taps.count + leading + k];
+				taps.weights[(size_t)o * count + k] = taps.weights[(size_t)o * taps.count + leading + k];
+			}
+		taps.count = count;
+		taps.indices.resize((size_t)destination * count);
+		taps.weights.resize((size_t)destination * count);
+		return taps;
+	}
+
+	//Grey and RGB are all color, the last channel of grey+alpha and RGBA is alpha.
+	int colorChannels(int channels, bool srgb)
+	{
+		if (!srgb)
+			return 0;
+		return channels == 2 || channels == 4 ? channels - 1 : channels;
+	}
+
+	void decode(const unsigned char* pixels, size_t texels, int channels, bool srgb, float* linear)
+	{
+		const ColorTables& tables = colorTables();
+		int color = colorChannels(channels, srgb);
+		for (size_t i = 0; i < texels; i++)
+			for (int c = 0; c < 4; c++)
+			{
+				unsigned char value = c < channels ? pixels[i * channels + c] : 0;
+				linear[i * 4 + c] = c < color ? tables.srgbToLinear[value] : value / 255.0f;
+			}
+	}
+
+	void encode(const float* linear, size_t texels, int channels, bool srgb, unsigned char* pixels)
+	{
+		const ColorTables& tables = colorTables();
+		int color = colorChannels(channels, srgb);
+		for (size_t i = 0; i < texels; i++)
+			for (int c = 0; c < channels; c++)
+			{
+				// the sharper filters overshoot
+				float value = std::min(std::max(linear[i * 4 + c], 0.0f), 1.0f);
+				pixels[i * channels + c] = c < color ? tables.linearToSrgb[(int)(value * linearSteps + 0.5f)] :
+					(unsigned char)(value * 255.0f + 0.5f);
+			}
+	}
+
+	//Texels are 4 floats whatever the channel count, so one texel is one SSE register.
+	void weightedSum(const float* const* rows, const float* weights, int count, size_t floats, float* target)
+	{
+		for (size_t i = 0; i < floats; i += 4)
+		{
+#ifdef MIP_GENERATOR_SSE
+			__m128 sum = _mm_setzero_ps();
+			for (int k = 0; k < count; k++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+			_mm_storeu_ps(target + i, sum);
+#else
+			float sum[4] = {};
+			for (int k = 0; k < count; k++)
+				for (int c = 0; c < 4; c++)
+					sum[c] += weights[k] * rows[k][i + c];
+			memcpy(target + i, sum, sizeof(sum));
+#endif
+		}
+	}
+
+	void filterRow(const float* row, const AxisTaps& taps, int width, float* target)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const int* indices = &taps.indices[(size_t)x * taps.count];
+			const float* weights = &taps.weights[(size_t)x * taps.count];
+#ifdef MIP_GENERATOR_SSE
+			__m128 sum = _mm_setzero_ps();
+			for (int k = 0; k < taps.count; k++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(row + (size_t)indices[k] * 4)));
+			_mm_storeu_ps(target + x * 4, sum);
+#else
+			float sum[4] = {};
+			for (int k = 0; k < taps.count; k++)
+				for (int c = 0; c < 4; c++)
+					sum[c] += weights[k] * row[(size_t)indices[k] * 4 + c];
+			memcpy(target + x * 4, sum, sizeof(sum));
+#endif
+		}
+	}
+
+	//Source rows come either from the 8 bit level 0, decoded as they are needed, or from the previous
+	//float level. Rows are filtered horizontally first into a ring holding the vertical taps' window, so each
+	//one is touched once and level 0 never exists in float as a whole.
+	struct LevelSource
+	{
+		const unsigned char* pixels;  // level 0, else NULL
+		const float* linear;
+		int width;
+		int height;
+		int channels;
+		bool srgb;
+	};
+
+	void resampleLevel(const LevelSource& source, int nextWidth, int nextHeight, MipFilter filter, float* destination,
+		std::vector<float>& scratch)
+	{
+		AxisTaps vertical = axisTaps(filter, source.height, nextHeight);
+		AxisTaps horizontal = axisTaps(filter, source.width, nextWidth);
+		size_t sourceFloats = (size_t)source.width * 4, rowFloats = (size_t)nextWidth * 4;
+		scratch.resize(sourceFloats + rowFloats * vertical.count);
+		float* decoded = &scratch[0];
+		float* ring = &scratch[sourceFloats];
+		std::vector<int> ringRows(vertical.count, -1);
+		std::vector<const float*> rows(vertical.count);
+
+		for (int y = 0; y < nextHeight; y++)
+		{
+			const int* indices = &vertical.indices[(size_t)y * vertical.count];
+			for (int k = 0; k < vertical.count; k++)
+			{
+				// the window is count consecutive rows, they never share a slot
+				int slot = indices[k] % vertical.count;
+				float* filtered = ring + slot * rowFloats;
+				if (ringRows[slot] != indices[k])
+				{
+					if (source.pixels)
+						decode(source.pixels + (size_t)indices[k] * source.width * source.channels, source.width,
+							source.channels, source.srgb, decoded);
+					filterRow(source.pixels ? decoded : source.linear + indices[k] * sourceFloats, horizontal, nextWidth,
+						filtered);
+					ringRows[slot] = indices[k];
+				}
+				rows[k] = filtered;
+			}
+			weightedSum(&rows[0], &vertical.weights[(size_t)y * vertical.count], vertical.count, rowFloats,
+				destination + y * rowFloats);
+		}
+	}
+}
+
+MipFilter parseMipFilter(const char* name, MipFilter fallback)
+{
+	if (!name)
+		return fallback;
+	if (strcmp(name, "box") == 0)
+		return MIP_FILTER_BOX;
+	if (strcmp(name, "kaiser") == 0)
+		return MIP_FILTER_KAISER;
+	if (strcmp(name, "lanczos") == 0)
+		return MIP_FILTER_LANCZOS;
+	return fallback;
+}
+
+int mipLevelCount(int width, int height)
+{
+	int levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		levels++;
+	}
+	return levels;
+}
+
+size_t mipChainLayout(int width, int height, int channels, std::vector<size_t>& levelOffsets)
+{
+	levelOffsets.assign(1, 0);
+	size_t total = (size_t)width * height * channels;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		levelOffsets.push_back(total);
+		total += (size_t)width * height * channels;
+	}
+	return total;
+}
+
+void generateMipLevels(const unsigned char* level0, int width, int height, int channels, MipFilter filter, bool srgb,
+	unsigned char* chain)
+{
+	std::vector<float> level, next, scratch;
+	unsigned char* target = chain + (size_t)width * height * channels;
+	while (width > 1 || height > 1)
+	{
+		int nextWidth = std::max(width / 2, 1), nextHeight = std::max(height / 2, 1);
+		size_t texels = (size_t)nextWidth * nextHeight;
+		next.resize(texels * 4);
+		LevelSource source = { level.empty() ? level0 : NULL, level.data(), width, height, channels, srgb };
+		resampleLevel(source, nextWidth, nextHeight, filter, &next[0], scratch);
+		encode(&next[0], texels, channels, srgb, target);
+
+		target += texels * channels;
+		level.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+}
+
+void appendMipLevels(std::vector<unsigned char>& pixels, int width, int height, int channels, MipFilter filter,
+	bool srgb, std::vector<size_t>& levelOffsets)
+{
+	pixels.resize(mipChainLayout(width, height, channels, levelOffsets));
+	if (width > 0 && height > 0)
+		generateMipLevels(&pixels[0], width, height, channels, filter, srgb, &pixels[0]);
+}
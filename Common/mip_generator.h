@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+//CPU mip chain generation, replacing glGenerateMipmap.
+//Every level is resampled from the previous one with a separable filter, in linear light: color channels
+//are decoded from sRGB before filtering and encoded again afterwards, alpha is filtered as is. Intermediate
+//levels stay in float, so the chain doesn't accumulate 8 bit rounding. The inner loops are SSE.
+//	MIP_FILTER_BOX      2x2 average (area coverage for odd sizes), what glGenerateMipmap does
+//	MIP_FILTER_KAISER   sinc windowed by a Kaiser window (beta 4), 12 taps per axis; sharper, slight ringing
+//	MIP_FILTER_LANCZOS  Lanczos3, 12 taps per axis; sharpest, most ringing
+
+enum MipFilter
+{
+	MIP_FILTER_BOX,
+	MIP_FILTER_KAISER,
+	MIP_FILTER_LANCZOS
+};
+
+//"box", "kaiser" or "lanczos"; fallback for anything else.
+MipFilter parseMipFilter(const char* name, MipFilter fallback);
+int mipLevelCount(int width, int height);
+
+//Byte offset of every level of a tightly packed width x height chain down to 1x1, level 0 first. Returns the
+//size of the whole chain.
+size_t mipChainLayout(int width, int height, int channels, std::vector<size_t>& levelOffsets);
+//Writes levels 1 and smaller of level0 to chain, at the offsets of mipChainLayout; level 0 itself isn't
+//copied. chain is only written, so it can be a mapped buffer. srgb=false filters color as linear data too
+//(normal maps, masks).
+void generateMipLevels(const unsigned char* level0, int width, int height, int channels, MipFilter filter, bool srgb,
+	unsigned char* chain);
+//pixels holds level 0 and gets the smaller levels appended, levelOffsets as from mipChainLayout.
+void appendMipLevels(std::vector<unsigned char>& pixels, int width, int height, int channels, MipFilter filter,
+	bool srgb, std::vector<size_t>& levelOffsets);
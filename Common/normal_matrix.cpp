@@ -0,0 +1,81 @@
+#include "normal_matrix.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NORMAL_MATRIX_SSE 1
+#include <xmmintrin.h>
+#endif
+
+glm::mat3 normalMatrixOf(const glm::mat4& model)
+{
+	// for columns a, b, c the inverse transpose is [b x c, c x a, a x b] / det
+	glm::vec3 a(model[0]), b(model[1]), c(model[2]);
+	glm::vec3 bc = glm::cross(b, c);
+	float inverseDeterminant = 1.0f / glm::dot(a, bc);
+	return glm::mat3(bc * inverseDeterminant, glm::cross(c, a) * inverseDeterminant, glm::cross(a, b) * inverseDeterminant);
+}
+
+#ifdef NORMAL_MATRIX_SSE
+namespace
+{
+	inline __m128 cross(__m128 ay, __m128 az, __m128 by, __m128 bz)
+	{
+		return _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+	}
+
+	void normalMatrices4(const glm::mat4* models, glm::mat3* normalMatrices)
+	{
+		// m[column][row] for the four matrices, one lane each
+		__m128 m[3][4];
+		for (int column = 0; column < 3; ++column)
+		{
+			for (int k = 0; k < 4; ++k)
+				m[column][k] = _mm_loadu_ps(&models[k][column][0]);
+			_MM_TRANSPOSE4_PS(m[column][0], m[column][1], m[column][2], m[column][3]);
+		}
+		const __m128 ax = m[0][0], ay = m[0][1], az = m[0][2];
+		const __m128 bx = m[1][0], by = m[1][1], bz = m[1][2];
+		const __m128 cx = m[2][0], cy = m[2][1], cz = m[2][2];
+
+		// b x c, c x a, a x b
+		__m128 n[9];
+		n[0] = cross(by, bz, cy, cz);
+		n[1] = cross(bz, bx, cz, cx);
+		n[2] = cross(bx, by, cx, cy);
+		n[3] = cross(cy, cz, ay, az);
+		n[4] = cross(cz, cx, az, ax);
+		n[5] = cross(cx, cy, ax, ay);
+		n[6] = cross(ay, az, by, bz);
+		n[7] = cross(az, ax, bz, bx);
+		n[8] = cross(ax, ay, bx, by);
+
+		__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, n[0]), _mm_mul_ps(ay, n[1])), _mm_mul_ps(az, n[2]));
+		__m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+		for (int i = 0; i < 9; ++i)
+			n[i] = _mm_mul_ps(n[i], inverseDeterminant);
+
+		// back to one mat3 (9 contiguous floats) per lane
+		__m128 last = n[8], zero1 = _mm_setzero_ps(), zero2 = _mm_setzero_ps(), zero3 = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(n[0], n[1], n[2], n[3]);
+		_MM_TRANSPOSE4_PS(n[4], n[5], n[6], n[7]);
+		_MM_TRANSPOSE4_PS(last, zero1, zero2, zero3);
+		__m128 lasts[4] = { last, zero1, zero2, zero3 };
+		for (int k = 0; k < 4; ++k)
+		{
+			float* out = &normalMatrices[k][0][0];
+			_mm_storeu_ps(out, n[k]);
+			_mm_storeu_ps(out + 4, n[4 + k]);
+			_mm_store_ss(out + 8, lasts[k]);
+		}
+	}
+}
+#endif
+
+void computeNormalMatrices(const glm::mat4* models, glm::mat3* normalMatrices, std::size_t count)
+{
+	std::size_t i = 0;
+#ifdef NORMAL_MATRIX_SSE
+	for (; i + 4 <= count; i += 4)
+		normalMatrices4(models + i, normalMatrices + i);
+#endif
+	for (; i < count; ++i)
+		normalMatrices[i] = normalMatrixOf(models[i]);
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+
+//Normal matrix (inverse transpose of the upper 3x3) computed on the CPU, once per object,
+//instead of mat3(transpose(inverse(model))) in the vertex shader for every vertex.
+glm::mat3 normalMatrixOf(const glm::mat4& model);
+
+//Batched version for large instance counts. Four matrices at a time are transposed into
+//structure-of-arrays registers and solved with SSE cofactors; falls back to normalMatrixOf
+//when SSE isn't available and for the tail.
+void computeNormalMatrices(const glm::mat4* models, glm::mat3* normalMatrices, std::size_t count);
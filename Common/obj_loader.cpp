@@ -0,0 +1,573 @@
+#include "obj_loader.h"
+#include "benchmark.h"
+#include "mapped_file.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OBJ_LOADER_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define OBJ_LOADER_SWAR 1
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+	const unsigned int none = 0xFFFFFFFFu;
+	const size_t minimumChunkBytes = 1 << 20;
+	const double powersOfTen[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14,
+		1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	//A corner index given relative to the end of the lists so far, resolved once the chunks before are counted.
+	struct RelativeIndex
+	{
+		size_t slot;              // into ObjChunk::corners, slot % 3 says which list
+		long long local;          // index into the chunk's own list, negative when it points into an earlier chunk
+	};
+
+	struct ObjChunk
+	{
+		const char* begin;
+		const char* end;
+		std::vector<float> positions;
+		std::vector<float> uvs;
+		std::vector<float> normals;
+		std::vector<unsigned int> corners;     // position, uv, normal for each triangle corner, 0-based or none
+		std::vector<RelativeIndex> relative;
+		size_t faces;
+		bool valid;
+	};
+
+	struct PolygonCorner
+	{
+		long long index[3];
+		bool relative[3];
+	};
+
+	template <typename Work>
+	void parallelFor(size_t count, unsigned int threads, Work work)
+	{
+		std::atomic<size_t> next(0);
+		auto worker = [&]()
+		{
+			for (size_t i = next++; i < count; i = next++)
+				work(i);
+		};
+		std::vector<std::thread> workers;
+		for (unsigned int i = 1; i < threads && i < count; i++)
+			workers.push_back(std::thread(worker));
+		worker();
+		for (size_t i = 0; i < workers.size(); i++)
+			workers[i].join();
+	}
+
+	int lowestBit(unsigned int mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (int)index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	//The next '\n' at or after cursor, or end.
+	const char* findLineEnd(const char* cursor, const char* end)
+	{
+#ifdef OBJ_LOADER_SSE
+		const __m128i newline = _mm_set1_epi8('\n');
+		for (; end - cursor >= 16; cursor += 16)
+		{
+			int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)cursor), newline));
+			if (mask)
+				return cursor + lowestBit((unsigned int)mask);
+		}
+#endif
+		while (cursor < end && *cursor != '\n')
+			cursor++;
+		return cursor;
+	}
+
+	const char* skipSpaces(const char* cursor, const char* end)
+	{
+		while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+			cursor++;
+		return cursor;
+	}
+
+	bool isDigit(char c)
+	{
+		return (unsigned int)(c - '0') < 10;
+	}
+
+#ifdef OBJ_LOADER_SWAR
+	//Whether the eight bytes are all ASCII digits, and their value, without a loop (little endian).
+	bool eightDigits(unsigned long long bytes)
+	{
+		return ((bytes & 0xF0F0F0F0F0F0F0F0ull) | (((bytes + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+			0x3333333333333333ull;
+	}
+
+	unsigned int eightDigitValue(unsigned long long bytes)
+	{
+		bytes = ((bytes & 0x0F0F0F0F0F0F0F0Full) * 2561) >> 8;
+		bytes = ((bytes & 0x00FF00FF00FF00FFull) * 6553601) >> 16;
+		return (unsigned int)(((bytes & 0x0000FFFF0000FFFFull) * 42949672960001ull) >> 32);
+	}
+
+	//The same for four, most fractions in a file written with %g being six digits.
+	bool fourDigits(unsigned int bytes)
+	{
+		return ((bytes & 0xF0F0F0F0u) | (((bytes + 0x06060606u) & 0xF0F0F0F0u) >> 4)) == 0x33333333u;
+	}
+
+	unsigned int fourDigitValue(unsigned int bytes)
+	{
+		bytes = ((bytes & 0x0F0F0F0Fu) * 2561) >> 8;
+		return ((bytes & 0x00FF00FFu) * 6553601) >> 16;
+	}
+#endif
+
+	const char* parseDigits(const char* cursor, const char* end, unsigned long long& mantissa, int& digits)
+	{
+#ifdef OBJ_LOADER_SWAR
+		unsigned long long bytes;
+		while (end - cursor >= 8 && (memcpy(&bytes, cursor, 8), eightDigits(bytes)))
+		{
+			mantissa = mantissa * 100000000 + eightDigitValue(bytes);
+			digits += 8;
+			cursor += 8;
+		}
+		unsigned int four;
+		if (end - cursor >= 4 && (memcpy(&four, cursor, 4), fourDigits(four)))
+		{
+			mantissa = mantissa * 10000 + fourDigitValue(four);
+			digits += 4;
+			cursor += 4;
+		}
+#endif
+		for (; cursor < end && isDigit(*cursor); cursor++, digits++)
+			mantissa = mantissa * 10 + (unsigned int)(*cursor - '0');
+		return cursor;
+	}
+
+	//strtod on a copy of the token, for what the fast path doesn't take: long mantissas, large exponents, inf, nan.
+	const char* slowFloat(const char* cursor, const char* end, float& value)
+	{
+		char token[64];
+		size_t length = 0;
+		while (cursor + length < end && length < sizeof(token) - 1 && cursor[length] != ' ' && cursor[length] != '\t' &&
+			cursor[length] != '\r' && cursor[length] != '\n')
+		{
+			token[length] = cursor[length];
+			length++;
+		}
+		token[length] = 0;
+		char* parsed;
+		value = (float)strtod(token, &parsed);
+		return cursor + (parsed - token);
+	}
+
+	//A decimal float, exact as a double for up to 19 digits and exponents within 22, so within one rounding of
+	//strtof. Returns cursor when there is no number.
+	const char* parseFloat(const char* cursor, const char* end, float& value)
+	{
+		const char* start = cursor;
+		bool negative = cursor < end && *cursor == '-';
+		if (cursor < end && (*cursor == '-' || *cursor == '+'))
+			cursor++;
+		unsigned long long mantissa = 0;
+		int digits = 0, exponent = 0;
+		cursor = parseDigits(cursor, end, mantissa, digits);
+		if (cursor < end && *cursor == '.')
+		{
+			const char* fraction = ++cursor;
+			cursor = parseDigits(cursor, end, mantissa, digits);
+			exponent -= (int)(cursor - fraction);
+		}
+		if (digits == 0)
+			return slowFloat(start, end, value);
+		if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+		{
+			const char* exponentStart = cursor++;
+			bool negativeExponent = cursor < end && *cursor == '-';
+			if (cursor < end && (*cursor == '-' || *cursor == '+'))
+				cursor++;
+			int written = 0;
+			for (; cursor < end && isDigit(*cursor) && written < 1000; cursor++)
+				written = written * 10 + (*cursor - '0');
+			if (cursor == exponentStart + 1 || !isDigit(cursor[-1]))
+				return slowFloat(start, end, value);
+			exponent += negativeExponent ? -written : written;
+		}
+		if (digits > 19 || mantissa > (1ull << 53) || exponent < -22 || exponent > 22)
+			return slowFloat(start, end, value);
+		double result = exponent < 0 ? (double)mantissa / powersOfTen[-exponent] : (double)mantissa * powersOfTen[exponent];
+		value = (float)(negative ? -result : result);
+		return cursor;
+	}
+
+	//No digits leave index at 0 for a missing index; a lone sign, 0 and more than 12 digits clear valid.
+	const char* parseIndex(const char* cursor, const char* end, long long& index, bool& valid)
+	{
+		bool negative = cursor < end && *cursor == '-';
+		if (negative)
+			cursor++;
+		unsigned long long value = 0;
+		int digits = 0;
+		cursor = parseDigits(cursor, end, value, digits);
+		valid = digits == 0 ? !negative : digits <= 12 && value != 0;
+		index = digits == 0 || !valid ? 0 : negative ? -(long long)value : (long long)value;
+		return cursor;
+	}
+
+	const char* parseFloats(const char* cursor, const char* end, int count, std::vector<float>& values)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			float value = 0.0f;
+			cursor = parseFloat(skipSpaces(cursor, end), end, value);
+			values.push_back(value);
+		}
+		return cursor;
+	}
+
+	//One "p", "p/t", "p//n" or "p/t/n" corner; false at the end of the line, and for a malformed corner, which
+	//also marks the chunk invalid. Relative indices become indices into the chunk's lists, which may be
+	//negative; missing ones come out as -1.
+	bool parseCorner(const char*& cursor, const char* end, ObjChunk& chunk, PolygonCorner& corner)
+	{
+		cursor = skipSpaces(cursor, end);
+		if (cursor == end || *cursor == '\n')
+			return false;
+		const size_t counts[3] = { chunk.positions.size() / 3, chunk.uvs.size() / 2, chunk.normals.size() / 3 };
+		for (int i = 0; i < 3; i++)
+		{
+			long long index = 0;
+			bool valid = true;
+			if (i == 0)
+				cursor = parseIndex(cursor, end, index, valid);
+			else if (cursor < end && *cursor == '/')
+				cursor = parseIndex(cursor + 1, end, index, valid);
+			if (!valid || (i == 0 && index == 0))
+			{
+				chunk.valid = false;
+				return false;
+			}
+			corner.relative[i] = index < 0;
+			corner.index[i] = index < 0 ? (long long)counts[i] + index : index - 1;
+		}
+		return true;
+	}
+
+	void addCorner(ObjChunk& chunk, const PolygonCorner& corner)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			if (corner.relative[i])
+			{
+				RelativeIndex relative = { chunk.corners.size(), corner.index[i] };
+				chunk.relative.push_back(relative);
+			}
+			bool absent = corner.index[i] < 0 || corner.index[i] >= (long long)none;
+			chunk.corners.push_back(corner.relative[i] || absent ? none : (unsigned int)corner.index[i]);
+			chunk.valid = chunk.valid && (i != 0 || corner.relative[i] || !absent);
+		}
+	}
+
+	void parseChunk(ObjChunk& chunk)
+	{
+		std::vector<PolygonCorner> polygon;
+		const char* end = chunk.end;
+		for (const char* cursor = chunk.begin; cursor < end; cursor++)
+		{
+			cursor = skipSpaces(cursor, end);
+			char first = cursor < end ? *cursor : 0, second = cursor + 1 < end ? cursor[1] : 0;
+			if (first == 'v' && (second == ' ' || second == '\t'))
+				cursor = parseFloats(cursor + 1, end, 3, chunk.positions);
+			else if (first == 'v' && second == 't')
+				cursor = parseFloats(cursor + 2, end, 2, chunk.uvs);
+			else if (first == 'v' && second == 'n')
+				cursor = parseFloats(cursor + 2, end, 3, chunk.normals);
+			else if (first == 'f' && (second == ' ' || second == '\t'))
+			{
+				cursor++;
+				polygon.clear();
+				PolygonCorner corner;
+				while (parseCorner(cursor, end, chunk, corner))
+					polygon.push_back(corner);
+				for (size_t i = 2; i < polygon.size(); i++)
+				{
+					addCorner(chunk, polygon[0]);
+					addCorner(chunk, polygon[i - 1]);
+					addCorner(chunk, polygon[i]);
+					chunk.faces++;
+				}
+			}
+			cursor = findLineEnd(cursor, end);
+		}
+	}
+
+	//Open addressing from corner to vertex, growing at half full; only for files whose corners mix indices.
+	struct CornerTable
+	{
+		const unsigned int* corners;
+		std::vector<unsigned int> slots;     // vertex or none
+		std::vector<size_t> firstCorners;    // per vertex, the first corner slot that made it
+	};
+
+	size_t hashCorner(const unsigned int* corner)
+	{
+		return (size_t)(corner[0] * 73856093u ^ corner[1] * 19349663u ^ corner[2] * 83492791u);
+	}
+
+	void growCornerTable(CornerTable& table)
+	{
+		std::vector<unsigned int> grown(std::max(table.slots.size() * 2, (size_t)1 << 16), none);
+		size_t mask = grown.size() - 1;
+		for (size_t vertex = 0; vertex < table.firstCorners.size(); vertex++)
+		{
+			size_t probe = hashCorner(table.corners + table.firstCorners[vertex]) & mask;
+			while (grown[probe] != none)
+				probe = (probe + 1) & mask;
+			grown[probe] = (unsigned int)vertex;
+		}
+		table.slots.swap(grown);
+	}
+
+	//The vertex of the corner at slot, new ones numbered in order of appearance.
+	unsigned int cornerVertex(CornerTable& table, size_t slot)
+	{
+		if ((table.firstCorners.size() + 1) * 2 > table.slots.size())
+			growCornerTable(table);
+		const unsigned int* corner = table.corners + slot;
+		size_t mask = table.slots.size() - 1;
+		for (size_t probe = hashCorner(corner) & mask;; probe = (probe + 1) & mask)
+		{
+			unsigned int vertex = table.slots[probe];
+			if (vertex == none)
+			{
+				table.slots[probe] = (unsigned int)table.firstCorners.size();
+				table.firstCorners.push_back(slot);
+				return table.slots[probe];
+			}
+			if (memcmp(table.corners + table.firstCorners[vertex], corner, 3 * sizeof(unsigned int)) == 0)
+				return vertex;
+		}
+	}
+
+	void generateNormals(const std::vector<float>& positions, const std::vector<unsigned int>& vertexPositions,
+		ObjMesh& mesh)
+	{
+		std::vector<glm::vec3> normals(positions.size() / 3, glm::vec3(0.0f));
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			unsigned int corner[3];
+			glm::vec3 position[3];
+			for (int c = 0; c < 3; c++)
+			{
+				corner[c] = vertexPositions[mesh.indices[i + c]];
+				position[c] = glm::vec3(positions[corner[c] * 3], positions[corner[c] * 3 + 1], positions[corner[c] * 3 + 2]);
+			}
+			// area weighted: the cross product's length is twice the area
+			glm::vec3 normal = glm::cross(position[1] - position[0], position[2] - position[0]);
+			for (int c = 0; c < 3; c++)
+				normals[corner[c]] += normal;
+		}
+		for (size_t vertex = 0; vertex < vertexPositions.size(); vertex++)
+		{
+			glm::vec3 normal = normals[vertexPositions[vertex]];
+			float length = glm::length(normal);
+			normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+			memcpy(&mesh.vertices[vertex * mesh.vertexSize + 3], &normal[0], 3 * sizeof(float));
+		}
+	}
+}
+
+bool loadObjFile(const char* path, unsigned int threads, ObjMesh& mesh, ObjLoadStats& stats)
+{
+	memset(&stats, 0, sizeof(stats));
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	threads = std::max(threads, 1u);
+	MappedFile file;
+	if (!mapFile(path, file))
+	{
+		std::cout << "ERROR::OBJ::READ_FAILED " << path << std::endl;
+		return false;
+	}
+
+	// line aligned chunks, several per thread so a slow one doesn't hold up the rest
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	const char* text = (const char*)file.data;
+	const char* textEnd = text + file.size;
+	size_t chunkBytes = std::max(minimumChunkBytes, file.size / (threads * 8) + 1);
+	std::vector<ObjChunk> chunks;
+	for (const char* begin = text; begin < textEnd;)
+	{
+		const char* end = begin + std::min(chunkBytes, (size_t)(textEnd - begin));
+		end = end < textEnd ? std::min(findLineEnd(end, textEnd) + 1, textEnd) : textEnd;
+		chunks.push_back(ObjChunk());
+		chunks.back().begin = begin;
+		chunks.back().end = end;
+		chunks.back().faces = 0;
+		chunks.back().valid = true;
+		begin = end;
+	}
+	parallelFor(chunks.size(), threads, [&](size_t i) { parseChunk(chunks[i]); });
+	stats.parseMs = millisecondsSince(start);
+
+	// where each chunk's lists go, then copy them there and resolve relative indices
+	start = std::chrono::steady_clock::now();
+	std::vector<size_t> bases(chunks.size() * 4, 0);
+	size_t totals[4] = { 0, 0, 0, 0 };
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		const size_t sizes[4] = { chunks[i].positions.size(), chunks[i].uvs.size(), chunks[i].normals.size(),
+			chunks[i].corners.size() };
+		for (int list = 0; list < 4; list++)
+		{
+			bases[i * 4 + list] = totals[list];
+			totals[list] += sizes[list];
+		}
+		stats.faces += chunks[i].faces;
+	}
+	std::vector<float> positions(totals[0]), uvs(totals[1]), normals(totals[2]);
+	std::vector<unsigned int> corners(totals[3]);
+	const size_t counts[3] = { totals[0] / 3, totals[1] / 2, totals[2] / 3 };
+	std::vector<unsigned char> valid(chunks.size()), shared(chunks.size()), normalsEverywhere(chunks.size());
+	std::vector<unsigned char> anyUvs(chunks.size());
+	parallelFor(chunks.size(), threads, [&](size_t i)
+	{
+		ObjChunk& chunk = chunks[i];
+		std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + bases[i * 4]);
+		std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + bases[i * 4 + 1]);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + bases[i * 4 + 2]);
+		unsigned int* target = corners.data() + bases[i * 4 + 3];
+		std::copy(chunk.corners.begin(), chunk.corners.end(), target);
+		bool chunkValid = chunk.valid;
+		for (size_t r = 0; r < chunk.relative.size(); r++)
+		{
+			size_t list = chunk.relative[r].slot % 3;
+			long long index = (long long)(bases[i * 4 + list] / (list == 1 ? 2 : 3)) + chunk.relative[r].local;
+			chunkValid = chunkValid && index >= 0;
+			target[chunk.relative[r].slot] = index >= 0 ? (unsigned int)index : none;
+		}
+		bool chunkShared = true, chunkNormals = true, chunkUvs = false;
+		for (size_t c = 0; c < chunk.corners.size(); c += 3)
+		{
+			unsigned int position = target[c], uv = target[c + 1], normal = target[c + 2];
+			chunkValid = chunkValid && position < counts[0] && (uv == none || uv < counts[1]) &&
+				(normal == none || normal < counts[2]);
+			chunkShared = chunkShared && (uv == none || uv == position) && (normal == none || normal == position);
+			chunkNormals = chunkNormals && normal != none;
+			chunkUvs = chunkUvs || uv != none;
+		}
+		valid[i] = chunkValid;
+		shared[i] = chunkShared;
+		normalsEverywhere[i] = chunkNormals;
+		anyUvs[i] = chunkUvs;
+		chunk = ObjChunk();
+	});
+	stats.mergeMs = millisecondsSince(start);
+	stats.bytes = file.size;
+	unmapFile(file);
+	stats.chunks = chunks.size();
+	stats.positions = counts[0];
+	if (std::find(valid.begin(), valid.end(), 0) != valid.end())
+	{
+		std::cout << "ERROR::OBJ::BAD_INDEX " << path << std::endl;
+		return false;
+	}
+
+	// corners into vertices: one per position when the file shares indices, through the table otherwise
+	start = std::chrono::steady_clock::now();
+	stats.sharedIndices = std::find(shared.begin(), shared.end(), 0) == shared.end();
+	bool hasNormals = std::find(normalsEverywhere.begin(), normalsEverywhere.end(), 0) == normalsEverywhere.end();
+	bool hasUvs = std::find(anyUvs.begin(), anyUvs.end(), 1) != anyUvs.end();
+	mesh.vertexSize = hasUvs ? 8 : 6;
+	mesh.generatedNormals = !hasNormals;
+	std::vector<unsigned int> vertexCorners;   // per vertex: position, uv, normal
+	size_t cornerCount = corners.size() / 3;
+	mesh.indices.resize(cornerCount);
+	if (stats.sharedIndices)
+	{
+		vertexCorners.resize(counts[0] * 3);
+		for (size_t vertex = 0; vertex < counts[0]; vertex++)
+		{
+			vertexCorners[vertex * 3] = (unsigned int)vertex;
+			vertexCorners[vertex * 3 + 1] = vertex < counts[1] ? (unsigned int)vertex : none;
+			vertexCorners[vertex * 3 + 2] = vertex < counts[2] ? (unsigned int)vertex : none;
+		}
+		for (size_t corner = 0; corner < cornerCount; corner++)
+			mesh.indices[corner] = corners[corner * 3];
+	}
+	else
+	{
+		CornerTable table;
+		table.corners = corners.data();
+		for (size_t corner = 0; corner < cornerCount; corner++)
+			mesh.indices[corner] = cornerVertex(table, corner * 3);
+		vertexCorners.resize(table.firstCorners.size() * 3);
+		for (size_t vertex = 0; vertex < table.firstCorners.size(); vertex++)
+			memcpy(&vertexCorners[vertex * 3], &corners[table.firstCorners[vertex]], 3 * sizeof(unsigned int));
+	}
+	std::vector<unsigned int>().swap(corners);
+
+	size_t vertexCount = vertexCorners.size() / 3;
+	const size_t blockVertices = 1 << 16;
+	mesh.vertices.resize(vertexCount * mesh.vertexSize);
+	parallelFor((vertexCount + blockVertices - 1) / blockVertices, threads, [&](size_t block)
+	{
+		for (size_t vertex = block * blockVertices; vertex < std::min(vertexCount, (block + 1) * blockVertices); vertex++)
+		{
+			float* target = &mesh.vertices[vertex * mesh.vertexSize];
+			unsigned int position = vertexCorners[vertex * 3], uv = vertexCorners[vertex * 3 + 1];
+			unsigned int normal = vertexCorners[vertex * 3 + 2];
+			memcpy(target, &positions[(size_t)position * 3], 3 * sizeof(float));
+			// unreferenced positions of a file with normals may have none
+			if (hasNormals && normal != none)
+				memcpy(target + 3, &normals[(size_t)normal * 3], 3 * sizeof(float));
+			else
+			{
+				target[3] = target[5] = 0.0f;
+				target[4] = 1.0f;
+			}
+			if (hasUvs)
+			{
+				target[6] = uv != none ? uvs[(size_t)uv * 2] : 0.0f;
+				target[7] = uv != none ? uvs[(size_t)uv * 2 + 1] : 0.0f;
+			}
+		}
+	});
+	if (!hasNormals)
+	{
+		std::vector<unsigned int> vertexPositions(vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+			vertexPositions[vertex] = vertexCorners[vertex * 3];
+		generateNormals(positions, vertexPositions, mesh);
+	}
+	stats.weldMs = millisecondsSince(start);
+	return true;
+}
+
+void printObjLoadStats(const char* name, const ObjMesh& mesh, const ObjLoadStats& stats)
+{
+	double total = stats.parseMs + stats.mergeMs + stats.weldMs;
+	std::cout << "OBJ " << name << ": " << stats.bytes / (1024 * 1024) << " MiB in " << stats.chunks << " chunks, "
+		<< stats.positions << " positions, " << stats.faces << " triangles -> " << mesh.vertices.size() / mesh.vertexSize
+		<< " vertices x " << mesh.vertexSize << " floats" << (mesh.generatedNormals ? " (normals generated)" : "")
+		<< "; parse " << stats.parseMs << " ms, merge " << stats.mergeMs << " ms, weld " << stats.weldMs << " ms ("
+		<< (stats.sharedIndices ? "shared indices" : "hashed corners") << "), "
+		<< stats.bytes / (1024.0 * 1024.0) * 1000.0 / total << " MiB/s" << std::endl;
+}
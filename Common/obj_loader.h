@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+//Wavefront OBJ loader for large files. The file is memory mapped and cut into line-aligned chunks that
+//threads parse at the same time: lines are found 16 bytes at a time with SSE2, numbers go through a fast
+//path reading eight digits at once (SWAR) that falls back to strtod for anything unusual. The chunks are then
+//merged in file order, relative (negative) indices resolved and face corners welded into vertices:
+//directly in parallel when every corner uses one index for position, uv and normal (as most exporters write
+//them), through a hash of the corners otherwise.
+//
+//Reads v, vt, vn and f (polygons fanned into triangles); groups, materials, smoothing groups, lines and
+//points are skipped. Files without normals get area weighted vertex normals.
+
+struct ObjMesh
+{
+	size_t vertexSize;              // floats: position, normal (6) and texture coordinate when the file has them (8)
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	bool generatedNormals;
+};
+
+struct ObjLoadStats
+{
+	size_t bytes;
+	size_t chunks;
+	size_t positions;
+	size_t faces;
+	bool sharedIndices;             // the corners needed no hash
+	double parseMs;
+	double mergeMs;
+	double weldMs;
+};
+
+//Fails with a message for unreadable files and out of range indices.
+bool loadObjFile(const char* path, unsigned int threads, ObjMesh& mesh, ObjLoadStats& stats);
+void printObjLoadStats(const char* name, const ObjMesh& mesh, const ObjLoadStats& stats);
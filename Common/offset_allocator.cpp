@@ -0,0 +1,324 @@
+#include "offset_allocator.h"
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+	const int secondLevelBits = 3;
+	const unsigned int secondLevelCount = 1u << secondLevelBits;
+	const unsigned int none = invalidAllocation;
+
+	int lowestBit(unsigned int mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (int)index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	int highestBit(unsigned int mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse(&index, mask);
+		return (int)index;
+#else
+		return 31 - __builtin_clz(mask);
+#endif
+	}
+
+	//Sizes below 8 get a bin each in the first level, above that 8 bins split every power of two.
+	void binOf(unsigned int size, unsigned int& first, unsigned int& second)
+	{
+		if (size < secondLevelCount)
+		{
+			first = 0;
+			second = size;
+			return;
+		}
+		int log = highestBit(size);
+		first = log - secondLevelBits + 1;
+		second = (size >> (log - secondLevelBits)) & (secondLevelCount - 1);
+	}
+
+	//The first bin whose every range holds size, so the search never has to look inside a bin.
+	void searchBinOf(unsigned int size, unsigned int& first, unsigned int& second)
+	{
+		if (size >= secondLevelCount)
+			size += (1u << (highestBit(size) - secondLevelBits)) - 1;
+		binOf(size, first, second);
+	}
+
+	unsigned int newNode(OffsetAllocator& allocator)
+	{
+		if (!allocator.unusedNodes.empty())
+		{
+			unsigned int node = allocator.unusedNodes.back();
+			allocator.unusedNodes.pop_back();
+			return node;
+		}
+		allocator.nodes.push_back(OffsetAllocator::Node());
+		return (unsigned int)allocator.nodes.size() - 1;
+	}
+
+	void insertFree(OffsetAllocator& allocator, unsigned int node)
+	{
+		OffsetAllocator::Node& free = allocator.nodes[node];
+		unsigned int first, second;
+		binOf(free.size, first, second);
+		unsigned int& head = allocator.bins[first * secondLevelCount + second];
+		free.used = false;
+		free.previousFree = none;
+		free.nextFree = head;
+		if (head != none)
+			allocator.nodes[head].previousFree = node;
+		head = node;
+		allocator.firstLevelMap |= 1u << first;
+		allocator.secondLevelMaps[first] |= 1u << second;
+	}
+
+	void removeFree(OffsetAllocator& allocator, unsigned int node)
+	{
+		OffsetAllocator::Node& free = allocator.nodes[node];
+		if (free.previousFree != none)
+			allocator.nodes[free.previousFree].nextFree = free.nextFree;
+		else
+		{
+			unsigned int first, second;
+			binOf(free.size, first, second);
+			allocator.bins[first * secondLevelCount + second] = free.nextFree;
+			if (free.nextFree == none)
+			{
+				allocator.secondLevelMaps[first] &= ~(1u << second);
+				if (!allocator.secondLevelMaps[first])
+					allocator.firstLevelMap &= ~(1u << first);
+			}
+		}
+		if (free.nextFree != none)
+			allocator.nodes[free.nextFree].previousFree = free.previousFree;
+	}
+
+	//Joins node's range onto its physical predecessor and recycles node. Recycled nodes have size 0.
+	void mergeIntoPrevious(OffsetAllocator& allocator, unsigned int node)
+	{
+		OffsetAllocator::Node& merged = allocator.nodes[node];
+		OffsetAllocator::Node& previous = allocator.nodes[merged.previous];
+		previous.size += merged.size;
+		previous.next = merged.next;
+		if (merged.next != none)
+			allocator.nodes[merged.next].previous = merged.previous;
+		merged.size = 0;
+		allocator.unusedNodes.push_back(node);
+	}
+
+	//A free range of at least size: the head of the first bin above size's own, or failing that (the space left
+	//is one range just a little bigger than asked for) the first one big enough in size's own bin.
+	unsigned int findFree(const OffsetAllocator& allocator, unsigned int size)
+	{
+		unsigned int first, second;
+		searchBinOf(size, first, second);
+		if (first < 32)
+		{
+			unsigned int secondMap = allocator.secondLevelMaps[first] & (~0u << second);
+			unsigned int firstMap = first + 1 < 32 ? allocator.firstLevelMap & (~0u << (first + 1)) : 0;
+			if (!secondMap && firstMap)
+			{
+				first = lowestBit(firstMap);
+				secondMap = allocator.secondLevelMaps[first];
+			}
+			if (secondMap)
+				return allocator.bins[first * secondLevelCount + lowestBit(secondMap)];
+		}
+		binOf(size, first, second);
+		for (unsigned int node = allocator.bins[first * secondLevelCount + second]; node != none; node = allocator.nodes[node].nextFree)
+			if (allocator.nodes[node].size >= size)
+				return node;
+		return none;
+	}
+
+	unsigned int lastNode(const OffsetAllocator& allocator)
+	{
+		unsigned int last = none;
+		for (unsigned int i = 0; i < allocator.nodes.size(); i++)
+		{
+			const OffsetAllocator::Node& node = allocator.nodes[i];
+			if (node.size && node.next == none && node.offset + node.size == allocator.capacity)
+				last = i;
+		}
+		return last;
+	}
+}
+
+void initOffsetAllocator(OffsetAllocator& allocator, unsigned int capacity)
+{
+	allocator.capacity = 0;
+	allocator.used = 0;
+	allocator.allocations = 0;
+	allocator.firstLevelMap = 0;
+	std::fill(allocator.secondLevelMaps, allocator.secondLevelMaps + 32, 0u);
+	std::fill(allocator.bins, allocator.bins + 32 * secondLevelCount, none);
+	allocator.nodes.clear();
+	allocator.unusedNodes.clear();
+	growOffsetAllocator(allocator, capacity);
+}
+
+unsigned int allocateRange(OffsetAllocator& allocator, unsigned int size)
+{
+	size = std::max(size, 1u);
+	unsigned int node = findFree(allocator, size);
+	if (node == none)
+		return none;
+	removeFree(allocator, node);
+	// the rest of the range stays free behind the allocation
+	if (allocator.nodes[node].size > size)
+	{
+		unsigned int rest = newNode(allocator);
+		OffsetAllocator::Node& allocated = allocator.nodes[node];
+		OffsetAllocator::Node& remainder = allocator.nodes[rest];
+		remainder.offset = allocated.offset + size;
+		remainder.size = allocated.size - size;
+		remainder.previous = node;
+		remainder.next = allocated.next;
+		if (allocated.next != none)
+			allocator.nodes[allocated.next].previous = rest;
+		allocated.next = rest;
+		allocated.size = size;
+		insertFree(allocator, rest);
+	}
+	allocator.nodes[node].used = true;
+	allocator.used += size;
+	allocator.allocations++;
+	return node;
+}
+
+void freeRange(OffsetAllocator& allocator, unsigned int allocation)
+{
+	if (allocation >= allocator.nodes.size() || !allocator.nodes[allocation].used)
+		return;
+	unsigned int node = allocation;
+	allocator.used -= allocator.nodes[node].size;
+	allocator.allocations--;
+	allocator.nodes[node].used = false;
+
+	unsigned int next = allocator.nodes[node].next;
+	if (next != none && !allocator.nodes[next].used)
+	{
+		removeFree(allocator, next);
+		mergeIntoPrevious(allocator, next);
+	}
+	unsigned int previous = allocator.nodes[node].previous;
+	if (previous != none && !allocator.nodes[previous].used)
+	{
+		removeFree(allocator, previous);
+		mergeIntoPrevious(allocator, node);
+		node = previous;
+	}
+	insertFree(allocator, node);
+}
+
+unsigned int rangeOffset(const OffsetAllocator& allocator, unsigned int allocation)
+{
+	return allocator.nodes[allocation].offset;
+}
+
+unsigned int rangeSize(const OffsetAllocator& allocator, unsigned int allocation)
+{
+	return allocator.nodes[allocation].size;
+}
+
+void growOffsetAllocator(OffsetAllocator& allocator, unsigned int capacity)
+{
+	if (capacity <= allocator.capacity)
+		return;
+	unsigned int last = lastNode(allocator);
+	if (last != none && !allocator.nodes[last].used)
+	{
+		removeFree(allocator, last);
+		allocator.nodes[last].size += capacity - allocator.capacity;
+		insertFree(allocator, last);
+	}
+	else
+	{
+		unsigned int node = newNode(allocator);
+		OffsetAllocator::Node& free = allocator.nodes[node];
+		free.offset = allocator.capacity;
+		free.size = capacity - allocator.capacity;
+		free.previous = last;
+		free.next = none;
+		if (last != none)
+			allocator.nodes[last].next = node;
+		insertFree(allocator, node);
+	}
+	allocator.capacity = capacity;
+}
+
+void defragmentOffsetAllocator(OffsetAllocator& allocator, std::vector<RangeMove>& moves)
+{
+	moves.clear();
+	unsigned int node = none;
+	for (unsigned int i = 0; i < allocator.nodes.size() && node == none; i++)
+		if (allocator.nodes[i].size && allocator.nodes[i].offset == 0)
+			node = i;
+
+	// walk the ranges in offset order, sliding the used ones down and recycling the free ones
+	unsigned int offset = 0, previous = none;
+	while (node != none)
+	{
+		OffsetAllocator::Node& range = allocator.nodes[node];
+		unsigned int next = range.next;
+		if (range.used)
+		{
+			RangeMove move = { range.offset, offset, range.size };
+			moves.push_back(move);
+			range.offset = offset;
+			range.previous = previous;
+			if (previous != none)
+				allocator.nodes[previous].next = node;
+			offset += range.size;
+			previous = node;
+		}
+		else
+		{
+			range.size = 0;
+			allocator.unusedNodes.push_back(node);
+		}
+		node = next;
+	}
+	if (previous != none)
+		allocator.nodes[previous].next = none;
+
+	allocator.firstLevelMap = 0;
+	std::fill(allocator.secondLevelMaps, allocator.secondLevelMaps + 32, 0u);
+	std::fill(allocator.bins, allocator.bins + 32 * secondLevelCount, none);
+	if (offset < allocator.capacity)
+	{
+		unsigned int free = newNode(allocator);
+		OffsetAllocator::Node& tail = allocator.nodes[free];
+		tail.offset = offset;
+		tail.size = allocator.capacity - offset;
+		tail.previous = previous;
+		tail.next = none;
+		if (previous != none)
+			allocator.nodes[previous].next = free;
+		insertFree(allocator, free);
+	}
+}
+
+OffsetAllocatorStats getOffsetAllocatorStats(const OffsetAllocator& allocator)
+{
+	OffsetAllocatorStats stats = { allocator.capacity, allocator.used, allocator.allocations, 0, 0, 0.0f };
+	for (unsigned int bin = 0; bin < 32 * secondLevelCount; bin++)
+		for (unsigned int node = allocator.bins[bin]; node != none; node = allocator.nodes[node].nextFree)
+		{
+			stats.freeRanges++;
+			stats.largestFree = std::max(stats.largestFree, allocator.nodes[node].size);
+		}
+	unsigned int free = allocator.capacity - allocator.used;
+	stats.fragmentation = free ? 1.0f - (float)stats.largestFree / free : 0.0f;
+	return stats;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+
+//Two-level segregated fit (TLSF) allocator of ranges in [0, capacity), for memory it doesn't own such as a GL
+//buffer. Free ranges sit in 8 bins per power of two, found through two bitmaps, so allocating and freeing are
+//constant time; freed ranges merge with free neighbours at once. Sizes and offsets are in caller units
+//(bytes, vertices, indices), capacity below 2^31.
+//
+//Allocations are identified by a handle that stays valid until freed, also across defragmentation, which
+//moves the ranges and changes their offsets.
+
+const unsigned int invalidAllocation = 0xffffffffu;
+
+struct OffsetAllocatorStats
+{
+	unsigned int capacity;
+	unsigned int used;
+	unsigned int allocations;
+	unsigned int freeRanges;
+	unsigned int largestFree;
+	float fragmentation;   // 1 - largestFree / free space, 0 when the free space is one range
+};
+
+struct OffsetAllocator
+{
+	struct Node
+	{
+		unsigned int offset;
+		unsigned int size;
+		unsigned int previous;       // neighbours by offset
+		unsigned int next;
+		unsigned int previousFree;   // bin list
+		unsigned int nextFree;
+		bool used;
+	};
+
+	unsigned int capacity;
+	unsigned int used;
+	unsigned int allocations;
+	unsigned int firstLevelMap;
+	unsigned int secondLevelMaps[32];
+	unsigned int bins[32 * 8];       // first free node of each bin
+	std::vector<Node> nodes;
+	std::vector<unsigned int> unusedNodes;
+};
+
+void initOffsetAllocator(OffsetAllocator& allocator, unsigned int capacity);
+//Returns the handle, or invalidAllocation when no free range holds size.
+unsigned int allocateRange(OffsetAllocator& allocator, unsigned int size);
+void freeRange(OffsetAllocator& allocator, unsigned int allocation);
+unsigned int rangeOffset(const OffsetAllocator& allocator, unsigned int allocation);
+unsigned int rangeSize(const OffsetAllocator& allocator, unsigned int allocation);
+//Adds free space at the end.
+void growOffsetAllocator(OffsetAllocator& allocator, unsigned int capacity);
+
+struct RangeMove
+{
+	unsigned int from;
+	unsigned int to;
+	unsigned int size;
+};
+//Packs every allocation to the front in offset order, leaving one free range at the end, and lists where every
+//allocation went (from == to for the ones that stay), in offset order, for the caller to copy its data.
+void defragmentOffsetAllocator(OffsetAllocator& allocator, std::vector<RangeMove>& moves);
+
+OffsetAllocatorStats getOffsetAllocatorStats(const OffsetAllocator& allocator);
@@ -0,0 +1,248 @@
+#include "program_cache.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+//glProgramBinary is core in 4.1, the bundled glad only goes up to 4.0
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace
+{
+	typedef void (APIENTRYP GetProgramBinaryProc)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+	typedef void (APIENTRYP ProgramBinaryProc)(GLuint, GLenum, const void*, GLsizei);
+	typedef void (APIENTRYP ProgramParameteriProc)(GLuint, GLenum, GLint);
+
+	const unsigned int cacheMagic = 0x43475050; // "PPGC"
+	const unsigned int cacheVersion = 1;
+
+	struct CacheHeader
+	{
+		unsigned int magic;
+		unsigned int version;
+		unsigned int format;
+		unsigned int length;
+	};
+
+	ProgramCacheStats stats = {};
+	bool initialized = false;
+	bool supported = false;
+	GetProgramBinaryProc getProgramBinary = NULL;
+	ProgramBinaryProc programBinary = NULL;
+	ProgramParameteriProc programParameteri = NULL;
+	std::string cacheDirectory;
+
+	void initialize()
+	{
+		initialized = true;
+		getProgramBinary = (GetProgramBinaryProc)glfwGetProcAddress("glGetProgramBinary");
+		programBinary = (ProgramBinaryProc)glfwGetProcAddress("glProgramBinary");
+		programParameteri = (ProgramParameteriProc)glfwGetProcAddress("glProgramParameteri");
+
+		GLint formats = 0;
+		if (getProgramBinary && programBinary && programParameteri)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		glGetError(); // the enum is unknown before 4.1
+		supported = formats > 0;
+
+		const char* directory = getenv("PROGRAM_CACHE_DIR");
+		cacheDirectory = directory ? directory : "program_cache";
+#ifdef _WIN32
+		_mkdir(cacheDirectory.c_str());
+#else
+		mkdir(cacheDirectory.c_str(), 0755);
+#endif
+	}
+
+	//FNV-1a, good enough to tell shader sources apart
+	unsigned long long hashString(unsigned long long hash, const char* text)
+	{
+		for (; text && *text; ++text)
+		{
+			hash ^= (unsigned char)*text;
+			hash *= 1099511628211ULL;
+		}
+		hash ^= 0xff; // separator so "ab"+"c" != "a"+"bc"
+		hash *= 1099511628211ULL;
+		return hash;
+	}
+
+	std::string cachePath(const char* vertexShaderSource, const char* fragmentShaderSource)
+	{
+		unsigned long long hash = 14695981039346656037ULL;
+		hash = hashString(hash, vertexShaderSource);
+		hash = hashString(hash, fragmentShaderSource);
+		hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+		hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", hash);
+		return cacheDirectory + "/" + name;
+	}
+
+	bool loadProgram(const std::string& path, unsigned int shaderProgram)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file)
+			return false;
+
+		CacheHeader header;
+		std::vector<char> binary;
+		bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+			header.magic == cacheMagic && header.version == cacheVersion;
+		if (valid)
+		{
+			binary.resize(header.length);
+			valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+		}
+		fclose(file);
+		if (!valid)
+			return false;
+
+		programBinary(shaderProgram, header.format, binary.data(), (GLsizei)binary.size());
+		int success;
+		glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+		if (!success)
+			glGetError(); // a rejected binary may leave GL_INVALID_ENUM behind, don't let it reach the caller
+		return success != 0;
+	}
+
+	void storeProgram(const std::string& path, unsigned int shaderProgram)
+	{
+		GLint length = 0;
+		glGetProgramiv(shaderProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		getProgramBinary(shaderProgram, length, NULL, &format, binary.data());
+
+		FILE* file = fopen(path.c_str(), "wb");
+		if (!file)
+			return;
+		CacheHeader header = { cacheMagic, cacheVersion, format, (unsigned int)length };
+		bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(binary.data(), 1, binary.size(), file) == binary.size();
+		fclose(file);
+		if (written)
+			stats.stores++;
+	}
+
+	unsigned int compileShader(const char* shaderSourceCode, unsigned int shaderType)
+	{
+		unsigned int shaderId = glCreateShader(shaderType);
+		glShaderSource(shaderId, 1, &shaderSourceCode, NULL);
+		glCompileShader(shaderId);
+
+		int success;
+		glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			char infoLog[512];
+			glGetShaderInfoLog(shaderId, 512, NULL, infoLog);
+			std::cout << (shaderType == GL_VERTEX_SHADER ?
+				"ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" :
+				"ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n") << infoLog << std::endl;
+		}
+		return shaderId;
+	}
+
+	int compileAndLinkProgram(const char* vertexShaderSource, const char* fragmentShaderSource, unsigned int shaderProgram)
+	{
+		unsigned int vertexShader = compileShader(vertexShaderSource, GL_VERTEX_SHADER);
+		unsigned int fragmentShader = compileShader(fragmentShaderSource, GL_FRAGMENT_SHADER);
+
+		if (supported)
+			programParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glAttachShader(shaderProgram, vertexShader);
+		glAttachShader(shaderProgram, fragmentShader);
+		glLinkProgram(shaderProgram);
+		glDetachShader(shaderProgram, vertexShader);
+		glDetachShader(shaderProgram, fragmentShader);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+
+		int success;
+		glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			char infoLog[512];
+			glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		}
+		return success;
+	}
+}
+
+int createCachedShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource, unsigned int& shaderProgram)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (!initialized)
+		initialize();
+
+	shaderProgram = glCreateProgram();
+	std::string path;
+	int success = 0;
+	bool hit = false;
+
+	if (supported)
+	{
+		path = cachePath(vertexShaderSource, fragmentShaderSource);
+		FILE* probe = fopen(path.c_str(), "rb");
+		if (probe)
+		{
+			fclose(probe);
+			hit = loadProgram(path, shaderProgram);
+			if (!hit)
+			{
+				// a failed glProgramBinary leaves the program unusable, start over
+				stats.rejected++;
+				glDeleteProgram(shaderProgram);
+				shaderProgram = glCreateProgram();
+			}
+		}
+	}
+
+	if (hit)
+	{
+		stats.hits++;
+		success = 1;
+	}
+	else
+	{
+		stats.misses++;
+		success = compileAndLinkProgram(vertexShaderSource, fragmentShaderSource, shaderProgram);
+		if (success && supported)
+			storeProgram(path, shaderProgram);
+	}
+
+	stats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return success;
+}
+
+ProgramCacheStats getProgramCacheStats()
+{
+	return stats;
+}
+
+void printProgramCacheStats()
+{
+	std::cout << "Program cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+		<< stats.rejected << " rejected, " << stats.stores << " stored, "
+		<< stats.milliseconds << " ms" << (supported ? "" : " (program binaries unsupported)") << std::endl;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+//On-disk cache of linked shader programs.
+//The key is a hash of the vertex and fragment sources plus the GL renderer/version strings,
+//the value is the driver blob from glGetProgramBinary. A missing, stale or rejected entry
+//falls back to a normal compile and link, and the fresh binary replaces the entry.
+//
+//The cache directory is PROGRAM_CACHE_DIR, or ./program_cache when it is not set.
+
+struct ProgramCacheStats
+{
+	unsigned int hits;       // programs restored with glProgramBinary
+	unsigned int misses;     // programs compiled from source
+	unsigned int rejected;   // entries the driver refused (format or driver mismatch)
+	unsigned int stores;     // binaries written back to disk
+	double milliseconds;     // total time spent creating programs
+};
+
+//Same contract as createAndLinkShaderProgram: returns the GL_LINK_STATUS of shaderProgram.
+//Compile and link errors are written to std::cout.
+int createCachedShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource, unsigned int& shaderProgram);
+
+ProgramCacheStats getProgramCacheStats();
+void printProgramCacheStats();
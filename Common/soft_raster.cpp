@@ -0,0 +1,476 @@
+#include "soft_raster.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFT_RASTER_SSE 1
+#include <emmintrin.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	//f(x, y) = a * x + b * y + c over the screen
+	struct Plane
+	{
+		float a, b, c;
+	};
+
+	struct SetupTriangle
+	{
+		Plane edges[3];     // >= 0 inside
+		bool topLeft[3];    // pixels exactly on the edge belong to this triangle
+		Plane depth;
+		Plane invW;
+		Plane varyings[rasterMaxVaryings];  // varying / w, divided by the interpolated 1 / w per pixel
+		unsigned int varyingCount;
+		int minX, minY, maxX, maxY;         // inclusive pixel bounds, inside the target
+		RasterFragmentShader shader;
+		const void* uniforms;
+	};
+
+	unsigned int packColor(const glm::vec4& color)
+	{
+		glm::vec4 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+		return (unsigned int)c.r | (unsigned int)c.g << 8 | (unsigned int)c.b << 16 | (unsigned int)c.a << 24;
+	}
+}
+
+struct RasterPool
+{
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	unsigned long long generation;
+	unsigned int busy;
+	bool quit;
+	std::atomic<int> nextTile;
+
+	RasterTarget* target;
+	int tilesX;
+	int tilesY;
+	unsigned int clearColor;
+	std::vector<SetupTriangle> triangles;
+	std::vector<std::vector<unsigned int> > bins;  // triangle indices per tile, in submission order
+};
+
+namespace
+{
+	Plane planeOf(const glm::dvec2* p, double f0, double f1, double f2, double det)
+	{
+		double dfdx = ((f1 - f0) * (p[2].y - p[0].y) - (f2 - f0) * (p[1].y - p[0].y)) / det;
+		double dfdy = ((f2 - f0) * (p[1].x - p[0].x) - (f1 - f0) * (p[2].x - p[0].x)) / det;
+		Plane plane = { (float)dfdx, (float)dfdy, (float)(f0 - dfdx * p[0].x - dfdy * p[0].y) };
+		return plane;
+	}
+
+	//Edge from (xi, yi) to (xj, yj). Swapping the ends negates every coefficient exactly, which is what
+	//makes shared edges watertight.
+	Plane edgeOf(float xi, float yi, float xj, float yj)
+	{
+		Plane edge = { yi - yj, xj - xi, xi * yj - xj * yi };
+		return edge;
+	}
+
+	bool tileRejected(const SetupTriangle& triangle, int tileX, int tileY)
+	{
+		// the pixel center of the tile that lies furthest inside each edge
+		for (int e = 0; e < 3; e++)
+		{
+			const Plane& edge = triangle.edges[e];
+			float x = (float)(tileX * rasterTileSize) + (edge.a > 0.0f ? rasterTileSize - 0.5f : 0.5f);
+			float y = (float)(tileY * rasterTileSize) + (edge.b > 0.0f ? rasterTileSize - 0.5f : 0.5f);
+			if (edge.a * x + (edge.b * y + edge.c) < 0.0f)
+				return true;
+		}
+		return false;
+	}
+
+	void setupTriangle(RasterPool* pool, const RasterVertex* v[3], unsigned int varyingCount,
+		RasterFragmentShader shader, const void* uniforms)
+	{
+		const RasterTarget& target = *pool->target;
+		float x[3], y[3], z[3], invW[3];
+		for (int i = 0; i < 3; i++)
+		{
+			invW[i] = 1.0f / v[i]->position.w;
+			x[i] = (v[i]->position.x * invW[i] * 0.5f + 0.5f) * target.width;
+			y[i] = (0.5f - v[i]->position.y * invW[i] * 0.5f) * target.height;  // row 0 at the top
+			z[i] = v[i]->position.z * invW[i] * 0.5f + 0.5f;
+		}
+
+		SetupTriangle triangle;
+		triangle.edges[0] = edgeOf(x[1], y[1], x[2], y[2]);
+		triangle.edges[1] = edgeOf(x[2], y[2], x[0], y[0]);
+		triangle.edges[2] = edgeOf(x[0], y[0], x[1], y[1]);
+		glm::dvec2 p[3] = { glm::dvec2(x[0], y[0]), glm::dvec2(x[1], y[1]), glm::dvec2(x[2], y[2]) };
+		double det = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+		if (!(det != 0.0) || !std::isfinite(det))
+			return;
+		for (int e = 0; e < 3; e++)
+		{
+			Plane& edge = triangle.edges[e];
+			if (det < 0.0)
+			{
+				// both faces are drawn, turn clockwise triangles around
+				edge.a = -edge.a;
+				edge.b = -edge.b;
+				edge.c = -edge.c;
+			}
+			triangle.topLeft[e] = edge.a > 0.0f || (edge.a == 0.0f && edge.b > 0.0f);
+		}
+
+		triangle.minX = std::max(0, (int)std::floor(std::min(x[0], std::min(x[1], x[2]))));
+		triangle.minY = std::max(0, (int)std::floor(std::min(y[0], std::min(y[1], y[2]))));
+		triangle.maxX = std::min(target.width - 1, (int)std::ceil(std::max(x[0], std::max(x[1], x[2]))));
+		triangle.maxY = std::min(target.height - 1, (int)std::ceil(std::max(y[0], std::max(y[1], y[2]))));
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+			return;
+
+		triangle.depth = planeOf(p, z[0], z[1], z[2], det);
+		triangle.invW = planeOf(p, invW[0], invW[1], invW[2], det);
+		for (unsigned int i = 0; i < varyingCount; i++)
+			triangle.varyings[i] = planeOf(p, v[0]->varyings[i] * invW[0], v[1]->varyings[i] * invW[1],
+				v[2]->varyings[i] * invW[2], det);
+		triangle.varyingCount = varyingCount;
+		triangle.shader = shader;
+		triangle.uniforms = uniforms;
+
+		unsigned int index = (unsigned int)pool->triangles.size();
+		pool->triangles.push_back(triangle);
+		for (int tileY = triangle.minY / rasterTileSize; tileY <= triangle.maxY / rasterTileSize; tileY++)
+			for (int tileX = triangle.minX / rasterTileSize; tileX <= triangle.maxX / rasterTileSize; tileX++)
+				if (!tileRejected(triangle, tileX, tileY))
+					pool->bins[tileY * pool->tilesX + tileX].push_back(index);
+	}
+
+	//The point where the edge from inside to outside crosses the near plane (z = -w). Always computed
+	//from the inside vertex, so two triangles sharing the edge get the same point.
+	RasterVertex nearIntersection(const RasterVertex& inside, const RasterVertex& outside, unsigned int varyingCount)
+	{
+		float dInside = inside.position.z + inside.position.w;
+		float dOutside = outside.position.z + outside.position.w;
+		float t = dInside / (dInside - dOutside);
+		RasterVertex result;
+		result.position = inside.position + (outside.position - inside.position) * t;
+		for (unsigned int i = 0; i < varyingCount; i++)
+			result.varyings[i] = inside.varyings[i] + (outside.varyings[i] - inside.varyings[i]) * t;
+		return result;
+	}
+
+	void shadeTriangle(const SetupTriangle& triangle, RasterTarget& target, int tileX, int tileY)
+	{
+		int x0 = std::max(triangle.minX, tileX * rasterTileSize) & ~3;
+		int x1 = std::min(triangle.maxX + 1, (tileX + 1) * rasterTileSize);
+		int y0 = std::max(triangle.minY, tileY * rasterTileSize);
+		int y1 = std::min(triangle.maxY + 1, (tileY + 1) * rasterTileSize);
+		float varyings[rasterMaxVaryings];
+
+#ifdef SOFT_RASTER_SSE
+		__m128 edgeA[3], edgeB[3], edgeC[3], onEdge[3];
+		for (int e = 0; e < 3; e++)
+		{
+			edgeA[e] = _mm_set1_ps(triangle.edges[e].a);
+			edgeB[e] = _mm_set1_ps(triangle.edges[e].b);
+			edgeC[e] = _mm_set1_ps(triangle.edges[e].c);
+			onEdge[e] = _mm_castsi128_ps(_mm_set1_epi32(triangle.topLeft[e] ? -1 : 0));
+		}
+		__m128 depthA = _mm_set1_ps(triangle.depth.a);
+		__m128 depthB = _mm_set1_ps(triangle.depth.b);
+		__m128 depthC = _mm_set1_ps(triangle.depth.c);
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+#endif
+
+		for (int y = y0; y < y1; y++)
+		{
+			float py = y + 0.5f;
+			float* depthRow = &target.depth[y * target.stride];
+			unsigned int* colorRow = &target.color[y * target.stride];
+			for (int x = x0; x < x1; x += 4)
+			{
+				// four pixels at once, the tile is padded so x + 3 is always inside the row
+#ifdef SOFT_RASTER_SSE
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+				__m128 vy = _mm_set1_ps(py);
+				__m128 covered = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (int e = 0; e < 3; e++)
+				{
+					__m128 value = _mm_add_ps(_mm_mul_ps(edgeA[e], px), _mm_add_ps(_mm_mul_ps(edgeB[e], vy), edgeC[e]));
+					__m128 inside = _mm_or_ps(_mm_cmpgt_ps(value, zero), _mm_and_ps(_mm_cmpeq_ps(value, zero), onEdge[e]));
+					covered = _mm_and_ps(covered, inside);
+				}
+				if (!_mm_movemask_ps(covered))
+					continue;
+
+				__m128 z = _mm_add_ps(_mm_mul_ps(depthA, px), _mm_add_ps(_mm_mul_ps(depthB, vy), depthC));
+				__m128 stored = _mm_loadu_ps(depthRow + x);
+				__m128 pass = _mm_and_ps(covered, _mm_and_ps(_mm_cmplt_ps(z, stored), _mm_cmple_ps(z, one)));
+				int passMask = _mm_movemask_ps(pass);
+				if (!passMask)
+					continue;
+				_mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, stored)));
+#else
+				int passMask = 0;
+				for (int lane = 0; lane < 4; lane++)
+				{
+					float px = x + lane + 0.5f;
+					bool inside = true;
+					for (int e = 0; e < 3; e++)
+					{
+						const Plane& edge = triangle.edges[e];
+						float value = edge.a * px + (edge.b * py + edge.c);
+						inside = inside && (value > 0.0f || (value == 0.0f && triangle.topLeft[e]));
+					}
+					float z = triangle.depth.a * px + (triangle.depth.b * py + triangle.depth.c);
+					if (inside && z < depthRow[x + lane] && z <= 1.0f)
+					{
+						depthRow[x + lane] = z;
+						passMask |= 1 << lane;
+					}
+				}
+				if (!passMask)
+					continue;
+#endif
+
+				for (int lane = 0; lane < 4; lane++)
+				{
+					if (!(passMask & (1 << lane)))
+						continue;
+					float px = x + lane + 0.5f;
+					float w = 1.0f / (triangle.invW.a * px + triangle.invW.b * py + triangle.invW.c);
+					for (unsigned int i = 0; i < triangle.varyingCount; i++)
+					{
+						const Plane& plane = triangle.varyings[i];
+						varyings[i] = (plane.a * px + plane.b * py + plane.c) * w;
+					}
+					colorRow[x + lane] = packColor(triangle.shader(varyings, triangle.uniforms));
+				}
+			}
+		}
+	}
+
+	void shadeTile(RasterPool* pool, int tile)
+	{
+		RasterTarget& target = *pool->target;
+		int tileX = tile % pool->tilesX;
+		int tileY = tile / pool->tilesX;
+
+		// clearing here keeps the clear parallel and the tile in cache for the triangles
+		for (int y = tileY * rasterTileSize; y < (tileY + 1) * rasterTileSize; y++)
+		{
+			std::fill_n(&target.color[y * target.stride + tileX * rasterTileSize], rasterTileSize, pool->clearColor);
+			std::fill_n(&target.depth[y * target.stride + tileX * rasterTileSize], rasterTileSize, 1.0f);
+		}
+
+		const std::vector<unsigned int>& bin = pool->bins[tile];
+		for (size_t i = 0; i < bin.size(); i++)
+			shadeTriangle(pool->triangles[bin[i]], target, tileX, tileY);
+	}
+
+	void shadeTiles(RasterPool* pool)
+	{
+		int tileCount = pool->tilesX * pool->tilesY;
+		for (int tile = pool->nextTile++; tile < tileCount; tile = pool->nextTile++)
+			shadeTile(pool, tile);
+	}
+
+	void workerLoop(RasterPool* pool)
+	{
+		unsigned long long seen = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(pool->mutex);
+				pool->wake.wait(lock, [&] { return pool->quit || pool->generation != seen; });
+				if (pool->quit)
+					return;
+				seen = pool->generation;
+			}
+			shadeTiles(pool);
+			{
+				std::lock_guard<std::mutex> lock(pool->mutex);
+				if (--pool->busy == 0)
+					pool->done.notify_one();
+			}
+		}
+	}
+}
+
+RasterPool* createRasterPool(unsigned int threads)
+{
+	RasterPool* pool = new RasterPool();
+	pool->generation = 0;
+	pool->busy = 0;
+	pool->quit = false;
+	pool->nextTile = 0;
+	pool->target = NULL;
+	pool->tilesX = 0;
+	pool->tilesY = 0;
+	pool->clearColor = 0;
+	for (unsigned int i = 1; i < threads; i++)
+		pool->workers.push_back(std::thread(workerLoop, pool));
+	return pool;
+}
+
+void destroyRasterPool(RasterPool* pool)
+{
+	{
+		std::lock_guard<std::mutex> lock(pool->mutex);
+		pool->quit = true;
+	}
+	pool->wake.notify_all();
+	for (size_t i = 0; i < pool->workers.size(); i++)
+		pool->workers[i].join();
+	delete pool;
+}
+
+void resizeRasterTarget(RasterTarget& target, int width, int height)
+{
+	target.width = width;
+	target.height = height;
+	target.stride = (width + rasterTileSize - 1) / rasterTileSize * rasterTileSize;
+	int rows = (height + rasterTileSize - 1) / rasterTileSize * rasterTileSize;
+	target.color.assign((size_t)target.stride * rows, 0);
+	target.depth.assign((size_t)target.stride * rows, 1.0f);
+}
+
+void beginRasterFrame(RasterPool* pool, RasterTarget& target, const glm::vec4& clearColor)
+{
+	pool->target = &target;
+	pool->tilesX = target.stride / rasterTileSize;
+	pool->tilesY = (int)(target.color.size() / target.stride) / rasterTileSize;
+	pool->clearColor = packColor(clearColor);
+	pool->triangles.clear();
+	pool->bins.resize(pool->tilesX * pool->tilesY);
+	for (size_t i = 0; i < pool->bins.size(); i++)
+		pool->bins[i].clear();
+}
+
+void drawRasterTriangles(RasterPool* pool, const RasterVertex* vertices, size_t count, unsigned int varyingCount,
+	RasterFragmentShader shader, const void* uniforms)
+{
+	varyingCount = std::min(varyingCount, rasterMaxVaryings);
+	for (size_t first = 0; first + 2 < count; first += 3)
+	{
+		const RasterVertex* triangle = vertices + first;
+		bool inside[3];
+		int insideCount = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			inside[i] = triangle[i].position.z + triangle[i].position.w >= 0.0f;
+			insideCount += inside[i];
+		}
+
+		if (insideCount == 3)
+		{
+			const RasterVertex* corners[3] = { &triangle[0], &triangle[1], &triangle[2] };
+			setupTriangle(pool, corners, varyingCount, shader, uniforms);
+			continue;
+		}
+		if (insideCount == 0)
+			continue;
+
+		// clip against the near plane, the other planes are handled by the bounds and the depth test
+		RasterVertex polygon[4];
+		int polygonCount = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			const RasterVertex& current = triangle[i];
+			const RasterVertex& next = triangle[(i + 1) % 3];
+			bool nextInside = inside[(i + 1) % 3];
+			if (inside[i])
+				polygon[polygonCount++] = current;
+			if (inside[i] && !nextInside)
+				polygon[polygonCount++] = nearIntersection(current, next, varyingCount);
+			else if (!inside[i] && nextInside)
+				polygon[polygonCount++] = nearIntersection(next, current, varyingCount);
+		}
+		for (int i = 1; i + 1 < polygonCount; i++)
+		{
+			const RasterVertex* corners[3] = { &polygon[0], &polygon[i], &polygon[i + 1] };
+			setupTriangle(pool, corners, varyingCount, shader, uniforms);
+		}
+	}
+}
+
+void finishRasterFrame(RasterPool* pool)
+{
+	{
+		std::lock_guard<std::mutex> lock(pool->mutex);
+		pool->nextTile = 0;
+		pool->busy = (unsigned int)pool->workers.size();
+		pool->generation++;
+	}
+	pool->wake.notify_all();
+	shadeTiles(pool);
+
+	std::unique_lock<std::mutex> lock(pool->mutex);
+	pool->done.wait(lock, [&] { return pool->busy == 0; });
+}
+
+glm::vec4 sampleRasterTexture(const RasterTexture& texture, glm::vec2 uv)
+{
+	float u = uv.x * texture.width - 0.5f;
+	float v = uv.y * texture.height - 0.5f;
+	float fu = std::floor(u);
+	float fv = std::floor(v);
+	float tu = u - fu;
+	float tv = v - fv;
+
+	// GL_REPEAT, also for negative coordinates
+	int x0 = (int)fu % texture.width;
+	int y0 = (int)fv % texture.height;
+	x0 += x0 < 0 ? texture.width : 0;
+	y0 += y0 < 0 ? texture.height : 0;
+	int x1 = x0 + 1 < texture.width ? x0 + 1 : 0;
+	int y1 = y0 + 1 < texture.height ? y0 + 1 : 0;
+
+	int channels = texture.channels;
+	const unsigned char* row0 = &texture.texels[(size_t)y0 * texture.width * channels];
+	const unsigned char* row1 = &texture.texels[(size_t)y1 * texture.width * channels];
+	const unsigned char* texels[4] = { row0 + x0 * channels, row0 + x1 * channels, row1 + x0 * channels, row1 + x1 * channels };
+	float weights[4] = { (1.0f - tu) * (1.0f - tv), tu * (1.0f - tv), (1.0f - tu) * tv, tu * tv };
+
+	float result[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 4; i++)
+		for (int c = 0; c < channels && c < 4; c++)
+			result[c] += texels[i][c] * weights[i];
+	// missing channels like GL: luminance in rgb, opaque alpha
+	if (channels < 3)
+		result[1] = result[2] = result[0];
+	if (channels < 4)
+		result[3] = 255.0f;
+	return glm::vec4(result[0], result[1], result[2], result[3]) * (1.0f / 255.0f);
+}
+
+bool writeRasterTarget(const RasterTarget& target, const char* path)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file)
+	{
+		std::cout << "Failed to write " << path << std::endl;
+		return false;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", target.width, target.height);
+	std::vector<unsigned char> row(target.width * 3);
+	for (int y = 0; y < target.height; y++)
+	{
+		for (int x = 0; x < target.width; x++)
+		{
+			unsigned int color = target.color[y * target.stride + x];
+			row[x * 3 + 0] = color & 0xff;
+			row[x * 3 + 1] = (color >> 8) & 0xff;
+			row[x * 3 + 2] = (color >> 16) & 0xff;
+		}
+		fwrite(row.data(), 1, row.size(), file);
+	}
+	fclose(file);
+	return true;
+}
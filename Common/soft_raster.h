@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+//Tile-based software rasterizer, the reference renderer for machines without a GPU.
+//drawRasterTriangles() runs triangle setup on the calling thread (near plane clipping, perspective divide,
+//viewport) and bins the triangles into rasterTileSize square screen tiles. finishRasterFrame() then shades
+//the tiles on the pool: each tile walks its triangles in submission order, evaluates the edge functions and
+//the depth test four pixels at a time with SSE and calls the fragment shader for the covered pixels, with
+//perspective correct varyings. Depth test is GL_LESS, both faces are drawn, no blending.
+//
+//Edge functions are evaluated directly (not stepped) from the vertex positions, so a shared edge gives
+//exactly negated values on both triangles and the top-left rule leaves no cracks or double hits.
+
+const int rasterTileSize = 64;
+const unsigned int rasterMaxVaryings = 8;
+
+//Output of the "vertex shader", which the caller runs.
+struct RasterVertex
+{
+	glm::vec4 position;  // clip space
+	float varyings[rasterMaxVaryings];
+};
+
+//Returns the linear RGBA color of one pixel, clamped to [0,1] when written.
+typedef glm::vec4 (*RasterFragmentShader)(const float* varyings, const void* uniforms);
+
+struct RasterTarget
+{
+	int width;
+	int height;
+	int stride;  // pixels per row, padded to whole tiles
+	std::vector<unsigned int> color;  // RGBA8, row 0 is the top
+	std::vector<float> depth;
+};
+
+struct RasterTexture
+{
+	int width;
+	int height;
+	int channels;
+	std::vector<unsigned char> texels;  // row 0 is the first row of the image, like glTexImage2D
+};
+
+struct RasterPool;
+
+//threads includes the calling thread, which shades tiles as well.
+RasterPool* createRasterPool(unsigned int threads);
+void destroyRasterPool(RasterPool* pool);
+
+void resizeRasterTarget(RasterTarget& target, int width, int height);
+//Starts a frame: clears the target and drops the triangles of the previous one.
+void beginRasterFrame(RasterPool* pool, RasterTarget& target, const glm::vec4& clearColor);
+//vertices holds count / 3 triangles. uniforms must stay valid until finishRasterFrame.
+void drawRasterTriangles(RasterPool* pool, const RasterVertex* vertices, size_t count, unsigned int varyingCount,
+	RasterFragmentShader shader, const void* uniforms);
+//Shades every tile, returns once the target is complete.
+void finishRasterFrame(RasterPool* pool);
+
+//Bilinear, GL_REPEAT, no mipmaps.
+glm::vec4 sampleRasterTexture(const RasterTexture& texture, glm::vec2 uv);
+bool writeRasterTarget(const RasterTarget& target, const char* path);  // binary PPM
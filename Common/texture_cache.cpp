@@ -0,0 +1,175 @@
+#include "texture_cache.h"
+#include "texture_loader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+namespace
+{
+	struct CacheEntry
+	{
+		unsigned int texture;
+		unsigned int references;
+		unsigned long long lastUse;
+	};
+
+	std::map<std::string, unsigned long long> pathKeys;      // canonical path -> content hash
+	std::map<unsigned long long, CacheEntry> entries;         // content hash -> texture
+	std::map<unsigned int, unsigned long long> textureKeys;   // texture -> content hash
+	unsigned long long useCounter = 0;
+	size_t budget = 0;
+	TextureCacheStats stats;
+
+	std::string canonicalPath(const char* path)
+	{
+#ifdef _WIN32
+		char buffer[_MAX_PATH];
+		if (_fullpath(buffer, path, _MAX_PATH))
+			return buffer;
+#else
+		char* resolved = realpath(path, NULL);
+		if (resolved)
+		{
+			std::string result = resolved;
+			free(resolved);
+			return result;
+		}
+#endif
+		return path;
+	}
+
+	//FNV-1a of the file contents, or of the path when it can't be read (the load fails the same way)
+	unsigned long long hashFile(const std::string& path)
+	{
+		unsigned long long hash = 14695981039346656037ULL;
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file)
+		{
+			for (size_t i = 0; i < path.size(); i++)
+			{
+				hash ^= (unsigned char)path[i];
+				hash *= 1099511628211ULL;
+			}
+			return hash;
+		}
+
+		unsigned char buffer[65536];
+		size_t count;
+		while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			for (size_t i = 0; i < count; i++)
+			{
+				hash ^= buffer[i];
+				hash *= 1099511628211ULL;
+			}
+		fclose(file);
+		return hash;
+	}
+
+	size_t residentBytes()
+	{
+		size_t total = 0;
+		for (std::map<unsigned long long, CacheEntry>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry)
+			total += residentTextureBytes(entry->second.texture);
+		return total;
+	}
+
+	void evict()
+	{
+		if (budget == 0)
+		{
+			const char* value = getenv("TEXTURE_CACHE_BUDGET");
+			budget = value && atoll(value) > 0 ? (size_t)atoll(value) : (size_t)256 << 20;
+		}
+
+		size_t resident = residentBytes();
+		while (resident > budget)
+		{
+			// least recently used among the unreferenced, resident textures; loading ones free nothing yet
+			std::map<unsigned long long, CacheEntry>::iterator victim = entries.end();
+			for (std::map<unsigned long long, CacheEntry>::iterator entry = entries.begin(); entry != entries.end(); ++entry)
+				if (entry->second.references == 0 && residentTextureBytes(entry->second.texture) > 0 &&
+					(victim == entries.end() || entry->second.lastUse < victim->second.lastUse))
+					victim = entry;
+			if (victim == entries.end())
+				return;
+
+			resident -= residentTextureBytes(victim->second.texture);
+			deleteRequestedTexture(victim->second.texture);
+			textureKeys.erase(victim->second.texture);
+			entries.erase(victim);
+			stats.evictions++;
+		}
+	}
+}
+
+unsigned int acquireTexture(const char* path)
+{
+	stats.acquires++;
+	std::string canonical = canonicalPath(path);
+	std::map<std::string, unsigned long long>::const_iterator known = pathKeys.find(canonical);
+	unsigned long long key = known != pathKeys.end() ? known->second : hashFile(canonical);
+	pathKeys[canonical] = key;
+
+	std::map<unsigned long long, CacheEntry>::iterator entry = entries.find(key);
+	if (entry != entries.end())
+	{
+		stats.hits++;
+		if (known == pathKeys.end())
+			stats.contentHits++;
+		entry->second.references++;
+		entry->second.lastUse = ++useCounter;
+		return entry->second.texture;
+	}
+
+	CacheEntry created = { requestTexture(canonical.c_str()), 1, ++useCounter };
+	entries[key] = created;
+	textureKeys[created.texture] = key;
+	evict();
+	return created.texture;
+}
+
+void releaseTexture(unsigned int texture)
+{
+	std::map<unsigned int, unsigned long long>::const_iterator key = textureKeys.find(texture);
+	if (key == textureKeys.end() || entries[key->second].references == 0)
+	{
+		std::cout << "ERROR::TEXTURE_CACHE::NOT_ACQUIRED " << texture << std::endl;
+		return;
+	}
+	CacheEntry& entry = entries[key->second];
+	entry.references--;
+	entry.lastUse = ++useCounter;
+	evict();
+}
+
+TextureCacheStats getTextureCacheStats()
+{
+	TextureCacheStats current = stats;
+	current.textures = (unsigned int)entries.size();
+	current.referenced = 0;
+	for (std::map<unsigned long long, CacheEntry>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry)
+		current.referenced += entry->second.references > 0;
+	current.residentBytes = residentBytes();
+	return current;
+}
+
+void printTextureCacheStats()
+{
+	TextureCacheStats current = getTextureCacheStats();
+	std::cout << "Texture cache: " << current.acquires << " acquires, "
+		<< (current.acquires ? 100.0 * current.hits / current.acquires : 0.0) << "% hits (" << current.contentHits
+		<< " by content), " << current.textures << " textures (" << current.referenced << " referenced), "
+		<< current.residentBytes / 1024 << " KiB resident, " << current.evictions << " evictions" << std::endl;
+}
+
+void finishTextureCache()
+{
+	printTextureCacheStats();
+	for (std::map<unsigned long long, CacheEntry>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry)
+		deleteRequestedTexture(entry->second.texture);
+	entries.clear();
+	textureKeys.clear();
+	pathKeys.clear();
+}
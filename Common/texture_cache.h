@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+
+//Shared, reference counted textures on top of the texture loader.
+//acquireTexture() canonicalizes the path, and the first time a path is seen hashes the file contents, so
+//the same image reached through different paths or stored in several copies is loaded once and every
+//caller gets the same GL texture. releaseTexture() drops a reference; unreferenced textures stay resident
+//for the next acquire until the resident total exceeds TEXTURE_CACHE_BUDGET bytes (default 256 MiB), then
+//the least recently used unreferenced ones are deleted. Files are assumed not to change while running.
+
+struct TextureCacheStats
+{
+	unsigned int acquires;
+	unsigned int hits;           // served by an existing texture
+	unsigned int contentHits;    // of those, found through the content hash under a new path
+	unsigned int evictions;
+	unsigned int textures;       // cached, referenced or not
+	unsigned int referenced;
+	size_t residentBytes;
+};
+
+//Render thread only, like requestTexture().
+unsigned int acquireTexture(const char* path);
+void releaseTexture(unsigned int texture);
+TextureCacheStats getTextureCacheStats();
+void printTextureCacheStats();
+//Deletes every cached texture and prints the stats, before finishTextureLoader().
+void finishTextureCache();
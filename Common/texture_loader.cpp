@@ -0,0 +1,618 @@
+#include "texture_loader.h"
+#include "gl_state.h"
+#include "ktx2.h"
+#include "mapped_file.h"
+#include "mip_generator.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+// static, so a sample that compiles its own stb_image still links; the entry points this file doesn't call
+// would each warn as unused, and the library isn't ours to fix
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wunused-but-set-variable"
+#pragma GCC diagnostic ignored "-Wsign-compare"
+#elif defined(_MSC_VER)
+#pragma warning(push, 0)
+#endif
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#elif defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+//BPTC and glTexStorage2D are core in 4.2 and S3TC an extension, the bundled glad only goes up to 4.0
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+	typedef void (APIENTRYP TexStorage2DProc)(GLenum, GLsizei, GLenum, GLsizei, GLsizei);
+
+	enum LoadStage
+	{
+		STAGE_HEADER,  // a worker maps the file and reads the image size
+		STAGE_BUFFER,  // waiting for the render thread to map a pixel buffer that size
+		STAGE_FILL     // a worker decodes into the buffer
+	};
+
+	//One texture on its way in, owned by the render thread and lent to a worker for the header and fill stages.
+	//Kept under its request id rather than the texture name: a deleted texture's name can be handed out again by
+	//GL while a worker still holds the old record.
+	struct PendingLoad
+	{
+		unsigned long long id;
+		unsigned int texture;                  // 0 once deleted
+		std::string path;
+		Clock::time_point requested;
+		LoadStage stage;
+		bool ok;
+		bool cancelled;                       // deleted while a worker had it
+		std::string source;                    // path, or the .ktx2 next to it
+		const unsigned char* memory;           // requestTextureFromMemory, read instead of source
+		size_t memorySize;
+		MappedFile file;                       // only while a worker reads it
+		bool compressed;
+		CompressedTexture blocks;              // levelOffsets into file
+		int width;
+		int height;
+		int channels;
+		std::vector<size_t> levelOffsets;      // of the chain in the buffer
+		size_t bytes;
+		unsigned int buffer;
+		unsigned char* destination;           // the mapped buffer, or fallback
+		std::vector<unsigned char> fallback;  // when the buffer can't be mapped
+	};
+
+	// shared with the workers
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable handedBack;     // a worker put a load on finished
+	std::deque<PendingLoad*> headerJobs;
+	std::deque<PendingLoad*> fillJobs;      // taken first, their buffers are already allocated
+	std::deque<PendingLoad*> finished;
+	size_t filledBytes = 0;                 // written into buffers since the last pumpTextureUploads()
+	bool stopping = false;
+	std::vector<std::thread> workers;
+	// written before the workers start
+	bool formatSupported[3] = {};  // by BlockFormat
+	MipFilter mipFilter = MIP_FILTER_BOX;
+
+	// render thread only
+	std::map<unsigned long long, PendingLoad> loads;        // by request id; requested, not resident or released yet
+	std::map<unsigned int, unsigned long long> loadOfTexture;  // texture name to the request still filling it
+	unsigned long long nextLoadId = 1;
+	std::deque<PendingLoad*> waiting;           // STAGE_BUFFER, in request order
+	size_t uploadBudget = 4 << 20;
+	size_t mappedBytes = 0;                     // of buffers not released yet
+	std::map<unsigned int, size_t> residentTextures;  // bytes with mipmaps
+	TextureLoadStats stats;
+	double totalLatencyMs = 0.0;
+	TexStorage2DProc texStorage2D = NULL;
+
+	GLenum formatOf(int channels)
+	{
+		switch (channels)
+		{
+		case 1: return GL_RED;
+		case 2: return GL_RG;
+		case 4: return GL_RGBA;
+		default: return GL_RGB;
+		}
+	}
+
+	GLenum sizedFormatOf(int channels)
+	{
+		switch (channels)
+		{
+		case 1: return GL_R8;
+		case 2: return GL_RG8;
+		case 4: return GL_RGBA8;
+		default: return GL_RGB8;
+		}
+	}
+
+	GLenum compressedFormatOf(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BLOCK_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case BLOCK_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		default: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+		}
+	}
+
+	bool hasExtension(const char* name)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+			if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+				return true;
+		return false;
+	}
+
+	//<name>.ktx2 next to the image, if there is one in a format the context can sample.
+	bool mapCompressed(PendingLoad& load)
+	{
+		size_t directory = load.path.find_last_of("/\\");
+		size_t extension = load.path.find_last_of('.');
+		if (extension == std::string::npos || (directory != std::string::npos && extension < directory))
+			extension = load.path.size();
+		load.source = load.path.substr(0, extension) + ".ktx2";
+		if (!mapFile(load.source.c_str(), load.file))
+			return false;
+		if (parseKtx2(load.file.data, load.file.size, load.source.c_str(), load.blocks) && formatSupported[load.blocks.format])
+			return true;
+		unmapFile(load.file);
+		return false;
+	}
+
+	//The encoded image, mapped from source or pointing at the caller's memory.
+	bool openSource(PendingLoad& load)
+	{
+		if (!load.memory)
+			return mapFile(load.source.c_str(), load.file);
+		load.file.data = load.memory;
+		load.file.size = load.memorySize;
+		return true;
+	}
+
+	void closeSource(PendingLoad& load)
+	{
+		if (load.memory)
+			memset(&load.file, 0, sizeof(load.file));
+		else
+			unmapFile(load.file);
+	}
+
+	//Only the header is read here, the pixels are decoded once there is a buffer to decode them into. The file
+	//is unmapped again in between, so a long queue doesn't keep every file resident.
+	void readHeader(PendingLoad& load)
+	{
+		load.compressed = !load.memory && mapCompressed(load);
+		if (load.compressed)
+		{
+			load.width = load.blocks.width;
+			load.height = load.blocks.height;
+			load.bytes = 0;
+			for (size_t level = 0; level < load.blocks.levelOffsets.size(); level++)
+			{
+				load.levelOffsets.push_back(load.bytes);
+				load.bytes += compressedLevelSize(load.blocks, level);
+			}
+			load.ok = true;
+		}
+		else
+		{
+			load.source = load.path;
+			load.ok = openSource(load) &&
+				stbi_info_from_memory(load.file.data, (int)load.file.size, &load.width, &load.height, &load.channels);
+			if (load.ok)
+				load.bytes = mipChainLayout(load.width, load.height, load.channels, load.levelOffsets);
+		}
+		closeSource(load);
+	}
+
+	void fill(PendingLoad& load)
+	{
+		// the file may have changed since the header was read, it has to describe the same image still
+		int width = 0, height = 0, channels = 0;
+		load.ok = openSource(load);
+		if (load.ok && load.compressed)
+		{
+			CompressedTexture blocks;
+			load.ok = parseKtx2(load.file.data, load.file.size, load.source.c_str(), blocks) &&
+				blocks.format == load.blocks.format && blocks.width == load.width && blocks.height == load.height;
+			load.blocks.levelOffsets.swap(blocks.levelOffsets);
+		}
+		else if (load.ok)
+			load.ok = stbi_info_from_memory(load.file.data, (int)load.file.size, &width, &height, &channels) &&
+				width == load.width && height == load.height && channels == load.channels;
+		if (!load.ok)
+		{
+			closeSource(load);
+			return;
+		}
+
+		if (load.compressed)
+		{
+			for (size_t level = 0; level < load.levelOffsets.size(); level++)
+				memcpy(load.destination + load.levelOffsets[level], load.file.data + load.blocks.levelOffsets[level],
+					compressedLevelSize(load.blocks, level));
+		}
+		else
+		{
+			// stb_image only decodes into memory of its own, this is the one copy left on the way to GL
+			unsigned char* pixels = stbi_load_from_memory(load.file.data, (int)load.file.size, &width, &height, &channels,
+				load.channels);
+			load.ok = pixels != NULL;
+			if (pixels)
+			{
+				memcpy(load.destination, pixels, (size_t)load.width * load.height * load.channels);
+				generateMipLevels(pixels, load.width, load.height, load.channels, mipFilter, true, load.destination);
+				stbi_image_free(pixels);
+			}
+		}
+		closeSource(load);
+	}
+
+	void workerLoop()
+	{
+		for (;;)
+		{
+			PendingLoad* load;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [] { return stopping || !headerJobs.empty() || !fillJobs.empty(); });
+				if (stopping)
+					return;
+				std::deque<PendingLoad*>& jobs = fillJobs.empty() ? headerJobs : fillJobs;
+				load = jobs.front();
+				jobs.pop_front();
+			}
+
+			if (load->stage == STAGE_HEADER)
+				readHeader(*load);
+			else
+				fill(*load);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (load->stage == STAGE_FILL && load->ok)
+					filledBytes += load->bytes;
+				finished.push_back(load);
+			}
+			handedBack.notify_all();
+		}
+	}
+
+	bool removeJob(std::deque<PendingLoad*>& jobs, PendingLoad* load)
+	{
+		std::deque<PendingLoad*>::iterator job = std::find(jobs.begin(), jobs.end(), load);
+		if (job == jobs.end())
+			return false;
+		jobs.erase(job);
+		return true;
+	}
+
+	void createPlaceholder(unsigned int texture)
+	{
+		// grey checkerboard, so a texture that is still loading is recognizable
+		const unsigned char checker[] = {
+			160, 160, 160,  96, 96, 96,
+			96, 96, 96,  160, 160, 160
+		};
+		stateBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 2, 2, 0, GL_RGB, GL_UNSIGNED_BYTE, checker);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	void mapBuffer(PendingLoad& load)
+	{
+		glGenBuffers(1, &load.buffer);
+		stateBindBuffer(GL_PIXEL_UNPACK_BUFFER, load.buffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, load.bytes, NULL, GL_STREAM_DRAW);
+		// fresh storage that nothing reads until it is unmapped, the worker can write it without syncing
+		load.destination = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, load.bytes,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (!load.destination)
+		{
+			load.fallback.resize(load.bytes);
+			load.destination = &load.fallback[0];
+		}
+	}
+
+	//Frees the file, the buffer and the bookkeeping of a load that no worker holds.
+	void releaseLoad(PendingLoad& load)
+	{
+		closeSource(load);
+		if (load.buffer)
+		{
+			// deleting a mapped buffer unmaps it; unbound first so the state cache stays right
+			stateBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glDeleteBuffers(1, &load.buffer);
+			mappedBytes -= load.bytes;
+		}
+		if (load.texture)
+			loadOfTexture.erase(load.texture);
+		loads.erase(load.id);
+	}
+
+	void failLoad(PendingLoad& load)
+	{
+		std::cout << "Failed to load texture " << load.path << std::endl;
+		stats.failed++;
+		releaseLoad(load);
+	}
+
+	//The buffer holds the whole mip chain, specify the texture from it.
+	void finishUpload(PendingLoad& load)
+	{
+		stateBindBuffer(GL_PIXEL_UNPACK_BUFFER, load.buffer);
+		if (!load.fallback.empty())
+			glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, load.bytes, &load.fallback[0]);
+		else if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) != GL_TRUE)
+		{
+			// the contents were lost, e.g. to a display mode change
+			failLoad(load);
+			return;
+		}
+
+		// every level comes from the worker, immutable storage when the context has it
+		GLsizei levels = (GLsizei)load.levelOffsets.size();
+		stateBindTexture(GL_TEXTURE_2D, load.texture);
+		if (load.compressed)
+		{
+			// the blocks go to the texture as they are
+			GLenum format = compressedFormatOf(load.blocks.format);
+			if (texStorage2D)
+				texStorage2D(GL_TEXTURE_2D, levels, format, load.width, load.height);
+			for (GLsizei level = 0; level < levels; level++)
+			{
+				GLsizei width = std::max(load.width >> level, 1), height = std::max(load.height >> level, 1);
+				GLsizei size = (GLsizei)compressedLevelSize(load.blocks, level);
+				void* offset = (void*)load.levelOffsets[level];
+				if (texStorage2D)
+					glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format, size, offset);
+				else
+					glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, size, offset);
+			}
+			stats.compressed++;
+		}
+		else
+		{
+			GLenum format = formatOf(load.channels);
+			if (texStorage2D)
+				texStorage2D(GL_TEXTURE_2D, levels, sizedFormatOf(load.channels), load.width, load.height);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			for (GLsizei level = 0; level < levels; level++)
+			{
+				GLsizei width = std::max(load.width >> level, 1), height = std::max(load.height >> level, 1);
+				void* offset = (void*)load.levelOffsets[level];
+				if (texStorage2D)
+					glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format, GL_UNSIGNED_BYTE, offset);
+				else
+					glTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, format, GL_UNSIGNED_BYTE, offset);
+			}
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+		double latency = std::chrono::duration<double, std::milli>(Clock::now() - load.requested).count();
+		residentTextures[load.texture] = load.bytes;
+		stats.resident++;
+		totalLatencyMs += latency;
+		stats.meanLatencyMs = totalLatencyMs / stats.resident;
+		stats.maxLatencyMs = std::max(stats.maxLatencyMs, latency);
+		releaseLoad(load);
+	}
+}
+
+bool loadImage(const char* path, Image& image)
+{
+	MappedFile file;
+	if (!mapFile(path, file))
+		return false;
+	unsigned char* data = stbi_load_from_memory(file.data, (int)file.size, &image.width, &image.height, &image.channels, 0);
+	unmapFile(file);
+	if (!data)
+		return false;
+	image.pixels.assign(data, data + (size_t)image.width * image.height * image.channels);
+	stbi_image_free(data);
+	return true;
+}
+
+void initTextureLoader()
+{
+	memset(&stats, 0, sizeof(stats));
+	const char* budget = getenv("TEXTURE_UPLOAD_BUDGET");
+	if (budget && atoll(budget) > 0)
+		uploadBudget = (size_t)atoll(budget);
+	const char* threads = getenv("TEXTURE_LOADER_THREADS");
+	unsigned int threadCount = threads && atoi(threads) > 0 ? (unsigned int)atoi(threads) : 2;
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	formatSupported[BLOCK_BC1] = formatSupported[BLOCK_BC3] = hasExtension("GL_EXT_texture_compression_s3tc");
+	formatSupported[BLOCK_BC7] = major * 10 + minor >= 42 || hasExtension("GL_ARB_texture_compression_bptc");
+	mipFilter = parseMipFilter(getenv("TEXTURE_MIP_FILTER"), MIP_FILTER_BOX);
+	if (major * 10 + minor >= 42 || hasExtension("GL_ARB_texture_storage"))
+		texStorage2D = (TexStorage2DProc)glfwGetProcAddress("glTexStorage2D");
+
+	stopping = false;
+	for (unsigned int i = 0; i < threadCount; i++)
+		workers.push_back(std::thread(workerLoop));
+}
+
+unsigned int requestTexture(const char* path)
+{
+	return requestTextureFromMemory(NULL, 0, path);
+}
+
+unsigned int requestTextureFromMemory(const unsigned char* data, size_t size, const char* name)
+{
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	createPlaceholder(texture);
+	stats.requested++;
+
+	unsigned long long id = nextLoadId++;
+	PendingLoad& load = loads[id];
+	loadOfTexture[texture] = id;
+	load.id = id;
+	load.texture = texture;
+	load.path = name;
+	load.memory = data;
+	load.memorySize = size;
+	load.requested = Clock::now();
+	load.stage = STAGE_HEADER;
+	load.ok = false;
+	load.cancelled = false;
+	memset(&load.file, 0, sizeof(load.file));
+	load.compressed = false;
+	load.width = load.height = load.channels = 0;
+	load.bytes = 0;
+	load.buffer = 0;
+	load.destination = NULL;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		headerJobs.push_back(&load);
+	}
+	wake.notify_one();
+	return texture;
+}
+
+bool textureResident(unsigned int texture)
+{
+	return residentTextures.count(texture) != 0;
+}
+
+size_t residentTextureBytes(unsigned int texture)
+{
+	std::map<unsigned int, size_t>::const_iterator resident = residentTextures.find(texture);
+	return resident == residentTextures.end() ? 0 : resident->second;
+}
+
+void deleteRequestedTexture(unsigned int texture)
+{
+	std::map<unsigned int, unsigned long long>::iterator pending = loadOfTexture.find(texture);
+	if (pending != loadOfTexture.end())
+	{
+		PendingLoad& load = loads[pending->second];
+		bool withWorker = false;
+		if (load.stage == STAGE_BUFFER)
+			removeJob(waiting, &load);
+		else
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			withWorker = !removeJob(headerJobs, &load) && !removeJob(fillJobs, &load) && !removeJob(finished, &load);
+			// the worker reads the caller's memory, which may be gone as soon as this returns; one image is
+			// quick enough to wait for
+			if (withWorker && load.memory)
+			{
+				handedBack.wait(lock, [&] { return removeJob(finished, &load); });
+				withWorker = false;
+			}
+		}
+		// a worker is on it, pumpTextureUploads releases it when it comes back; the name is let go now, so GL
+		// may reuse it for a new request, which gets a record of its own
+		if (withWorker)
+		{
+			load.cancelled = true;
+			load.texture = 0;
+			loadOfTexture.erase(pending);
+		}
+		else
+			releaseLoad(load);
+	}
+	residentTextures.erase(texture);
+	glDeleteTextures(1, &texture);
+}
+
+void pumpTextureUploads()
+{
+	std::deque<PendingLoad*> done;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		done.swap(finished);
+		stats.bytesLastFrame = filledBytes;
+		filledBytes = 0;
+	}
+	for (size_t i = 0; i < done.size(); i++)
+	{
+		PendingLoad& load = *done[i];
+		if (load.cancelled)
+			releaseLoad(load);
+		else if (!load.ok)
+			failLoad(load);
+		else if (load.stage == STAGE_HEADER)
+		{
+			load.stage = STAGE_BUFFER;
+			waiting.push_back(&load);
+		}
+		else
+			finishUpload(load);
+	}
+
+	// buffers for the images whose size is known, the workers decode straight into them. Buffers the workers
+	// haven't filled yet are capped too, else slow decoding would leave the whole queue mapped at once.
+	size_t mappedThisFrame = 0, queued = 0;
+	while (!waiting.empty() && mappedThisFrame < uploadBudget && mappedBytes < uploadBudget)
+	{
+		PendingLoad& load = *waiting.front();
+		waiting.pop_front();
+		mapBuffer(load);
+		load.stage = STAGE_FILL;
+		mappedThisFrame += load.bytes;
+		mappedBytes += load.bytes;
+		std::lock_guard<std::mutex> lock(mutex);
+		fillJobs.push_back(&load);
+		queued++;
+	}
+	for (size_t i = 0; i < queued; i++)
+		wake.notify_one();
+	// client memory uploads elsewhere must not read from a PBO
+	stateBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (stats.bytesLastFrame)
+	{
+		stats.uploadFrames++;
+		stats.totalBytes += stats.bytesLastFrame;
+		stats.peakBytesPerFrame = std::max(stats.peakBytesPerFrame, stats.bytesLastFrame);
+	}
+}
+
+TextureLoadStats getTextureLoadStats()
+{
+	return stats;
+}
+
+void finishTextureLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		headerJobs.clear();
+		fillJobs.clear();
+		finished.clear();
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+	// nothing is lent out anymore, what came back meanwhile is released with the rest
+	finished.clear();
+	waiting.clear();
+	while (!loads.empty())
+		releaseLoad(loads.begin()->second);
+
+	std::cout << "Textures: " << stats.resident << "/" << stats.requested << " resident (" << stats.compressed
+		<< " block compressed), " << stats.failed << " failed, latency " << stats.meanLatencyMs << " ms mean, "
+		<< stats.maxLatencyMs << " ms max; uploaded " << stats.totalBytes / 1024 << " KiB over " << stats.uploadFrames
+		<< " frames, peak " << stats.peakBytesPerFrame / 1024 << " KiB/frame" << std::endl;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+//Asynchronous texture loading.
+//requestTexture() returns a GL texture at once; it shows a placeholder checkerboard until the image is
+//resident. Files are memory mapped and handled by TEXTURE_LOADER_THREADS worker threads (default 2): a
+//worker first reads just the image size, then pumpTextureUploads(), called once per frame on the render
+//thread, maps a pixel buffer object for the whole mip chain and a worker decodes the file straight into it.
+//At most TEXTURE_UPLOAD_BUDGET bytes of these buffers are mapped at a time (default 4 MiB, a bigger image is
+//mapped alone). Once filled the render thread unmaps the buffer and specifies the texture from it. Decoded
+//pixels never wait in memory of their own for the render thread, they go from stb_image's buffer into the PBO.
+//
+//The workers also build the mip chain (mip_generator.h, filter TEXTURE_MIP_FILTER: box, kaiser or lanczos,
+//default box), so every level is uploaded explicitly instead of calling glGenerateMipmap, into immutable
+//glTexStorage2D storage when the context has GL 4.2 or ARB_texture_storage.
+//
+//If a <name>.ktx2 written by TextureCompressor sits next to the requested <name>.<ext> and the context
+//supports its BC1/BC3/BC7 format, the worker reads that instead and the levels in it are uploaded as
+//they are: no image decode, no mip generation, and 4-8x less memory than RGB8/RGBA8.
+//
+//Textures get GL_REPEAT and GL_LINEAR filtering, like the samples used to set up by hand.
+
+struct Image
+{
+	int width;
+	int height;
+	int channels;
+	std::vector<unsigned char> pixels;  // rows top to bottom, as stored in the file
+};
+
+struct TextureLoadStats
+{
+	unsigned int requested;
+	unsigned int resident;
+	unsigned int compressed;    // of those, uploaded from a .ktx2
+	unsigned int failed;
+	double meanLatencyMs;       // requestTexture() to resident
+	double maxLatencyMs;
+	size_t bytesLastFrame;      // copied into PBOs by the workers between the last two pumpTextureUploads()
+	size_t peakBytesPerFrame;
+	size_t totalBytes;
+	long long uploadFrames;     // frames with anything copied
+};
+
+//Synchronous decode, safe on any thread.
+bool loadImage(const char* path, Image& image);
+
+//Call once the GL context is current.
+void initTextureLoader();
+unsigned int requestTexture(const char* path);
+//The same for an image already in memory, e.g. embedded in a model file; name is only for messages. No .ktx2
+//is looked for, and data has to stay valid until the texture is resident or deleteRequestedTexture() has returned.
+unsigned int requestTextureFromMemory(const unsigned char* data, size_t size, const char* name);
+bool textureResident(unsigned int texture);
+//GPU memory of a resident texture including its mip chain, 0 while it is loading.
+size_t residentTextureBytes(unsigned int texture);
+//Deletes a texture from requestTexture(), also while it is still loading. Its name may come back from GL for a
+//later request at once; a load a worker is still busy with is dropped when it returns, except one reading the
+//caller's memory, which is waited for.
+void deleteRequestedTexture(unsigned int texture);
+//Once per frame before drawing, on the thread owning the context.
+void pumpTextureUploads();
+TextureLoadStats getTextureLoadStats();
+//Stops the workers and prints the stats, before glfwTerminate.
+void finishTextureLoader();
@@ -0,0 +1,30 @@
+#include "torus_mesh.h"
+#include <cmath>
+
+void torusVertex(unsigned int i, unsigned int j, unsigned int size, float* vertex)
+{
+	const float pi = 3.14159265f;
+	float u = (float)i / size, v = (float)j / size;
+	float theta = u * 2.0f * pi, phi = v * 2.0f * pi;
+	float normal[3] = { cosf(theta) * cosf(phi), sinf(phi), sinf(theta) * cosf(phi) };
+	vertex[0] = cosf(theta) + 0.3f * normal[0];
+	vertex[1] = 0.3f * normal[1];
+	vertex[2] = sinf(theta) + 0.3f * normal[2];
+	vertex[3] = normal[0];
+	vertex[4] = normal[1];
+	vertex[5] = normal[2];
+	vertex[6] = u;
+	vertex[7] = v;
+}
+
+std::vector<float> makeTorus(unsigned int size)
+{
+	std::vector<float> vertices((size_t)size * size * 6 * 8);
+	const unsigned int corners[6][2] = { { 0, 0 }, { 1, 1 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 0, 1 } };
+	float* vertex = &vertices[0];
+	for (unsigned int j = 0; j < size; j++)
+		for (unsigned int i = 0; i < size; i++)
+			for (int corner = 0; corner < 6; corner++, vertex += 8)
+				torusVertex(i + corners[corner][0], j + corners[corner][1], size, vertex);
+	return vertices;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <vector>
+
+//Procedural torus the mesh benchmarks share: ring radius 1, tube radius 0.3, size x size quads. Vertices are 8
+//floats, position, normal and uv; the seam repeats its positions with other uvs, like real meshes.
+
+//Grid vertex i, j of a size x size torus, i and j in [0, size].
+void torusVertex(unsigned int i, unsigned int j, unsigned int size, float* vertex);
+//Non-indexed triangle list, 6 vertices per quad, counter-clockwise from outside.
+std::vector<float> makeTorus(unsigned int size);
@@ -0,0 +1,52 @@
+#include "uniform_table.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+void reflectUniforms(unsigned int program, UniformTable& table)
+{
+	table.program = program;
+	table.uniforms.clear();
+
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::vector<char> name(maxLength > 0 ? maxLength : 1);
+	for (GLint i = 0; i < count; ++i)
+	{
+		UniformInfo info;
+		GLsizei length = 0;
+		glGetActiveUniform(program, i, (GLsizei)name.size(), &length, &info.size, &info.type, name.data());
+		info.name.assign(name.data(), length);
+		// arrays are reported as "name[0]", keep the plain name
+		if (info.name.size() > 3 && info.name.compare(info.name.size() - 3, 3, "[0]") == 0)
+			info.name.resize(info.name.size() - 3);
+		info.location = glGetUniformLocation(program, name.data());
+		// uniforms living in a uniform block have no location
+		if (info.location >= 0)
+			table.uniforms.push_back(info);
+	}
+
+	std::sort(table.uniforms.begin(), table.uniforms.end(),
+		[](const UniformInfo& a, const UniformInfo& b) { return a.name < b.name; });
+}
+
+const UniformInfo* findUniformInfo(const UniformTable& table, const char* name)
+{
+	std::vector<UniformInfo>::const_iterator it = std::lower_bound(table.uniforms.begin(), table.uniforms.end(), name,
+		[](const UniformInfo& info, const char* key) { return strcmp(info.name.c_str(), key) < 0; });
+	if (it == table.uniforms.end() || it->name != name)
+		return NULL;
+	return &*it;
+}
+
+bool checkUniformType(const UniformInfo& info, GLenum type)
+{
+	// samplers are set with glUniform1i
+	bool sampler = type == GL_INT && (info.type == GL_SAMPLER_2D || info.type == GL_SAMPLER_3D || info.type == GL_SAMPLER_CUBE);
+	if (info.type == type || sampler)
+		return true;
+	std::cout << "ERROR::UNIFORM::TYPE_MISMATCH " << info.name << std::endl;
+	return false;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <string>
+#include <vector>
+
+//Active uniforms of a linked program, enumerated once with glGetActiveUniform.
+//Look handles up by name at setup time; the render loop only uses the handles.
+struct UniformInfo
+{
+	std::string name;
+	GLint location;
+	GLenum type;
+	GLint size;
+};
+
+struct UniformTable
+{
+	unsigned int program;
+	std::vector<UniformInfo> uniforms; // sorted by name
+};
+
+void reflectUniforms(unsigned int program, UniformTable& table);
+const UniformInfo* findUniformInfo(const UniformTable& table, const char* name);
+
+template <typename T> struct UniformType;
+template <> struct UniformType<int> { static const GLenum value = GL_INT; };
+template <> struct UniformType<float> { static const GLenum value = GL_FLOAT; };
+template <> struct UniformType<glm::vec3> { static const GLenum value = GL_FLOAT_VEC3; };
+template <> struct UniformType<glm::vec4> { static const GLenum value = GL_FLOAT_VEC4; };
+template <> struct UniformType<glm::mat3> { static const GLenum value = GL_FLOAT_MAT3; };
+template <> struct UniformType<glm::mat4> { static const GLenum value = GL_FLOAT_MAT4; };
+
+//Pre-resolved, typed uniform handle. Location -1 (uniform not active) makes every set a no-op,
+//the same as glGetUniformLocation.
+template <typename T>
+struct Uniform
+{
+	GLint location;
+};
+
+bool checkUniformType(const UniformInfo& info, GLenum type);
+
+template <typename T>
+Uniform<T> findUniform(const UniformTable& table, const char* name)
+{
+	Uniform<T> uniform = { -1 };
+	const UniformInfo* info = findUniformInfo(table, name);
+	if (info && checkUniformType(*info, UniformType<T>::value))
+		uniform.location = info->location;
+	return uniform;
+}
+
+inline void setUniform(Uniform<int> uniform, int value) { glUniform1i(uniform.location, value); }
+inline void setUniform(Uniform<float> uniform, float value) { glUniform1f(uniform.location, value); }
+inline void setUniform(Uniform<glm::vec3> uniform, const glm::vec3& value) { glUniform3fv(uniform.location, 1, glm::value_ptr(value)); }
+inline void setUniform(Uniform<glm::vec4> uniform, const glm::vec4& value) { glUniform4fv(uniform.location, 1, glm::value_ptr(value)); }
+inline void setUniform(Uniform<glm::mat3> uniform, const glm::mat3& value) { glUniformMatrix3fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value)); }
+inline void setUniform(Uniform<glm::mat4> uniform, const glm::mat4& value) { glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value)); }
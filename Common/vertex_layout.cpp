@@ -0,0 +1,52 @@
+#include "vertex_layout.h"
+#include <cstdlib>
+#include <cstring>
+
+VertexStreams readVertexStreams()
+{
+	const char* value = getenv("VERTEX_STREAMS");
+	return value && strcmp(value, "split") == 0 ? VERTEX_SPLIT : VERTEX_INTERLEAVED;
+}
+
+void setVertexAttributes(const VertexAttribute* attributes, size_t count, size_t stride, size_t offset, size_t vertexCount)
+{
+	size_t streamOffset = offset;
+	for (size_t i = 0; i < count; i++)
+	{
+		const VertexAttribute& attribute = attributes[i];
+		size_t columnSize = attribute.size / attribute.columns;
+		GLsizei attributeStride = (GLsizei)(stride ? stride : attribute.size);
+		size_t start = stride ? offset + attribute.offset : streamOffset;
+		for (int column = 0; column < attribute.columns; column++)
+		{
+			GLuint location = attribute.location + column;
+			void* pointer = (void*)(start + column * columnSize);
+			if (attribute.integer)
+				glVertexAttribIPointer(location, attribute.components, attribute.type, attributeStride, pointer);
+			else
+				glVertexAttribPointer(location, attribute.components, attribute.type, attribute.normalized ? GL_TRUE : GL_FALSE,
+					attributeStride, pointer);
+			glEnableVertexAttribArray(location);
+			glVertexAttribDivisor(location, attribute.divisor);
+		}
+		streamOffset += attribute.size * vertexCount;
+	}
+}
+
+void splitVertexStreams(const VertexAttribute* attributes, size_t count, size_t stride, const void* vertices,
+	size_t vertexCount, std::vector<unsigned char>& streams)
+{
+	size_t vertexSize = 0;
+	for (size_t i = 0; i < count; i++)
+		vertexSize += attributes[i].size;
+	streams.resize(vertexSize * vertexCount);
+
+	const unsigned char* source = (const unsigned char*)vertices;
+	unsigned char* target = streams.data();
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t size = attributes[i].size;
+		for (size_t vertex = 0; vertex < vertexCount; vertex++, target += size)
+			memcpy(target, source + vertex * stride + attributes[i].offset, size);
+	}
+}
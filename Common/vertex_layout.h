@@ -0,0 +1,152 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <cstddef>
+#include <vector>
+
+//Vertex layouts described from the vertex struct instead of hand-written stride and offset math:
+//
+//	struct TexturedVertex { glm::vec3 position; glm::vec2 texCoord; };
+//	constexpr auto texturedVertexLayout = makeVertexLayout<TexturedVertex>(
+//		VERTEX_ATTRIBUTE(TexturedVertex, position, 0),
+//		VERTEX_ATTRIBUTE(TexturedVertex, texCoord, 1));
+//
+//Components, GL type, normalization, integer-ness and size come from the member's type (VertexAttributeType),
+//offsets from offsetof and the stride from sizeof, all at compile time. uploadVertices() fills the bound
+//GL_ARRAY_BUFFER and points the bound VAO at it, either interleaved as the structs are or split into one
+//tightly packed stream per attribute, back to back in the same buffer.
+
+//Types without a plain glm equivalent. Normalized<T> reads integers as [0, 1] / [-1, 1] floats.
+template <typename T>
+struct Normalized
+{
+	T value;
+};
+struct Half2
+{
+	glm::uint32 packed;   // glm::packHalf2x16
+};
+struct Snorm10x3
+{
+	glm::uint32 packed;   // glm::packSnorm3x10_1x2, read as a normalized vec4
+};
+
+template <typename T> struct VertexAttributeType;
+#define VERTEX_ATTRIBUTE_TYPE(T, componentCount, glType, isNormalized, isInteger, columnCount) \
+	template <> struct VertexAttributeType<T> \
+	{ \
+		static const int components = componentCount; \
+		static const GLenum type = glType; \
+		static const bool normalized = isNormalized; \
+		static const bool integer = isInteger; \
+		static const int columns = columnCount; \
+	}
+VERTEX_ATTRIBUTE_TYPE(float, 1, GL_FLOAT, false, false, 1);
+VERTEX_ATTRIBUTE_TYPE(glm::vec2, 2, GL_FLOAT, false, false, 1);
+VERTEX_ATTRIBUTE_TYPE(glm::vec3, 3, GL_FLOAT, false, false, 1);
+VERTEX_ATTRIBUTE_TYPE(glm::vec4, 4, GL_FLOAT, false, false, 1);
+VERTEX_ATTRIBUTE_TYPE(glm::mat3, 3, GL_FLOAT, false, false, 3);
+VERTEX_ATTRIBUTE_TYPE(glm::mat4, 4, GL_FLOAT, false, false, 4);
+VERTEX_ATTRIBUTE_TYPE(int, 1, GL_INT, false, true, 1);
+VERTEX_ATTRIBUTE_TYPE(glm::ivec2, 2, GL_INT, false, true, 1);
+VERTEX_ATTRIBUTE_TYPE(glm::ivec4, 4, GL_INT, false, true, 1);
+VERTEX_ATTRIBUTE_TYPE(unsigned int, 1, GL_UNSIGNED_INT, false, true, 1);
+VERTEX_ATTRIBUTE_TYPE(glm::uvec2, 2, GL_UNSIGNED_INT, false, true, 1);
+VERTEX_ATTRIBUTE_TYPE(glm::uvec4, 4, GL_UNSIGNED_INT, false, true, 1);
+VERTEX_ATTRIBUTE_TYPE(Normalized<glm::u8vec4>, 4, GL_UNSIGNED_BYTE, true, false, 1);
+VERTEX_ATTRIBUTE_TYPE(Normalized<glm::i8vec4>, 4, GL_BYTE, true, false, 1);
+VERTEX_ATTRIBUTE_TYPE(Normalized<glm::u16vec2>, 2, GL_UNSIGNED_SHORT, true, false, 1);
+VERTEX_ATTRIBUTE_TYPE(Normalized<glm::u16vec4>, 4, GL_UNSIGNED_SHORT, true, false, 1);
+VERTEX_ATTRIBUTE_TYPE(Normalized<glm::i16vec2>, 2, GL_SHORT, true, false, 1);
+VERTEX_ATTRIBUTE_TYPE(Normalized<glm::i16vec4>, 4, GL_SHORT, true, false, 1);
+VERTEX_ATTRIBUTE_TYPE(Half2, 2, GL_HALF_FLOAT, false, false, 1);
+VERTEX_ATTRIBUTE_TYPE(Snorm10x3, 4, GL_INT_2_10_10_10_REV, true, false, 1);
+#undef VERTEX_ATTRIBUTE_TYPE
+
+//One attribute as GL sees it. Matrices take columns consecutive locations of size / columns bytes each.
+struct VertexAttribute
+{
+	int location;
+	int components;
+	GLenum type;
+	bool normalized;
+	bool integer;         // glVertexAttribIPointer, read as ivec/uvec
+	int columns;
+	size_t offset;        // bytes into the vertex
+	size_t size;          // bytes
+	unsigned int divisor; // 0 per vertex, n advances every n instances
+};
+
+template <typename T>
+constexpr VertexAttribute vertexAttribute(int location, size_t offset, unsigned int divisor)
+{
+	return { location, VertexAttributeType<T>::components, VertexAttributeType<T>::type, VertexAttributeType<T>::normalized,
+		VertexAttributeType<T>::integer, VertexAttributeType<T>::columns, offset, sizeof(T), divisor };
+}
+
+#define VERTEX_ATTRIBUTE(Vertex, member, location) \
+	vertexAttribute<decltype(Vertex::member)>(location, offsetof(Vertex, member), 0)
+#define INSTANCE_ATTRIBUTE(Vertex, member, location) \
+	vertexAttribute<decltype(Vertex::member)>(location, offsetof(Vertex, member), 1)
+
+template <typename Vertex, size_t Count>
+struct VertexLayout
+{
+	VertexAttribute attributes[Count];
+	static constexpr size_t count = Count;
+	static constexpr size_t stride = sizeof(Vertex);
+};
+template <typename Vertex, size_t Count> constexpr size_t VertexLayout<Vertex, Count>::count;
+template <typename Vertex, size_t Count> constexpr size_t VertexLayout<Vertex, Count>::stride;
+
+template <typename Vertex, typename... Attributes>
+constexpr VertexLayout<Vertex, sizeof...(Attributes)> makeVertexLayout(Attributes... attributes)
+{
+	return { { attributes... } };
+}
+
+enum VertexStreams
+{
+	VERTEX_INTERLEAVED,   // one stream of whole vertices
+	VERTEX_SPLIT          // one stream per attribute (SoA)
+};
+
+//VERTEX_STREAMS=split picks VERTEX_SPLIT, anything else VERTEX_INTERLEAVED.
+VertexStreams readVertexStreams();
+
+//glVertexAttrib(I)Pointer, glEnableVertexAttribArray and glVertexAttribDivisor for the bound VAO, reading the
+//bound GL_ARRAY_BUFFER from offset with stride; a stride of 0 means every attribute is its own tightly packed
+//stream of vertexCount elements, one after the other in attribute order.
+void setVertexAttributes(const VertexAttribute* attributes, size_t count, size_t stride, size_t offset, size_t vertexCount);
+//Copies interleaved vertices into split streams, laid out as setVertexAttributes expects.
+void splitVertexStreams(const VertexAttribute* attributes, size_t count, size_t stride, const void* vertices,
+	size_t vertexCount, std::vector<unsigned char>& streams);
+
+//Uploads size bytes of Vertex structs (sizeof of an array of them, or of a float array laid out the same) into the
+//bound GL_ARRAY_BUFFER with glBufferData and sets the attributes of the bound VAO.
+template <typename Vertex, size_t Count>
+void uploadVertices(const VertexLayout<Vertex, Count>& layout, const void* vertices, size_t size, VertexStreams streams,
+	GLenum usage)
+{
+	size_t vertexCount = size / sizeof(Vertex);
+	if (streams == VERTEX_SPLIT)
+	{
+		std::vector<unsigned char> split;
+		splitVertexStreams(layout.attributes, Count, sizeof(Vertex), vertices, vertexCount, split);
+		glBufferData(GL_ARRAY_BUFFER, split.size(), split.data(), usage);
+		setVertexAttributes(layout.attributes, Count, 0, 0, vertexCount);
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, usage);
+		setVertexAttributes(layout.attributes, Count, sizeof(Vertex), 0, vertexCount);
+	}
+}
+
+//Sets the attributes for vertices already in the bound GL_ARRAY_BUFFER, interleaved at offset.
+template <typename Vertex, size_t Count>
+void setVertexAttributes(const VertexLayout<Vertex, Count>& layout, size_t offset = 0)
+{
+	setVertexAttributes(layout.attributes, Count, sizeof(Vertex), offset, 0);
+}
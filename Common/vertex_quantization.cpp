@@ -0,0 +1,240 @@
+#include "vertex_quantization.h"
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	glm::vec3 readVec3(const float* vertex, int offset)
+	{
+		return glm::vec3(vertex[offset], vertex[offset + 1], vertex[offset + 2]);
+	}
+
+	glm::vec2 octahedralEncode(glm::vec3 normal)
+	{
+		normal /= fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+		if (normal.z >= 0.0f)
+			return glm::vec2(normal.x, normal.y);
+		// the lower half folds over the diagonals
+		return glm::vec2((1.0f - fabsf(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - fabsf(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f));
+	}
+
+	//decodeNormal of VERTEX_DECODE_GLSL.
+	glm::vec3 octahedralDecode(glm::vec2 encoded)
+	{
+		glm::vec3 normal(encoded.x, encoded.y, 1.0f - fabsf(encoded.x) - fabsf(encoded.y));
+		float fold = std::max(-normal.z, 0.0f);
+		normal.x += normal.x >= 0.0f ? -fold : fold;
+		normal.y += normal.y >= 0.0f ? -fold : fold;
+		return glm::normalize(normal);
+	}
+
+	float angleDegrees(glm::vec3 a, glm::vec3 b)
+	{
+		float cosine = glm::clamp(glm::dot(glm::normalize(a), glm::normalize(b)), -1.0f, 1.0f);
+		return glm::degrees(acosf(cosine));
+	}
+
+	const char* positionFormatName(PositionFormat format)
+	{
+		return format == POSITION_UNORM16 ? "unorm16" : "float";
+	}
+
+	const char* normalFormatName(NormalFormat format)
+	{
+		switch (format)
+		{
+		case NORMAL_FLOAT3: return "float";
+		case NORMAL_SNORM10: return "snorm10";
+		case NORMAL_OCT16: return "octahedral snorm16";
+		default: return "no";
+		}
+	}
+
+	const char* uvFormatName(UvFormat format)
+	{
+		switch (format)
+		{
+		case UV_FLOAT2: return "float";
+		case UV_HALF2: return "half";
+		default: return "no";
+		}
+	}
+}
+
+void quantizeVertices(const float* vertices, size_t vertexCount, const FloatVertexLayout& layout,
+	const VertexTolerance& tolerance, QuantizedVertices& quantized)
+{
+	glm::vec3 minimum(0.0f), maximum(0.0f);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		glm::vec3 position = readVec3(vertices + i * layout.vertexSize, layout.position);
+		minimum = i ? glm::min(minimum, position) : position;
+		maximum = i ? glm::max(maximum, position) : position;
+	}
+	glm::vec3 extent = maximum - minimum;
+	glm::vec3 inverseExtent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+		extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+	// worst round trip error of every candidate
+	float positionError = 0.0f, snorm10Error = 0.0f, octahedralError = 0.0f, halfError = 0.0f;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float* vertex = vertices + i * layout.vertexSize;
+		glm::vec3 position = readVec3(vertex, layout.position);
+		glm::vec4 stored = glm::unpackUnorm4x16(glm::packUnorm4x16(glm::vec4((position - minimum) * inverseExtent, 0.0f)));
+		glm::vec3 difference = glm::abs(minimum + extent * glm::vec3(stored) - position);
+		positionError = std::max(positionError, std::max(difference.x, std::max(difference.y, difference.z)));
+
+		if (layout.normal >= 0)
+		{
+			glm::vec3 normal = readVec3(vertex, layout.normal);
+			if (glm::dot(normal, normal) > 0.0f)
+			{
+				glm::vec4 snorm10 = glm::unpackSnorm3x10_1x2(glm::packSnorm3x10_1x2(glm::vec4(glm::normalize(normal), 0.0f)));
+				snorm10Error = std::max(snorm10Error, angleDegrees(glm::vec3(snorm10), normal));
+				glm::vec2 octahedral = glm::unpackSnorm2x16(glm::packSnorm2x16(octahedralEncode(normal)));
+				octahedralError = std::max(octahedralError, angleDegrees(octahedralDecode(octahedral), normal));
+			}
+		}
+		if (layout.uv >= 0)
+		{
+			glm::vec2 uv(vertex[layout.uv], vertex[layout.uv + 1]);
+			glm::vec2 difference = glm::abs(glm::unpackHalf2x16(glm::packHalf2x16(uv)) - uv);
+			halfError = std::max(halfError, std::max(difference.x, difference.y));
+		}
+	}
+
+	quantized.positionFormat = positionError <= tolerance.position ? POSITION_UNORM16 : POSITION_FLOAT3;
+	quantized.positionError = quantized.positionFormat == POSITION_UNORM16 ? positionError : 0.0f;
+	quantized.normalFormat = NORMAL_NONE;
+	quantized.normalErrorDegrees = 0.0f;
+	if (layout.normal >= 0)
+	{
+		if (snorm10Error <= tolerance.normalDegrees)
+		{
+			quantized.normalFormat = NORMAL_SNORM10;
+			quantized.normalErrorDegrees = snorm10Error;
+		}
+		else if (octahedralError <= tolerance.normalDegrees)
+		{
+			quantized.normalFormat = NORMAL_OCT16;
+			quantized.normalErrorDegrees = octahedralError;
+		}
+		else
+			quantized.normalFormat = NORMAL_FLOAT3;
+	}
+	quantized.uvFormat = layout.uv < 0 ? UV_NONE : halfError <= tolerance.uv ? UV_HALF2 : UV_FLOAT2;
+	quantized.uvError = quantized.uvFormat == UV_HALF2 ? halfError : 0.0f;
+
+	// every attribute starts 4 byte aligned
+	quantized.positionOffset = 0;
+	quantized.normalOffset = quantized.positionFormat == POSITION_UNORM16 ? 8 : 12;
+	size_t normalBytes = quantized.normalFormat == NORMAL_NONE ? 0 : quantized.normalFormat == NORMAL_FLOAT3 ? 12 : 4;
+	quantized.uvOffset = quantized.normalOffset + normalBytes;
+	size_t uvBytes = quantized.uvFormat == UV_NONE ? 0 : quantized.uvFormat == UV_FLOAT2 ? 8 : 4;
+	quantized.stride = quantized.uvOffset + uvBytes;
+	quantized.decodeOffset = quantized.positionFormat == POSITION_UNORM16 ? minimum : glm::vec3(0.0f);
+	quantized.decodeScale = quantized.positionFormat == POSITION_UNORM16 ? extent : glm::vec3(1.0f);
+	quantized.vertexCount = vertexCount;
+	quantized.data.assign(vertexCount * quantized.stride, 0);
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float* vertex = vertices + i * layout.vertexSize;
+		unsigned char* target = quantized.data.data() + i * quantized.stride;
+		glm::vec3 position = readVec3(vertex, layout.position);
+		if (quantized.positionFormat == POSITION_UNORM16)
+		{
+			glm::uint64 packed = glm::packUnorm4x16(glm::vec4((position - minimum) * inverseExtent, 0.0f));
+			memcpy(target + quantized.positionOffset, &packed, 8);
+		}
+		else
+			memcpy(target + quantized.positionOffset, &position, 12);
+
+		if (quantized.normalFormat != NORMAL_NONE)
+		{
+			glm::vec3 normal = readVec3(vertex, layout.normal);
+			glm::uint32 packed = 0;
+			if (quantized.normalFormat == NORMAL_FLOAT3)
+				memcpy(target + quantized.normalOffset, &normal, 12);
+			else if (glm::dot(normal, normal) > 0.0f)
+			{
+				packed = quantized.normalFormat == NORMAL_SNORM10 ?
+					glm::packSnorm3x10_1x2(glm::vec4(glm::normalize(normal), 0.0f)) :
+					glm::packSnorm2x16(octahedralEncode(normal));
+				memcpy(target + quantized.normalOffset, &packed, 4);
+			}
+		}
+
+		if (quantized.uvFormat != UV_NONE)
+		{
+			glm::vec2 uv(vertex[layout.uv], vertex[layout.uv + 1]);
+			if (quantized.uvFormat == UV_HALF2)
+			{
+				glm::uint32 packed = glm::packHalf2x16(uv);
+				memcpy(target + quantized.uvOffset, &packed, 4);
+			}
+			else
+				memcpy(target + quantized.uvOffset, &uv, 8);
+		}
+	}
+}
+
+size_t quantizedAttributes(const QuantizedVertices& quantized, int positionLocation, int normalLocation, int uvLocation,
+	VertexAttribute* attributes)
+{
+	size_t count = 0;
+	if (positionLocation >= 0)
+	{
+		bool unorm16 = quantized.positionFormat == POSITION_UNORM16;
+		VertexAttribute position = { positionLocation, 3, (GLenum)(unorm16 ? GL_UNSIGNED_SHORT : GL_FLOAT), unorm16, false, 1,
+			quantized.positionOffset, (size_t)(unorm16 ? 8 : 12), 0 };
+		attributes[count++] = position;
+	}
+	if (normalLocation >= 0 && quantized.normalFormat != NORMAL_NONE)
+	{
+		VertexAttribute normal = { normalLocation, 3, GL_FLOAT, false, false, 1, quantized.normalOffset, 12, 0 };
+		if (quantized.normalFormat == NORMAL_SNORM10)
+			normal = vertexAttribute<Snorm10x3>(normalLocation, quantized.normalOffset, 0);
+		else if (quantized.normalFormat == NORMAL_OCT16)
+			normal = vertexAttribute<Normalized<glm::i16vec2>>(normalLocation, quantized.normalOffset, 0);
+		attributes[count++] = normal;
+	}
+	if (uvLocation >= 0 && quantized.uvFormat != UV_NONE)
+		attributes[count++] = quantized.uvFormat == UV_HALF2 ? vertexAttribute<Half2>(uvLocation, quantized.uvOffset, 0) :
+			vertexAttribute<glm::vec2>(uvLocation, quantized.uvOffset, 0);
+	return count;
+}
+
+void setQuantizedAttributes(const QuantizedVertices& quantized, int positionLocation, int normalLocation, int uvLocation)
+{
+	VertexAttribute attributes[3];
+	size_t count = quantizedAttributes(quantized, positionLocation, normalLocation, uvLocation, attributes);
+	setVertexAttributes(attributes, count, quantized.stride, 0, quantized.vertexCount);
+}
+
+void setVertexDecodeUniforms(unsigned int program, const QuantizedVertices& quantized)
+{
+	setVertexDecodeUniforms(program, quantized.decodeOffset, quantized.decodeScale, quantized.normalFormat == NORMAL_OCT16);
+}
+
+void setVertexDecodeUniforms(unsigned int program, const glm::vec3& offset, const glm::vec3& scale, bool octahedralNormals)
+{
+	glUniform3fv(glGetUniformLocation(program, "positionOffset"), 1, glm::value_ptr(offset));
+	glUniform3fv(glGetUniformLocation(program, "positionScale"), 1, glm::value_ptr(scale));
+	glUniform1i(glGetUniformLocation(program, "octahedralNormals"), octahedralNormals);
+}
+
+void printQuantizedVertexStats(const char* name, const QuantizedVertices& quantized, const FloatVertexLayout& layout)
+{
+	std::cout << "Vertices " << name << ": " << quantized.vertexCount << " x " << quantized.stride << " bytes ("
+		<< positionFormatName(quantized.positionFormat) << " positions, " << normalFormatName(quantized.normalFormat)
+		<< " normals, " << uvFormatName(quantized.uvFormat) << " uvs) instead of " << layout.vertexSize * sizeof(float)
+		<< "; worst error " << quantized.positionError << " position, " << quantized.normalErrorDegrees
+		<< " degrees normal, " << quantized.uvError << " uv" << std::endl;
+}
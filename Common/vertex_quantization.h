@@ -0,0 +1,106 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+#include "vertex_layout.h"
+
+//Compact vertex formats, packed with glm/gtc/packing.hpp and decoded in the vertex shader.
+//	positions  float3, or unorm16x3 relative to the mesh's bounding box (8 bytes with padding)
+//	normals    float3, snorm10x3 in GL_INT_2_10_10_10_REV (decoded by the vertex fetch), or octahedral
+//	           snorm16x2 (decoded in the shader, about 30x more precise)
+//	uvs        float2, or half2
+//quantizeVertices() picks per mesh the smallest format whose worst round trip error over all vertices stays
+//within the tolerance, the cheaper to decode one when two are the same size.
+//
+//Shaders paste VERTEX_DECODE_GLSL after their #version line, declare the normal input as vec4 and read
+//decodePosition(aPos) and decodeNormal(aNormal). setVertexDecodeUniforms() tells them the mesh's formats;
+//a float mesh decodes to itself.
+#define VERTEX_DECODE_GLSL \
+"uniform vec3 positionOffset;\n" \
+"uniform vec3 positionScale;\n" \
+"uniform bool octahedralNormals;\n" \
+"vec3 decodePosition(vec3 position)\n" \
+"{\n" \
+"	return positionOffset + positionScale * position;\n" \
+"}\n" \
+"vec3 decodeNormal(vec4 normal)\n" \
+"{\n" \
+"	if (!octahedralNormals)\n" \
+"		return normal.xyz;\n" \
+"	vec3 n = vec3(normal.xy, 1.0 - abs(normal.x) - abs(normal.y));\n" \
+"	float fold = max(-n.z, 0.0);\n" \
+"	n.xy += vec2(n.x >= 0.0 ? -fold : fold, n.y >= 0.0 ? -fold : fold);\n" \
+"	return normalize(n);\n" \
+"}\n"
+
+enum PositionFormat
+{
+	POSITION_FLOAT3,
+	POSITION_UNORM16
+};
+
+enum NormalFormat
+{
+	NORMAL_NONE,
+	NORMAL_FLOAT3,
+	NORMAL_SNORM10,
+	NORMAL_OCT16
+};
+
+enum UvFormat
+{
+	UV_NONE,
+	UV_FLOAT2,
+	UV_HALF2
+};
+
+//Float offsets of the attributes in the source vertices, -1 for the ones it doesn't have.
+struct FloatVertexLayout
+{
+	size_t vertexSize;  // floats
+	int position;
+	int normal;
+	int uv;
+};
+
+struct VertexTolerance
+{
+	float position;       // in mesh units
+	float normalDegrees;
+	float uv;
+};
+
+//1/1000 of a unit, 0.25 degrees and half a texel of a 1024 texture.
+const VertexTolerance defaultVertexTolerance = { 0.001f, 0.25f, 1.0f / 2048.0f };
+
+struct QuantizedVertices
+{
+	PositionFormat positionFormat;
+	NormalFormat normalFormat;
+	UvFormat uvFormat;
+	size_t stride;               // bytes, multiple of 4
+	size_t positionOffset;       // bytes into a vertex
+	size_t normalOffset;
+	size_t uvOffset;
+	glm::vec3 decodeOffset;      // position = decodeOffset + decodeScale * stored
+	glm::vec3 decodeScale;
+	size_t vertexCount;
+	std::vector<unsigned char> data;
+	float positionError;         // worst round trip error of the chosen formats
+	float normalErrorDegrees;
+	float uvError;
+};
+
+void quantizeVertices(const float* vertices, size_t vertexCount, const FloatVertexLayout& layout,
+	const VertexTolerance& tolerance, QuantizedVertices& quantized);
+//The attributes setQuantizedAttributes sets, at most 3, returns how many.
+size_t quantizedAttributes(const QuantizedVertices& quantized, int positionLocation, int normalLocation, int uvLocation,
+	VertexAttribute* attributes);
+//glVertexAttribPointer and glEnableVertexAttribArray for the bound VAO, reading the bound GL_ARRAY_BUFFER
+//that holds data; a location of -1 leaves that attribute out.
+void setQuantizedAttributes(const QuantizedVertices& quantized, int positionLocation, int normalLocation, int uvLocation);
+//The uniforms of VERTEX_DECODE_GLSL; program has to be in use.
+void setVertexDecodeUniforms(unsigned int program, const QuantizedVertices& quantized);
+void setVertexDecodeUniforms(unsigned int program, const glm::vec3& offset, const glm::vec3& scale, bool octahedralNormals);
+//Chosen formats, bytes per vertex against floats, worst errors.
+void printQuantizedVertexStats(const char* name, const QuantizedVertices& quantized, const FloatVertexLayout& layout);
@@ -1,6 +1,8 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include "benchmark.h"
+#include "vertex_layout.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
@@ -13,6 +15,14 @@ void processInput(GLFWwindow* window)
 		glfwSetWindowShouldClose(window, true);
 }
 
+struct PositionVertex
+{
+	glm::vec3 position;
+};
+
+constexpr auto positionVertexLayout = makeVertexLayout<PositionVertex>(
+	VERTEX_ATTRIBUTE(PositionVertex, position, 0));
+
 const char* vertexShaderSource = 
 "#version 330 core\n"
 "layout (location = 0) in vec3 aPos;\n"
@@ -53,6 +63,8 @@ int main()
 		return -1;
 	}
 
+	initBenchmark("FirstTriangle");
+
 	glViewport(0, 0, 800, 600);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
@@ -113,17 +125,14 @@ int main()
 	glBindVertexArray(VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
-		(void*)0);
-	glEnableVertexAttribArray(0);
+	uploadVertices(positionVertexLayout, vertices, sizeof(vertices), readVertexStreams(), GL_STATIC_DRAW);
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 
 	while (!glfwWindowShouldClose(window))
 	{
+		beginBenchmarkFrame();
 
 		processInput(window);
 
@@ -135,9 +144,11 @@ int main()
 		glDrawArrays(GL_TRIANGLES, 0, 3);
 
 		glfwSwapBuffers(window);
+		endBenchmarkFrame(window);
 		glfwPollEvents();
 	}
 
+	finishBenchmark();
 	glfwTerminate();
 	return 0;
 
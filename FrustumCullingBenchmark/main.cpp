@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "benchmark.h"
+#include "frustum_culling.h"
+
+//Culls FRUSTUM_CULLING_OBJECTS bounding spheres (default 1M) scattered through a 1000 unit cube, seen by a
+//camera in its middle that turns a little every frame, for FRUSTUM_CULLING_FRAMES frames (default 200):
+//	scalar   sphereInFrustum for one sphere after the other, pushing the visible ones
+//	threads  cullSpheres (Common/frustum_culling.h) on FRUSTUM_CULLING_THREADS threads, e.g. "1,2,4" (default
+//	         powers of two up to the core count), batched with SSE or AVX and compacted without branches
+//Every frame's visible list is compared with the scalar one.
+
+std::vector<unsigned int> readThreadCounts()
+{
+	std::vector<unsigned int> counts;
+	const char* value = getenv("FRUSTUM_CULLING_THREADS");
+	if (value)
+	{
+		std::stringstream list(value);
+		std::string item;
+		while (std::getline(list, item, ','))
+			if (atoi(item.c_str()) > 0)
+				counts.push_back((unsigned int)atoi(item.c_str()));
+	}
+	if (!counts.empty())
+		return counts;
+
+	unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned int count = 1; count < cores; count *= 2)
+		counts.push_back(count);
+	counts.push_back(cores);
+	return counts;
+}
+
+Frustum frameFrustum(unsigned int frame)
+{
+	// the camera turns round once every 360 frames and nods up and down
+	float yaw = glm::radians((float)frame);
+	float pitch = 0.3f * sinf(frame * 0.05f);
+	glm::vec3 direction(cosf(pitch) * sinf(yaw), sinf(pitch), cosf(pitch) * cosf(yaw));
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f), direction, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 500.0f);
+	return frustumOf(projection * view);
+}
+
+size_t cullScalar(const Frustum& frustum, const CullSpheres& spheres, std::vector<unsigned int>& visible)
+{
+	visible.clear();
+	for (size_t i = 0; i < spheres.x.size(); i++)
+		if (sphereInFrustum(frustum, glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]))
+			visible.push_back((unsigned int)i);
+	return visible.size();
+}
+
+void printRow(const char* name, double totalMicroseconds, unsigned int frames, size_t objects, double visible)
+{
+	double perFrame = totalMicroseconds / frames;
+	std::cout << "  " << name << std::string(std::max(0, 11 - (int)std::string(name).size()), ' ') << perFrame
+		<< " us/frame (" << perFrame * 1000.0 / objects << " ns/object), " << visible / frames << " visible and "
+		<< objects - visible / frames << " culled per frame" << std::endl;
+}
+
+int main()
+{
+	unsigned int objects = readCount("FRUSTUM_CULLING_OBJECTS", 1000000);
+	unsigned int frames = readCount("FRUSTUM_CULLING_FRAMES", 200);
+	std::vector<unsigned int> threadCounts = readThreadCounts();
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f), radius(0.5f, 2.0f);
+	CullSpheres spheres;
+	for (unsigned int i = 0; i < objects; i++)
+		addCullSphere(spheres, glm::vec3(position(random), position(random), position(random)), radius(random));
+	std::cout << objects << " spheres, " << frames << " frames, " << cullBatchSize << " at a time:" << std::endl;
+
+	std::vector<unsigned int> scalarVisible;
+	scalarVisible.reserve(objects);
+	double total = 0.0, visibleTotal = 0.0;
+	for (unsigned int frame = 0; frame < frames; frame++)
+	{
+		Frustum frustum = frameFrustum(frame);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		visibleTotal += (double)cullScalar(frustum, spheres, scalarVisible);
+		total += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+	printRow("scalar", total, frames, objects, visibleTotal);
+
+	std::vector<unsigned int> visible(objects);
+	for (size_t t = 0; t < threadCounts.size(); t++)
+	{
+		CullPool* pool = createCullPool(threadCounts[t]);
+		unsigned int mismatches = 0;
+		for (unsigned int frame = 0; frame < frames; frame++)
+		{
+			Frustum frustum = frameFrustum(frame);
+			size_t count = cullSpheres(pool, frustum, spheres, visible.data());
+			// outside the timing, which cullSpheres keeps itself
+			cullScalar(frustum, spheres, scalarVisible);
+			if (count != scalarVisible.size() || !std::equal(scalarVisible.begin(), scalarVisible.end(), visible.begin()))
+				mismatches++;
+		}
+		CullStats stats = getCullStats(pool);
+		std::string name = std::to_string(threadCounts[t]) + (threadCounts[t] == 1 ? " thread" : " threads");
+		printRow(name.c_str(), stats.meanMicroseconds * frames, frames, objects, stats.meanVisible * frames);
+		std::cout << "    " << stats.maxMicroseconds << " us max, " << mismatches << " frames differ from scalar" << std::endl;
+		destroyCullPool(pool);
+	}
+	return 0;
+}
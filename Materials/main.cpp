@@ -1,30 +1,46 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "benchmark.h"
+#include "camera_block.h"
+#include "cpu_profiler.h"
+#include "frustum_culling.h"
+#include "gl_state.h"
+#include "gltf_loader.h"
+#include "gpu_timer.h"
+#include "mesh_optimizer.h"
+#include "normal_matrix.h"
+#include "program_cache.h"
+#include "texture_loader.h"
+#include "uniform_table.h"
+#include "vertex_quantization.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	stateViewport(0, 0, width, height);
 }
 
 void processInput(GLFWwindow* window)
 {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
+	dumpCpuTraceOnKey(window, GLFW_KEY_F12);
 }
 
 const char* lightCubeVertexShaderSource = //same for light
 "#version 330 core\n"
+CAMERA_BLOCK_GLSL
+VERTEX_DECODE_GLSL
 "layout(location = 0) in vec3 aPos;\n"
 "uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
 "void main()\n"
 "{\n"
-"	gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
+"	gl_Position = viewProj * model * vec4(decodePosition(aPos), 1.0);\n"
 "}\n";
 
 const char* lightCubeFragmentShaderSource =
@@ -37,28 +53,34 @@ const char* lightCubeFragmentShaderSource =
 
 const char* materialVertexShaderSource =
 "#version 330 core\n"
+CAMERA_BLOCK_GLSL
+VERTEX_DECODE_GLSL
 "layout(location = 0) in vec3 aPos;\n"
-"layout(location = 1) in vec3 aNormal;\n"
+"layout(location = 1) in vec4 aNormal;\n"
+"layout(location = 2) in vec2 aTexCoord;\n"
 "out vec3 FragPos;\n"
 "out vec3 Normal;\n"
+"out vec2 TexCoord;\n"
 "uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
+"uniform mat3 normalMatrix;\n"
 "void main()\n"
 "{\n"
-"	FragPos = vec3(model * vec4(aPos, 1.0));\n"
-"	Normal = mat3(transpose(inverse(model))) * aNormal;\n"
-"	gl_Position = projection * view * vec4(FragPos, 1.0);\n"
+"	FragPos = vec3(model * vec4(decodePosition(aPos), 1.0));\n"
+"	Normal = normalMatrix * decodeNormal(aNormal);\n"
+"	TexCoord = aTexCoord;\n"
+"	gl_Position = viewProj * vec4(FragPos, 1.0);\n"
 "}\n";
 
 const char* materialFragmentShaderSource =
 "#version 330 core\n"
+CAMERA_BLOCK_GLSL
 "out vec4 FragColor;\n"
 "struct Material {\n"
 "	vec3 ambient;\n"
 "	vec3 diffuse;\n"
 "	vec3 specular;\n"
 "	float shininess;\n"
+"	sampler2D diffuseMap;\n" // white for materials without a texture
 "};\n"
 "struct Light {\n"
 "	vec3 position;\n"
@@ -68,16 +90,17 @@ const char* materialFragmentShaderSource =
 "};\n"
 "in vec3 FragPos;\n"
 "in vec3 Normal;\n"
-"uniform vec3 viewPos;\n"
+"in vec2 TexCoord;\n"
 "uniform Material material;\n"
 "uniform Light light;\n"
 "void main()\n"
 "{\n"
-"	vec3 ambient = light.ambient * material.ambient;\n" //ambient
+"	vec3 baseColor = texture(material.diffuseMap, TexCoord).rgb;\n"
+"	vec3 ambient = light.ambient * material.ambient * baseColor;\n" //ambient
 "	vec3 norm = normalize(Normal);\n" // diffuse 
 "	vec3 lightDir = normalize(light.position - FragPos);\n"
 "	float diff = max(dot(norm, lightDir), 0.0);\n"
-"	vec3 diffuse = light.diffuse * (diff * material.diffuse);\n"
+"	vec3 diffuse = light.diffuse * (diff * material.diffuse * baseColor);\n"
 "	vec3 viewDir = normalize(viewPos - FragPos);\n" // specular
 "	vec3 reflectDir = reflect(-lightDir, norm);\n"
 "	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);\n"
@@ -87,9 +110,6 @@ const char* materialFragmentShaderSource =
 "}\n";
 
 
-const char* vertexShaderError = "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n";
-const char* fragmentShaderError = "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n";
-const char* shaderProgramError = "ERROR::SHADER::PROGRAM::LINKING_FAILED\n";
 
 // timing
 float deltaTime = 0.0f;
@@ -99,49 +119,10 @@ float lastFrame = 0.0f;
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
-bool checkShaderError(int success, int shaderId, const char* shaderError)
-{
-	if (!success)
-	{
-		char infoLog[512];
-		glGetShaderInfoLog(shaderId, 512, NULL, infoLog);
-		std::cout << shaderError <<
-			infoLog << std::endl;
-	}
-	return success;
-}
-
-//As we require two shaders here I define some utility functions, a class would be better for so many reasons
-//but I'll stick with functions now
-int createAndCompileShader(const char* shaderSourceCode, unsigned int& shaderId, unsigned int shaderType)
-{
-	shaderId = glCreateShader(shaderType);
-
-	glShaderSource(shaderId, 1, &shaderSourceCode, NULL);
-	glCompileShader(shaderId);
-
-	int success;
-	glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
-	return success;
-}
-
-int createAndLinkShaderProgram(unsigned int vertexShaderId, unsigned int fragmentShaderId, unsigned int& shaderProgram)
-{
-	shaderProgram = glCreateProgram();
-
-	glAttachShader(shaderProgram, vertexShaderId);
-	glAttachShader(shaderProgram, fragmentShaderId);
-	glLinkProgram(shaderProgram);
-
-	int success;
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-	return success;
-}
-
-
 int main()
 {
 
+	initCpuProfiler();
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -162,53 +143,22 @@ int main()
 		return -1;
 	}
 
+	initBenchmark("Materials");
+	initGpuTimer();
+
 	glViewport(0, 0, 800, 600);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
 	//Shader section
-	unsigned int lightCubeVertexShader = 0, materialVertexShader = 0;
-	checkShaderError(
-		createAndCompileShader(lightCubeVertexShaderSource, lightCubeVertexShader, GL_VERTEX_SHADER), 
-		lightCubeVertexShader, 
-		vertexShaderError
-	);
-
-	checkShaderError(
-		createAndCompileShader(materialVertexShaderSource, materialVertexShader, GL_VERTEX_SHADER),
-		materialVertexShader,
-		vertexShaderError
-	);
-
-	unsigned int lightCubeFragmentShader = 0, materialFragmentShader = 0;
-	checkShaderError(
-		createAndCompileShader(lightCubeFragmentShaderSource, lightCubeFragmentShader, GL_FRAGMENT_SHADER),
-		lightCubeFragmentShader,
-		fragmentShaderError
-	);
-
-	checkShaderError(
-		createAndCompileShader(materialFragmentShaderSource, materialFragmentShader, GL_FRAGMENT_SHADER),
-		materialFragmentShader,
-		fragmentShaderError
-	);
-
 	unsigned int lightCubeShaderProgram = 0, materialShaderProgram = 0;
-	checkShaderError(
-		createAndLinkShaderProgram(lightCubeVertexShader, lightCubeFragmentShader, lightCubeShaderProgram),
-		lightCubeShaderProgram,
-		shaderProgramError
-	);
-
-	checkShaderError(
-		createAndLinkShaderProgram(materialVertexShader, materialFragmentShader, materialShaderProgram),
-		materialShaderProgram,
-		shaderProgramError
-	);
-
-	glDeleteShader(lightCubeVertexShader);
-	glDeleteShader(lightCubeFragmentShader);
-	glDeleteShader(materialVertexShader);
-	glDeleteShader(materialFragmentShader);
+	createCachedShaderProgram(lightCubeVertexShaderSource, lightCubeFragmentShaderSource, lightCubeShaderProgram);
+	createCachedShaderProgram(materialVertexShaderSource, materialFragmentShaderSource, materialShaderProgram);
+	printProgramCacheStats();
+
+	// view and projection live in one buffer shared by both programs
+	unsigned int cameraBuffer = createCameraBuffer();
+	bindCameraBlock(lightCubeShaderProgram);
+	bindCameraBlock(materialShaderProgram);
 
 	glUseProgram(materialShaderProgram); //Not sure what to do with this
 
@@ -257,21 +207,34 @@ int main()
 		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
 	};
 
-	unsigned int VBO, VAO;
+	// the 36 corners weld to 24 vertices, drawn with an index buffer in vertex cache order
+	IndexedMesh cube;
+	buildIndexedMesh(vertices, sizeof(vertices) / (6 * sizeof(float)), 6, cube);
+	printIndexedMeshStats("cube", cube);
+	GLenum cubeIndexType = cube.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	// and packed into the smallest formats that keep it exact enough, decoded by both programs
+	FloatVertexLayout cubeLayout = { 6, 0, 3, -1 };
+	QuantizedVertices cubeVertices;
+	quantizeVertices(cube.vertices.data(), cube.vertices.size() / 6, cubeLayout, defaultVertexTolerance, cubeVertices);
+	printQuantizedVertexStats("cube", cubeVertices, cubeLayout);
+	glUseProgram(lightCubeShaderProgram);
+	setVertexDecodeUniforms(lightCubeShaderProgram, cubeVertices);
+	glUseProgram(materialShaderProgram);
+	setVertexDecodeUniforms(materialShaderProgram, cubeVertices);
+
+	unsigned int VBO, VAO, EBO;
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
 
 	glBindVertexArray(VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, cubeVertices.data.size(), cubeVertices.data.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, cube.indices.size(), cube.indices.data(), GL_STATIC_DRAW);
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-		(void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-		(void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	setQuantizedAttributes(cubeVertices, 0, 1, -1);
 
 	unsigned int lightVAO;
 	glGenVertexArrays(1, &lightVAO);
@@ -279,19 +242,88 @@ int main()
 
 	// we only need to bind to the VBO (to link it with glVertexAttribPointer), no need to fill it; the VBO's data already contains all we need (it's already bound, but we do it again for educational purposes)
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
+	// the element buffer binding is part of the VAO, the lamp needs it as well
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	setQuantizedAttributes(cubeVertices, 0, -1, -1);
+
+	// materials without a texture sample white, which leaves their colors as they are
+	unsigned int whiteTexture;
+	const unsigned char white[] = { 255, 255, 255, 255 };
+	glGenTextures(1, &whiteTexture);
+	glBindTexture(GL_TEXTURE_2D, whiteTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// MATERIALS_MODEL=<file.gltf or .glb> draws that model in place of the material cube, scaled to the cube's size
+	const char* modelPath = getenv("MATERIALS_MODEL");
+	GltfModel gltf;
+	bool hasModel = false;
+	glm::mat4 modelFit = glm::mat4(1.0f);
+	if (modelPath)
+	{
+		initTextureLoader();
+		hasModel = loadGltfModel(modelPath, gltf);
+	}
+	if (hasModel)
+	{
+		printGltfModelStats(modelPath, gltf);
+		glm::vec3 extent = gltf.maximum - gltf.minimum;
+		float size = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+		modelFit = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / size));
+		modelFit = glm::translate(modelFit, -0.5f * (gltf.minimum + gltf.maximum));
+		// the attributes are read in the file's formats, positions need no decoding
+		glUseProgram(materialShaderProgram);
+		setVertexDecodeUniforms(materialShaderProgram, glm::vec3(0.0f), glm::vec3(1.0f), false);
+	}
+
+	// bounding spheres of the material objects (the cube or the model's draws) and then the lamp, culled every frame;
+	// a handful of objects, the calling thread is plenty
+	CullSpheres sceneSpheres;
+	std::vector<unsigned int> visibleObjects((hasModel ? gltf.draws.size() : 1) + 1);
+	CullPool* cullPool = createCullPool(1);
 
 	// lighting position
 	glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
 	glEnable(GL_DEPTH_TEST);
 
+	// uniform handles, resolved once so the loop doesn't look names up every frame
+	UniformTable materialUniforms, lightCubeUniforms;
+	reflectUniforms(materialShaderProgram, materialUniforms);
+	reflectUniforms(lightCubeShaderProgram, lightCubeUniforms);
+
+	Uniform<glm::vec3> lightAmbientUniform = findUniform<glm::vec3>(materialUniforms, "light.ambient");
+	Uniform<glm::vec3> lightDiffuseUniform = findUniform<glm::vec3>(materialUniforms, "light.diffuse");
+	Uniform<glm::vec3> lightSpecularUniform = findUniform<glm::vec3>(materialUniforms, "light.specular");
+	Uniform<glm::vec3> materialAmbientUniform = findUniform<glm::vec3>(materialUniforms, "material.ambient");
+	Uniform<glm::vec3> materialDiffuseUniform = findUniform<glm::vec3>(materialUniforms, "material.diffuse");
+	Uniform<glm::vec3> materialSpecularUniform = findUniform<glm::vec3>(materialUniforms, "material.specular");
+	Uniform<float> materialShininessUniform = findUniform<float>(materialUniforms, "material.shininess");
+	Uniform<glm::mat4> materialModelUniform = findUniform<glm::mat4>(materialUniforms, "model");
+	Uniform<glm::mat3> materialNormalMatrixUniform = findUniform<glm::mat3>(materialUniforms, "normalMatrix");
+
+	Uniform<glm::mat4> lightCubeModelUniform = findUniform<glm::mat4>(lightCubeUniforms, "model");
+
+	// setup above talked to GL directly, start the state cache from scratch
+	resetStateCache();
+
+	unsigned int materialCubeScope = gpuScopeId("material cube");
+	unsigned int lampScope = gpuScopeId("lamp");
+
 	while (!glfwWindowShouldClose(window))
 	{
+		beginBenchmarkFrame();
+		beginCpuZone("frame");
+		beginGpuFrame();
 
+		beginCpuZone("processInput");
 		processInput(window);
+		endCpuZone();
+
+		if (modelPath)
+			pumpTextureUploads();
 
-		float currentFrame = glfwGetTime();
+		float currentFrame = benchmarkTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
@@ -299,14 +331,15 @@ int main()
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 
-		glUseProgram(materialShaderProgram);
+		beginCpuZone("uniforms");
+		stateUseProgram(materialShaderProgram);
 
 		//Material and light stuff
 		 // light properties
 		glm::vec3 lightColor;
-		lightColor.x = sin(glfwGetTime() * 2.0f);
-		lightColor.y = sin(glfwGetTime() * 0.7f);
-		lightColor.z = sin(glfwGetTime() * 1.3f);
+		lightColor.x = sin(benchmarkTime() * 2.0f);
+		lightColor.y = sin(benchmarkTime() * 0.7f);
+		lightColor.z = sin(benchmarkTime() * 1.3f);
 		glm::vec3 diffuseColor = lightColor * glm::vec3(0.5f); // decrease the influence
 		glm::vec3 ambientColor = diffuseColor * glm::vec3(0.2f); // low influence
 		glm::vec3 specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
@@ -315,83 +348,122 @@ int main()
 		glm::vec3 materialSpecularColor = glm::vec3(0.5f, 0.5f, 0.5f);
 		float materialShininessColor = 32.0f;
 
-		GLuint lightAmbientLocation = glGetUniformLocation(materialShaderProgram, "light.ambient");
-		GLuint lightDiffuseLocation = glGetUniformLocation(materialShaderProgram, "light.diffuse");
-		GLuint lightSpecularLocation = glGetUniformLocation(materialShaderProgram, "light.specular");
-		GLuint materialAmbientLocation = glGetUniformLocation(materialShaderProgram, "material.ambient");
-		GLuint materialDiffuseLocation = glGetUniformLocation(materialShaderProgram, "material.diffuse");
-		GLuint materialSpecularLocation = glGetUniformLocation(materialShaderProgram, "material.specular");
-		GLuint materialShininessLocation = glGetUniformLocation(materialShaderProgram, "material.shininess");
-
-
-		glUniform3fv(lightAmbientLocation,1 , glm::value_ptr(ambientColor));
-		glUniform3fv(lightDiffuseLocation,1 , glm::value_ptr(diffuseColor));
-		glUniform3fv(lightSpecularLocation, 1, glm::value_ptr(specularColor));
-		glUniform3fv(materialAmbientLocation, 1, glm::value_ptr(materialAmbientColor));
-		glUniform3fv(materialDiffuseLocation, 1, glm::value_ptr(materialDiffuseColor));
-		glUniform3fv(materialSpecularLocation, 1, glm::value_ptr(materialSpecularColor));
-		glUniform1f(materialShininessLocation, materialShininessColor);
-
-
-		//Light settings
-		glm::vec3 objectColor(1.0f, 0.5f, 0.31f);
-		lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
-		GLuint objectColorLocation = glGetUniformLocation(materialShaderProgram, "objectColor");
-		GLuint lightColorLocation = glGetUniformLocation(materialShaderProgram, "lightColor");
-		GLuint lightPosLocation = glGetUniformLocation(materialShaderProgram, "lightPos");
-		glUniform3fv(objectColorLocation, 1, glm::value_ptr(objectColor));
-		glUniform3fv(lightColorLocation, 1, glm::value_ptr(lightColor));
-		glUniform3fv(lightPosLocation, 1, glm::value_ptr(lightPos));
+		setUniform(lightAmbientUniform, ambientColor);
+		setUniform(lightDiffuseUniform, diffuseColor);
+		setUniform(lightSpecularUniform, specularColor);
+		setUniform(materialAmbientUniform, materialAmbientColor);
+		setUniform(materialDiffuseUniform, materialDiffuseColor);
+		setUniform(materialSpecularUniform, materialSpecularColor);
+		setUniform(materialShininessUniform, materialShininessColor);
 
 		// camera/view transformation
-		GLuint viewMatrixLocation = glGetUniformLocation(materialShaderProgram, "view");
-		GLuint projectionMatrixLocation = glGetUniformLocation(materialShaderProgram, "projection");
-		GLuint modelMatrixLocation = glGetUniformLocation(materialShaderProgram, "model");
-
-
 		glm::mat4 view = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
 		float radius = 10.0f;
-		float camX = sin(glfwGetTime()) * radius;
-		float camZ = cos(glfwGetTime()) * radius;
+		float camX = sin(benchmarkTime()) * radius;
+		float camZ = cos(benchmarkTime()) * radius;
 		view = glm::lookAt(glm::vec3(camX, 0.0f, camZ), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
 		glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+		updateCameraBuffer(cameraBuffer, view, projection, glm::vec3(camX, 0.0f, camZ), benchmarkTime());
 
 		glm::mat4 model = glm::mat4(1.0f);
 		float angle = 0.0f;
 		model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
 
-		glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
-		glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
-		glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(model));
+		setUniform(materialModelUniform, model);
+		setUniform(materialNormalMatrixUniform, normalMatrixOf(model)); // once per object, not per vertex
+		endCpuZone();
+
+		glm::mat4 lampModel = glm::mat4(1.0f);
+		lampModel = glm::translate(lampModel, lightPos);
+		lampModel = glm::scale(lampModel, glm::vec3(0.2f)); // a smaller cube
+
+		// the visible list is in sphere order, material objects first and the lamp last
+		beginCpuZone("culling");
+		clearCullSpheres(sceneSpheres);
+		if (hasModel)
+			for (size_t i = 0; i < gltf.draws.size(); i++)
+			{
+				const GltfPrimitive& primitive = gltf.primitives[gltf.draws[i].primitive];
+				addCullBox(sceneSpheres, model * modelFit * gltf.draws[i].transform, primitive.minimum, primitive.maximum);
+			}
+		else
+			addCullBox(sceneSpheres, model, glm::vec3(-0.5f), glm::vec3(0.5f));
+		addCullBox(sceneSpheres, lampModel, glm::vec3(-0.5f), glm::vec3(0.5f));
+		size_t visibleCount = cullSpheres(cullPool, frustumOf(projection * view), sceneSpheres, visibleObjects.data());
+		bool lampVisible = visibleCount && visibleObjects[visibleCount - 1] == sceneSpheres.x.size() - 1;
+		size_t visibleMaterialObjects = visibleCount - (lampVisible ? 1 : 0);
+		endCpuZone();
 
 		// render the cube
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
+		beginCpuZone("draw");
+		beginGpuScope(materialCubeScope);
+		if (hasModel)
+		{
+			for (size_t i = 0; i < visibleMaterialObjects; i++)
+			{
+				const GltfDraw& draw = gltf.draws[visibleObjects[i]];
+				const GltfMaterial& material = gltf.materials[gltf.primitives[draw.primitive].material];
+				glm::mat4 placed = model * modelFit * draw.transform;
+				setUniform(materialModelUniform, placed);
+				setUniform(materialNormalMatrixUniform, normalMatrixOf(placed));
+				setUniform(materialAmbientUniform, material.ambient);
+				setUniform(materialDiffuseUniform, material.diffuse);
+				setUniform(materialSpecularUniform, material.specular);
+				setUniform(materialShininessUniform, material.shininess);
+				stateBindTexture(GL_TEXTURE_2D, material.diffuseMap ? material.diffuseMap : whiteTexture);
+				drawGltfPrimitive(gltf, draw.primitive);
+			}
+		}
+		else if (visibleMaterialObjects)
+		{
+			stateBindTexture(GL_TEXTURE_2D, whiteTexture);
+			stateBindVertexArray(VAO);
+			glDrawElements(GL_TRIANGLES, (GLsizei)cube.indexCount, cubeIndexType, 0);
+		}
+		endGpuScope(materialCubeScope);
 
 		// also draw the lamp object
-		glUseProgram(lightCubeShaderProgram);
-		projectionMatrixLocation = glGetUniformLocation(lightCubeShaderProgram, "projection");
-		viewMatrixLocation = glGetUniformLocation(lightCubeShaderProgram,"view");
-		modelMatrixLocation = glGetUniformLocation(lightCubeShaderProgram, "model");
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, lightPos);
-		model = glm::scale(model, glm::vec3(0.2f)); // a smaller cube
-		
-		glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
-		glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
-		glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(model));
-
-		glBindVertexArray(lightVAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-
+		beginGpuScope(lampScope);
+		if (lampVisible)
+		{
+			stateUseProgram(lightCubeShaderProgram);
+			setUniform(lightCubeModelUniform, lampModel);
+			stateBindVertexArray(lightVAO);
+			glDrawElements(GL_TRIANGLES, (GLsizei)cube.indexCount, cubeIndexType, 0);
+		}
+		endGpuScope(lampScope);
+		endCpuZone();
+
+		endGpuFrame();
+		endStateFrame();
+		beginCpuZone("glfwSwapBuffers");
 		glfwSwapBuffers(window);
+		endCpuZone();
+		endBenchmarkFrame(window);
+		beginCpuZone("glfwPollEvents");
 		glfwPollEvents();
+		endCpuZone();
+		endCpuZone();
 	}
 
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	glDeleteBuffers(1, &cameraBuffer);
+	glDeleteTextures(1, &whiteTexture);
+	printCullStats("scene", cullPool);
+	destroyCullPool(cullPool);
+	if (modelPath)
+	{
+		destroyGltfModel(gltf);
+		finishTextureLoader();
+	}
 
+	printStateStats();
+	finishGpuTimer();
+	finishCpuProfiler();
+	finishBenchmark();
 	glfwTerminate();
 	return 0;
 
@@ -0,0 +1,267 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "benchmark.h"
+#include "gl_state.h"
+#include "mesh_heap.h"
+#include "program_cache.h"
+#include "vertex_layout.h"
+
+//Draws MESH_COUNT small tori (default 10000, 32 to 290 vertices each, spread over a field) three ways:
+//	separate  a VAO, VBO and EBO per mesh, bound before each glDrawElements
+//	heap      every mesh in one MeshHeap, one glDrawElementsBaseVertex per mesh
+//	merged    the same heap, one glMultiDrawElementsBaseVertex for all of them
+//Prints the CPU time to submit a frame and the time until glFinish returns over MESH_FRAMES frames (default 20)
+//with rasterization disabled, and checks that a rendered frame is the same all three ways. Then removes and
+//adds back a random half of the meshes MESH_CHURN times (default 10), printing the heap's fragmentation
+//before and after defragmentMeshHeap() and that the frame survived the move.
+
+struct MeshVertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+};
+
+constexpr auto meshVertexLayout = makeVertexLayout<MeshVertex>(
+	VERTEX_ATTRIBUTE(MeshVertex, position, 0),
+	VERTEX_ATTRIBUTE(MeshVertex, normal, 1));
+
+const char* vertexShaderSource =
+"#version 330 core\n"
+"layout(location = 0) in vec3 aPos;\n"
+"layout(location = 1) in vec3 aNormal;\n"
+"out vec3 Normal;\n"
+"uniform mat4 viewProj;\n"
+"void main()\n"
+"{\n"
+"	Normal = aNormal;\n"
+"	gl_Position = viewProj * vec4(aPos, 1.0);\n"
+"}\n";
+
+const char* fragmentShaderSource =
+"#version 330 core\n"
+"out vec4 FragColor;\n"
+"in vec3 Normal;\n"
+"void main()\n"
+"{\n"
+"	FragColor = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);\n"
+"}\n";
+
+struct SourceMesh
+{
+	std::vector<MeshVertex> vertices;
+	std::vector<unsigned short> indices;
+};
+
+//Torus of size x size quads around center, vertices shared along the grid but not across the seam.
+SourceMesh makeTorus(unsigned int size, glm::vec3 center, float radius)
+{
+	SourceMesh mesh;
+	const float pi = 3.14159265f;
+	for (unsigned int j = 0; j <= size; j++)
+		for (unsigned int i = 0; i <= size; i++)
+		{
+			float theta = 2.0f * pi * i / size, phi = 2.0f * pi * j / size;
+			glm::vec3 normal(cosf(theta) * cosf(phi), sinf(phi), sinf(theta) * cosf(phi));
+			MeshVertex vertex = { center + radius * (glm::vec3(cosf(theta), 0.0f, sinf(theta)) + 0.3f * normal), normal };
+			mesh.vertices.push_back(vertex);
+		}
+	for (unsigned int j = 0; j < size; j++)
+		for (unsigned int i = 0; i < size; i++)
+		{
+			unsigned short corner = (unsigned short)(j * (size + 1) + i);
+			unsigned short quad[6] = { corner, (unsigned short)(corner + size + 2), (unsigned short)(corner + 1), (unsigned short)(corner + size + 2),
+				corner, (unsigned short)(corner + size + 1) };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	return mesh;
+}
+
+SourceMesh randomMesh(std::mt19937& random, unsigned int slot, unsigned int side)
+{
+	float spacing = 1.0f;
+	glm::vec3 center((slot % side - side * 0.5f) * spacing, 0.0f, (slot / side - side * 0.5f) * spacing);
+	return makeTorus(3 + random() % 14, center, 0.3f);
+}
+
+//Frame time with rasterization disabled: CPU submission and until the GPU is done, in ms.
+template <typename Draw>
+void timeFrames(const char* name, unsigned int frames, Draw draw)
+{
+	glEnable(GL_RASTERIZER_DISCARD);
+	draw();
+	glFinish();
+	double submit = 0.0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < frames; i++)
+	{
+		std::chrono::steady_clock::time_point frame = std::chrono::steady_clock::now();
+		draw();
+		submit += millisecondsSince(frame);
+	}
+	glFinish();
+	double total = millisecondsSince(start);
+	glDisable(GL_RASTERIZER_DISCARD);
+	std::cout << "  " << name << ": submit " << submit / frames << " ms, frame " << total / frames << " ms" << std::endl;
+}
+
+template <typename Draw>
+std::vector<unsigned char> renderFrame(Draw draw)
+{
+	std::vector<unsigned char> pixels(800 * 600 * 4);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	draw();
+	glReadPixels(0, 0, 800, 600, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	return pixels;
+}
+
+int main()
+{
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGL", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	unsigned int program = 0;
+	createCachedShaderProgram(vertexShaderSource, fragmentShaderSource, program);
+	unsigned int meshCount = readCount("MESH_COUNT", 10000);
+	unsigned int frames = readCount("MESH_FRAMES", 20);
+	unsigned int churn = readCount("MESH_CHURN", 10);
+	unsigned int side = (unsigned int)ceil(sqrt((double)meshCount));
+
+	std::mt19937 random(3);
+	std::vector<SourceMesh> sources;
+	size_t vertexCount = 0, indexCount = 0;
+	for (unsigned int i = 0; i < meshCount; i++)
+	{
+		sources.push_back(randomMesh(random, i, side));
+		vertexCount += sources.back().vertices.size();
+		indexCount += sources.back().indices.size();
+	}
+	std::cout << meshCount << " meshes, " << vertexCount << " vertices, " << indexCount / 3 << " triangles" << std::endl;
+
+	resetStateCache();
+	stateUseProgram(program);
+	glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f) *
+		glm::lookAt(glm::vec3(0.0f, side * 0.6f, side * 0.7f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glUniformMatrix4fv(glGetUniformLocation(program, "viewProj"), 1, GL_FALSE, glm::value_ptr(viewProj));
+	glEnable(GL_DEPTH_TEST);
+
+	// a VAO, VBO and EBO per mesh
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<unsigned int> vertexArrays(meshCount), buffers(meshCount * 2);
+	glGenVertexArrays(meshCount, vertexArrays.data());
+	glGenBuffers(meshCount * 2, buffers.data());
+	for (unsigned int i = 0; i < meshCount; i++)
+	{
+		stateBindVertexArray(vertexArrays[i]);
+		stateBindBuffer(GL_ARRAY_BUFFER, buffers[i * 2]);
+		uploadVertices(meshVertexLayout, sources[i].vertices.data(), sources[i].vertices.size() * sizeof(MeshVertex),
+			VERTEX_INTERLEAVED, GL_STATIC_DRAW);
+		stateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[i * 2 + 1]);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sources[i].indices.size() * sizeof(unsigned short), sources[i].indices.data(),
+			GL_STATIC_DRAW);
+	}
+	glFinish();
+	double separateUpload = millisecondsSince(start);
+
+	// one heap, starting small so it has to grow
+	start = std::chrono::steady_clock::now();
+	MeshHeap heap;
+	createMeshHeap(heap, meshVertexLayout, GL_UNSIGNED_SHORT, 65536, 65536 * 3);
+	std::vector<HeapMesh> meshes(meshCount);
+	for (unsigned int i = 0; i < meshCount; i++)
+		addHeapMesh(heap, sources[i].vertices.data(), (unsigned int)sources[i].vertices.size(), sources[i].indices.data(),
+			(unsigned int)sources[i].indices.size(), meshes[i]);
+	glFinish();
+	double heapUpload = millisecondsSince(start);
+	std::cout << "Upload: separate " << separateUpload << " ms, heap " << heapUpload << " ms" << std::endl;
+	printMeshHeapStats("after upload", heap);
+
+	auto drawSeparate = [&]()
+	{
+		for (unsigned int i = 0; i < meshCount; i++)
+		{
+			stateBindVertexArray(vertexArrays[i]);
+			glDrawElements(GL_TRIANGLES, (GLsizei)sources[i].indices.size(), GL_UNSIGNED_SHORT, 0);
+		}
+	};
+	auto drawHeap = [&]()
+	{
+		bindMeshHeap(heap);
+		for (unsigned int i = 0; i < meshCount; i++)
+			drawHeapMesh(heap, meshes[i]);
+	};
+	auto drawMerged = [&]()
+	{
+		bindMeshHeap(heap);
+		drawHeapMeshes(heap, meshes.data(), meshes.size());
+	};
+
+	std::cout << "Draws:" << std::endl;
+	timeFrames("separate", frames, drawSeparate);
+	timeFrames("heap", frames, drawHeap);
+	timeFrames("merged", frames, drawMerged);
+	std::vector<unsigned char> separateFrame = renderFrame(drawSeparate);
+	bool heapSame = renderFrame(drawHeap) == separateFrame, mergedSame = renderFrame(drawMerged) == separateFrame;
+	std::cout << "  heap frame " << (heapSame ? "identical" : "DIFFERS") << ", merged frame "
+		<< (mergedSame ? "identical" : "DIFFERS") << " to separate" << std::endl;
+
+	// replace a random half of the meshes with new ones of other sizes
+	for (unsigned int round = 0; round < churn; round++)
+	{
+		std::vector<unsigned int> replaced;
+		for (unsigned int i = 0; i < meshCount; i++)
+			if (random() % 2)
+			{
+				removeHeapMesh(heap, meshes[i]);
+				replaced.push_back(i);
+			}
+		for (unsigned int i : replaced)
+		{
+			sources[i] = randomMesh(random, i, side);
+			addHeapMesh(heap, sources[i].vertices.data(), (unsigned int)sources[i].vertices.size(), sources[i].indices.data(),
+				(unsigned int)sources[i].indices.size(), meshes[i]);
+		}
+	}
+	printMeshHeapStats("after churn", heap);
+	std::vector<unsigned char> churnedFrame = renderFrame(drawMerged);
+	start = std::chrono::steady_clock::now();
+	defragmentMeshHeap(heap);
+	glFinish();
+	double defragment = millisecondsSince(start);
+	printMeshHeapStats("defragmented", heap);
+	std::cout << "Defragmentation " << defragment << " ms, frame "
+		<< (renderFrame(drawMerged) == churnedFrame ? "identical" : "DIFFERS") << std::endl;
+
+	destroyMeshHeap(heap);
+	glDeleteVertexArrays(meshCount, vertexArrays.data());
+	glDeleteBuffers(meshCount * 2, buffers.data());
+	glfwTerminate();
+	return 0;
+
+}
@@ -0,0 +1,470 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "benchmark.h"
+#include "gl_state.h"
+#include "mesh_file.h"
+#include "obj_loader.h"
+#include "program_cache.h"
+#include "torus_mesh.h"
+#include "vertex_layout.h"
+#include "vertex_quantization.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Writes a torus of MESH_LOAD_TRIANGLES triangles (default 10M, in bands of under 65536 vertices) to MESH_LOAD_DIR
+//(default the current directory) as Wavefront OBJ text and as a .mesh file, then loads it onto the GPU every way:
+//	obj              the text a line at a time, strtof/strtoul, corners welded through a hash map, float vertices
+//	obj parallel     the text through loadObjFile (Common/obj_loader.h) on all cores, float vertices
+//	mesh read        readMeshFile, the whole file read and its blobs copied out, then glBufferData
+//	mesh mmap ...    mapMeshFile, parsed in place, then uploadMeshFile straight from the mapping with glBufferData,
+//	                 a glBufferSubData per submesh or a persistently mapped buffer
+//Each runs from a cold page cache (the file's pages dropped with posix_fadvise, no privileges needed; not on
+//Windows) and then a warm one, timed from opening the file until glFinish returns after the upload. Checks that
+//the OBJ paths and the .mesh paths each render the same frame, and how much the quantized frame differs from the
+//OBJ's floats. The files are removed afterwards.
+
+struct FloatVertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 texCoord;
+};
+
+constexpr auto floatVertexLayout = makeVertexLayout<FloatVertex>(
+	VERTEX_ATTRIBUTE(FloatVertex, position, 0),
+	VERTEX_ATTRIBUTE(FloatVertex, normal, 1),
+	VERTEX_ATTRIBUTE(FloatVertex, texCoord, 2));
+
+const char* vertexShaderSource =
+"#version 330 core\n"
+VERTEX_DECODE_GLSL
+"layout(location = 0) in vec3 aPos;\n"
+"layout(location = 1) in vec4 aNormal;\n"
+"layout(location = 2) in vec2 aTexCoord;\n"
+"out vec3 Normal;\n"
+"out vec2 TexCoord;\n"
+"uniform mat4 viewProj;\n"
+"void main()\n"
+"{\n"
+"	Normal = decodeNormal(aNormal);\n"
+"	TexCoord = aTexCoord;\n"
+"	gl_Position = viewProj * vec4(decodePosition(aPos), 1.0);\n"
+"}\n";
+
+const char* fragmentShaderSource =
+"#version 330 core\n"
+"out vec4 FragColor;\n"
+"in vec3 Normal;\n"
+"in vec2 TexCoord;\n"
+"void main()\n"
+"{\n"
+"	FragColor = vec4(normalize(Normal) * 0.5 + 0.5, TexCoord.x);\n"
+"}\n";
+
+//An OBJ face corner, 1-based like the file; 0 for a missing uv or normal.
+struct Corner
+{
+	unsigned int position;
+	unsigned int uv;
+	unsigned int normal;
+	bool operator==(const Corner& other) const
+	{
+		return position == other.position && uv == other.uv && normal == other.normal;
+	}
+};
+
+struct CornerHash
+{
+	size_t operator()(const Corner& corner) const
+	{
+		return ((size_t)corner.position * 73856093u) ^ ((size_t)corner.uv * 19349663u) ^ ((size_t)corner.normal * 83492791u);
+	}
+};
+
+//Torus of size x size quads cut into bands of rows that each stay under 65536 vertices, the way a large model
+//arrives as many submeshes.
+std::vector<FloatSubmesh> makeTorusBands(unsigned int size)
+{
+	unsigned int rows = std::max(1u, std::min(size, 65536u / (size + 1) - 1));
+	std::vector<FloatSubmesh> bands;
+	for (unsigned int first = 0; first < size; first += rows)
+	{
+		unsigned int count = std::min(rows, size - first);
+		bands.push_back(FloatSubmesh());
+		FloatSubmesh& band = bands.back();
+		band.vertices.resize((size_t)(count + 1) * (size + 1) * 8);
+		for (unsigned int j = 0; j <= count; j++)
+			for (unsigned int i = 0; i <= size; i++)
+				torusVertex(i, first + j, size, &band.vertices[((size_t)j * (size + 1) + i) * 8]);
+		for (unsigned int j = 0; j < count; j++)
+			for (unsigned int i = 0; i < size; i++)
+			{
+				unsigned int corner = j * (size + 1) + i;
+				unsigned int quad[6] = { corner, corner + size + 2, corner + 1, corner + size + 2, corner, corner + size + 1 };
+				band.indices.insert(band.indices.end(), quad, quad + 6);
+			}
+	}
+	return bands;
+}
+
+bool writeObj(const char* path, const std::vector<FloatSubmesh>& submeshes)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+	size_t base = 1;
+	for (size_t s = 0; s < submeshes.size(); s++)
+	{
+		const std::vector<float>& vertices = submeshes[s].vertices;
+		fprintf(file, "o band%u\n", (unsigned int)s);
+		for (size_t i = 0; i < vertices.size(); i += 8)
+			fprintf(file, "v %.6g %.6g %.6g\n", vertices[i], vertices[i + 1], vertices[i + 2]);
+		for (size_t i = 0; i < vertices.size(); i += 8)
+			fprintf(file, "vt %.6g %.6g\n", vertices[i + 6], vertices[i + 7]);
+		for (size_t i = 0; i < vertices.size(); i += 8)
+			fprintf(file, "vn %.6g %.6g %.6g\n", vertices[i + 3], vertices[i + 4], vertices[i + 5]);
+		const std::vector<unsigned int>& indices = submeshes[s].indices;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			size_t a = base + indices[i], b = base + indices[i + 1], c = base + indices[i + 2];
+			fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, b, b, b, c, c, c);
+		}
+		base += vertices.size() / 8;
+	}
+	return fclose(file) == 0;
+}
+
+//Wavefront OBJ the straightforward way: a line at a time with fgets, numbers with strtof/strtoul, every distinct
+//position/uv/normal corner becoming a vertex through a hash map; polygons are fanned into triangles.
+bool loadObj(const char* path, std::vector<float>& vertices, std::vector<unsigned int>& indices)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return false;
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> uvs;
+	std::unordered_map<Corner, unsigned int, CornerHash> corners;
+	std::vector<unsigned int> face;
+	char line[512];
+	bool valid = true;
+	while (valid && fgets(line, sizeof(line), file))
+	{
+		char* cursor = line + 2;
+		if (line[0] == 'v' && line[1] == ' ')
+		{
+			glm::vec3 position;
+			for (int i = 0; i < 3; i++)
+				position[i] = strtof(cursor, &cursor);
+			positions.push_back(position);
+		}
+		else if (line[0] == 'v' && line[1] == 'n')
+		{
+			cursor++;
+			glm::vec3 normal;
+			for (int i = 0; i < 3; i++)
+				normal[i] = strtof(cursor, &cursor);
+			normals.push_back(normal);
+		}
+		else if (line[0] == 'v' && line[1] == 't')
+		{
+			cursor++;
+			glm::vec2 uv;
+			for (int i = 0; i < 2; i++)
+				uv[i] = strtof(cursor, &cursor);
+			uvs.push_back(uv);
+		}
+		else if (line[0] == 'f' && line[1] == ' ')
+		{
+			face.clear();
+			for (;;)
+			{
+				char* end;
+				Corner corner = { (unsigned int)strtoul(cursor, &end, 10), 0, 0 };
+				if (end == cursor)
+					break;
+				cursor = end;
+				if (*cursor == '/')
+				{
+					corner.uv = (unsigned int)strtoul(cursor + 1, &cursor, 10);
+					if (*cursor == '/')
+						corner.normal = (unsigned int)strtoul(cursor + 1, &cursor, 10);
+				}
+				if (corner.position == 0 || corner.position > positions.size() || corner.uv > uvs.size() ||
+					corner.normal > normals.size())
+				{
+					valid = false;
+					break;
+				}
+				std::pair<std::unordered_map<Corner, unsigned int, CornerHash>::iterator, bool> inserted =
+					corners.insert(std::make_pair(corner, (unsigned int)corners.size()));
+				if (inserted.second)
+				{
+					glm::vec3 normal = corner.normal ? normals[corner.normal - 1] : glm::vec3(0.0f, 1.0f, 0.0f);
+					glm::vec2 uv = corner.uv ? uvs[corner.uv - 1] : glm::vec2(0.0f);
+					FloatVertex vertex = { positions[corner.position - 1], normal, uv };
+					const float* floats = glm::value_ptr(vertex.position);
+					vertices.insert(vertices.end(), floats, floats + 8);
+				}
+				face.push_back(inserted.first->second);
+			}
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				indices.push_back(face[0]);
+				indices.push_back(face[i - 1]);
+				indices.push_back(face[i]);
+			}
+		}
+	}
+	fclose(file);
+	if (!valid)
+		std::cout << "ERROR::OBJ::BAD_INDEX " << path << std::endl;
+	return valid;
+}
+
+//Writes back anything dirty and drops the file from the page cache, so the next read comes from the disk.
+bool dropFromPageCache(const char* path)
+{
+#ifdef _WIN32
+	(void)path;
+	return false;
+#else
+	int descriptor = open(path, O_RDONLY);
+	if (descriptor < 0)
+		return false;
+	bool dropped = fdatasync(descriptor) == 0 && posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(descriptor);
+	return dropped;
+#endif
+}
+
+size_t fileSize(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return 0;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fclose(file);
+	return size > 0 ? (size_t)size : 0;
+}
+
+//Float vertices as a one submesh view, uploaded with glBufferData.
+bool uploadFloats(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, MeshFileView& view,
+	MeshBuffers& buffers)
+{
+	Submesh whole = { 0, (unsigned int)indices.size(), 0, (unsigned int)(vertices.size() / 8), glm::vec3(0.0f), glm::vec3(0.0f) };
+	view.flags = 0;
+	view.vertexSize = sizeof(FloatVertex);
+	view.indexSize = 4;
+	view.attributes.assign(floatVertexLayout.attributes, floatVertexLayout.attributes + floatVertexLayout.count);
+	view.submeshes.assign(1, whole);
+	view.positionOffset = glm::vec3(0.0f);
+	view.positionScale = glm::vec3(1.0f);
+	view.vertexCount = vertices.size() / 8;
+	view.indexCount = indices.size();
+	view.vertices = (const unsigned char*)vertices.data();
+	view.indices = (const unsigned char*)indices.data();
+	return uploadMeshFile(view, MESH_UPLOAD_DATA, buffers);
+}
+
+std::vector<unsigned char> renderFrame(unsigned int program, const MeshFileView& view, const MeshBuffers& buffers)
+{
+	std::vector<unsigned char> pixels(800 * 600 * 4);
+	setVertexDecodeUniforms(program, view.positionOffset, view.positionScale, (view.flags & MESH_OCTAHEDRAL_NORMALS) != 0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	for (size_t i = 0; i < view.submeshes.size(); i++)
+		drawMeshSubmesh(view, buffers, i);
+	glReadPixels(0, 0, 800, 600, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	return pixels;
+}
+
+double differingPercent(const std::vector<unsigned char>& frame, const std::vector<unsigned char>& reference)
+{
+	size_t differing = 0;
+	for (size_t pixel = 0; pixel < 800 * 600; pixel++)
+		for (int channel = 0; channel < 3; channel++)
+			if (abs((int)frame[pixel * 4 + channel] - (int)reference[pixel * 4 + channel]) > 2)
+			{
+				differing++;
+				break;
+			}
+	return 100.0 * differing / (800 * 600);
+}
+
+int main()
+{
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGL", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	unsigned int program = 0;
+	createCachedShaderProgram(vertexShaderSource, fragmentShaderSource, program);
+	unsigned int triangles = readCount("MESH_LOAD_TRIANGLES", 10000000);
+	const char* directory = getenv("MESH_LOAD_DIR");
+	std::string objPath = std::string(directory ? directory : ".") + "/mesh_load.obj";
+	std::string meshPath = std::string(directory ? directory : ".") + "/mesh_load.mesh";
+
+	// the model, optimized and quantized as ModelImporter would
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<FloatSubmesh> bands = makeTorusBands((unsigned int)ceil(sqrt(triangles / 2.0)));
+	MeshFile mesh;
+	buildMeshFile(bands, defaultVertexTolerance, std::max(std::thread::hardware_concurrency(), 1u), mesh);
+	if (!writeMeshFile(meshPath.c_str(), mesh) || !writeObj(objPath.c_str(), bands))
+	{
+		std::cout << "ERROR::MESH_LOAD::WRITE_FAILED " << objPath << std::endl;
+		remove(objPath.c_str());
+		remove(meshPath.c_str());
+		glfwTerminate();
+		return -1;
+	}
+	printMeshFileStats(meshPath.c_str(), mesh);
+	std::cout << "Written in " << millisecondsSince(start) << " ms: OBJ " << fileSize(objPath.c_str()) / (1024 * 1024)
+		<< " MiB, mesh " << fileSize(meshPath.c_str()) / (1024 * 1024) << " MiB" << std::endl;
+	mesh = MeshFile();
+	bands.clear();
+
+	resetStateCache();
+	stateUseProgram(program);
+	glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f) *
+		glm::lookAt(glm::vec3(0.0f, 2.0f, 2.5f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glUniformMatrix4fv(glGetUniformLocation(program, "viewProj"), 1, GL_FALSE, glm::value_ptr(viewProj));
+	glEnable(GL_DEPTH_TEST);
+
+	// every loader leaves the model in buffers and the tables in view; its own memory is gone by then
+	typedef std::function<bool(MeshFileView&, MeshBuffers&)> Loader;
+	Loader loadText = [&](MeshFileView& view, MeshBuffers& buffers)
+	{
+		std::vector<float> vertices;
+		std::vector<unsigned int> indices;
+		return loadObj(objPath.c_str(), vertices, indices) && uploadFloats(vertices, indices, view, buffers);
+	};
+	Loader loadTextParallel = [&](MeshFileView& view, MeshBuffers& buffers)
+	{
+		ObjMesh obj;
+		ObjLoadStats stats;
+		return loadObjFile(objPath.c_str(), std::max(std::thread::hardware_concurrency(), 1u), obj, stats) &&
+			obj.vertexSize == 8 && uploadFloats(obj.vertices, obj.indices, view, buffers);
+	};
+	Loader loadRead = [&](MeshFileView& view, MeshBuffers& buffers)
+	{
+		MeshFile file;
+		if (!readMeshFile(meshPath.c_str(), file))
+			return false;
+		view = viewMeshFile(file);
+		return uploadMeshFile(view, MESH_UPLOAD_DATA, buffers);
+	};
+	auto loadMapped = [&](MeshUploadMode mode)
+	{
+		return [&, mode](MeshFileView& view, MeshBuffers& buffers)
+		{
+			MappedFile file;
+			if (!mapMeshFile(meshPath.c_str(), file, view))
+				return false;
+			bool uploaded = uploadMeshFile(view, mode, buffers);
+			unmapFile(file);
+			return uploaded;
+		};
+	};
+	const char* names[6] = { "obj", "obj parallel", "mesh read", "mesh mmap glBufferData", "mesh mmap glBufferSubData",
+		"mesh mmap persistent" };
+	Loader loaders[6] = { loadText, loadTextParallel, loadRead, loadMapped(MESH_UPLOAD_DATA),
+		loadMapped(MESH_UPLOAD_SUB_DATA), loadMapped(MESH_UPLOAD_PERSISTENT) };
+
+	std::cout << "Loads (cold / warm page cache):" << std::endl;
+	std::vector<unsigned char> objFrame, meshFrame;
+	bool objFramesSame = true, meshFramesSame = true;
+	// a failed load still goes on to the cleanup below, the files are hundreds of MiB at the default size
+	bool loaded = true;
+	for (int i = 0; i < 6 && loaded; i++)
+	{
+		std::string path = i < 2 ? objPath : meshPath;
+		double milliseconds[2] = { -1.0, -1.0 };
+		for (int warm = 0; warm < 2 && loaded; warm++)
+		{
+			if (!warm && !dropFromPageCache(path.c_str()))
+				continue;
+			MeshFileView view;
+			MeshBuffers buffers;
+			start = std::chrono::steady_clock::now();
+			loaded = loaders[i](view, buffers);
+			if (!loaded)
+				break;
+			glFinish();
+			milliseconds[warm] = millisecondsSince(start);
+
+			std::vector<unsigned char> frame = renderFrame(program, view, buffers);
+			std::vector<unsigned char>& reference = i < 2 ? objFrame : meshFrame;
+			bool& same = i < 2 ? objFramesSame : meshFramesSame;
+			if (reference.empty())
+				reference = frame;
+			else
+				same = same && frame == reference;
+			destroyMeshBuffers(buffers);
+		}
+		if (!loaded)
+			break;
+		double megabytes = fileSize(path.c_str()) / (1024.0 * 1024.0);
+		std::cout << "  " << names[i] << ": ";
+		if (milliseconds[0] >= 0.0)
+			std::cout << milliseconds[0] << " ms (" << megabytes * 1000.0 / milliseconds[0] << " MiB/s) / ";
+		else
+			std::cout << "no cold run / ";
+		std::cout << milliseconds[1] << " ms (" << megabytes * 1000.0 / milliseconds[1] << " MiB/s)" << std::endl;
+	}
+
+	if (loaded)
+	{
+		// parsing alone, with the pages already cached
+		MappedFile file;
+		MeshFileView view;
+		start = std::chrono::steady_clock::now();
+		bool mapped = mapMeshFile(meshPath.c_str(), file, view);
+		double mapMilliseconds = millisecondsSince(start);
+		if (mapped)
+			unmapFile(file);
+		std::cout << "mapMeshFile alone: " << mapMilliseconds * 1000.0 << " us for " << view.submeshes.size() << " submeshes"
+			<< std::endl;
+		std::cout << "Frames: OBJ paths " << (objFramesSame ? "identical" : "DIFFER") << ", .mesh paths "
+			<< (meshFramesSame ? "identical" : "DIFFER") << ", "
+			<< differingPercent(meshFrame, objFrame) << "% of the pixels differ from the OBJ's float vertices" << std::endl;
+	}
+
+	remove(objPath.c_str());
+	remove(meshPath.c_str());
+	glfwTerminate();
+	return loaded ? 0 : -1;
+
+}
@@ -0,0 +1,205 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "benchmark.h"
+#include "mesh_optimizer.h"
+#include "program_cache.h"
+#include "torus_mesh.h"
+#include "vertex_layout.h"
+
+//Runs the mesh optimizer on a procedural torus of MESH_GRID_SIZE x MESH_GRID_SIZE quads (default 1000, two
+//million triangles) given as a non-indexed triangle list with position, normal and uv. The triangles come
+//once in grid order and once shuffled, like meshes from tools that don't care about order. Prints the time
+//of every step, ACMR/ATVR before and after, and the overdraw of every order: fragments that pass the depth
+//test per visible pixel (GL_SAMPLES_PASSED) with back faces culled, averaged over eight views around the torus.
+
+struct TorusVertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 texCoord;
+};
+
+//Overdraw only needs the positions.
+constexpr auto torusPositionLayout = makeVertexLayout<TorusVertex>(
+	VERTEX_ATTRIBUTE(TorusVertex, position, 0));
+
+const char* vertexShaderSource =
+"#version 330 core\n"
+"layout(location = 0) in vec3 aPos;\n"
+"uniform mat4 viewProj;\n"
+"void main()\n"
+"{\n"
+"	gl_Position = viewProj * vec4(aPos, 1.0);\n"
+"}\n";
+
+const char* fragmentShaderSource =
+"#version 330 core\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"	FragColor = vec4(1.0);\n"
+"}\n";
+
+unsigned int program = 0;
+
+std::vector<float> shuffleTriangles(const std::vector<float>& vertices)
+{
+	size_t triangleSize = 3 * 8;
+	size_t triangleCount = vertices.size() / triangleSize;
+	std::vector<size_t> order(triangleCount);
+	for (size_t i = 0; i < triangleCount; i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), std::mt19937(1));
+	std::vector<float> shuffled(vertices.size());
+	for (size_t i = 0; i < triangleCount; i++)
+		std::copy(vertices.begin() + order[i] * triangleSize, vertices.begin() + (order[i] + 1) * triangleSize,
+			shuffled.begin() + i * triangleSize);
+	return shuffled;
+}
+
+unsigned int countSamples(unsigned int count)
+{
+	unsigned int query, samples = 0;
+	glGenQueries(1, &query);
+	glBeginQuery(GL_SAMPLES_PASSED, query);
+	glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0);
+	glEndQuery(GL_SAMPLES_PASSED);
+	glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samples);
+	glDeleteQueries(1, &query);
+	return samples;
+}
+
+//Uploads the order and draws it from eight directions, counting every fragment that passes GL_LESS
+//against the pixels left visible, which a second pass with GL_EQUAL counts.
+float measureOverdraw(unsigned int VAO, const std::vector<unsigned int>& indices)
+{
+	unsigned int EBO;
+	glGenBuffers(1, &EBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	glUseProgram(program);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+	unsigned long long shaded = 0, visible = 0;
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+	for (int view = 0; view < 8; view++)
+	{
+		float angle = view * 0.785398f;
+		glm::vec3 eye(3.0f * cosf(angle), 0.4f * (view % 2 ? 1.0f : -1.0f), 3.0f * sinf(angle));
+		glm::mat4 viewProj = projection * glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glUniformMatrix4fv(glGetUniformLocation(program, "viewProj"), 1, GL_FALSE, glm::value_ptr(viewProj));
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glDepthFunc(GL_LESS);
+		shaded += countSamples((unsigned int)indices.size());
+		glDepthFunc(GL_EQUAL);
+		visible += countSamples((unsigned int)indices.size());
+	}
+
+	glDepthFunc(GL_LESS);
+	glDisable(GL_CULL_FACE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glBindVertexArray(0);
+	glDeleteBuffers(1, &EBO);
+	return visible ? (float)shaded / visible : 0.0f;
+}
+
+void run(const char* name, const std::vector<float>& vertices)
+{
+	size_t vertexCount = vertices.size() / 8;
+	std::vector<float> unique;
+	std::vector<unsigned int> indices;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t uniqueCount = weldVertices(&vertices[0], vertexCount, 8, unique, indices);
+	double weldMs = millisecondsSince(start);
+	VertexCacheStats welded = analyzeVertexCache(&indices[0], indices.size(), uniqueCount, MESH_CACHE_SIZE);
+	std::vector<unsigned int> weldedOrder = indices;
+
+	start = std::chrono::steady_clock::now();
+	optimizeVertexCache(&indices[0], indices.size(), uniqueCount);
+	double cacheMs = millisecondsSince(start);
+	VertexCacheStats cached = analyzeVertexCache(&indices[0], indices.size(), uniqueCount, MESH_CACHE_SIZE);
+	std::vector<unsigned int> cacheOrder = indices;
+
+	start = std::chrono::steady_clock::now();
+	optimizeOverdraw(&indices[0], indices.size(), &unique[0], uniqueCount, 8, 1.05f);
+	double overdrawMs = millisecondsSince(start);
+	VertexCacheStats sorted = analyzeVertexCache(&indices[0], indices.size(), uniqueCount, MESH_CACHE_SIZE);
+
+	// before the vertex fetch pass renumbers the vertices
+	unsigned int VBO, VAO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	uploadVertices(torusPositionLayout, unique.data(), unique.size() * sizeof(float), VERTEX_INTERLEAVED, GL_STATIC_DRAW);
+	float weldedOverdraw = measureOverdraw(VAO, weldedOrder);
+	float cacheOverdraw = measureOverdraw(VAO, cacheOrder);
+	float sortedOverdraw = measureOverdraw(VAO, indices);
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+
+	start = std::chrono::steady_clock::now();
+	optimizeVertexFetch(unique, 8, &indices[0], indices.size());
+	double fetchMs = millisecondsSince(start);
+
+	double totalMs = weldMs + cacheMs + overdrawMs + fetchMs;
+	std::cout << name << ": " << vertexCount << " vertices welded to " << uniqueCount << ", "
+		<< indices.size() / 3 << " triangles, " << indexSizeFor(uniqueCount) * 8 << " bit indices" << std::endl;
+	std::cout << "  weld " << weldMs << " ms, vertex cache " << cacheMs << " ms, overdraw " << overdrawMs
+		<< " ms, vertex fetch " << fetchMs << " ms: " << indices.size() / 3 / totalMs / 1000.0 << " Mtriangles/s" << std::endl;
+	std::cout << "  ACMR 3 -> " << welded.acmr << " welded -> " << cached.acmr << " vertex cache -> " << sorted.acmr
+		<< " overdraw" << std::endl;
+	std::cout << "  ATVR " << (float)vertexCount / uniqueCount << " -> " << welded.atvr << " welded -> " << cached.atvr
+		<< " vertex cache -> " << sorted.atvr << " overdraw" << std::endl;
+	std::cout << "  overdraw " << weldedOverdraw << " welded -> " << cacheOverdraw << " vertex cache -> "
+		<< sortedOverdraw << " overdraw" << std::endl;
+}
+
+int main()
+{
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGL", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	createCachedShaderProgram(vertexShaderSource, fragmentShaderSource, program);
+
+	unsigned int size = readCount("MESH_GRID_SIZE", 1000);
+	std::vector<float> vertices = makeTorus(size);
+	std::cout << "Torus " << size << "x" << size << ", FIFO cache of " << MESH_CACHE_SIZE << std::endl;
+	run("grid order", vertices);
+	run("shuffled", shuffleTriangles(vertices));
+
+	glfwTerminate();
+	return 0;
+
+}
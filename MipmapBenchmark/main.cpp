@@ -0,0 +1,120 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "mip_generator.h"
+
+//Times the CPU mip generator against glGenerateMipmap on a procedural RGB image: every filter on one
+//thread, then one image per thread on all of them, in megapixels of level 0 per second (per core).
+//
+//Environment:
+//	MIPMAP_SIZE        width and height of the image (default 2048)
+//	MIPMAP_ITERATIONS  chains built per measurement (default 5)
+//	MIPMAP_THREADS     threads of the parallel run (default the core count)
+
+//Gradients, rings and a checkerboard: smooth areas plus edges that show aliasing and ringing.
+std::vector<unsigned char> makeImage(int size)
+{
+	std::vector<unsigned char> pixels((size_t)size * size * 3);
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++)
+		{
+			float u = (float)x / size, v = (float)y / size;
+			float ring = 0.5f + 0.5f * sinf(((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f)) * 600.0f);
+			bool checker = ((x / 16) + (y / 16)) % 2 == 0;
+			unsigned char* texel = &pixels[((size_t)y * size + x) * 3];
+			texel[0] = (unsigned char)(u * 255.0f);
+			texel[1] = (unsigned char)(ring * 255.0f);
+			texel[2] = checker ? 230 : 20;
+		}
+	return pixels;
+}
+
+void buildChains(const std::vector<unsigned char>& image, int size, MipFilter filter, unsigned int iterations)
+{
+	std::vector<size_t> levelOffsets;
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		std::vector<unsigned char> pixels = image;
+		appendMipLevels(pixels, size, size, 3, filter, true, levelOffsets);
+	}
+}
+
+int main()
+{
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGL", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	int size = (int)readCount("MIPMAP_SIZE", 2048);
+	unsigned int iterations = readCount("MIPMAP_ITERATIONS", 5);
+	unsigned int threadCount = readCount("MIPMAP_THREADS", std::max(std::thread::hardware_concurrency(), 1u));
+	std::vector<unsigned char> image = makeImage(size);
+	double megapixels = (double)size * size / 1e6;
+
+	std::cout << size << "x" << size << " RGB8, " << mipLevelCount(size, size) << " levels, " << iterations
+		<< " chains per run:" << std::endl;
+	const char* names[] = { "box    ", "kaiser ", "lanczos" };
+	for (int filter = MIP_FILTER_BOX; filter <= MIP_FILTER_LANCZOS; filter++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		buildChains(image, size, (MipFilter)filter, iterations);
+		double singleMs = millisecondsSince(start) / iterations;
+
+		start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (unsigned int i = 0; i < threadCount; i++)
+			threads.push_back(std::thread(buildChains, std::cref(image), size, (MipFilter)filter, iterations));
+		for (unsigned int i = 0; i < threadCount; i++)
+			threads[i].join();
+		double parallelMs = millisecondsSince(start) / iterations;
+
+		std::cout << "  CPU " << names[filter] << " " << singleMs << " ms/chain, " << megapixels * 1000.0 / singleMs
+			<< " MP/s on 1 thread; " << megapixels * threadCount * 1000.0 / parallelMs << " MP/s on " << threadCount
+			<< " threads (" << megapixels * 1000.0 / parallelMs << " MP/s per core)" << std::endl;
+	}
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data());
+	// warm up, the first call may allocate the chain
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glFinish();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < iterations; i++)
+		glGenerateMipmap(GL_TEXTURE_2D);
+	glFinish();
+	double generateMs = millisecondsSince(start) / iterations;
+	std::cout << "  glGenerateMipmap " << generateMs << " ms/chain, " << megapixels * 1000.0 / generateMs << " MP/s ("
+		<< glGetString(GL_RENDERER) << ")" << std::endl;
+
+	glDeleteTextures(1, &texture);
+	glfwTerminate();
+	return 0;
+
+}
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <assimp/Importer.hpp>
+#include <assimp/config.h>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include "benchmark.h"
+#include "mesh_file.h"
+
+//Offline model converter: imports anything Assimp reads, triangulates, welds and smooths it, then reorders
+//every mesh for the vertex cache, overdraw and vertex fetch (mesh_optimizer) on all cores, quantizes the vertices
+//(vertex_quantization) and writes one runtime .mesh file (mesh_file.h). The samples load that with
+//readMeshFile and upload it as it is; only this tool links Assimp.
+//
+//Usage: ModelImporter_bin <model> [output.mesh]
+//	the output defaults to <name>.mesh
+//
+//Environment:
+//	MODEL_IMPORTER_THREADS  threads converting and optimizing meshes (default the core count)
+
+//Position, normal and first texture coordinate set, 8 floats per vertex; faces are triangles after import.
+void convertMesh(const aiMesh* mesh, FloatSubmesh& submesh)
+{
+	submesh.vertices.resize((size_t)mesh->mNumVertices * 8);
+	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+	{
+		float* vertex = &submesh.vertices[(size_t)i * 8];
+		aiVector3D normal = mesh->HasNormals() ? mesh->mNormals[i] : aiVector3D(0.0f, 1.0f, 0.0f);
+		aiVector3D uv = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0][i] : aiVector3D(0.0f);
+		float values[8] = { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z, normal.x, normal.y, normal.z,
+			uv.x, uv.y };
+		std::copy(values, values + 8, vertex);
+	}
+	submesh.indices.clear();
+	submesh.indices.reserve((size_t)mesh->mNumFaces * 3);
+	for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+		if (mesh->mFaces[i].mNumIndices == 3)
+			submesh.indices.insert(submesh.indices.end(), mesh->mFaces[i].mIndices, mesh->mFaces[i].mIndices + 3);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: " << argv[0] << " <model> [output.mesh]" << std::endl;
+		return 1;
+	}
+
+	std::string output = argc > 2 ? argv[2] : argv[1];
+	if (argc <= 2)
+		output = output.substr(0, output.find_last_of('.')) + ".mesh";
+
+	const char* threadsValue = getenv("MODEL_IMPORTER_THREADS");
+	unsigned int threads = threadsValue && atoi(threadsValue) > 0 ? (unsigned int)atoi(threadsValue) :
+		std::max(std::thread::hardware_concurrency(), 1u);
+
+	// points and lines are dropped, everything is flattened into world space meshes; Assimp's cache locality
+	// pass gives optimizeVertexCache a good order to start from
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	Assimp::Importer importer;
+	importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+	const aiScene* scene = importer.ReadFile(argv[1], aiProcess_Triangulate | aiProcess_JoinIdenticalVertices |
+		aiProcess_GenSmoothNormals | aiProcess_SortByPType | aiProcess_PreTransformVertices |
+		aiProcess_ImproveCacheLocality);
+	if (!scene || !scene->mRootNode || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE))
+	{
+		std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+		return 1;
+	}
+	double importMs = millisecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	std::vector<FloatSubmesh> submeshes(scene->mNumMeshes);
+	std::atomic<unsigned int> next(0);
+	auto convert = [&]()
+	{
+		for (unsigned int i = next++; i < scene->mNumMeshes; i = next++)
+			convertMesh(scene->mMeshes[i], submeshes[i]);
+	};
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threads && i < scene->mNumMeshes; i++)
+		workers.push_back(std::thread(convert));
+	convert();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	MeshFile mesh;
+	buildMeshFile(submeshes, defaultVertexTolerance, threads, mesh);
+	double buildMs = millisecondsSince(start);
+	if (!writeMeshFile(output.c_str(), mesh))
+		return 1;
+
+	printMeshFileStats(output.c_str(), mesh);
+	std::cout << "Imported in " << importMs << " ms, optimized and quantized in " << buildMs << " ms on " << threads
+		<< " threads" << std::endl;
+	return 0;
+}
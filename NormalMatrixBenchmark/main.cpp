@@ -0,0 +1,188 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "benchmark.h"
+#include "normal_matrix.h"
+#include "program_cache.h"
+#include "vertex_layout.h"
+
+//Compares the normal matrix computed per vertex in the shader against the one computed per object
+//on the CPU: first the CPU kernels on NORMAL_MATRIX_COUNT matrices, then the vertex stage on
+//VERTEX_COUNT points drawn with rasterization disabled so only the vertex stage is timed.
+
+struct LitVertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+};
+
+constexpr auto litVertexLayout = makeVertexLayout<LitVertex>(
+	VERTEX_ATTRIBUTE(LitVertex, position, 0),
+	VERTEX_ATTRIBUTE(LitVertex, normal, 1));
+
+const char* perVertexShaderSource =
+"#version 330 core\n"
+"layout(location = 0) in vec3 aPos;\n"
+"layout(location = 1) in vec3 aNormal;\n"
+"out vec3 Normal;\n"
+"uniform mat4 model;\n"
+"uniform mat4 viewProj;\n"
+"void main()\n"
+"{\n"
+"	Normal = mat3(transpose(inverse(model))) * aNormal;\n"
+"	gl_Position = viewProj * model * vec4(aPos, 1.0);\n"
+"}\n";
+
+const char* perObjectShaderSource =
+"#version 330 core\n"
+"layout(location = 0) in vec3 aPos;\n"
+"layout(location = 1) in vec3 aNormal;\n"
+"out vec3 Normal;\n"
+"uniform mat4 model;\n"
+"uniform mat3 normalMatrix;\n"
+"uniform mat4 viewProj;\n"
+"void main()\n"
+"{\n"
+"	Normal = normalMatrix * aNormal;\n"
+"	gl_Position = viewProj * model * vec4(aPos, 1.0);\n"
+"}\n";
+
+const char* fragmentShaderSource =
+"#version 330 core\n"
+"out vec4 FragColor;\n"
+"in vec3 Normal;\n"
+"void main()\n"
+"{\n"
+"	FragColor = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);\n"
+"}\n";
+
+void benchmarkCpu(unsigned int count)
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<glm::mat4> models(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(unit(random), unit(random), unit(random)) * 50.0f);
+		model = glm::rotate(model, unit(random) * 3.14159f, glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 2.0f)));
+		models[i] = glm::scale(model, glm::vec3(1.0f + unit(random) * 0.5f, 1.0f + unit(random) * 0.5f, 1.0f));
+	}
+
+	std::vector<glm::mat3> reference(count), single(count), batched(count);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < count; i++)
+		reference[i] = glm::mat3(glm::transpose(glm::inverse(models[i])));
+	double referenceTime = millisecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < count; i++)
+		single[i] = normalMatrixOf(models[i]);
+	double singleTime = millisecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	computeNormalMatrices(models.data(), batched.data(), count);
+	double batchedTime = millisecondsSince(start);
+
+	float maxError = 0.0f;
+	for (unsigned int i = 0; i < count; i++)
+		for (int c = 0; c < 3; c++)
+			for (int r = 0; r < 3; r++)
+				maxError = glm::max(maxError, glm::abs(batched[i][c][r] - reference[i][c][r]));
+
+	std::cout << "CPU, " << count << " matrices:" << std::endl;
+	std::cout << "  transpose(inverse(mat4)) " << referenceTime * 1e6 / count << " ns/matrix" << std::endl;
+	std::cout << "  normalMatrixOf           " << singleTime * 1e6 / count << " ns/matrix" << std::endl;
+	std::cout << "  computeNormalMatrices    " << batchedTime * 1e6 / count << " ns/matrix"
+		<< " (max error " << maxError << ")" << std::endl;
+}
+
+double timeDraws(unsigned int shaderProgram, unsigned int VAO, unsigned int vertexCount, const glm::mat4& model, int repetitions)
+{
+	glUseProgram(shaderProgram);
+	glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f) *
+		glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+	glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "viewProj"), 1, GL_FALSE, glm::value_ptr(viewProj));
+	glUniformMatrix3fv(glGetUniformLocation(shaderProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(normalMatrixOf(model)));
+	glBindVertexArray(VAO);
+
+	// warm up, the first draw may still be compiling the variant
+	glDrawArrays(GL_POINTS, 0, vertexCount);
+	glFinish();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < repetitions; i++)
+		glDrawArrays(GL_POINTS, 0, vertexCount);
+	glFinish();
+	return millisecondsSince(start) / repetitions;
+}
+
+int main()
+{
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGL", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	benchmarkCpu(readCount("NORMAL_MATRIX_COUNT", 1000000));
+
+	unsigned int perVertexProgram = 0, perObjectProgram = 0;
+	createCachedShaderProgram(perVertexShaderSource, fragmentShaderSource, perVertexProgram);
+	createCachedShaderProgram(perObjectShaderSource, fragmentShaderSource, perObjectProgram);
+
+	unsigned int vertexCount = readCount("VERTEX_COUNT", 4000000);
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<float> vertices(vertexCount * 6);
+	for (unsigned int i = 0; i < vertices.size(); i++)
+		vertices[i] = unit(random);
+
+	unsigned int VBO, VAO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	uploadVertices(litVertexLayout, vertices.data(), vertices.size() * sizeof(float), readVertexStreams(), GL_STATIC_DRAW);
+
+	// keep primitive setup and fragment work out of the measurement
+	glEnable(GL_RASTERIZER_DISCARD);
+	glm::mat4 model = glm::rotate(glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 2.0f, 0.5f)), 0.7f, glm::vec3(1.0f, 0.3f, 0.5f));
+	int repetitions = 10;
+	double perVertexTime = timeDraws(perVertexProgram, VAO, vertexCount, model, repetitions);
+	double perObjectTime = timeDraws(perObjectProgram, VAO, vertexCount, model, repetitions);
+
+	std::cout << "Vertex stage, " << vertexCount << " vertices (" << glGetString(GL_RENDERER) << "):" << std::endl;
+	std::cout << "  normal matrix per vertex " << perVertexTime << " ms/draw" << std::endl;
+	std::cout << "  normal matrix per object " << perObjectTime << " ms/draw" << std::endl;
+
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+
+	glfwTerminate();
+	return 0;
+
+}
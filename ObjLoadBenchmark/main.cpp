@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "benchmark.h"
+#include "mapped_file.h"
+#include "obj_loader.h"
+#include "torus_mesh.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Writes a torus of OBJ_LOAD_TRIANGLES triangles (default 10M) to OBJ_LOAD_DIR (default the current directory)
+//twice: with one index per corner for position, uv and normal, as most exporters write, and with uvs listed in
+//another order and normals indexed relative (negative), which takes the loader's hash path. Each file is then
+//	read     mapped and every page touched, the speed of the disk or page cache
+//	naive    parsed a line at a time with fgets, strtof and std::unordered_map on one thread
+//	threads  loadObjFile (Common/obj_loader.h) with OBJ_LOAD_THREADS threads, e.g. "1,2,4" (default powers of
+//	         two up to the core count)
+//from a cold page cache (posix_fadvise, not on Windows) and a warm one, and the corners of every triangle are
+//compared with the naive loader's. The files are removed afterwards.
+
+//An OBJ face corner, 1-based like the file; 0 for a missing uv or normal.
+struct Corner
+{
+	unsigned int position;
+	unsigned int uv;
+	unsigned int normal;
+	bool operator==(const Corner& other) const
+	{
+		return position == other.position && uv == other.uv && normal == other.normal;
+	}
+};
+
+struct CornerHash
+{
+	size_t operator()(const Corner& corner) const
+	{
+		return ((size_t)corner.position * 73856093u) ^ ((size_t)corner.uv * 19349663u) ^ ((size_t)corner.normal * 83492791u);
+	}
+};
+
+std::vector<unsigned int> readThreadCounts()
+{
+	std::vector<unsigned int> counts;
+	const char* value = getenv("OBJ_LOAD_THREADS");
+	if (value)
+	{
+		std::stringstream list(value);
+		std::string item;
+		while (std::getline(list, item, ','))
+			if (atoi(item.c_str()) > 0)
+				counts.push_back((unsigned int)atoi(item.c_str()));
+	}
+	if (!counts.empty())
+		return counts;
+
+	unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned int count = 1; count < cores; count *= 2)
+		counts.push_back(count);
+	counts.push_back(cores);
+	return counts;
+}
+
+//A torus of size x size quads in bands of rows, each an "o" group with its own vertices. With mixed indices the
+//uvs of a band are listed back to front and the normals referenced relative to the end of the list.
+bool writeTorusObj(const char* path, unsigned int size, bool mixedIndices)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+	const unsigned int rows = 64;
+	size_t base = 1;
+	std::vector<float> vertices;
+	for (unsigned int first = 0; first < size; first += rows)
+	{
+		unsigned int count = std::min(rows, size - first);
+		size_t vertexCount = (size_t)(count + 1) * (size + 1);
+		vertices.resize(vertexCount * 8);
+		for (unsigned int j = 0; j <= count; j++)
+			for (unsigned int i = 0; i <= size; i++)
+				torusVertex(i, first + j, size, &vertices[((size_t)j * (size + 1) + i) * 8]);
+
+		fprintf(file, "o band%u\n", first / rows);
+		for (size_t i = 0; i < vertexCount; i++)
+			fprintf(file, "v %.6g %.6g %.6g\n", vertices[i * 8], vertices[i * 8 + 1], vertices[i * 8 + 2]);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			size_t uv = mixedIndices ? vertexCount - 1 - i : i;
+			fprintf(file, "vt %.6g %.6g\n", vertices[uv * 8 + 6], vertices[uv * 8 + 7]);
+		}
+		for (size_t i = 0; i < vertexCount; i++)
+			fprintf(file, "vn %.6g %.6g %.6g\n", vertices[i * 8 + 3], vertices[i * 8 + 4], vertices[i * 8 + 5]);
+		for (unsigned int j = 0; j < count; j++)
+			for (unsigned int i = 0; i < size; i++)
+			{
+				size_t corner = (size_t)j * (size + 1) + i;
+				size_t quad[4] = { corner, corner + 1, corner + size + 2, corner + size + 1 };
+				fputc('f', file);
+				for (int c = 0; c < 4; c++)
+				{
+					size_t local = quad[c];
+					if (mixedIndices)
+						fprintf(file, " %zu/%zu/-%zu", base + local, base + vertexCount - 1 - local, vertexCount - local);
+					else
+						fprintf(file, " %zu/%zu/%zu", base + local, base + local, base + local);
+				}
+				fputc('\n', file);
+			}
+		base += vertexCount;
+	}
+	return fclose(file) == 0;
+}
+
+//Wavefront OBJ the straightforward way: a line at a time with fgets, numbers with strtof/strtol, every distinct
+//position/uv/normal corner becoming a vertex through a hash map; polygons are fanned into triangles.
+bool loadObjNaive(const char* path, std::vector<float>& vertices, std::vector<unsigned int>& indices)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return false;
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> uvs;
+	std::unordered_map<Corner, unsigned int, CornerHash> corners;
+	std::vector<unsigned int> face;
+	char line[512];
+	bool valid = true;
+	while (valid && fgets(line, sizeof(line), file))
+	{
+		char* cursor = line + 2;
+		if (line[0] == 'v' && line[1] == ' ')
+		{
+			glm::vec3 position;
+			for (int i = 0; i < 3; i++)
+				position[i] = strtof(cursor, &cursor);
+			positions.push_back(position);
+		}
+		else if (line[0] == 'v' && line[1] == 'n')
+		{
+			glm::vec3 normal;
+			for (int i = 0; i < 3; i++)
+				normal[i] = strtof(cursor + (i == 0), &cursor);
+			normals.push_back(normal);
+		}
+		else if (line[0] == 'v' && line[1] == 't')
+		{
+			glm::vec2 uv;
+			for (int i = 0; i < 2; i++)
+				uv[i] = strtof(cursor + (i == 0), &cursor);
+			uvs.push_back(uv);
+		}
+		else if (line[0] == 'f' && line[1] == ' ')
+		{
+			face.clear();
+			for (;;)
+			{
+				char* end;
+				long values[3] = { strtol(cursor, &end, 10), 0, 0 };
+				if (end == cursor)
+					break;
+				cursor = end;
+				for (int i = 1; i < 3 && *cursor == '/'; i++)
+					values[i] = strtol(cursor + 1, &cursor, 10);
+				const size_t counts[3] = { positions.size(), uvs.size(), normals.size() };
+				for (int i = 0; i < 3; i++)
+					if (values[i] < 0)
+						values[i] += (long)counts[i] + 1;
+				Corner corner = { (unsigned int)values[0], (unsigned int)values[1], (unsigned int)values[2] };
+				if (values[0] <= 0 || corner.position > positions.size() || corner.uv > uvs.size() ||
+					corner.normal > normals.size())
+				{
+					valid = false;
+					break;
+				}
+				std::pair<std::unordered_map<Corner, unsigned int, CornerHash>::iterator, bool> inserted =
+					corners.insert(std::make_pair(corner, (unsigned int)corners.size()));
+				if (inserted.second)
+				{
+					glm::vec3 normal = corner.normal ? normals[corner.normal - 1] : glm::vec3(0.0f, 1.0f, 0.0f);
+					glm::vec2 uv = corner.uv ? uvs[corner.uv - 1] : glm::vec2(0.0f);
+					float vertex[8] = { positions[corner.position - 1].x, positions[corner.position - 1].y,
+						positions[corner.position - 1].z, normal.x, normal.y, normal.z, uv.x, uv.y };
+					vertices.insert(vertices.end(), vertex, vertex + 8);
+				}
+				face.push_back(inserted.first->second);
+			}
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				indices.push_back(face[0]);
+				indices.push_back(face[i - 1]);
+				indices.push_back(face[i]);
+			}
+		}
+	}
+	fclose(file);
+	if (!valid)
+		std::cout << "ERROR::OBJ::BAD_INDEX " << path << std::endl;
+	return valid;
+}
+
+//Writes back anything dirty and drops the file from the page cache, so the next read comes from the disk.
+bool dropFromPageCache(const char* path)
+{
+#ifdef _WIN32
+	(void)path;
+	return false;
+#else
+	int descriptor = open(path, O_RDONLY);
+	if (descriptor < 0)
+		return false;
+	bool dropped = fdatasync(descriptor) == 0 && posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(descriptor);
+	return dropped;
+#endif
+}
+
+// keeps the page reads below from being optimized away
+volatile unsigned int touchedSum = 0;
+
+//Maps the file and reads a byte of every page.
+void touchFile(const char* path)
+{
+	MappedFile file;
+	if (!mapFile(path, file))
+		return;
+	unsigned int sum = 0;
+	for (size_t offset = 0; offset < file.size; offset += 4096)
+		sum += file.data[offset];
+	touchedSum = touchedSum + sum;
+	unmapFile(file);
+}
+
+//Triangle corners whose position, normal and uv differ between the two loads, which have to agree on the
+//triangles but may number vertices differently.
+size_t differingCorners(const ObjMesh& mesh, const std::vector<float>& vertices, const std::vector<unsigned int>& indices)
+{
+	if (mesh.indices.size() != indices.size())
+		return std::max(mesh.indices.size(), indices.size());
+	size_t differing = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+		if (memcmp(&mesh.vertices[(size_t)mesh.indices[i] * mesh.vertexSize], &vertices[(size_t)indices[i] * 8],
+			std::min(mesh.vertexSize, (size_t)8) * sizeof(float)) != 0)
+			differing++;
+	return differing;
+}
+
+void printRun(const char* name, double megabytes, double cold, double warm)
+{
+	std::cout << "  " << name << ": ";
+	if (cold >= 0.0)
+		std::cout << cold << " ms (" << megabytes * 1000.0 / cold << " MiB/s) / ";
+	else
+		std::cout << "no cold run / ";
+	std::cout << warm << " ms (" << megabytes * 1000.0 / warm << " MiB/s)" << std::endl;
+}
+
+int main()
+{
+	unsigned int triangles = readCount("OBJ_LOAD_TRIANGLES", 10000000);
+	unsigned int size = (unsigned int)ceil(sqrt(triangles / 2.0));
+	std::vector<unsigned int> threadCounts = readThreadCounts();
+	const char* directory = getenv("OBJ_LOAD_DIR");
+	const char* names[2] = { "shared indices", "mixed indices" };
+
+	for (int variant = 0; variant < 2; variant++)
+	{
+		std::string path = std::string(directory ? directory : ".") + (variant ? "/obj_load_mixed.obj" : "/obj_load.obj");
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (!writeTorusObj(path.c_str(), size, variant == 1))
+		{
+			std::cout << "ERROR::OBJ_LOAD::WRITE_FAILED " << path << std::endl;
+			return 1;
+		}
+		MappedFile file;
+		double megabytes = mapFile(path.c_str(), file) ? file.size / (1024.0 * 1024.0) : 0.0;
+		unmapFile(file);
+		std::cout << names[variant] << ": " << size * size * 2 << " triangles, " << megabytes << " MiB written in "
+			<< millisecondsSince(start) << " ms (cold / warm page cache)" << std::endl;
+
+		double cold = -1.0, warm;
+		if (dropFromPageCache(path.c_str()))
+		{
+			start = std::chrono::steady_clock::now();
+			touchFile(path.c_str());
+			cold = millisecondsSince(start);
+		}
+		start = std::chrono::steady_clock::now();
+		touchFile(path.c_str());
+		warm = millisecondsSince(start);
+		printRun("read", megabytes, cold, warm);
+
+		std::vector<float> naiveVertices;
+		std::vector<unsigned int> naiveIndices;
+		start = std::chrono::steady_clock::now();
+		if (!loadObjNaive(path.c_str(), naiveVertices, naiveIndices))
+			return 1;
+		printRun("naive", megabytes, -1.0, millisecondsSince(start));
+
+		for (size_t t = 0; t < threadCounts.size(); t++)
+		{
+			ObjMesh mesh;
+			ObjLoadStats stats;
+			cold = -1.0;
+			// the cold run only for the most threads, the rest show the scaling
+			if (t + 1 == threadCounts.size() && dropFromPageCache(path.c_str()))
+			{
+				start = std::chrono::steady_clock::now();
+				if (!loadObjFile(path.c_str(), threadCounts[t], mesh, stats))
+					return 1;
+				cold = millisecondsSince(start);
+			}
+			start = std::chrono::steady_clock::now();
+			if (!loadObjFile(path.c_str(), threadCounts[t], mesh, stats))
+				return 1;
+			warm = millisecondsSince(start);
+			std::string name = std::to_string(threadCounts[t]) + (threadCounts[t] == 1 ? " thread" : " threads");
+			printRun(name.c_str(), megabytes, cold, warm);
+			if (t + 1 == threadCounts.size())
+			{
+				printObjLoadStats(path.c_str(), mesh, stats);
+				std::cout << "  " << differingCorners(mesh, naiveVertices, naiveIndices) << " of " << naiveIndices.size()
+					<< " triangle corners differ from the naive load" << std::endl;
+			}
+		}
+		remove(path.c_str());
+	}
+	return 0;
+}
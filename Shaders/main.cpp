@@ -1,6 +1,8 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include "benchmark.h"
+#include "vertex_layout.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
@@ -13,6 +15,16 @@ void processInput(GLFWwindow* window)
 		glfwSetWindowShouldClose(window, true);
 }
 
+struct ColoredVertex
+{
+	glm::vec3 position;
+	glm::vec3 color;
+};
+
+constexpr auto coloredVertexLayout = makeVertexLayout<ColoredVertex>(
+	VERTEX_ATTRIBUTE(ColoredVertex, position, 0),
+	VERTEX_ATTRIBUTE(ColoredVertex, color, 1));
+
 const char* vertexShaderSource = 
 "#version 330 core\n"
 "layout (location = 0) in vec3 aPos;\n"
@@ -58,6 +70,8 @@ int main()
 		return -1;
 	}
 
+	initBenchmark("Shaders");
+
 	glViewport(0, 0, 800, 600);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
@@ -121,20 +135,14 @@ int main()
 	glBindVertexArray(VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-		(void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-		(void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	uploadVertices(coloredVertexLayout, vertices, sizeof(vertices), readVertexStreams(), GL_STATIC_DRAW);
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 
 	while (!glfwWindowShouldClose(window))
 	{
+		beginBenchmarkFrame();
 
 		processInput(window);
 
@@ -146,9 +154,11 @@ int main()
 		glDrawArrays(GL_TRIANGLES, 0, 3);
 
 		glfwSwapBuffers(window);
+		endBenchmarkFrame(window);
 		glfwPollEvents();
 	}
 
+	finishBenchmark();
 	glfwTerminate();
 	return 0;
 
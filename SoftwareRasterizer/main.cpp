@@ -0,0 +1,270 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "normal_matrix.h"
+#include "soft_raster.h"
+#include "texture_loader.h"
+
+//Renders the Materials and Texture scenes on the CPU with the tile-based software rasterizer and reports
+//frames per second for every thread count. Uses the same vertex arrays as those samples and the lighting
+//of materialFragmentShaderSource translated to C++. No GL context is created.
+//
+//Environment:
+//	RASTER_FRAMES   frames timed per scene and thread count (default 100)
+//	RASTER_THREADS  thread counts to run, e.g. "1,2,4" (default powers of two up to the core count)
+//	RASTER_DUMP     if set, the last frame of each scene is written to <RASTER_DUMP><scene>.ppm
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+
+// position, normal; the cube of Materials
+const float cubeVertices[] = {
+	-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+	 0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+	 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+	 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+	-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+	-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+
+	-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+	 0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+	 0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+	 0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+	-0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+	-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+
+	-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
+	-0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
+	-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
+	-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
+	-0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
+	-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
+
+	 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
+	 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
+	 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
+	 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
+	 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
+	 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
+
+	-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
+	 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
+	 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
+	 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
+	-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
+	-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
+
+	-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
+	 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
+	 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
+	 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
+	-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
+	-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
+};
+
+// position, color, texture coords; the quad of Texture
+const float quadVertices[] = {
+	0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, // top right
+	0.5f, -0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, // bottom right
+	-0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, // bottom left
+	-0.5f, 0.5f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f // top left
+};
+
+const unsigned int quadIndices[] = {
+	0, 1, 3, // first triangle
+	1, 2, 3  // second triangle
+};
+
+struct MaterialUniforms
+{
+	glm::vec3 viewPos;
+	glm::vec3 lightPosition;
+	glm::vec3 lightAmbient;
+	glm::vec3 lightDiffuse;
+	glm::vec3 lightSpecular;
+	glm::vec3 materialAmbient;
+	glm::vec3 materialDiffuse;
+	glm::vec3 materialSpecular;
+	float materialShininess;
+};
+
+// varyings: FragPos, Normal
+glm::vec4 materialFragmentShader(const float* varyings, const void* uniforms)
+{
+	const MaterialUniforms& u = *(const MaterialUniforms*)uniforms;
+	glm::vec3 fragPos(varyings[0], varyings[1], varyings[2]);
+	glm::vec3 normal(varyings[3], varyings[4], varyings[5]);
+
+	glm::vec3 ambient = u.lightAmbient * u.materialAmbient;
+	glm::vec3 norm = glm::normalize(normal);
+	glm::vec3 lightDir = glm::normalize(u.lightPosition - fragPos);
+	float diff = glm::max(glm::dot(norm, lightDir), 0.0f);
+	glm::vec3 diffuse = u.lightDiffuse * (diff * u.materialDiffuse);
+	glm::vec3 viewDir = glm::normalize(u.viewPos - fragPos);
+	glm::vec3 reflectDir = glm::reflect(-lightDir, norm);
+	float spec = glm::pow(glm::max(glm::dot(viewDir, reflectDir), 0.0f), u.materialShininess);
+	glm::vec3 specular = u.lightSpecular * (spec * u.materialSpecular);
+	glm::vec3 result = ambient + diffuse + specular;
+	return glm::vec4(result, 1.0f);
+}
+
+glm::vec4 lightCubeFragmentShader(const float*, const void*)
+{
+	return glm::vec4(1.0f);
+}
+
+// varyings: ourColor, TexCoord
+glm::vec4 textureFragmentShader(const float* varyings, const void* uniforms)
+{
+	return sampleRasterTexture(*(const RasterTexture*)uniforms, glm::vec2(varyings[3], varyings[4]));
+}
+
+struct MaterialScene
+{
+	std::vector<RasterVertex> cube;
+	std::vector<RasterVertex> lamp;
+	MaterialUniforms uniforms;
+};
+
+//Same frame as Materials at time t.
+void drawMaterialScene(RasterPool* pool, RasterTarget& target, MaterialScene& scene, float t)
+{
+	glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
+	glm::vec3 lightColor(sin(t * 2.0f), sin(t * 0.7f), sin(t * 1.3f));
+	MaterialUniforms& u = scene.uniforms;
+	u.lightDiffuse = lightColor * glm::vec3(0.5f);
+	u.lightAmbient = u.lightDiffuse * glm::vec3(0.2f);
+	u.lightSpecular = glm::vec3(1.0f);
+	u.materialAmbient = glm::vec3(1.0f, 0.5f, 0.31f);
+	u.materialDiffuse = glm::vec3(1.0f, 0.5f, 0.31f);
+	u.materialSpecular = glm::vec3(0.5f);
+	u.materialShininess = 32.0f;
+	// Materials never sets light.position, so the light sits at the origin like there
+	u.lightPosition = glm::vec3(0.0f);
+
+	float radius = 10.0f;
+	u.viewPos = glm::vec3(sin(t) * radius, 0.0f, cos(t) * radius);
+	glm::mat4 view = glm::lookAt(u.viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+	glm::mat4 viewProj = projection * view;
+
+	// vertex shaders
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::mat3 normalMatrix = normalMatrixOf(model);
+	for (unsigned int i = 0; i < 36; i++)
+	{
+		const float* vertex = &cubeVertices[i * 6];
+		glm::vec3 fragPos = glm::vec3(model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f));
+		glm::vec3 normal = normalMatrix * glm::vec3(vertex[3], vertex[4], vertex[5]);
+		RasterVertex& out = scene.cube[i];
+		out.position = viewProj * glm::vec4(fragPos, 1.0f);
+		out.varyings[0] = fragPos.x; out.varyings[1] = fragPos.y; out.varyings[2] = fragPos.z;
+		out.varyings[3] = normal.x; out.varyings[4] = normal.y; out.varyings[5] = normal.z;
+	}
+
+	model = glm::scale(glm::translate(glm::mat4(1.0f), lightPos), glm::vec3(0.2f));
+	for (unsigned int i = 0; i < 36; i++)
+	{
+		const float* vertex = &cubeVertices[i * 6];
+		scene.lamp[i].position = viewProj * model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+	}
+
+	beginRasterFrame(pool, target, glm::vec4(0.1f, 0.1f, 0.1f, 1.0f));
+	drawRasterTriangles(pool, scene.cube.data(), scene.cube.size(), 6, materialFragmentShader, &scene.uniforms);
+	drawRasterTriangles(pool, scene.lamp.data(), scene.lamp.size(), 0, lightCubeFragmentShader, NULL);
+	finishRasterFrame(pool);
+}
+
+void drawTextureScene(RasterPool* pool, RasterTarget& target, std::vector<RasterVertex>& quad, const RasterTexture& texture)
+{
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		const float* vertex = &quadVertices[quadIndices[i] * 8];
+		RasterVertex& out = quad[i];
+		out.position = glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+		for (int v = 0; v < 5; v++)
+			out.varyings[v] = vertex[3 + v];
+	}
+
+	beginRasterFrame(pool, target, glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+	drawRasterTriangles(pool, quad.data(), quad.size(), 5, textureFragmentShader, &texture);
+	finishRasterFrame(pool);
+}
+
+std::vector<unsigned int> readThreadCounts()
+{
+	std::vector<unsigned int> counts;
+	const char* value = getenv("RASTER_THREADS");
+	if (value)
+	{
+		std::stringstream list(value);
+		std::string item;
+		while (std::getline(list, item, ','))
+			if (atoi(item.c_str()) > 0)
+				counts.push_back((unsigned int)atoi(item.c_str()));
+	}
+	if (!counts.empty())
+		return counts;
+
+	unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned int count = 1; count < cores; count *= 2)
+		counts.push_back(count);
+	counts.push_back(cores);
+	return counts;
+}
+
+int main()
+{
+	const char* framesValue = getenv("RASTER_FRAMES");
+	int frames = framesValue && atoi(framesValue) > 0 ? atoi(framesValue) : 100;
+	const char* dumpPrefix = getenv("RASTER_DUMP");
+
+	Image image;
+	if (!loadImage("../Texture/container.jpg", image))
+	{
+		std::cout << "Failed to load texture" << std::endl;
+		return -1;
+	}
+	RasterTexture texture = { image.width, image.height, image.channels, image.pixels };
+
+	RasterTarget target;
+	resizeRasterTarget(target, SCR_WIDTH, SCR_HEIGHT);
+	MaterialScene materialScene;
+	materialScene.cube.resize(36);
+	materialScene.lamp.resize(36);
+	std::vector<RasterVertex> quad(6);
+
+	std::vector<unsigned int> threadCounts = readThreadCounts();
+	std::cout << "Software rasterizer, " << SCR_WIDTH << "x" << SCR_HEIGHT << ", " << rasterTileSize << "px tiles, "
+		<< frames << " frames, " << std::thread::hardware_concurrency() << " cores" << std::endl;
+	for (size_t i = 0; i < threadCounts.size(); i++)
+	{
+		RasterPool* pool = createRasterPool(threadCounts[i]);
+
+		// animated like Materials at 60 fps
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++)
+			drawMaterialScene(pool, target, materialScene, frame / 60.0f);
+		double materialSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (dumpPrefix && i + 1 == threadCounts.size())
+			writeRasterTarget(target, (std::string(dumpPrefix) + "materials.ppm").c_str());
+
+		start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++)
+			drawTextureScene(pool, target, quad, texture);
+		double textureSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (dumpPrefix && i + 1 == threadCounts.size())
+			writeRasterTarget(target, (std::string(dumpPrefix) + "texture.ppm").c_str());
+
+		std::cout << "  " << threadCounts[i] << " threads: Materials " << frames / materialSeconds << " fps, Texture "
+			<< frames / textureSeconds << " fps" << std::endl;
+		destroyRasterPool(pool);
+	}
+	return 0;
+}
@@ -1,12 +1,15 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include "benchmark.h"
+#include "gl_state.h"
+#include "texture_cache.h"
+#include "texture_loader.h"
+#include "vertex_layout.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	stateViewport(0, 0, width, height);
 }
 
 void processInput(GLFWwindow* window)
@@ -15,6 +18,18 @@ void processInput(GLFWwindow* window)
 		glfwSetWindowShouldClose(window, true);
 }
 
+struct TexturedVertex
+{
+	glm::vec3 position;
+	glm::vec3 color;
+	glm::vec2 texCoord;
+};
+
+constexpr auto texturedVertexLayout = makeVertexLayout<TexturedVertex>(
+	VERTEX_ATTRIBUTE(TexturedVertex, position, 0),
+	VERTEX_ATTRIBUTE(TexturedVertex, color, 1),
+	VERTEX_ATTRIBUTE(TexturedVertex, texCoord, 2));
+
 const char* vertexShaderSource =
 "#version 330 core\n"
 "layout(location = 0) in vec3 aPos;\n"
@@ -62,39 +77,14 @@ int main()
 		return -1;
 	}
 
+	initBenchmark("Texture");
+	initTextureLoader();
+
 	glViewport(0, 0, 800, 600);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-	//Begin texture
-	unsigned int texture;
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	// set the texture wrapping/filtering options (on currently bound texture)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load and generate the texture
-	int width, height, nrChannels;
-	unsigned char* data = stbi_load("./container.jpg", &width, &height,
-		&nrChannels, 0);
-
-	std::cout << "Width, height " << width << ", " << height << std::endl;
-
-	if (data)
-	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-			GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
-	{
-		std::cout << "Failed to load texture" << std::endl;
-	}
-
-	stbi_image_free(data);
-
-	//end texture
+	// shared with anything else using the same image, decoded on a worker thread
+	unsigned int texture = acquireTexture("./container.jpg");
 
 	//Shader section
 
@@ -162,28 +152,23 @@ int main()
 	glBindVertexArray(VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	uploadVertices(texturedVertexLayout, vertices, sizeof(vertices), readVertexStreams(), GL_STATIC_DRAW);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-		(void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-		(void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-		(void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 
 	system("pwd");
 
+	// setup above talked to GL directly, start the state cache from scratch
+	resetStateCache();
+
 	while (!glfwWindowShouldClose(window))
 	{
+		beginBenchmarkFrame();
+		pumpTextureUploads();
 
 		processInput(window);
 
@@ -191,13 +176,16 @@ int main()
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		// bind Texture
-		glBindTexture(GL_TEXTURE_2D, texture);
+		stateActiveTexture(GL_TEXTURE0);
+		stateBindTexture(GL_TEXTURE_2D, texture);
 
-		glUseProgram(shaderProgram);
-		glBindVertexArray(VAO); //This isn't necessary
+		stateUseProgram(shaderProgram);
+		stateBindVertexArray(VAO); // already bound, the state cache skips it
 		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
+		endStateFrame();
 		glfwSwapBuffers(window);
+		endBenchmarkFrame(window);
 		glfwPollEvents();
 	}
 
@@ -205,6 +193,11 @@ int main()
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &EBO);
 
+	printStateStats();
+	releaseTexture(texture);
+	finishTextureCache();
+	finishTextureLoader();
+	finishBenchmark();
 	glfwTerminate();
 	return 0;
 
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "block_compression.h"
+#include "ktx2.h"
+#include "mip_generator.h"
+#include "texture_loader.h"
+
+//Offline texture converter: decodes an image, builds its mip chain down to 1x1 with mip_generator and
+//block compresses every level into a KTX2 file. The texture loader picks up <name>.ktx2 next to a
+//requested <name>.<ext> and uploads the blocks as they are, without decoding or generating mipmaps.
+//
+//Usage: TextureCompressor_bin <image> [bc1|bc3|bc7] [output.ktx2]
+//	the format defaults to bc1 for images without alpha and bc7 otherwise, the output to <name>.ktx2
+//
+//Environment:
+//	TEXTURE_COMPRESSOR_THREADS  encoder threads (default the core count)
+//	TEXTURE_MIP_FILTER          box, kaiser or lanczos (default box), like the texture loader
+
+//Expands 1-4 channel pixels to RGBA8, grey goes to all three color channels.
+std::vector<unsigned char> toRgba(const Image& image)
+{
+	size_t texels = (size_t)image.width * image.height;
+	std::vector<unsigned char> rgba(texels * 4);
+	for (size_t i = 0; i < texels; i++)
+	{
+		const unsigned char* source = &image.pixels[i * image.channels];
+		unsigned char* target = &rgba[i * 4];
+		bool grey = image.channels < 3;
+		target[0] = source[0];
+		target[1] = grey ? source[0] : source[1];
+		target[2] = grey ? source[0] : source[2];
+		target[3] = image.channels == 2 ? source[1] : image.channels == 4 ? source[3] : 255;
+	}
+	return rgba;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: " << argv[0] << " <image> [bc1|bc3|bc7] [output.ktx2]" << std::endl;
+		return 1;
+	}
+
+	Image image;
+	if (!loadImage(argv[1], image))
+	{
+		std::cout << "Failed to load texture " << argv[1] << std::endl;
+		return 1;
+	}
+
+	CompressedTexture texture;
+	texture.width = image.width;
+	texture.height = image.height;
+	bool alpha = image.channels == 2 || image.channels == 4;
+	texture.format = alpha ? BLOCK_BC7 : BLOCK_BC1;
+	if (argc > 2 && strcmp(argv[2], "bc1") == 0)
+		texture.format = BLOCK_BC1;
+	else if (argc > 2 && strcmp(argv[2], "bc3") == 0)
+		texture.format = BLOCK_BC3;
+	else if (argc > 2 && strcmp(argv[2], "bc7") == 0)
+		texture.format = BLOCK_BC7;
+	else if (argc > 2)
+	{
+		std::cout << "ERROR::TEXTURE_COMPRESSOR::UNKNOWN_FORMAT " << argv[2] << std::endl;
+		return 1;
+	}
+
+	std::string output = argc > 3 ? argv[3] : argv[1];
+	if (argc <= 3)
+		output = output.substr(0, output.find_last_of('.')) + ".ktx2";
+
+	const char* threadsValue = getenv("TEXTURE_COMPRESSOR_THREADS");
+	unsigned int threads = threadsValue && atoi(threadsValue) > 0 ? (unsigned int)atoi(threadsValue) :
+		std::max(std::thread::hardware_concurrency(), 1u);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<unsigned char> rgba = toRgba(image);
+	std::vector<size_t> levelOffsets;
+	appendMipLevels(rgba, image.width, image.height, 4, parseMipFilter(getenv("TEXTURE_MIP_FILTER"), MIP_FILTER_BOX),
+		true, levelOffsets);
+	double encodeMs = 0.0;
+	for (size_t level = 0; level < levelOffsets.size(); level++)
+	{
+		int width = std::max(image.width >> level, 1), height = std::max(image.height >> level, 1);
+		texture.levelOffsets.push_back(texture.data.size());
+		texture.data.resize(texture.data.size() + compressedLevelBytes(texture.format, width, height));
+		std::chrono::steady_clock::time_point encodeStart = std::chrono::steady_clock::now();
+		compressImage(texture.format, &rgba[levelOffsets[level]], width, height, &texture.data[texture.levelOffsets.back()],
+			threads);
+		encodeMs += millisecondsSince(encodeStart);
+	}
+	if (!writeKtx2(output.c_str(), texture))
+		return 1;
+
+	const char* names[] = { "BC1", "BC3", "BC7" };
+	size_t uncompressed = (size_t)image.width * image.height * image.channels;
+	std::cout << output << ": " << names[texture.format] << " " << image.width << "x" << image.height << ", "
+		<< texture.levelOffsets.size() << " levels, " << texture.data.size() / 1024 << " KiB (level 0 "
+		<< compressedLevelSize(texture, 0) / 1024 << " KiB, " << uncompressed / 1024 << " KiB uncompressed)" << std::endl;
+	std::cout << "Encoded in " << encodeMs << " ms on " << threads << " threads ("
+		<< image.width * image.height * 4.0 / 3.0 / (encodeMs * 1000.0) << " MP/s), total " << millisecondsSince(start)
+		<< " ms" << std::endl;
+	return 0;
+}
@@ -0,0 +1,173 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "texture_loader.h"
+#ifdef _WIN32
+#include <direct.h>
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//Loads a set of images through the texture loader as fast as it goes and reports the time until all of
+//them were resident and the peak resident set size of the process. Textures are deleted as soon as they
+//are resident, so the peak is the loader's working memory, not the textures. Frames are paced at 1 ms.
+//
+//Usage: TextureLoadBenchmark_bin [image] [count]
+//	writes count copies (default 1000) of image (default ../Texture/container.jpg) to TEXTURE_LOAD_DIR
+//	(default texture_set/) and loads those; they are in the page cache by then, so this measures decoding
+//	and uploading, not the disk. The copies are deleted again on exit.
+
+double peakResidentMiB()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / (1024.0 * 1024.0);  // bytes
+#else
+	return usage.ru_maxrss / 1024.0;  // KiB
+#endif
+#endif
+}
+
+//created says whether the directory was made here, and is removed again with the copies.
+bool writeCopies(const char* image, unsigned int count, const std::string& directory, std::vector<std::string>& paths,
+	bool& created)
+{
+	created = false;
+	FILE* file = fopen(image, "rb");
+	if (!file)
+		return false;
+	std::vector<char> bytes;
+	char buffer[65536];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		bytes.insert(bytes.end(), buffer, buffer + read);
+	fclose(file);
+
+#ifdef _WIN32
+	created = _mkdir(directory.c_str()) == 0;
+#else
+	created = mkdir(directory.c_str(), 0755) == 0;
+#endif
+	std::string extension = image;
+	extension = extension.substr(extension.find_last_of('.'));
+	for (unsigned int i = 0; i < count; i++)
+	{
+		paths.push_back(directory + "/" + std::to_string(i) + extension);
+		FILE* copy = fopen(paths.back().c_str(), "wb");
+		if (!copy)
+			return false;
+		fwrite(bytes.data(), 1, bytes.size(), copy);
+		fclose(copy);
+	}
+	return true;
+}
+
+void removeCopies(const std::vector<std::string>& paths, const std::string& directory, bool created)
+{
+	for (size_t i = 0; i < paths.size(); i++)
+		remove(paths[i].c_str());
+	if (created)
+#ifdef _WIN32
+		_rmdir(directory.c_str());
+#else
+		rmdir(directory.c_str());
+#endif
+}
+
+int main(int argc, char** argv)
+{
+
+	const char* image = argc > 1 ? argv[1] : "../Texture/container.jpg";
+	unsigned int count = argc > 2 && atoi(argv[2]) > 0 ? (unsigned int)atoi(argv[2]) : 1000;
+	const char* directoryValue = getenv("TEXTURE_LOAD_DIR");
+	std::string directory = directoryValue ? directoryValue : "texture_set";
+	std::vector<std::string> paths;
+	bool created;
+	if (!writeCopies(image, count, directory, paths, created))
+	{
+		std::cout << "ERROR::TEXTURE_LOAD_BENCHMARK::COPY_FAILED " << image << std::endl;
+		removeCopies(paths, directory, created);
+		return -1;
+	}
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGL", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		removeCopies(paths, directory, created);
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		removeCopies(paths, directory, created);
+		return -1;
+	}
+
+	initTextureLoader();
+	double baselineMiB = peakResidentMiB();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::set<unsigned int> loading;
+	for (unsigned int i = 0; i < count; i++)
+		loading.insert(requestTexture(paths[i].c_str()));
+
+	long long frames = 0;
+	TextureLoadStats stats = getTextureLoadStats();
+	while (stats.resident + stats.failed < count)
+	{
+		pumpTextureUploads();
+		glFlush();
+		frames++;
+		// stands in for rendering, so a spinning render thread doesn't starve the workers
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		for (std::set<unsigned int>::iterator texture = loading.begin(); texture != loading.end();)
+			if (textureResident(*texture))
+			{
+				deleteRequestedTexture(*texture);
+				texture = loading.erase(texture);
+			}
+			else
+				++texture;
+		stats = getTextureLoadStats();
+	}
+	glFinish();
+	double loadMs = millisecondsSince(start);
+
+	std::cout << count << " images, " << stats.totalBytes / (1024 * 1024) << " MiB uploaded in " << loadMs << " ms over "
+		<< frames << " frames: " << count * 1000.0 / loadMs << " images/s" << std::endl;
+	std::cout << "Peak RSS " << peakResidentMiB() << " MiB (" << baselineMiB << " MiB before loading)" << std::endl;
+
+	for (std::set<unsigned int>::iterator texture = loading.begin(); texture != loading.end(); ++texture)
+		deleteRequestedTexture(*texture);
+	finishTextureLoader();
+	removeCopies(paths, directory, created);
+	glfwTerminate();
+	return 0;
+
+}
@@ -0,0 +1,235 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "benchmark.h"
+#include "mesh_optimizer.h"
+#include "program_cache.h"
+#include "torus_mesh.h"
+#include "vertex_layout.h"
+#include "vertex_quantization.h"
+
+//Draws an indexed torus of VERTEX_GRID_SIZE x VERTEX_GRID_SIZE quads (default 1000, a million vertices with
+//position, normal and uv) with float vertices and with the quantized formats, decoded in the vertex shader:
+//	float       tolerance 0, everything stays float (32 bytes)
+//	default     defaultVertexTolerance, unorm16 positions, snorm10 normals, half uvs (16 bytes)
+//	octahedral  normals within 0.05 degrees, which takes octahedral snorm16 (16 bytes)
+//Prints bytes per vertex, the vertex stage time with rasterization disabled (VERTEX_DRAWS draws, default 10)
+//and how many pixels of a normal/uv shaded frame differ from the float one by more than 2/255, the silhouette
+//moving by a fraction of a pixel included. Then the float torus once interleaved and once split into a stream per
+//attribute, timed with a shader reading every attribute and with one reading positions only.
+
+struct TorusVertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 texCoord;
+};
+
+constexpr auto torusVertexLayout = makeVertexLayout<TorusVertex>(
+	VERTEX_ATTRIBUTE(TorusVertex, position, 0),
+	VERTEX_ATTRIBUTE(TorusVertex, normal, 1),
+	VERTEX_ATTRIBUTE(TorusVertex, texCoord, 2));
+
+const char* vertexShaderSource =
+"#version 330 core\n"
+VERTEX_DECODE_GLSL
+"layout(location = 0) in vec3 aPos;\n"
+"layout(location = 1) in vec4 aNormal;\n"
+"layout(location = 2) in vec2 aTexCoord;\n"
+"out vec3 Normal;\n"
+"out vec2 TexCoord;\n"
+"uniform mat4 viewProj;\n"
+"void main()\n"
+"{\n"
+"	Normal = decodeNormal(aNormal);\n"
+"	TexCoord = aTexCoord;\n"
+"	gl_Position = viewProj * vec4(decodePosition(aPos), 1.0);\n"
+"}\n";
+
+const char* positionShaderSource =
+"#version 330 core\n"
+"layout(location = 0) in vec3 aPos;\n"
+"uniform mat4 viewProj;\n"
+"void main()\n"
+"{\n"
+"	gl_Position = viewProj * vec4(aPos, 1.0);\n"
+"}\n";
+
+const char* fragmentShaderSource =
+"#version 330 core\n"
+"out vec4 FragColor;\n"
+"in vec3 Normal;\n"
+"in vec2 TexCoord;\n"
+"void main()\n"
+"{\n"
+"	FragColor = vec4(normalize(Normal) * 0.5 + 0.5, TexCoord.x);\n"
+"}\n";
+
+void drawMesh(const IndexedMesh& mesh)
+{
+	glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indexCount, mesh.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, 0);
+}
+
+glm::mat4 viewProjection()
+{
+	return glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f) *
+		glm::lookAt(glm::vec3(0.0f, 2.0f, 2.5f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+//ms per draw of the bound VAO and program, keeping primitive setup and fragment work out of the measurement.
+//The first draw uploads.
+double timeVertexStage(const IndexedMesh& mesh, unsigned int draws)
+{
+	glEnable(GL_RASTERIZER_DISCARD);
+	drawMesh(mesh);
+	glFinish();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < draws; i++)
+		drawMesh(mesh);
+	glFinish();
+	double milliseconds = millisecondsSince(start) / draws;
+	glDisable(GL_RASTERIZER_DISCARD);
+	return milliseconds;
+}
+
+//Vertex stage time in ms per draw, and the shaded frame.
+double measure(unsigned int program, const IndexedMesh& mesh, const QuantizedVertices& vertices, unsigned int draws,
+	std::vector<unsigned char>& frame)
+{
+	unsigned int VAO, VBO, EBO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.data.size(), vertices.data.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size(), mesh.indices.data(), GL_STATIC_DRAW);
+	setQuantizedAttributes(vertices, 0, 1, 2);
+	glUseProgram(program);
+	setVertexDecodeUniforms(program, vertices);
+	glUniformMatrix4fv(glGetUniformLocation(program, "viewProj"), 1, GL_FALSE, glm::value_ptr(viewProjection()));
+	double milliseconds = timeVertexStage(mesh, draws);
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	drawMesh(mesh);
+	frame.resize(800 * 600 * 4);
+	glReadPixels(0, 0, 800, 600, GL_RGBA, GL_UNSIGNED_BYTE, frame.data());
+
+	glBindVertexArray(0);
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	return milliseconds;
+}
+
+void compareStreams(unsigned int program, unsigned int positionProgram, const IndexedMesh& mesh, unsigned int draws)
+{
+	const char* names[2] = { "interleaved", "split" };
+	const VertexStreams streams[2] = { VERTEX_INTERLEAVED, VERTEX_SPLIT };
+	size_t vertexCount = mesh.vertices.size() / 8;
+	for (int i = 0; i < 2; i++)
+	{
+		unsigned int VAO, VBO, EBO;
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		uploadVertices(torusVertexLayout, mesh.vertices.data(), mesh.vertices.size() * sizeof(float), streams[i], GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size(), mesh.indices.data(), GL_STATIC_DRAW);
+
+		// float vertices decode to themselves
+		glUseProgram(program);
+		setVertexDecodeUniforms(program, glm::vec3(0.0f), glm::vec3(1.0f), false);
+		glUniformMatrix4fv(glGetUniformLocation(program, "viewProj"), 1, GL_FALSE, glm::value_ptr(viewProjection()));
+		double all = timeVertexStage(mesh, draws);
+		glUseProgram(positionProgram);
+		glUniformMatrix4fv(glGetUniformLocation(positionProgram, "viewProj"), 1, GL_FALSE, glm::value_ptr(viewProjection()));
+		double positions = timeVertexStage(mesh, draws);
+
+		std::cout << "Streams " << names[i] << ": all attributes " << all << " ms/draw ("
+			<< vertexCount / all / 1000.0 << " Mvertices/s), positions only " << positions << " ms/draw ("
+			<< vertexCount / positions / 1000.0 << " Mvertices/s)" << std::endl;
+
+		glBindVertexArray(0);
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+	}
+}
+
+int main()
+{
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGL", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	unsigned int program = 0, positionProgram = 0;
+	createCachedShaderProgram(vertexShaderSource, fragmentShaderSource, program);
+	createCachedShaderProgram(positionShaderSource, fragmentShaderSource, positionProgram);
+	glEnable(GL_DEPTH_TEST);
+
+	unsigned int size = readCount("VERTEX_GRID_SIZE", 1000);
+	unsigned int draws = readCount("VERTEX_DRAWS", 10);
+	std::vector<float> triangles = makeTorus(size);
+	IndexedMesh mesh;
+	buildIndexedMesh(triangles.data(), triangles.size() / 8, 8, mesh);
+	size_t vertexCount = mesh.vertices.size() / 8;
+	FloatVertexLayout layout = { 8, 0, 3, 6 };
+	std::cout << "Torus " << size << "x" << size << ": " << vertexCount << " vertices, " << mesh.indexCount / 3
+		<< " triangles (" << glGetString(GL_RENDERER) << ")" << std::endl;
+
+	const char* names[3] = { "float", "default", "octahedral" };
+	VertexTolerance tolerances[3] = { { 0.0f, 0.0f, 0.0f }, defaultVertexTolerance, defaultVertexTolerance };
+	tolerances[2].normalDegrees = 0.05f;
+	std::vector<unsigned char> reference, frame;
+	for (int i = 0; i < 3; i++)
+	{
+		QuantizedVertices vertices;
+		quantizeVertices(mesh.vertices.data(), vertexCount, layout, tolerances[i], vertices);
+		double milliseconds = measure(program, mesh, vertices, draws, i == 0 ? reference : frame);
+		size_t differing = 0;
+		for (size_t j = 0; i > 0 && j < frame.size(); j += 4)
+			for (size_t channel = j; channel < j + 4; channel++)
+				if (abs((int)frame[channel] - (int)reference[channel]) > 2)
+				{
+					differing++;
+					break;
+				}
+		printQuantizedVertexStats(names[i], vertices, layout);
+		std::cout << "  " << vertices.data.size() / (1024.0 * 1024.0) << " MiB, vertex stage " << milliseconds
+			<< " ms/draw (" << vertexCount / milliseconds / 1000.0 << " Mvertices/s), "
+			<< 100.0 * differing / (800 * 600) << "% of the pixels differ from float" << std::endl;
+	}
+	compareStreams(program, positionProgram, mesh, draws);
+
+	glfwTerminate();
+	return 0;
+
+}
@@ -1,6 +1,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include "benchmark.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
@@ -35,11 +36,14 @@ int main()
 		return -1;
 	}
 
+	initBenchmark("WindowCreation");
+
 	glViewport(0, 0, 800, 600);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
 	while (!glfwWindowShouldClose(window))
 	{
+		beginBenchmarkFrame();
 
 		processInput(window);
 
@@ -47,10 +51,12 @@ int main()
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		glfwSwapBuffers(window);
+		endBenchmarkFrame(window);
 		glfwPollEvents();
 	}
 
 
+	finishBenchmark();
 	glfwTerminate();
 	return 0;
 